@@ -47,12 +47,14 @@
 #include <cstdio>
 #include <cstring>
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "gromacs/analysisdata/dataframe.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/xvgbinary.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/options/basicoptions.h"
@@ -73,7 +75,10 @@ namespace gmx
  */
 
 AnalysisDataPlotSettings::AnalysisDataPlotSettings() :
-    selections_(nullptr), timeUnit_(TimeUnit::Default), plotFormat_(XvgFormat::Xmgrace)
+    selections_(nullptr),
+    timeUnit_(TimeUnit::Default),
+    plotFormat_(XvgFormat::Xmgrace),
+    fileFormat_(PlotFileFormat::Text)
 {
 }
 
@@ -91,10 +96,19 @@ const gmx::EnumerationArray<XvgFormat, const char*> c_xvgFormatNames = {
     { "xmgrace", "xmgr", "none" }
 };
 
+//! Names for PlotFileFormat
+const gmx::EnumerationArray<PlotFileFormat, const char*> c_plotFileFormatNames = {
+    { "text", "binary", "compressed" }
+};
+
 void AnalysisDataPlotSettings::initOptions(IOptionsContainer* options)
 {
     options->addOption(
             EnumOption<XvgFormat>("xvg").enumValue(c_xvgFormatNames).store(&plotFormat_).description("Plot formatting"));
+    options->addOption(EnumOption<PlotFileFormat>("datafmt")
+                               .enumValue(c_plotFileFormatNames)
+                               .store(&fileFormat_)
+                               .description("Data file format"));
 }
 
 
@@ -113,6 +127,8 @@ public:
     AnalysisDataPlotSettings settings_;
     std::string              filename_;
     FILE*                    fp_;
+    //! Writer for binary output, used instead of fp_
+    std::unique_ptr<XvgBinaryWriter> binaryWriter_;
 
     bool                     bPlain_;
     bool                     bOmitX_;
@@ -147,6 +163,11 @@ AbstractPlotModule::Impl::~Impl()
 
 void AbstractPlotModule::Impl::closeFile()
 {
+    if (binaryWriter_)
+    {
+        binaryWriter_->close();
+        binaryWriter_.reset();
+    }
     if (fp_ != nullptr)
     {
         if (bPlain_)
@@ -300,7 +321,20 @@ void AbstractPlotModule::dataStarted(AbstractAnalysisData* /* data */)
 {
     if (!impl_->filename_.empty())
     {
-        if (impl_->bPlain_)
+        if (impl_->settings_.fileFormat() != PlotFileFormat::Text)
+        {
+            XvgBinaryHeader header;
+            header.title    = impl_->title_;
+            header.subtitle = impl_->subtitle_;
+            header.xLabel   = impl_->xlabel_;
+            header.yLabel   = impl_->ylabel_;
+            header.legends  = impl_->legend_;
+            impl_->binaryWriter_ = std::make_unique<XvgBinaryWriter>(
+                    impl_->filename_,
+                    header,
+                    impl_->settings_.fileFormat() == PlotFileFormat::CompressedBinary);
+        }
+        else if (impl_->bPlain_)
         {
             impl_->fp_ = gmx_fio_fopen(impl_->filename_.c_str(), "w");
         }
@@ -345,7 +379,14 @@ void AbstractPlotModule::frameStarted(const AnalysisDataFrameHeader& header)
     }
     if (!impl_->bOmitX_)
     {
-        std::fprintf(impl_->fp_, impl_->xformat_.c_str(), header.x() * impl_->xscale_);
+        if (impl_->binaryWriter_)
+        {
+            impl_->binaryWriter_->addValue(header.x() * impl_->xscale_);
+        }
+        else
+        {
+            std::fprintf(impl_->fp_, impl_->xformat_.c_str(), header.x() * impl_->xscale_);
+        }
     }
 }
 
@@ -356,7 +397,14 @@ void AbstractPlotModule::frameFinished(const AnalysisDataFrameHeader& /*header*/
     {
         return;
     }
-    std::fprintf(impl_->fp_, "\n");
+    if (impl_->binaryWriter_)
+    {
+        impl_->binaryWriter_->finishRow();
+    }
+    else
+    {
+        std::fprintf(impl_->fp_, "\n");
+    }
 }
 
 
@@ -368,7 +416,7 @@ void AbstractPlotModule::dataFinished()
 /*! \cond libapi */
 bool AbstractPlotModule::isFileOpen() const
 {
-    return impl_->fp_ != nullptr;
+    return impl_->fp_ != nullptr || impl_->binaryWriter_ != nullptr;
 }
 
 
@@ -376,6 +424,15 @@ void AbstractPlotModule::writeValue(const AnalysisDataValue& value) const
 {
     GMX_ASSERT(isFileOpen(), "File not opened, but write attempted");
     const real y = value.isSet() ? value.value() : 0.0;
+    if (impl_->binaryWriter_)
+    {
+        impl_->binaryWriter_->addValue(y);
+        if (impl_->bErrorsAsSeparateColumn_)
+        {
+            impl_->binaryWriter_->addValue(value.isSet() ? value.error() : 0.0);
+        }
+        return;
+    }
     std::fprintf(impl_->fp_, impl_->yformat_.c_str(), y);
     if (impl_->bErrorsAsSeparateColumn_)
     {
@@ -59,6 +59,24 @@ class AnalysisDataValue;
 class IOptionsContainer;
 class SelectionCollection;
 
+/*! \brief
+ * File formats for writing data plots.
+ *
+ * \inpublicapi
+ * \ingroup module_analysisdata
+ */
+enum class PlotFileFormat : int
+{
+    //! Text, with xvgr codes according to the plot format.
+    Text,
+    //! Binary columns, see XvgBinaryWriter.
+    Binary,
+    //! Binary columns with lossless compression.
+    CompressedBinary,
+    //! Number of file formats.
+    Count
+};
+
 /*! \brief
  * Common settings for data plots.
  *
@@ -79,6 +97,10 @@ public:
      * Returns the plot format.
      */
     XvgFormat plotFormat() const { return plotFormat_; }
+    /*! \brief
+     * Returns the file format.
+     */
+    PlotFileFormat fileFormat() const { return fileFormat_; }
 
     /*! \brief
      * Set selection collection to print as comments into the output.
@@ -111,6 +133,7 @@ private:
     const SelectionCollection* selections_;
     TimeUnit                   timeUnit_;
     XvgFormat                  plotFormat_;
+    PlotFileFormat             fileFormat_;
 };
 
 /*! \brief
@@ -123,6 +146,10 @@ private:
  * By default, the data is written into an xvgr file, according to the
  * options read from the AnalysisDataPlotSettings object given to the
  * constructor.
+ * When the settings select a binary file format, the title, labels and
+ * legends are stored as metadata and the values as binary columns, which
+ * avoids formatting the values as text; read_xvg() and related functions
+ * read such files.
  * For non-xvgr data, it's possible to skip all headers by calling
  * setPlainOutput().
  *
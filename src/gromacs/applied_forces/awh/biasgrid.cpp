@@ -671,9 +671,6 @@ namespace
  */
 void setNeighborsOfGridPoint(int pointIndex, const BiasGrid& grid, std::vector<int>* neighborIndexArray)
 {
-    const int c_maxNeighborsAlongAxis =
-            1 + 2 * static_cast<int>(BiasGrid::c_numPointsPerSigma * BiasGrid::c_scopeCutoff);
-
     awh_ivec numCandidates = { 0 };
     awh_ivec subgridOrigin = { 0 };
     for (int d = 0; d < grid.numDimensions(); d++)
@@ -687,7 +684,8 @@ void setNeighborsOfGridPoint(int pointIndex, const BiasGrid& grid, std::vector<i
         else
         {
             /* The number of candidate points along this dimension is given by the scope cutoff. */
-            numCandidates[d] = std::min(c_maxNeighborsAlongAxis, grid.axis(d).numPoints());
+            numCandidates[d] =
+                    std::min(BiasGrid::c_maxNeighborsAlongAxis, grid.axis(d).numPoints());
 
             /* The origin of the subgrid to search */
             int centerIndex  = grid.point(pointIndex).index[d];
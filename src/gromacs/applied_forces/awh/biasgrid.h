@@ -193,6 +193,10 @@ public:
     //! Cut-off in sigma for considering points, neglects 4e-8 of the density.
     static constexpr double c_scopeCutoff = 5.5;
 
+    //! The maximum number of neighbors along a non-lambda axis, centered on the point
+    static constexpr int c_maxNeighborsAlongAxis =
+            1 + 2 * static_cast<int>(c_numPointsPerSigma * c_scopeCutoff);
+
     /*! \brief Construct a grid using AWH input parameters.
      *
      * \param[in] dimParams     Dimension parameters including the expected inverse variance of the
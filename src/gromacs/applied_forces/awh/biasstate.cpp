@@ -61,6 +61,7 @@
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/math/units.h"
 #include "gromacs/math/utilities.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdrunutility/multisim.h"
 #include "gromacs/mdtypes/awh_history.h"
 #include "gromacs/mdtypes/awh_params.h"
@@ -96,6 +97,21 @@ void BiasState::getPmf(gmx::ArrayRef<float> pmf) const
 namespace
 {
 
+//! The minimum number of grid points per thread for loops over points
+constexpr int c_minNumPointsPerThread = 256;
+
+/*! \brief Returns the number of OpenMP threads to use for a loop over \p numPoints grid points
+ *
+ * Most AWH grids are small, so we only use multiple threads when each thread
+ * gets enough points to amortize the cost of the parallel region.
+ */
+int numThreadsForPointLoop(int numPoints)
+{
+    const int maxNumThreads = std::max(1, gmx_omp_nthreads_get(ModuleMultiThread::Default));
+
+    return std::clamp(numPoints / c_minNumPointsPerThread, 1, maxNumThreads);
+}
+
 /*! \brief
  * Sum PMF over multiple simulations, when requested.
  *
@@ -159,65 +175,137 @@ double freeEnergyMinimumValue(gmx::ArrayRef<const PointState> pointState)
 }
 
 /*! \brief
- * Find and return the log of the probability weight of a point given a coordinate value.
+ * The log of the umbrella weights along each grid axis for a coordinate value.
  *
- * The unnormalized weight is given by
+ * The unnormalized probability weight of a point given a coordinate value is
  * w(point|value) = exp(bias(point) - U(value,point)),
  * where U is a harmonic umbrella potential.
  *
- * \param[in] dimParams              The bias dimensions parameters
- * \param[in] points                 The point state.
- * \param[in] grid                   The grid.
- * \param[in] pointIndex             Point to evaluate probability weight for.
- * \param[in] pointBias              Bias for the point (as a log weight).
- * \param[in] value                  Coordinate value.
- * \param[in] neighborLambdaEnergies The energy of the system in neighboring lambdas states. Can be
- * empty when there are no free energy lambda state dimensions.
- * \param[in] gridpointIndex         The index of the current grid point.
- * \returns the log of the biased probability weight.
+ * The umbrella potential is a sum of terms that each depend on one dimension only.
+ * The log weight of a neighbor is thus the bias of the neighbor plus a sum of terms
+ * that only depend on the index of the neighbor along each axis. Tabulating these
+ * terms for the at most BiasGrid::c_maxNeighborsAlongAxis indices along each axis
+ * replaces the evaluation of the deviation for each neighbor and dimension by
+ * table lookups, which matters for multidimensional grids where the number of
+ * neighbors grows exponentially with the number of dimensions.
  */
-double biasedLogWeightFromPoint(ArrayRef<const DimParams>  dimParams,
-                                ArrayRef<const PointState> points,
-                                const BiasGrid&            grid,
-                                int                        pointIndex,
-                                double                     pointBias,
-                                const awh_dvec             value,
-                                ArrayRef<const double>     neighborLambdaEnergies,
-                                int                        gridpointIndex)
+class UmbrellaLogWeights
 {
-    double logWeight = detail::c_largeNegativeExponent;
-
-    /* Only points in the target region have non-zero weight */
-    if (points[pointIndex].inTargetRegion())
-    {
-        logWeight = pointBias;
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] dimParams              The bias dimensions parameters
+     * \param[in] grid                   The grid.
+     * \param[in] gridpointIndex         The point whose neighbors will be evaluated.
+     * \param[in] value                  Coordinate value.
+     * \param[in] neighborLambdaEnergies The energy of the system in neighboring lambdas states.
+     * Can be empty, then no weights are applied along lambda axes.
+     */
+    UmbrellaLogWeights(ArrayRef<const DimParams> dimParams,
+                       const BiasGrid&           grid,
+                       int                       gridpointIndex,
+                       const awh_dvec            value,
+                       ArrayRef<const double>    neighborLambdaEnergies) :
+        numDimensions_(dimParams.size())
+    {
+        int numAxisPoints = 0;
+        for (int d = 0; d < numDimensions_; d++)
+        {
+            axisOffset_[d] = numAxisPoints;
+            numAxisPoints += grid.axis(d).numPoints();
+        }
+        logWeights_.resize(numAxisPoints, 0);
 
-        /* Add potential for all parameter dimensions */
-        for (size_t d = 0; d < dimParams.size(); d++)
+        const GridPoint& gridpoint = grid.point(gridpointIndex);
+        for (int d = 0; d < numDimensions_; d++)
         {
+            const GridAxis& axis           = grid.axis(d);
+            double*         axisLogWeights = logWeights_.data() + axisOffset_[d];
+
+            /* The point at each index along this axis, with index 0 along the other axes */
+            awh_ivec indexMulti   = { 0 };
+            auto     pointAtIndex = [&](int index) {
+                indexMulti[d] = index;
+                return multiDimGridIndexToLinear(grid, indexMulti);
+            };
+
             if (dimParams[d].isFepLambdaDimension())
             {
-                /* If this is not a sampling step or if this function is called from
-                 * calcConvolvedBias(), when writing energy subblocks, neighborLambdaEnergies will
-                 * be empty. No convolution is required along the lambda dimension. */
+                /* All points along a lambda axis are neighbors */
                 if (!neighborLambdaEnergies.empty())
                 {
-                    const int pointLambdaIndex     = grid.point(pointIndex).coordValue[d];
-                    const int gridpointLambdaIndex = grid.point(gridpointIndex).coordValue[d];
-                    logWeight -= dimParams[d].fepDimParams().beta
-                                 * (neighborLambdaEnergies[pointLambdaIndex]
-                                    - neighborLambdaEnergies[gridpointLambdaIndex]);
+                    const int gridpointLambdaIndex = gridpoint.coordValue[d];
+                    for (int i = 0; i < axis.numPoints(); i++)
+                    {
+                        const int pointLambdaIndex = grid.point(pointAtIndex(i)).coordValue[d];
+                        axisLogWeights[i] = -(dimParams[d].fepDimParams().beta
+                                              * (neighborLambdaEnergies[pointLambdaIndex]
+                                                 - neighborLambdaEnergies[gridpointLambdaIndex]));
+                    }
                 }
             }
             else
             {
-                double dev = getDeviationFromPointAlongGridAxis(grid, d, pointIndex, value[d]);
-                logWeight -= 0.5 * dimParams[d].pullDimParams().betak * dev * dev;
+                /* Cover the neighbor scope around the point, wrapping periodic axes.
+                 * For simplicity we may cover a few more indices than needed.
+                 */
+                const int    halfScope = BiasGrid::c_maxNeighborsAlongAxis / 2;
+                const int    period    = axis.numPointsInPeriod();
+                const double betak     = dimParams[d].pullDimParams().betak;
+                for (int i = gridpoint.index[d] - halfScope; i <= gridpoint.index[d] + halfScope;
+                     i++)
+                {
+                    int index = i;
+                    if (axis.isPeriodic())
+                    {
+                        index = ((index % period) + period) % period;
+                    }
+                    if (index >= 0 && index < axis.numPoints())
+                    {
+                        const double dev = getDeviationFromPointAlongGridAxis(
+                                grid, d, pointAtIndex(index), value[d]);
+                        axisLogWeights[index] = -0.5 * betak * dev * dev;
+                    }
+                }
             }
         }
     }
-    return logWeight;
-}
+
+    /*! \brief Returns the log of the biased probability weight of a neighbor
+     *
+     * \param[in] points     The point state.
+     * \param[in] grid       The grid.
+     * \param[in] pointIndex The neighbor to evaluate the weight for.
+     * \param[in] pointBias  Bias for the point (as a log weight).
+     */
+    double biasedLogWeight(ArrayRef<const PointState> points,
+                           const BiasGrid&            grid,
+                           int                        pointIndex,
+                           double                     pointBias) const
+    {
+        /* Only points in the target region have non-zero weight */
+        if (!points[pointIndex].inTargetRegion())
+        {
+            return detail::c_largeNegativeExponent;
+        }
+
+        const awh_ivec& index     = grid.point(pointIndex).index;
+        double          logWeight = pointBias;
+        for (int d = 0; d < numDimensions_; d++)
+        {
+            logWeight += logWeights_[axisOffset_[d] + index[d]];
+        }
+        return logWeight;
+    }
+
+private:
+    //! The number of dimensions
+    int numDimensions_;
+    //! The offset of the weights of each axis in logWeights_
+    awh_ivec axisOffset_ = { 0 };
+    //! The log weights for all points along all axes, only the neighbor scope is set
+    std::vector<double> logWeights_;
+};
 
 /*! \brief
  * Calculates the marginal distribution (marginal probability) for each value along
@@ -265,31 +353,43 @@ void BiasState::calcConvolvedPmf(ArrayRef<const DimParams> dimParams,
     std::vector<float> pmf(numPoints);
     getPmf(pmf);
 
-    for (size_t m = 0; m < numPoints; m++)
+    /* The points are independent, so we can use threads */
+    const int numThreads = numThreadsForPointLoop(numPoints);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int m = 0; m < static_cast<int>(numPoints); m++)
     {
-        double           freeEnergyWeights = 0;
-        const GridPoint& point             = grid.point(m);
-        for (const auto& neighbor : point.neighbor)
+        try
         {
-            /* Do not convolve the bias along a lambda axis - only use the pmf from the current point */
-            if (!pointsHaveDifferentLambda(grid, m, neighbor))
+            double           freeEnergyWeights = 0;
+            const GridPoint& point             = grid.point(m);
+
+            const UmbrellaLogWeights umbrellaLogWeights(dimParams, grid, m, point.coordValue, {});
+
+            for (const auto& neighbor : point.neighbor)
             {
-                /* The negative PMF is a positive bias. */
-                double biasNeighbor = -pmf[neighbor];
-
-                /* Add the convolved PMF weights for the neighbors of this point.
-                Note that this function only adds point within the target > 0 region.
-                Sum weights, take the logarithm last to get the free energy. */
-                double logWeight = biasedLogWeightFromPoint(
-                        dimParams, points_, grid, neighbor, biasNeighbor, point.coordValue, {}, m);
-                freeEnergyWeights += std::exp(logWeight);
+                /* Do not convolve the bias along a lambda axis,
+                 * only use the pmf from the current point.
+                 */
+                if (!pointsHaveDifferentLambda(grid, m, neighbor))
+                {
+                    /* The negative PMF is a positive bias. */
+                    double biasNeighbor = -pmf[neighbor];
+
+                    /* Add the convolved PMF weights for the neighbors of this point.
+                    Note that this function only adds point within the target > 0 region.
+                    Sum weights, take the logarithm last to get the free energy. */
+                    double logWeight = umbrellaLogWeights.biasedLogWeight(
+                            points_, grid, neighbor, biasNeighbor);
+                    freeEnergyWeights += std::exp(logWeight);
+                }
             }
-        }
 
-        GMX_RELEASE_ASSERT(freeEnergyWeights > 0,
-                           "Attempting to do log(<= 0) in AWH convolved PMF calculation.");
-        // We should cast to float after taking the logarithm to avoid underflows
-        (*convolvedPmf)[m] = static_cast<float>(-std::log(freeEnergyWeights));
+            GMX_RELEASE_ASSERT(freeEnergyWeights > 0,
+                               "Attempting to do log(<= 0) in AWH convolved PMF calculation.");
+            // We should cast to float after taking the logarithm to avoid underflows
+            (*convolvedPmf)[m] = static_cast<float>(-std::log(freeEnergyWeights));
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 }
 
@@ -1163,21 +1263,34 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(ArrayRef<const DimParam
     setHistogramUpdateScaleFactors(
             params, newHistogramSize, histogramSize_.histogramSize(), &weightHistScalingNew, &logPmfsumScalingNew);
 
-    /* Update free energy and reference weight histogram for points in the update list. */
-    for (int pointIndex : *updateList)
+    /* Update free energy and reference weight histogram for points in the update list.
+     * The points are updated independently, so we can use threads.
+     */
+    const int numUpdatePoints = updateList->size();
+    const int numThreads      = numThreadsForPointLoop(numUpdatePoints);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numUpdatePoints; i++)
     {
-        PointState* pointStateToUpdate = &points_[pointIndex];
-
-        /* Do updates from previous update steps that were skipped because this point was at that time non-local. */
-        if (params.skipUpdates())
+        try
         {
-            pointStateToUpdate->performPreviouslySkippedUpdates(
-                    params, histogramSize_.numUpdates(), weightHistScalingSkipped, logPmfsumScalingSkipped);
-        }
+            PointState* pointStateToUpdate = &points_[(*updateList)[i]];
 
-        /* Now do an update with new sampling data. */
-        pointStateToUpdate->updateWithNewSampling(
-                params, histogramSize_.numUpdates(), weightHistScalingNew, logPmfsumScalingNew);
+            /* Do updates from previous update steps that were skipped
+             * because this point was at that time non-local.
+             */
+            if (params.skipUpdates())
+            {
+                pointStateToUpdate->performPreviouslySkippedUpdates(params,
+                                                                    histogramSize_.numUpdates(),
+                                                                    weightHistScalingSkipped,
+                                                                    logPmfsumScalingSkipped);
+            }
+
+            /* Now do an update with new sampling data. */
+            pointStateToUpdate->updateWithNewSampling(
+                    params, histogramSize_.numUpdates(), weightHistScalingNew, logPmfsumScalingNew);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
     /* Only update the histogram size after we are done with the local point updates */
@@ -1196,9 +1309,10 @@ void BiasState::updateFreeEnergyAndAddSamplesToHistogram(ArrayRef<const DimParam
 
     /* Update the bias. The bias is updated separately and last since it simply a function of
        the free energy and the target distribution and we want to avoid doing extra work. */
-    for (int pointIndex : *updateList)
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numUpdatePoints; i++)
     {
-        points_[pointIndex].updateBias();
+        points_[(*updateList)[i]].updateBias();
     }
 
     /* Increase the update counter. */
@@ -1211,7 +1325,8 @@ double BiasState::updateProbabilityWeightsAndConvolvedBias(ArrayRef<const DimPar
                                                            std::vector<double, AlignedAllocator<double>>* weight) const
 {
     /* Only neighbors of the current coordinate value will have a non-negligible chance of getting sampled */
-    const std::vector<int>& neighbors = grid.point(coordState_.gridpointIndex()).neighbor;
+    const int               gridpointIndex = coordState_.gridpointIndex();
+    const std::vector<int>& neighbors      = grid.point(gridpointIndex).neighbor;
 
 #if GMX_SIMD_HAVE_DOUBLE
     typedef SimdDouble PackType;
@@ -1224,37 +1339,54 @@ double BiasState::updateProbabilityWeightsAndConvolvedBias(ArrayRef<const DimPar
     const int weightSize = ((neighbors.size() + packSize - 1) / packSize) * packSize;
     weight->resize(weightSize);
 
+    const UmbrellaLogWeights umbrellaLogWeights(
+            dimParams, grid, gridpointIndex, coordState_.coordValue(), neighborLambdaEnergies);
+
+    /* With multidimensional grids there can be many thousands of neighbors. We sum the weights
+     * in blocks of fixed size, distributed over threads, and sum the block sums in order.
+     * This gives results that are independent of the number of threads.
+     */
+    constexpr int c_blockSize = 256;
+    static_assert(c_blockSize % packSize == 0, "The block size should be a multiple of packSize");
+    const int           numBlocks = (weightSize + c_blockSize - 1) / c_blockSize;
+    std::vector<double> blockWeightSum(numBlocks);
+
     double* gmx_restrict weightData = weight->data();
-    PackType             weightSumPack(0.0);
-    for (size_t i = 0; i < neighbors.size(); i += packSize)
+    const int            numThreads = numThreadsForPointLoop(neighbors.size());
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int block = 0; block < numBlocks; block++)
     {
-        for (size_t n = i; n < i + packSize; n++)
+        const int blockEnd = std::min((block + 1) * c_blockSize, weightSize);
+        PackType  weightSumPack(0.0);
+        for (int i = block * c_blockSize; i < blockEnd; i += packSize)
         {
-            if (n < neighbors.size())
-            {
-                const int neighbor = neighbors[n];
-                (*weight)[n]       = biasedLogWeightFromPoint(dimParams,
-                                                        points_,
-                                                        grid,
-                                                        neighbor,
-                                                        points_[neighbor].bias(),
-                                                        coordState_.coordValue(),
-                                                        neighborLambdaEnergies,
-                                                        coordState_.gridpointIndex());
-            }
-            else
+            for (int n = i; n < i + packSize; n++)
             {
-                /* Pad with values that don't affect the result */
-                (*weight)[n] = detail::c_largeNegativeExponent;
+                if (n < static_cast<int>(neighbors.size()))
+                {
+                    const int neighbor = neighbors[n];
+                    weightData[n]      = umbrellaLogWeights.biasedLogWeight(
+                            points_, grid, neighbor, points_[neighbor].bias());
+                }
+                else
+                {
+                    /* Pad with values that don't affect the result */
+                    weightData[n] = detail::c_largeNegativeExponent;
+                }
             }
+            PackType weightPack = load<PackType>(weightData + i);
+            weightPack          = gmx::exp(weightPack);
+            weightSumPack       = weightSumPack + weightPack;
+            store(weightData + i, weightPack);
         }
-        PackType weightPack = load<PackType>(weightData + i);
-        weightPack          = gmx::exp(weightPack);
-        weightSumPack       = weightSumPack + weightPack;
-        store(weightData + i, weightPack);
+        blockWeightSum[block] = reduce(weightSumPack);
     }
     /* Sum of probability weights */
-    double weightSum = reduce(weightSumPack);
+    double weightSum = 0;
+    for (double blockSum : blockWeightSum)
+    {
+        weightSum += blockSum;
+    }
     GMX_RELEASE_ASSERT(weightSum > 0,
                        "zero probability weight when updating AWH probability weights.");
 
@@ -1303,6 +1435,8 @@ double BiasState::calcConvolvedBias(ArrayRef<const DimParams> dimParams,
     int              point     = grid.nearestIndex(coordValue);
     const GridPoint& gridPoint = grid.point(point);
 
+    const UmbrellaLogWeights umbrellaLogWeights(dimParams, grid, point, coordValue, {});
+
     /* Sum the probability weights from the neighborhood of the given point */
     double weightSum = 0;
     for (int neighbor : gridPoint.neighbor)
@@ -1312,8 +1446,8 @@ double BiasState::calcConvolvedBias(ArrayRef<const DimParams> dimParams,
         {
             continue;
         }
-        double logWeight = biasedLogWeightFromPoint(
-                dimParams, points_, grid, neighbor, points_[neighbor].bias(), coordValue, {}, point);
+        double logWeight = umbrellaLogWeights.biasedLogWeight(
+                points_, grid, neighbor, points_[neighbor].bias());
         weightSum += std::exp(logWeight);
     }
 
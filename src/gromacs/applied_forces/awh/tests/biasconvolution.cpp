@@ -0,0 +1,264 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/applied_forces/awh/bias.h"
+#include "gromacs/applied_forces/awh/biasgrid.h"
+#include "gromacs/applied_forces/awh/correlationgrid.h"
+#include "gromacs/applied_forces/awh/pointstate.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdtypes/awh_params.h"
+#include "gromacs/utility/inmemoryserializer.h"
+
+#include "gromacs/applied_forces/awh/tests/awh_setup.h"
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+/*! \brief Sets up a multidimensional bias, the first dimension is periodic
+ *
+ * With beta=0.4 and a force constant of 1000, there are about 20 points
+ * per unit of \p length along each axis and 11 neighbors along each axis.
+ */
+class MultiDimBias
+{
+public:
+    MultiDimBias(int numDim, double length) : length_(length)
+    {
+        std::vector<std::vector<char>> awhDimParameters;
+        for (int d = 0; d < numDim; d++)
+        {
+            const double origin = (d == 0 ? -0.5 * length : 0.5);
+            const double end    = origin + length;
+            const double period = (d == 0 ? length : 0);
+            awhDimParameters.emplace_back(awhDimParamSerialized(
+                    AwhCoordinateProviderType::Pull, d, origin, end, period, 0.1));
+        }
+        params_ = std::make_unique<AwhTestParameters>(
+                getAwhTestParameters(AwhHistogramGrowthType::Linear,
+                                     AwhPotentialType::Convolved,
+                                     awhDimParameters,
+                                     false,
+                                     c_beta,
+                                     false,
+                                     0.5,
+                                     0));
+
+        const AwhBiasParams& awhBiasParams = params_->awhParams.awhBiasParams()[0];
+        for (int d = 0; d < numDim; d++)
+        {
+            dimParams_.push_back(DimParams::pullDimParams(1, c_forceConstant, c_beta));
+        }
+        grid_ = std::make_unique<BiasGrid>(dimParams_, awhBiasParams.dimParams());
+        bias_ = std::make_unique<Bias>(-1,
+                                       params_->awhParams,
+                                       awhBiasParams,
+                                       dimParams_,
+                                       c_beta,
+                                       0.1,
+                                       nullptr,
+                                       "",
+                                       Bias::ThisRankWillDoIO::No,
+                                       BiasParams::DisableUpdateSkips::no);
+    }
+
+    //! Sets \p value to the coordinate value along a smooth path through the grid at \p step
+    void getCoordValue(int64_t step, awh_dvec value) const
+    {
+        for (size_t d = 0; d < dimParams_.size(); d++)
+        {
+            const double origin = (d == 0 ? -0.5 * length_ : 0.5);
+            value[d] = origin + length_ * (0.5 + 0.45 * std::sin(0.03 * (d + 1) * step + d));
+        }
+    }
+
+    //! Runs \p numSteps steps, returns the sum of the potentials
+    double run(int numSteps)
+    {
+        double potentialSum = 0;
+        for (int64_t step = 0; step < numSteps; step++)
+        {
+            awh_dvec coordValue    = { 0, 0, 0, 0 };
+            double   potential     = 0;
+            double   potentialJump = 0;
+            getCoordValue(step, coordValue);
+            bias_->calcForceAndUpdateBias(coordValue,
+                                          {},
+                                          {},
+                                          &potential,
+                                          &potentialJump,
+                                          step,
+                                          step,
+                                          params_->awhParams.seed(),
+                                          nullptr);
+            potentialSum += potential;
+        }
+        return potentialSum;
+    }
+
+    //! Returns the convolved bias at \p coordValue computed by direct summation
+    double referenceConvolvedBias(const awh_dvec& coordValue) const
+    {
+        ArrayRef<const PointState> points = bias_->state().points();
+
+        double weightSum = 0;
+        for (int neighbor : grid_->point(grid_->nearestIndex(coordValue)).neighbor)
+        {
+            if (!points[neighbor].inTargetRegion())
+            {
+                continue;
+            }
+            double logWeight = points[neighbor].bias();
+            for (size_t d = 0; d < dimParams_.size(); d++)
+            {
+                const double dev =
+                        getDeviationFromPointAlongGridAxis(*grid_, d, neighbor, coordValue[d]);
+                logWeight -= 0.5 * dimParams_[d].pullDimParams().betak * dev * dev;
+            }
+            weightSum += std::exp(logWeight);
+        }
+        return std::log(weightSum);
+    }
+
+    //! 1/(kB*T)
+    static constexpr double c_beta = 0.4;
+    //! The force constant of the umbrella potential
+    static constexpr double c_forceConstant = 1000;
+
+    //! The length of the grid along each axis
+    double length_;
+    //! The test parameters
+    std::unique_ptr<AwhTestParameters> params_;
+    //! The dimension parameters
+    std::vector<DimParams> dimParams_;
+    //! A grid identical to the one used by the bias
+    std::unique_ptr<BiasGrid> grid_;
+    //! The bias
+    std::unique_ptr<Bias> bias_;
+};
+
+//! Sets the number of OpenMP threads for the default module and restores it at destruction
+class ScopedNumThreads
+{
+public:
+    explicit ScopedNumThreads(int numThreads) :
+        savedNumThreads_(gmx_omp_nthreads_get(ModuleMultiThread::Default))
+    {
+        gmx_omp_nthreads_set(ModuleMultiThread::Default, numThreads);
+    }
+    ~ScopedNumThreads() { gmx_omp_nthreads_set(ModuleMultiThread::Default, savedNumThreads_); }
+
+private:
+    int savedNumThreads_;
+};
+
+TEST(BiasConvolutionTest, ConvolvedBiasMatchesDirectSum)
+{
+    MultiDimBias multiDimBias(3, 1.0);
+    multiDimBias.run(200);
+
+    const Bias& bias = *multiDimBias.bias_;
+    for (int64_t step = 0; step < 200; step += 17)
+    {
+        awh_dvec coordValue = { 0, 0, 0, 0 };
+        multiDimBias.getCoordValue(step, coordValue);
+        const double reference = multiDimBias.referenceConvolvedBias(coordValue);
+        EXPECT_DOUBLE_EQ_TOL(reference,
+                             bias.calcConvolvedBias(coordValue),
+                             relativeToleranceAsFloatingPoint(reference, 1e-12));
+    }
+
+    /* Check the probability weights at the last coordinate value */
+    std::vector<double, AlignedAllocator<double>> weights;
+    const double convolvedBias = bias.state().updateProbabilityWeightsAndConvolvedBias(
+            multiDimBias.dimParams_, *multiDimBias.grid_, {}, &weights);
+    const double reference =
+            multiDimBias.referenceConvolvedBias(bias.state().coordState().coordValue());
+    EXPECT_DOUBLE_EQ_TOL(
+            reference, convolvedBias, relativeToleranceAsFloatingPoint(reference, 1e-12));
+
+    double weightSum = 0;
+    for (double weight : weights)
+    {
+        weightSum += weight;
+    }
+    EXPECT_DOUBLE_EQ_TOL(1.0, weightSum, relativeToleranceAsFloatingPoint(1.0, 1e-12));
+}
+
+TEST(BiasConvolutionTest, ResultsAreIndependentOfNumberOfThreads)
+{
+    MultiDimBias serialBias(3, 1.0);
+    MultiDimBias threadedBias(3, 1.0);
+
+    double serialPotentialSum   = 0;
+    double threadedPotentialSum = 0;
+    {
+        ScopedNumThreads numThreads(1);
+        serialPotentialSum = serialBias.run(100);
+    }
+    {
+        ScopedNumThreads numThreads(4);
+        threadedPotentialSum = threadedBias.run(100);
+    }
+    EXPECT_EQ(serialPotentialSum, threadedPotentialSum);
+
+    ArrayRef<const PointState> serialPoints   = serialBias.bias_->state().points();
+    ArrayRef<const PointState> threadedPoints = threadedBias.bias_->state().points();
+    ASSERT_EQ(serialPoints.size(), threadedPoints.size());
+    for (size_t i = 0; i < serialPoints.size(); i++)
+    {
+        EXPECT_EQ(serialPoints[i].bias(), threadedPoints[i].bias());
+        EXPECT_EQ(serialPoints[i].logPmfSum(), threadedPoints[i].logPmfSum());
+    }
+}
+
+} // namespace
+
+} // namespace test
+} // namespace gmx
@@ -43,6 +43,7 @@
 
 #include "densityfittingforceprovider.h"
 
+#include <algorithm>
 #include <numeric>
 #include <optional>
 
@@ -53,10 +54,12 @@
 #include "gromacs/math/densityfittingforce.h"
 #include "gromacs/math/gausstransform.h"
 #include "gromacs/mdlib/broadcaststructs.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/enerdata.h"
 #include "gromacs/mdtypes/forceoutput.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/strconvert.h"
 
 #include "densityfittingamplitudelookup.h"
@@ -172,7 +175,8 @@ private:
     GaussianSpreadKernelParameters::Shape spreadKernel_;
     GaussTransform3D                      gaussTransform_;
     DensitySimilarityMeasure              measure_;
-    DensityFittingForce                   densityFittingForce_;
+    //! Force evaluators with their work buffers, one per thread
+    std::vector<DensityFittingForce> densityFittingForces_;
     //! the local atom coordinates transformed into the grid coordinate system
     std::vector<RVec>             transformedCoordinates_;
     std::vector<RVec>             forces_;
@@ -205,7 +209,7 @@ DensityFittingForceProvider::Impl::Impl(const DensityFittingParameters&
                                    transformationToDensityLattice.scaleOperationOnly())),
     gaussTransform_(referenceDensity.extents(), spreadKernel_),
     measure_(parameters.similarityMeasureMethod_, referenceDensity),
-    densityFittingForce_(spreadKernel_),
+    densityFittingForces_(1, DensityFittingForce(spreadKernel_)),
     transformedCoordinates_(localAtomSet_.numAtomsLocal()),
     amplitudeLookup_(parameters_.amplitudeLookupMethod_),
     transformationToDensityLattice_(transformationToDensityLattice),
@@ -314,13 +318,9 @@ void DensityFittingForceProvider::Impl::calculateForces(const ForceProviderInput
         }
     }
 
-    auto amplitudeIterator = amplitudes.cbegin();
+    const int numThreads = std::max(1, gmx_omp_nthreads_get(ModuleMultiThread::Default));
 
-    for (const auto& r : transformedCoordinates_)
-    {
-        gaussTransform_.add({ r, *amplitudeIterator });
-        ++amplitudeIterator;
-    }
+    gaussTransform_.add(transformedCoordinates_, amplitudes, numThreads);
 
     // communicate grid
     if (havePPDomainDecomposition(&forceProviderInput.cr_))
@@ -336,14 +336,28 @@ void DensityFittingForceProvider::Impl::calculateForces(const ForceProviderInput
             measure_.gradient(gaussTransform_.constView());
     // calculate forces
     forces_.resize(localAtomSet_.numAtomsLocal());
-    std::transform(
-            std::begin(transformedCoordinates_),
-            std::end(transformedCoordinates_),
-            std::begin(amplitudes),
-            std::begin(forces_),
-            [&densityDerivative, this](const RVec r, real amplitude) {
-                return densityFittingForce_.evaluateForce({ r, amplitude }, densityDerivative);
-            });
+    if (densityFittingForces_.size() < static_cast<size_t>(numThreads))
+    {
+        densityFittingForces_.resize(numThreads, densityFittingForces_[0]);
+    }
+    const int numAtoms = ssize(transformedCoordinates_);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            DensityFittingForce& densityFittingForce = densityFittingForces_[thread];
+
+            const int atomBegin = (numAtoms * thread) / numThreads;
+            const int atomEnd   = (numAtoms * (thread + 1)) / numThreads;
+            for (int i = atomBegin; i < atomEnd; i++)
+            {
+                forces_[i] = densityFittingForce.evaluateForce(
+                        { transformedCoordinates_[i], amplitudes[i] }, densityDerivative);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
 
     transformationToDensityLattice_.scaleOperationOnly().inverseIgnoringZeroScale(forces_);
 
@@ -54,6 +54,7 @@
 #include "gromacs/utility/fatalerror.h"
 
 #include "atomdistribution.h"
+#include "dlbloadmodel.h"
 #include "domdec_internal.h"
 #include "utility.h"
 
@@ -580,6 +581,14 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t*      dd,
     {
         rowMaster->oldCellFrac[i] = rowMaster->cellFrac[i];
     }
+
+    domdec_load_t& load = comm->load[d];
+
+    const bool useLoadModel = (!bUniform && dd_load_count(comm) > 0
+                               && gmx::ssize(load.cellProfiles) == ncd * c_dlbLoadModelNumBins);
+
+    rowMaster->predictedImbalance = -1;
+
     if (bUniform)
     {
         for (int i = 0; i < ncd; i++)
@@ -587,6 +596,50 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t*      dd,
             cell_size[i] = 1.0 / ncd;
         }
     }
+    else if (useLoadModel)
+    {
+        gmx::ArrayRef<const real> oldCellFrac = rowMaster->oldCellFrac;
+
+        /* Scale the profile of each cell to the measured load of the cell,
+         * which takes the limited balancing along the higher dimensions into account.
+         */
+        for (int i = 0; i < ncd; i++)
+        {
+            gmx::ArrayRef<float> profile = gmx::makeArrayRef(load.cellProfiles)
+                                                   .subArray(i * c_dlbLoadModelNumBins,
+                                                             c_dlbLoadModelNumBins);
+            const real load_i = load.load[i * load.nload + 2];
+            real       sum    = 0;
+            for (const float value : profile)
+            {
+                sum += value;
+            }
+            for (float& value : profile)
+            {
+                value = (sum > 0 ? value * load_i / sum : load_i / c_dlbLoadModelNumBins);
+            }
+        }
+
+        /* Place the boundaries where the load model predicts equal load */
+        dlbLoadModelCellSizes(oldCellFrac, load.cellProfiles, cell_size);
+
+        /* Limit the amount of scaling, using the same rescaling for all cells */
+        real change_max = 0;
+        for (int i = 0; i < ncd; i++)
+        {
+            const real change = cell_size[i] / (oldCellFrac[i + 1] - oldCellFrac[i]) - 1;
+            change_max        = std::max(change_max, std::abs(change));
+        }
+        if (change_max > change_limit)
+        {
+            const real sc = change_limit / change_max;
+            for (int i = 0; i < ncd; i++)
+            {
+                const real oldSize = oldCellFrac[i + 1] - oldCellFrac[i];
+                cell_size[i]       = oldSize + sc * (cell_size[i] - oldSize);
+            }
+        }
+    }
     else if (dd_load_count(comm) > 0)
     {
         real load_aver  = comm->load[d].sum_m / ncd;
@@ -677,6 +730,21 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t*      dd,
     dd_cell_sizes_dlb_root_enforce_limits(
             dd, d, dim, rowMaster, ddbox, bUniform, step, cellsize_limit_f, range);
 
+    if (useLoadModel)
+    {
+        rowMaster->predictedImbalance = dlbLoadModelImbalance(
+                rowMaster->oldCellFrac,
+                load.cellProfiles,
+                gmx::constArrayRefFromArray(rowMaster->cellFrac.data(), ncd + 1));
+        if (debug)
+        {
+            fprintf(debug,
+                    "dim %d load model predicted imbalance %.3f\n",
+                    d,
+                    rowMaster->predictedImbalance);
+        }
+    }
+
 
     /* After the checks above, the cells should obey the cut-off
      * restrictions, but it does not hurt to check.
@@ -56,6 +56,27 @@
 #include "distribute.h"
 #include "domdec_internal.h"
 
+//! MPI tag for the non-blocking collection, distinct from the rank tags of the blocking sends
+static constexpr int c_collectionTag = 32767;
+
+DDCollectionCommunication::~DDCollectionCommunication()
+{
+#if GMX_MPI
+    int mpiIsFinalized = 0;
+    MPI_Finalized(&mpiIsFinalized);
+    if (!mpiIsFinalized)
+    {
+        for (Send& send : sends)
+        {
+            if (send.isInFlight)
+            {
+                MPI_Wait(&send.request, MPI_STATUS_IGNORE);
+            }
+        }
+    }
+#endif
+}
+
 static void dd_collect_cg(gmx_domdec_t*            dd,
                           const int                ddpCount,
                           const int                ddpCountCgGl,
@@ -67,6 +88,12 @@ static void dd_collect_cg(gmx_domdec_t*            dd,
         return;
     }
 
+    if (DDMASTER(dd))
+    {
+        /* Collections in flight use the current distribution */
+        dd_collect_vec_wait(dd);
+    }
+
     gmx::ArrayRef<const int> atomGroups;
     int                      nat_home = 0;
 
@@ -264,6 +291,150 @@ void dd_collect_vec(gmx_domdec_t*                  dd,
 }
 
 
+//! Returns a send buffer that is not in use, completes sends when needed
+static DDCollectionCommunication::Send* getFreeSend(DDCollectionCommunication* collection)
+{
+    for (DDCollectionCommunication::Send& send : collection->sends)
+    {
+        if (send.isInFlight)
+        {
+#if GMX_MPI
+            int isCompleted = 0;
+            MPI_Test(&send.request, &isCompleted, MPI_STATUS_IGNORE);
+            send.isInFlight = (isCompleted == 0);
+#endif
+        }
+        if (!send.isInFlight)
+        {
+            return &send;
+        }
+    }
+
+    collection->sends.emplace_back();
+
+    return &collection->sends.back();
+}
+
+void dd_collect_vec_start(gmx_domdec_t*                  dd,
+                          const int                      ddpCount,
+                          const int                      ddpCountCgGl,
+                          gmx::ArrayRef<const int>       localCGNumbers,
+                          gmx::ArrayRef<const gmx::RVec> localVector,
+                          gmx::ArrayRef<gmx::RVec>       globalVector)
+{
+    dd_collect_cg(dd, ddpCount, ddpCountCgGl, localCGNumbers);
+
+    DDCollectionCommunication& collection = dd->comm->collection;
+
+    if (!DDMASTER(dd))
+    {
+        /* The same atom count as sent to the master by dd_collect_cg() */
+        const int numHomeAtoms = (ddpCount == dd->ddp_count ? dd->comm->atomRanges.numHomeAtoms()
+                                                            : localCGNumbers.ssize());
+        if (numHomeAtoms == 0)
+        {
+            return;
+        }
+
+        /* Copy to a send buffer, so we can continue to modify localVector */
+        DDCollectionCommunication::Send& send = *getFreeSend(&collection);
+        send.buffer.assign(localVector.begin(), localVector.begin() + numHomeAtoms);
+#if GMX_MPI
+        MPI_Isend(send.buffer.data(),
+                  numHomeAtoms * sizeof(rvec),
+                  MPI_BYTE,
+                  dd->masterrank,
+                  c_collectionTag,
+                  dd->mpi_comm_all,
+                  &send.request);
+        send.isInFlight = true;
+#endif
+    }
+    else
+    {
+        const AtomDistribution& ma = *dd->ma;
+
+        if (collection.numReceivesInFlight == gmx::ssize(collection.receives))
+        {
+            collection.receives.emplace_back();
+        }
+        DDCollectionCommunication::Receive& receive =
+                collection.receives[collection.numReceivesInFlight++];
+
+        int numAtoms = 0;
+        for (int rank = 0; rank < dd->nnodes; rank++)
+        {
+            if (rank != dd->rank)
+            {
+                numAtoms += ma.domainGroups[rank].numAtoms;
+            }
+        }
+        receive.buffer.resize(numAtoms);
+        receive.requests.clear();
+        receive.globalVector = globalVector;
+
+        int offset = 0;
+        for (int rank = 0; rank < dd->nnodes; rank++)
+        {
+            const int numAtomsRank = ma.domainGroups[rank].numAtoms;
+            if (rank != dd->rank && numAtomsRank > 0)
+            {
+#if GMX_MPI
+                receive.requests.emplace_back();
+                MPI_Irecv(receive.buffer.data() + offset,
+                          numAtomsRank * sizeof(rvec),
+                          MPI_BYTE,
+                          rank,
+                          c_collectionTag,
+                          dd->mpi_comm_all,
+                          &receive.requests.back());
+#endif
+                offset += numAtomsRank;
+            }
+        }
+
+        /* Copy our own data while the data of the other ranks arrives */
+        int localAtom = 0;
+        for (const int& globalAtom : ma.domainGroups[dd->rank].atomGroups)
+        {
+            copy_rvec(localVector[localAtom++], globalVector[globalAtom]);
+        }
+    }
+}
+
+void dd_collect_vec_wait(gmx_domdec_t* dd)
+{
+    if (!DDMASTER(dd))
+    {
+        return;
+    }
+
+    DDCollectionCommunication& collection = dd->comm->collection;
+    const AtomDistribution&    ma         = *dd->ma;
+
+    for (int i = 0; i < collection.numReceivesInFlight; i++)
+    {
+        DDCollectionCommunication::Receive& receive = collection.receives[i];
+
+#if GMX_MPI
+        MPI_Waitall(receive.requests.size(), receive.requests.data(), MPI_STATUSES_IGNORE);
+#endif
+
+        int bufferAtom = 0;
+        for (int rank = 0; rank < dd->nnodes; rank++)
+        {
+            if (rank != dd->rank)
+            {
+                for (const int& globalAtom : ma.domainGroups[rank].atomGroups)
+                {
+                    copy_rvec(receive.buffer[bufferAtom++], receive.globalVector[globalAtom]);
+                }
+            }
+        }
+    }
+    collection.numReceivesInFlight = 0;
+}
+
 void dd_collect_state(gmx_domdec_t* dd, const t_state* state_local, t_state* state)
 {
     int nh = state_local->nhchainlength;
@@ -309,31 +480,32 @@ void dd_collect_state(gmx_domdec_t* dd, const t_state* state_local, t_state* sta
     if (state_local->flags & enumValueToBitMask(StateEntry::X))
     {
         auto globalXRef = state ? state->x : gmx::ArrayRef<gmx::RVec>();
-        dd_collect_vec(dd,
-                       state_local->ddp_count,
-                       state_local->ddp_count_cg_gl,
-                       state_local->cg_gl,
-                       state_local->x,
-                       globalXRef);
+        dd_collect_vec_start(dd,
+                             state_local->ddp_count,
+                             state_local->ddp_count_cg_gl,
+                             state_local->cg_gl,
+                             state_local->x,
+                             globalXRef);
     }
     if (state_local->flags & enumValueToBitMask(StateEntry::V))
     {
         auto globalVRef = state ? state->v : gmx::ArrayRef<gmx::RVec>();
-        dd_collect_vec(dd,
-                       state_local->ddp_count,
-                       state_local->ddp_count_cg_gl,
-                       state_local->cg_gl,
-                       state_local->v,
-                       globalVRef);
+        dd_collect_vec_start(dd,
+                             state_local->ddp_count,
+                             state_local->ddp_count_cg_gl,
+                             state_local->cg_gl,
+                             state_local->v,
+                             globalVRef);
     }
     if (state_local->flags & enumValueToBitMask(StateEntry::Cgp))
     {
         auto globalCgpRef = state ? state->cg_p : gmx::ArrayRef<gmx::RVec>();
-        dd_collect_vec(dd,
-                       state_local->ddp_count,
-                       state_local->ddp_count_cg_gl,
-                       state_local->cg_gl,
-                       state_local->cg_p,
-                       globalCgpRef);
+        dd_collect_vec_start(dd,
+                             state_local->ddp_count,
+                             state_local->ddp_count_cg_gl,
+                             state_local->cg_gl,
+                             state_local->cg_p,
+                             globalCgpRef);
     }
+    dd_collect_vec_wait(dd);
 }
@@ -61,6 +61,27 @@ void dd_collect_vec(gmx_domdec_t*                  dd,
                     gmx::ArrayRef<const gmx::RVec> localVector,
                     gmx::ArrayRef<gmx::RVec>       globalVector);
 
+/*! \brief Starts gathering rvec arrays \p localVector to \p globalVector on the master rank
+ *
+ * The non-master ranks copy their home atom data to a send buffer and
+ * return without waiting for the master rank to receive the data.
+ * On the master rank, \p globalVector is only complete after
+ * dd_collect_vec_wait() has been called and should not be accessed
+ * or resized before that.
+ */
+void dd_collect_vec_start(gmx_domdec_t*                  dd,
+                          int                            ddpCount,
+                          int                            ddpCountCgGl,
+                          gmx::ArrayRef<const int>       localCGNumbers,
+                          gmx::ArrayRef<const gmx::RVec> localVector,
+                          gmx::ArrayRef<gmx::RVec>       globalVector);
+
+/*! \brief Waits for the completion of the gathers started with dd_collect_vec_start()
+ *
+ * Only the master rank waits, the sends of the other ranks complete in the background.
+ */
+void dd_collect_vec_wait(gmx_domdec_t* dd);
+
 /*! \brief Gathers state \p localState to \p globalState on the master rank */
 void dd_collect_state(gmx_domdec_t* dd, const t_state* localState, t_state* globalState);
 
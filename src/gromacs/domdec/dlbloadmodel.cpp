@@ -0,0 +1,269 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file implements the load model for the dynamic load balancing.
+ *
+ * \ingroup module_domdec
+ */
+
+#include "gmxpre.h"
+
+#include "dlbloadmodel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/nbnxm/nbnxm.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/topology/ifunc.h"
+#include "gromacs/utility/gmxassert.h"
+
+#include "domdec_internal.h"
+#include "utility.h"
+
+/*! \brief The estimated cost of a bonded interaction relative to the cost of one pair
+ *
+ * This is only a rough average, the actual ratio depends on the interaction
+ * types and the non-bonded kernels. Since the total cost of each rank is
+ * calibrated with the measured load, this only affects the distribution
+ * of the load within a cell.
+ */
+static constexpr real c_bondedCostRelativeToPair = 20;
+
+void computeDlbLoadModelProfiles(const gmx_domdec_t&            dd,
+                                 const matrix                   box,
+                                 gmx::ArrayRef<const gmx::RVec> x,
+                                 const nonbonded_verlet_t&      nbv,
+                                 const InteractionDefinitions&  idef,
+                                 gmx::ArrayRef<float>           profiles)
+{
+    GMX_ASSERT(profiles.ssize() == dd.ndim * c_dlbLoadModelNumBins,
+               "profiles should have the size of the number of DD dimensions times the bins");
+
+    const gmx_domdec_comm_t& comm         = *dd.comm;
+    const int                numHomeAtoms = comm.atomRanges.numHomeAtoms();
+
+    std::vector<real> atomCost(numHomeAtoms, 0);
+    nbv.addPairlistCountsForHomeAtoms(atomCost);
+
+    /* Assign the cost of each bonded interaction to its first atom */
+    for (int ftype = 0; ftype < F_NRE; ftype++)
+    {
+        const InteractionList& il   = idef.il[ftype];
+        const int              nral = NRAL(ftype);
+        for (int i = 0; i < il.size(); i += 1 + nral)
+        {
+            const int a = il.iatoms[i + 1];
+            if (a < numHomeAtoms)
+            {
+                atomCost[a] += c_bondedCostRelativeToPair;
+            }
+        }
+    }
+
+    matrix tcm;
+    make_tric_corr_matrix(dd.unitCellInfo.npbcdim, box, tcm);
+
+    std::fill(profiles.begin(), profiles.end(), 0.0F);
+    for (int d = 0; d < dd.ndim; d++)
+    {
+        gmx::ArrayRef<float> profile =
+                profiles.subArray(d * c_dlbLoadModelNumBins, c_dlbLoadModelNumBins);
+
+        const int  dim        = dd.dim[d];
+        const real cellLower  = comm.cell_x0[dim];
+        const real binInvSize = c_dlbLoadModelNumBins / (comm.cell_x1[dim] - cellLower);
+        for (int a = 0; a < numHomeAtoms; a++)
+        {
+            /* Determine the location of the atom in lattice coordinates */
+            real pos = x[a][dim];
+            for (int d2 = dim + 1; d2 < DIM; d2++)
+            {
+                pos += x[a][d2] * tcm[d2][dim];
+            }
+            /* Atoms might have moved slightly out of the cell since the last partitioning */
+            const int bin = std::clamp(
+                    static_cast<int>((pos - cellLower) * binInvSize), 0, c_dlbLoadModelNumBins - 1);
+            profile[bin] += atomCost[a];
+        }
+    }
+}
+
+void calibrateDlbLoadModelProfiles(float measuredLoad, gmx::ArrayRef<float> profiles)
+{
+    /* All dimensions have the same total load */
+    float estimatedLoad = 0;
+    for (int b = 0; b < c_dlbLoadModelNumBins; b++)
+    {
+        estimatedLoad += profiles[b];
+    }
+
+    for (float& value : profiles)
+    {
+        value = (estimatedLoad > 0 ? value * measuredLoad / estimatedLoad
+                                   : measuredLoad / c_dlbLoadModelNumBins);
+    }
+}
+
+namespace
+{
+
+/*! \brief The cumulative load along a row of cells
+ *
+ * The load density is constant within each bin of each cell.
+ */
+class CumulativeLoad
+{
+public:
+    CumulativeLoad(gmx::ArrayRef<const real> cellFrac, gmx::ArrayRef<const float> cellProfiles)
+    {
+        const int numCells = cellProfiles.ssize() / c_dlbLoadModelNumBins;
+        GMX_ASSERT(cellFrac.ssize() >= numCells + 1, "Need numCells+1 cell boundaries");
+
+        position_.push_back(cellFrac[0]);
+        cumulative_.push_back(0);
+        for (int i = 0; i < numCells; i++)
+        {
+            const real binSize = (cellFrac[i + 1] - cellFrac[i]) / c_dlbLoadModelNumBins;
+            for (int b = 0; b < c_dlbLoadModelNumBins; b++)
+            {
+                position_.push_back(cellFrac[i] + (b + 1) * binSize);
+                cumulative_.push_back(cumulative_.back()
+                                      + cellProfiles[i * c_dlbLoadModelNumBins + b]);
+            }
+        }
+    }
+
+    //! Returns the total load
+    real total() const { return cumulative_.back(); }
+
+    //! Returns the load up to \p frac
+    real loadUpTo(real frac) const
+    {
+        const auto it = std::upper_bound(position_.begin(), position_.end(), frac);
+        if (it == position_.begin())
+        {
+            return 0;
+        }
+        if (it == position_.end())
+        {
+            return total();
+        }
+        const size_t i = it - position_.begin();
+        const real   f = (frac - position_[i - 1]) / (position_[i] - position_[i - 1]);
+
+        return cumulative_[i - 1] + f * (cumulative_[i] - cumulative_[i - 1]);
+    }
+
+    //! Returns the lowest position where the cumulative load reaches \p load
+    real positionOf(real load) const
+    {
+        const auto it = std::lower_bound(cumulative_.begin(), cumulative_.end(), load);
+        if (it == cumulative_.begin())
+        {
+            return position_.front();
+        }
+        if (it == cumulative_.end())
+        {
+            return position_.back();
+        }
+        const size_t i = it - cumulative_.begin();
+        const real   f = (load - cumulative_[i - 1]) / (cumulative_[i] - cumulative_[i - 1]);
+
+        return position_[i - 1] + f * (position_[i] - position_[i - 1]);
+    }
+
+private:
+    //! The bin boundaries, in fractions of the box
+    std::vector<real> position_;
+    //! The cumulative load at each bin boundary
+    std::vector<real> cumulative_;
+};
+
+} // namespace
+
+void dlbLoadModelCellSizes(gmx::ArrayRef<const real>  cellFrac,
+                           gmx::ArrayRef<const float> cellProfiles,
+                           gmx::ArrayRef<real>        cellSizes)
+{
+    const int numCells = cellSizes.ssize();
+    GMX_ASSERT(cellProfiles.ssize() == numCells * c_dlbLoadModelNumBins,
+               "Need profiles for all cells");
+
+    const CumulativeLoad cumulativeLoad(cellFrac, cellProfiles);
+
+    if (cumulativeLoad.total() <= 0)
+    {
+        std::fill(cellSizes.begin(), cellSizes.end(), 1.0 / numCells);
+        return;
+    }
+
+    /* Place the boundaries at equal fractions of the cumulative load */
+    const real loadPerCell = cumulativeLoad.total() / numCells;
+    real       lower       = cellFrac[0];
+    for (int i = 0; i < numCells; i++)
+    {
+        const real upper = (i + 1 < numCells) ? cumulativeLoad.positionOf((i + 1) * loadPerCell)
+                                              : cellFrac[numCells];
+        cellSizes[i]     = upper - lower;
+        lower            = upper;
+    }
+}
+
+real dlbLoadModelImbalance(gmx::ArrayRef<const real>  cellFrac,
+                           gmx::ArrayRef<const float> cellProfiles,
+                           gmx::ArrayRef<const real>  newCellFrac)
+{
+    const int numCells = cellProfiles.ssize() / c_dlbLoadModelNumBins;
+
+    const CumulativeLoad cumulativeLoad(cellFrac, cellProfiles);
+
+    if (cumulativeLoad.total() <= 0)
+    {
+        return 0;
+    }
+
+    real maxLoad = 0;
+    for (int i = 0; i < numCells; i++)
+    {
+        maxLoad = std::max(maxLoad,
+                           cumulativeLoad.loadUpTo(newCellFrac[i + 1])
+                                   - cumulativeLoad.loadUpTo(newCellFrac[i]));
+    }
+
+    return maxLoad * numCells / cumulativeLoad.total() - 1;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief This file declares functions for the load model that can be
+ * used by the dynamic load balancing to set the cell boundaries.
+ *
+ * The load model estimates how the compute cost is distributed within
+ * each DD cell along each DD dimension. The cost of each home atom is
+ * estimated from the number of pairs in the pairlists and the number of
+ * bonded interactions. These costs are binned along each dimension and
+ * the total is calibrated to the measured force load of the rank.
+ * With these profiles the row root of the load balancing can directly
+ * place the cell boundaries at the positions that equalize the load,
+ * instead of only shifting the boundaries based on the total cell loads.
+ *
+ * \ingroup module_domdec
+ */
+
+#ifndef GMX_DOMDEC_DLBLOADMODEL_H
+#define GMX_DOMDEC_DLBLOADMODEL_H
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+struct gmx_domdec_t;
+class InteractionDefinitions;
+struct nonbonded_verlet_t;
+
+//! The number of bins per cell along each dimension for the load profiles
+constexpr int c_dlbLoadModelNumBins = 8;
+
+/*! \brief Computes the estimated load profiles of the home atoms along all DD dimensions
+ *
+ * The profiles are stored in \p profiles with \p c_dlbLoadModelNumBins bins
+ * per DD dimension index, the bins cover the cell along each dimension.
+ * The load is in units of the cost of a pair interaction.
+ *
+ * \param[in]  dd        The domain decomposition struct
+ * \param[in]  box       The unit cell
+ * \param[in]  x         The local coordinates
+ * \param[in]  nbv       The non-bonded setup, with pairlists for the current atom order
+ * \param[in]  idef      The local bonded interactions
+ * \param[out] profiles  The profiles, size dd.ndim*c_dlbLoadModelNumBins
+ */
+void computeDlbLoadModelProfiles(const gmx_domdec_t&            dd,
+                                 const matrix                   box,
+                                 gmx::ArrayRef<const gmx::RVec> x,
+                                 const nonbonded_verlet_t&      nbv,
+                                 const InteractionDefinitions&  idef,
+                                 gmx::ArrayRef<float>           profiles);
+
+/*! \brief Scales the estimated profiles such that the load of each dimension equals \p measuredLoad
+ *
+ * When no load was estimated, the measured load is distributed uniformly.
+ */
+void calibrateDlbLoadModelProfiles(float measuredLoad, gmx::ArrayRef<float> profiles);
+
+/*! \brief Returns the cell sizes that equalize the load given by the load profiles
+ *
+ * \param[in]  cellFrac      The current cell boundaries, in fractions, size numCells+1
+ * \param[in]  cellProfiles  The load profile of each cell, size numCells*c_dlbLoadModelNumBins
+ * \param[out] cellSizes     The new cell sizes, in fractions, size numCells
+ */
+void dlbLoadModelCellSizes(gmx::ArrayRef<const real>  cellFrac,
+                           gmx::ArrayRef<const float> cellProfiles,
+                           gmx::ArrayRef<real>        cellSizes);
+
+/*! \brief Returns the load imbalance, max/average - 1, predicted for boundaries \p newCellFrac
+ *
+ * \param[in] cellFrac      The cell boundaries the profiles were measured with, size numCells+1
+ * \param[in] cellProfiles  The load profile of each cell, size numCells*c_dlbLoadModelNumBins
+ * \param[in] newCellFrac   The new cell boundaries, size numCells+1
+ */
+real dlbLoadModelImbalance(gmx::ArrayRef<const real>  cellFrac,
+                           gmx::ArrayRef<const float> cellProfiles,
+                           gmx::ArrayRef<const real>  newCellFrac);
+
+#endif
@@ -115,6 +115,7 @@
 #include "box.h"
 #include "cellsizes.h"
 #include "distribute.h"
+#include "dlbloadmodel.h"
 #include "domdec_constraints.h"
 #include "domdec_internal.h"
 #include "domdec_setup.h"
@@ -259,68 +260,171 @@ void dd_get_constraint_range(const gmx_domdec_t& dd, int* at_start, int* at_end)
     *at_end   = dd.comm->atomRanges.end(DDAtomRanges::Type::Constraints);
 }
 
-void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
+/*! \brief Packs the coordinates to send in pulse \p ind along DD dimension index \p d
+ *
+ * Shifts the coordinates over the periodic boundary, when needed.
+ */
+static void packHaloCoordinates(const gmx_domdec_t&            dd,
+                                int                            d,
+                                const matrix                   box,
+                                const gmx_domdec_ind_t&        ind,
+                                gmx::ArrayRef<const gmx::RVec> x,
+                                gmx::ArrayRef<gmx::RVec>       sendBuffer)
 {
-    wallcycle_start(wcycle, WallCycleCounter::MoveX);
-
     rvec shift = { 0, 0, 0 };
 
-    gmx_domdec_comm_t* comm = dd->comm.get();
-
-    int nzone   = 1;
-    int nat_tot = comm->atomRanges.numHomeAtoms();
-    for (int d = 0; d < dd->ndim; d++)
+    const bool bPBC   = (dd.ci[dd.dim[d]] == 0);
+    const bool bScrew = (bPBC && dd.unitCellInfo.haveScrewPBC && dd.dim[d] == XX);
+    if (bPBC)
+    {
+        copy_rvec(box[dd.dim[d]], shift);
+    }
+    int n = 0;
+    if (!bPBC)
     {
-        const bool bPBC   = (dd->ci[dd->dim[d]] == 0);
-        const bool bScrew = (bPBC && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
+        for (int j : ind.index)
         {
-            copy_rvec(box[dd->dim[d]], shift);
+            sendBuffer[n] = x[j];
+            n++;
         }
-        gmx_domdec_comm_dim_t* cd = &comm->cd[d];
-        for (const gmx_domdec_ind_t& ind : cd->ind)
+    }
+    else if (!bScrew)
+    {
+        for (int j : ind.index)
         {
-            DDBufferAccess<gmx::RVec> sendBufferAccess(comm->rvecBuffer, ind.nsend[nzone + 1]);
-            gmx::ArrayRef<gmx::RVec>& sendBuffer = sendBufferAccess.buffer;
-            int                       n          = 0;
-            if (!bPBC)
-            {
-                for (int j : ind.index)
-                {
-                    sendBuffer[n] = x[j];
-                    n++;
-                }
-            }
-            else if (!bScrew)
+            /* We need to shift the coordinates */
+            for (int d = 0; d < DIM; d++)
             {
-                for (int j : ind.index)
-                {
-                    /* We need to shift the coordinates */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        sendBuffer[n][d] = x[j][d] + shift[d];
-                    }
-                    n++;
-                }
+                sendBuffer[n][d] = x[j][d] + shift[d];
             }
-            else
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Shift x */
+            sendBuffer[n][XX] = x[j][XX] + shift[XX];
+            /* Rotate y and z.
+             * This operation requires a special shift force
+             * treatment, which is performed in calc_vir.
+             */
+            sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
+            sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+            n++;
+        }
+    }
+}
+
+//! Copies coordinates that were not received in place to the halo zones in \p x
+static void unpackHaloCoordinates(const gmx_domdec_ind_t&        ind,
+                                  int                            nzone,
+                                  gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                                  gmx::ArrayRef<gmx::RVec>       x)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            x[i] = receiveBuffer[j++];
+        }
+    }
+}
+
+//! Returns the total number of pulses over all DD dimensions
+static int numHaloPulses(const gmx_domdec_t& dd)
+{
+    int numPulses = 0;
+    for (int d = 0; d < dd.ndim; d++)
+    {
+        numPulses += dd.comm->cd[d].numPulses();
+    }
+    return numPulses;
+}
+
+void dd_move_x_start(gmx_domdec_t*            dd,
+                     const matrix             box,
+                     gmx::ArrayRef<gmx::RVec> x,
+                     gmx_wallcycle*           wcycle)
+{
+    gmx_domdec_comm_t&           comm = *dd->comm;
+    DDHaloExchangeCommunication& halo = comm.coordinateHalo;
+    GMX_RELEASE_ASSERT(!halo.firstPulseIsInFlight,
+                       "A coordinate halo exchange should not be started twice");
+
+    if (dd->ndim == 0 || comm.cd[0].ind.empty())
+    {
+        return;
+    }
+
+    wallcycle_start(wcycle, WallCycleCounter::MoveX);
+
+    halo.pulses.resize(numHaloPulses(*dd));
+
+    /* The first pulse along the first dimension only sends home atoms */
+    const int                    nzone = 1;
+    const gmx_domdec_comm_dim_t& cd    = comm.cd[0];
+    const gmx_domdec_ind_t&      ind   = cd.ind[0];
+    DDHaloPulseCommunication&    pulse = halo.pulses[0];
+
+    pulse.sendBuffer.resize(ind.nsend[nzone + 1]);
+    packHaloCoordinates(*dd, 0, box, ind, x, pulse.sendBuffer);
+
+    gmx::ArrayRef<gmx::RVec> receiveBuffer;
+    if (cd.receiveInPlace)
+    {
+        receiveBuffer = gmx::arrayRefFromArray(x.data() + comm.atomRanges.numHomeAtoms(),
+                                               ind.nrecv[nzone + 1]);
+    }
+    else
+    {
+        pulse.receiveBuffer.resize(ind.nrecv[nzone + 1]);
+        receiveBuffer = pulse.receiveBuffer;
+    }
+    pulse.sendrecv.start<gmx::RVec>(dd, 0, dddirBackward, pulse.sendBuffer, receiveBuffer);
+    halo.firstPulseIsInFlight = true;
+
+    wallcycle_stop(wcycle, WallCycleCounter::MoveX);
+}
+
+void dd_move_x_finish(gmx_domdec_t*            dd,
+                      const matrix             box,
+                      gmx::ArrayRef<gmx::RVec> x,
+                      gmx_wallcycle*           wcycle)
+{
+    wallcycle_start_nocount(wcycle, WallCycleCounter::MoveX);
+
+    gmx_domdec_comm_t*           comm = dd->comm.get();
+    DDHaloExchangeCommunication& halo = comm->coordinateHalo;
+
+    halo.pulses.resize(numHaloPulses(*dd));
+
+    int nzone      = 1;
+    int nat_tot    = comm->atomRanges.numHomeAtoms();
+    int pulseIndex = 0;
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        gmx_domdec_comm_dim_t* cd = &comm->cd[d];
+        for (int p = 0; p < cd->numPulses(); p++)
+        {
+            const gmx_domdec_ind_t&   ind   = cd->ind[p];
+            DDHaloPulseCommunication& pulse = halo.pulses[pulseIndex++];
+            if (pulseIndex == 1 && halo.firstPulseIsInFlight)
             {
-                for (int j : ind.index)
+                pulse.sendrecv.wait();
+                if (!cd->receiveInPlace)
                 {
-                    /* Shift x */
-                    sendBuffer[n][XX] = x[j][XX] + shift[XX];
-                    /* Rotate y and z.
-                     * This operation requires a special shift force
-                     * treatment, which is performed in calc_vir.
-                     */
-                    sendBuffer[n][YY] = box[YY][YY] - x[j][YY];
-                    sendBuffer[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                    n++;
+                    unpackHaloCoordinates(ind, nzone, pulse.receiveBuffer, x);
                 }
+                halo.firstPulseIsInFlight = false;
+                nat_tot += ind.nrecv[nzone + 1];
+                continue;
             }
 
-            DDBufferAccess<gmx::RVec> receiveBufferAccess(
-                    comm->rvecBuffer2, cd->receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
+            pulse.sendBuffer.resize(ind.nsend[nzone + 1]);
+            packHaloCoordinates(*dd, d, box, ind, x, pulse.sendBuffer);
 
             gmx::ArrayRef<gmx::RVec> receiveBuffer;
             if (cd->receiveInPlace)
@@ -329,21 +433,16 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
             }
             else
             {
-                receiveBuffer = receiveBufferAccess.buffer;
+                pulse.receiveBuffer.resize(ind.nrecv[nzone + 1]);
+                receiveBuffer = pulse.receiveBuffer;
             }
             /* Send and receive the coordinates */
-            ddSendrecv(dd, d, dddirBackward, sendBuffer, receiveBuffer);
+            pulse.sendrecv.start<gmx::RVec>(dd, d, dddirBackward, pulse.sendBuffer, receiveBuffer);
+            pulse.sendrecv.wait();
 
             if (!cd->receiveInPlace)
             {
-                int j = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        x[i] = receiveBuffer[j++];
-                    }
-                }
+                unpackHaloCoordinates(ind, nzone, receiveBuffer, x);
             }
             nat_tot += ind.nrecv[nzone + 1];
         }
@@ -353,41 +452,185 @@ void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, g
     wallcycle_stop(wcycle, WallCycleCounter::MoveX);
 }
 
-void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+void dd_move_x(gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVec> x, gmx_wallcycle* wcycle)
 {
-    wallcycle_start(wcycle, WallCycleCounter::MoveF);
+    dd_move_x_start(dd, box, x, wcycle);
+    dd_move_x_finish(dd, box, x, wcycle);
+}
+
+//! Copies the forces on the halo zones to send, when not sending in place
+static void packHaloForces(const gmx_domdec_ind_t&        ind,
+                           int                            nzone,
+                           gmx::ArrayRef<const gmx::RVec> f,
+                           gmx::ArrayRef<gmx::RVec>       sendBuffer)
+{
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
+        {
+            sendBuffer[j++] = f[i];
+        }
+    }
+}
 
+/*! \brief Adds the forces received in pulse \p ind along DD dimension index \p d
+ *
+ * Also updates the shift forces when these are needed for the virial.
+ */
+static void addHaloForces(const gmx_domdec_t&            dd,
+                          int                            d,
+                          const gmx_domdec_ind_t&        ind,
+                          gmx::ArrayRef<const gmx::RVec> receiveBuffer,
+                          gmx::ForceWithShiftForces*     forceWithShiftForces)
+{
     gmx::ArrayRef<gmx::RVec> f      = forceWithShiftForces->force();
     gmx::ArrayRef<gmx::RVec> fshift = forceWithShiftForces->shiftForces();
 
-    gmx_domdec_comm_t& comm    = *dd->comm;
-    int                nzone   = comm.zones.n / 2;
-    int                nat_tot = comm.atomRanges.end(DDAtomRanges::Type::Zones);
-    for (int d = dd->ndim - 1; d >= 0; d--)
+    /* Only forces in domains near the PBC boundaries need to
+       consider PBC in the treatment of fshift */
+    const bool shiftForcesNeedPbc =
+            (forceWithShiftForces->computeVirial() && dd.ci[dd.dim[d]] == 0);
+    const bool applyScrewPbc =
+            (shiftForcesNeedPbc && dd.unitCellInfo.haveScrewPBC && dd.dim[d] == XX);
+    /* Determine which shift vector we need */
+    ivec vis       = { 0, 0, 0 };
+    vis[dd.dim[d]] = 1;
+    const int is   = gmx::ivecToShiftIndex(vis);
+
+    int n = 0;
+    if (!shiftForcesNeedPbc)
+    {
+        for (int j : ind.index)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                f[j][d] += receiveBuffer[n][d];
+            }
+            n++;
+        }
+    }
+    else if (!applyScrewPbc)
+    {
+        for (int j : ind.index)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                f[j][d] += receiveBuffer[n][d];
+            }
+            /* Add this force to the shift force */
+            for (int d = 0; d < DIM; d++)
+            {
+                fshift[is][d] += receiveBuffer[n][d];
+            }
+            n++;
+        }
+    }
+    else
+    {
+        for (int j : ind.index)
+        {
+            /* Rotate the force */
+            f[j][XX] += receiveBuffer[n][XX];
+            f[j][YY] -= receiveBuffer[n][YY];
+            f[j][ZZ] -= receiveBuffer[n][ZZ];
+            if (shiftForcesNeedPbc)
+            {
+                /* Add this force to the shift force */
+                for (int d = 0; d < DIM; d++)
+                {
+                    fshift[is][d] += receiveBuffer[n][d];
+                }
+            }
+            n++;
+        }
+    }
+}
+
+void dd_move_f_start(gmx_domdec_t*              dd,
+                     gmx::ForceWithShiftForces* forceWithShiftForces,
+                     gmx_wallcycle*             wcycle)
+{
+    gmx_domdec_comm_t&           comm = *dd->comm;
+    DDHaloExchangeCommunication& halo = comm.forceHalo;
+    GMX_RELEASE_ASSERT(!halo.firstPulseIsInFlight,
+                       "A force halo exchange should not be started twice");
+
+    const int d = dd->ndim - 1;
+    if (d < 0 || comm.cd[d].ind.empty())
+    {
+        return;
+    }
+
+    wallcycle_start(wcycle, WallCycleCounter::MoveF);
+
+    halo.pulses.resize(numHaloPulses(*dd));
+
+    /* The last pulse along the last dimension is communicated first and
+     * only sends forces on atoms that do not receive forces themselves.
+     */
+    const int                    nzone = comm.zones.n / 2;
+    const gmx_domdec_comm_dim_t& cd    = comm.cd[d];
+    const gmx_domdec_ind_t&      ind   = cd.ind.back();
+    DDHaloPulseCommunication&    pulse = halo.pulses[0];
+
+    const int nat_tot = comm.atomRanges.end(DDAtomRanges::Type::Zones) - ind.nrecv[nzone + 1];
+
+    gmx::ArrayRef<gmx::RVec> f = forceWithShiftForces->force();
+    gmx::ArrayRef<gmx::RVec> sendBuffer;
+    if (cd.receiveInPlace)
     {
-        /* Only forces in domains near the PBC boundaries need to
-           consider PBC in the treatment of fshift */
-        const bool shiftForcesNeedPbc =
-                (forceWithShiftForces->computeVirial() && dd->ci[dd->dim[d]] == 0);
-        const bool applyScrewPbc =
-                (shiftForcesNeedPbc && dd->unitCellInfo.haveScrewPBC && dd->dim[d] == XX);
-        /* Determine which shift vector we need */
-        ivec vis        = { 0, 0, 0 };
-        vis[dd->dim[d]] = 1;
-        const int is    = gmx::ivecToShiftIndex(vis);
+        sendBuffer = gmx::arrayRefFromArray(f.data() + nat_tot, ind.nrecv[nzone + 1]);
+    }
+    else
+    {
+        pulse.sendBuffer.resize(ind.nrecv[nzone + 1]);
+        packHaloForces(ind, nzone, f, pulse.sendBuffer);
+        sendBuffer = pulse.sendBuffer;
+    }
+    pulse.receiveBuffer.resize(ind.nsend[nzone + 1]);
+    pulse.sendrecv.start<gmx::RVec>(dd, d, dddirForward, sendBuffer, pulse.receiveBuffer);
+    halo.firstPulseIsInFlight = true;
 
+    wallcycle_stop(wcycle, WallCycleCounter::MoveF);
+}
+
+void dd_move_f_finish(gmx_domdec_t*              dd,
+                      gmx::ForceWithShiftForces* forceWithShiftForces,
+                      gmx_wallcycle*             wcycle)
+{
+    wallcycle_start_nocount(wcycle, WallCycleCounter::MoveF);
+
+    gmx::ArrayRef<gmx::RVec> f = forceWithShiftForces->force();
+
+    gmx_domdec_comm_t&           comm = *dd->comm;
+    DDHaloExchangeCommunication& halo = comm.forceHalo;
+
+    halo.pulses.resize(numHaloPulses(*dd));
+
+    int nzone      = comm.zones.n / 2;
+    int nat_tot    = comm.atomRanges.end(DDAtomRanges::Type::Zones);
+    int pulseIndex = 0;
+    for (int d = dd->ndim - 1; d >= 0; d--)
+    {
         /* Loop over the pulses */
         const gmx_domdec_comm_dim_t& cd = comm.cd[d];
         for (int p = cd.numPulses() - 1; p >= 0; p--)
         {
-            const gmx_domdec_ind_t&   ind = cd.ind[p];
-            DDBufferAccess<gmx::RVec> receiveBufferAccess(comm.rvecBuffer, ind.nsend[nzone + 1]);
-            gmx::ArrayRef<gmx::RVec>& receiveBuffer = receiveBufferAccess.buffer;
+            const gmx_domdec_ind_t&   ind   = cd.ind[p];
+            DDHaloPulseCommunication& pulse = halo.pulses[pulseIndex++];
 
             nat_tot -= ind.nrecv[nzone + 1];
 
-            DDBufferAccess<gmx::RVec> sendBufferAccess(
-                    comm.rvecBuffer2, cd.receiveInPlace ? 0 : ind.nrecv[nzone + 1]);
+            if (pulseIndex == 1 && halo.firstPulseIsInFlight)
+            {
+                pulse.sendrecv.wait();
+                addHaloForces(*dd, d, ind, pulse.receiveBuffer, forceWithShiftForces);
+                halo.firstPulseIsInFlight = false;
+                continue;
+            }
+
+            pulse.receiveBuffer.resize(ind.nsend[nzone + 1]);
 
             gmx::ArrayRef<gmx::RVec> sendBuffer;
             if (cd.receiveInPlace)
@@ -396,72 +639,27 @@ void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces
             }
             else
             {
-                sendBuffer = sendBufferAccess.buffer;
-                int j      = 0;
-                for (int zone = 0; zone < nzone; zone++)
-                {
-                    for (int i = ind.cell2at0[zone]; i < ind.cell2at1[zone]; i++)
-                    {
-                        sendBuffer[j++] = f[i];
-                    }
-                }
+                pulse.sendBuffer.resize(ind.nrecv[nzone + 1]);
+                packHaloForces(ind, nzone, f, pulse.sendBuffer);
+                sendBuffer = pulse.sendBuffer;
             }
             /* Communicate the forces */
-            ddSendrecv(dd, d, dddirForward, sendBuffer, receiveBuffer);
+            pulse.sendrecv.start<gmx::RVec>(dd, d, dddirForward, sendBuffer, pulse.receiveBuffer);
+            pulse.sendrecv.wait();
             /* Add the received forces */
-            int n = 0;
-            if (!shiftForcesNeedPbc)
-            {
-                for (int j : ind.index)
-                {
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        f[j][d] += receiveBuffer[n][d];
-                    }
-                    n++;
-                }
-            }
-            else if (!applyScrewPbc)
-            {
-                for (int j : ind.index)
-                {
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        f[j][d] += receiveBuffer[n][d];
-                    }
-                    /* Add this force to the shift force */
-                    for (int d = 0; d < DIM; d++)
-                    {
-                        fshift[is][d] += receiveBuffer[n][d];
-                    }
-                    n++;
-                }
-            }
-            else
-            {
-                for (int j : ind.index)
-                {
-                    /* Rotate the force */
-                    f[j][XX] += receiveBuffer[n][XX];
-                    f[j][YY] -= receiveBuffer[n][YY];
-                    f[j][ZZ] -= receiveBuffer[n][ZZ];
-                    if (shiftForcesNeedPbc)
-                    {
-                        /* Add this force to the shift force */
-                        for (int d = 0; d < DIM; d++)
-                        {
-                            fshift[is][d] += receiveBuffer[n][d];
-                        }
-                    }
-                    n++;
-                }
-            }
+            addHaloForces(*dd, d, ind, pulse.receiveBuffer, forceWithShiftForces);
         }
         nzone /= 2;
     }
     wallcycle_stop(wcycle, WallCycleCounter::MoveF);
 }
 
+void dd_move_f(gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle)
+{
+    dd_move_f_start(dd, forceWithShiftForces, wcycle);
+    dd_move_f_finish(dd, forceWithShiftForces, wcycle);
+}
+
 real dd_cutoff_multibody(const gmx_domdec_t* dd)
 {
     const gmx_domdec_comm_t& comm       = *dd->comm;
@@ -934,7 +1132,8 @@ static void make_load_communicator(gmx_domdec_t* dd, int dim_ind, ivec loc)
         }
         if (dd->ci[dim] == dd->master_ci[dim])
         {
-            dd->comm->load[dim_ind].load.resize(dd->numCells[dim] * DD_NLOAD_MAX);
+            dd->comm->load[dim_ind].load.resize(
+                    dd->numCells[dim] * (DD_NLOAD_MAX + DIM * c_dlbLoadModelNumBins));
         }
     }
 }
@@ -2703,6 +2902,7 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
     ddSettings.useDDOrderZYX       = bool(dd_getenv(mdlog, "GMX_DD_ORDER_ZYX", 0));
     ddSettings.useCartesianReorder = bool(dd_getenv(mdlog, "GMX_NO_CART_REORDER", 1));
     ddSettings.eFlop               = dd_getenv(mdlog, "GMX_DLB_BASED_ON_FLOPS", 0);
+    ddSettings.useDlbLoadModel     = (dd_getenv(mdlog, "GMX_DLB_LOAD_MODEL", 0) != 0);
     const int recload              = dd_getenv(mdlog, "GMX_DD_RECORD_LOAD", 1);
     ddSettings.nstDDDump           = dd_getenv(mdlog, "GMX_DD_NST_DUMP", 0);
     ddSettings.nstDDDumpGrid       = dd_getenv(mdlog, "GMX_DD_NST_DUMP_GRID", 0);
@@ -2727,6 +2927,14 @@ static DDSettings getDDSettings(const gmx::MDLogger&     mdlog,
         ddSettings.recordLoad = (wallcycle_have_counter() && recload > 0);
     }
 
+    if (ddSettings.useDlbLoadModel)
+    {
+        GMX_LOG(mdlog.info)
+                .appendText(
+                        "Dynamic load balancing will set cell boundaries using load profiles "
+                        "estimated from the pairlists and bonded interactions");
+    }
+
     ddSettings.initialDlbState = determineInitialDlbState(mdlog,
                                                           options,
                                                           ddSettings.recordLoad,
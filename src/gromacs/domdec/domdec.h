@@ -201,6 +201,45 @@ void dd_move_x(struct gmx_domdec_t* dd, const matrix box, gmx::ArrayRef<gmx::RVe
  */
 void dd_move_f(struct gmx_domdec_t* dd, gmx::ForceWithShiftForces* forceWithShiftForces, gmx_wallcycle* wcycle);
 
+/*! \brief Starts communicating the coordinates to the neighboring cells
+ *
+ * Posts the first pulse of the halo exchange done by dd_move_x() as
+ * non-blocking communication, so local work can overlap with it.
+ * Only the coordinates of home atoms can be used until
+ * dd_move_x_finish() has been called with the same arguments.
+ */
+void dd_move_x_start(struct gmx_domdec_t*     dd,
+                     const matrix             box,
+                     gmx::ArrayRef<gmx::RVec> x,
+                     gmx_wallcycle*           wcycle);
+
+/*! \brief Finishes the communication started with dd_move_x_start()
+ *
+ * Completes the first pulse and communicates the remaining pulses,
+ * which forward coordinates received in earlier pulses.
+ */
+void dd_move_x_finish(struct gmx_domdec_t*     dd,
+                      const matrix             box,
+                      gmx::ArrayRef<gmx::RVec> x,
+                      gmx_wallcycle*           wcycle);
+
+/*! \brief Starts summing the forces over the neighboring cells
+ *
+ * Posts the first pulse of the force halo exchange done by dd_move_f()
+ * as non-blocking communication. All contributions to the forces on
+ * non-local atoms should have been computed. Until dd_move_f_finish()
+ * has been called with the same arguments, only forces on home atoms
+ * can be modified.
+ */
+void dd_move_f_start(struct gmx_domdec_t*       dd,
+                     gmx::ForceWithShiftForces* forceWithShiftForces,
+                     gmx_wallcycle*             wcycle);
+
+//! Finishes the force summation started with dd_move_f_start()
+void dd_move_f_finish(struct gmx_domdec_t*       dd,
+                      gmx::ForceWithShiftForces* forceWithShiftForces,
+                      gmx_wallcycle*             wcycle);
+
 /*! \brief Reset all the statistics and counters for total run counting */
 void reset_dd_statistics_counters(struct gmx_domdec_t* dd);
 
@@ -48,6 +48,7 @@
 
 #include "gromacs/domdec/dlbtiming.h"
 #include "gromacs/domdec/domdec.h"
+#include "gromacs/domdec/domdec_network.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/mdlib/updategroupscog.h"
 #include "gromacs/timing/cyclecounter.h"
@@ -128,6 +129,8 @@ struct RowMaster
     bool dlbIsLimited = false;
     /**< Temp. var.  */
     std::vector<real> buf_ncd;
+    /**< The imbalance predicted by the load model for the last cell sizes, -1 when not used */
+    real predictedImbalance = -1;
 };
 
 /*! \brief Struct for managing cell sizes with DLB along a dimension */
@@ -172,6 +175,10 @@ typedef struct domdec_load
     float pme = 0;
     /**< Bit flags that tell if DLB was limited, per dimension */
     int flags = 0;
+    /**< The load model profiles along the lower dimensions, summed over the ranks */
+    std::vector<float> profile;
+    /**< The load model profile along this dimension for each cell in the row */
+    std::vector<float> cellProfiles;
 } domdec_load_t;
 
 /*! \brief Data needed to sort an atom to the desired location in the local state */
@@ -411,6 +418,79 @@ public:
     gmx::ArrayRef<T> buffer; /**< The access to the memory buffer */
 };
 
+/*! \brief The buffers and communication of one pulse of a halo exchange
+ *
+ * The buffers are owned by the pulse, so their addresses and sizes only
+ * change when the pulse layout changes at repartitioning. This allows
+ * the communication to reuse persistent requests between exchanges.
+ */
+struct DDHaloPulseCommunication
+{
+    //! The values to send, not used when sending in place
+    std::vector<gmx::RVec> sendBuffer;
+    //! Buffer for receiving, not used when receiving in place
+    std::vector<gmx::RVec> receiveBuffer;
+    //! The send and receive with persistent requests
+    DDPersistentSendrecv sendrecv;
+};
+
+/*! \brief The communication for all pulses of a coordinate or force halo exchange
+ *
+ * All pulses, apart from the first communicated, forward atoms received
+ * in earlier pulses, so only the first pulse can be communicated while
+ * other work is done.
+ */
+struct DDHaloExchangeCommunication
+{
+    //! The pulses in order of communication
+    std::vector<DDHaloPulseCommunication> pulses;
+    //! Whether the first pulse has been started and the exchange not yet finished
+    bool firstPulseIsInFlight = false;
+};
+
+/*! \brief Buffers and requests for collecting vectors to the master rank without blocking
+ *
+ * The non-master ranks copy their home atom data to a send buffer and
+ * only check for completion of the send when they need a buffer again.
+ * The master rank receives each vector into a separate buffer and only
+ * waits for the data when it is needed for writing.
+ */
+struct DDCollectionCommunication
+{
+    //! A send from a non-master rank
+    struct Send
+    {
+        //! The home atom data
+        std::vector<gmx::RVec> buffer;
+        //! The request of the send
+        MPI_Request request;
+        //! Whether the send might not have completed
+        bool isInFlight = false;
+    };
+
+    //! A collection of a vector on the master rank
+    struct Receive
+    {
+        //! The data of the other ranks, ordered by rank
+        std::vector<gmx::RVec> buffer;
+        //! The requests of the receives from each rank
+        std::vector<MPI_Request> requests;
+        //! The vector to copy the received data to
+        gmx::ArrayRef<gmx::RVec> globalVector;
+    };
+
+    DDCollectionCommunication() = default;
+    //! Completes pending sends
+    ~DDCollectionCommunication();
+
+    //! The sends, only used on the non-master ranks
+    std::vector<Send> sends;
+    //! The collections, only used on the master rank
+    std::vector<Receive> receives;
+    //! The number of collections in \p receives that have not been waited for
+    int numReceivesInFlight = 0;
+};
+
 /*! \brief Temporary buffer for setting up communiation over one pulse and all zones in the halo */
 struct dd_comm_setup_work_t
 {
@@ -491,6 +571,9 @@ struct DDSettings
     //! Whether we should record the load
     bool recordLoad = false;
 
+    //! Whether DLB sets the cell boundaries using load profiles estimated from the pairlists
+    bool useDlbLoadModel = false;
+
     /* Debugging */
     //! Step interval for dumping the local+non-local atoms to pdb
     int nstDDDump = 0;
@@ -652,6 +735,8 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
      *  stored as DD partitioning call count.
      */
     int64_t master_cg_ddp_count = 0;
+    /** Communication for collecting vectors to the master without blocking */
+    DDCollectionCommunication collection;
 
     /** The number of cg's received from the direct neighbors */
     std::array<int, DD_MAXZONE> zone_ncg1 = { 0 };
@@ -676,6 +761,11 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /**< Another rvec comm. buffer */
     DDBuffer<gmx::RVec> rvecBuffer2;
 
+    /**< The communication of the coordinate halo exchange */
+    DDHaloExchangeCommunication coordinateHalo;
+    /**< The communication of the force halo exchange */
+    DDHaloExchangeCommunication forceHalo;
+
     /* Communication buffers for local redistribution */
     /**< Charge group flag comm. buffers */
     std::array<std::vector<int>, DIM * 2> cggl_flag;
@@ -688,6 +778,8 @@ struct gmx_domdec_comm_t // NOLINT (clang-analyzer-optin.performance.Padding)
     /* Stuff for load communication */
     /**< The recorded load data */
     std::vector<domdec_load_t> load;
+    /**< The load model profiles of our rank along the DD dimensions */
+    std::vector<float> dlbLoadModelProfiles;
     /**< The number of MPI ranks sharing the GPU our rank is using */
     int nrank_gpu_shared = 0;
 #if GMX_MPI
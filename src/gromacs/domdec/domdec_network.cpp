@@ -50,7 +50,10 @@
 
 #include <cstring>
 
+#include <utility>
+
 #include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/gmxmpi.h"
 
 #include "domdec_internal.h"
@@ -145,6 +148,190 @@ template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<real>, gmx
 //! Specialization of extern template for gmx::RVec
 template void ddSendrecv(const gmx_domdec_t*, int, int, gmx::ArrayRef<gmx::RVec>, gmx::ArrayRef<gmx::RVec>);
 
+DDPersistentSendrecv::~DDPersistentSendrecv()
+{
+    freeRequests();
+}
+
+DDPersistentSendrecv::DDPersistentSendrecv(DDPersistentSendrecv&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+DDPersistentSendrecv& DDPersistentSendrecv::operator=(DDPersistentSendrecv&& other) noexcept
+{
+    if (this != &other)
+    {
+        freeRequests();
+        sendBuffer_                   = other.sendBuffer_;
+        sendSize_                     = other.sendSize_;
+        receiveBuffer_                = other.receiveBuffer_;
+        receiveSize_                  = other.receiveSize_;
+        sendRank_                     = other.sendRank_;
+        receiveRank_                  = other.receiveRank_;
+        requests_[0]                  = other.requests_[0];
+        requests_[1]                  = other.requests_[1];
+        numRequests_                  = other.numRequests_;
+        havePersistentRequests_       = other.havePersistentRequests_;
+        isInFlight_                   = other.isInFlight_;
+        numSetups_                    = other.numSetups_;
+        other.numRequests_            = 0;
+        other.havePersistentRequests_ = false;
+        other.isInFlight_             = false;
+    }
+    return *this;
+}
+
+void DDPersistentSendrecv::freeRequests()
+{
+    GMX_ASSERT(!isInFlight_, "Communication should be completed before freeing the requests");
+#if GMX_LIB_MPI
+    if (havePersistentRequests_)
+    {
+        /* The requests might outlive MPI when the DD object is destructed late */
+        int isFinalized = 0;
+        MPI_Finalized(&isFinalized);
+        if (!isFinalized)
+        {
+            for (int i = 0; i < numRequests_; i++)
+            {
+                MPI_Request_free(&requests_[i]);
+            }
+        }
+    }
+#endif
+    havePersistentRequests_ = false;
+    numRequests_            = 0;
+}
+
+void DDPersistentSendrecv::startBytes(const gmx_domdec_t* dd,
+                                      int                 ddDimensionIndex,
+                                      int                 direction,
+                                      const void*         sendBuffer,
+                                      int                 sendSize,
+                                      void*               receiveBuffer,
+                                      int                 receiveSize)
+{
+    GMX_ASSERT(!isInFlight_, "The previous communication should have been completed");
+#if GMX_MPI
+    const int sendRank    = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 0 : 1];
+    const int receiveRank = dd->neighbor[ddDimensionIndex][direction == dddirForward ? 1 : 0];
+
+    if (numSetups_ == 0 || sendBuffer != sendBuffer_ || sendSize != sendSize_
+        || receiveBuffer != receiveBuffer_ || receiveSize != receiveSize_
+        || sendRank != sendRank_ || receiveRank != receiveRank_)
+    {
+        freeRequests();
+        sendBuffer_    = sendBuffer;
+        sendSize_      = sendSize;
+        receiveBuffer_ = receiveBuffer;
+        receiveSize_   = receiveSize;
+        sendRank_      = sendRank;
+        receiveRank_   = receiveRank;
+        numSetups_++;
+#    if GMX_LIB_MPI
+        constexpr int mpiTag = 0;
+        if (receiveSize > 0)
+        {
+            MPI_Recv_init(receiveBuffer,
+                          receiveSize,
+                          MPI_BYTE,
+                          receiveRank,
+                          mpiTag,
+                          dd->mpi_comm_all,
+                          &requests_[numRequests_++]);
+        }
+        if (sendSize > 0)
+        {
+            /* MPI_Send_init takes a non-const pointer with MPI versions before 3 */
+            MPI_Send_init(const_cast<void*>(sendBuffer),
+                          sendSize,
+                          MPI_BYTE,
+                          sendRank,
+                          mpiTag,
+                          dd->mpi_comm_all,
+                          &requests_[numRequests_++]);
+        }
+        havePersistentRequests_ = true;
+#    endif
+    }
+
+#    if GMX_LIB_MPI
+    if (numRequests_ > 0)
+    {
+        MPI_Startall(numRequests_, requests_);
+    }
+#    else
+    /* Thread-MPI does not support persistent requests */
+    constexpr int mpiTag = 0;
+    numRequests_         = 0;
+    if (receiveSize > 0)
+    {
+        MPI_Irecv(receiveBuffer,
+                  receiveSize,
+                  MPI_BYTE,
+                  receiveRank,
+                  mpiTag,
+                  dd->mpi_comm_all,
+                  &requests_[numRequests_++]);
+    }
+    if (sendSize > 0)
+    {
+        MPI_Isend(const_cast<void*>(sendBuffer),
+                  sendSize,
+                  MPI_BYTE,
+                  sendRank,
+                  mpiTag,
+                  dd->mpi_comm_all,
+                  &requests_[numRequests_++]);
+    }
+#    endif
+    isInFlight_ = true;
+#else  // GMX_MPI
+    GMX_UNUSED_VALUE(dd);
+    GMX_UNUSED_VALUE(ddDimensionIndex);
+    GMX_UNUSED_VALUE(direction);
+    GMX_UNUSED_VALUE(sendBuffer);
+    GMX_UNUSED_VALUE(sendSize);
+    GMX_UNUSED_VALUE(receiveBuffer);
+    GMX_UNUSED_VALUE(receiveSize);
+#endif // GMX_MPI
+}
+
+template<typename T>
+void DDPersistentSendrecv::start(const gmx_domdec_t* dd,
+                                 int                 ddDimensionIndex,
+                                 int                 direction,
+                                 gmx::ArrayRef<T>    sendBuffer,
+                                 gmx::ArrayRef<T>    receiveBuffer)
+{
+    startBytes(dd,
+               ddDimensionIndex,
+               direction,
+               sendBuffer.data(),
+               sendBuffer.size() * sizeof(T),
+               receiveBuffer.data(),
+               receiveBuffer.size() * sizeof(T));
+}
+
+//! Specialization of extern template for gmx::RVec
+template void DDPersistentSendrecv::start(const gmx_domdec_t*,
+                                          int,
+                                          int,
+                                          gmx::ArrayRef<gmx::RVec>,
+                                          gmx::ArrayRef<gmx::RVec>);
+
+void DDPersistentSendrecv::wait()
+{
+#if GMX_MPI
+    if (isInFlight_ && numRequests_ > 0)
+    {
+        MPI_Waitall(numRequests_, requests_, MPI_STATUSES_IGNORE);
+    }
+#endif
+    isInFlight_ = false;
+}
+
 void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused* dd,
                        int gmx_unused                        ddimind,
                        rvec gmx_unused* buf_s_fw,
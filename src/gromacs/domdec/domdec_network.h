@@ -50,6 +50,7 @@
 #define GMX_DOMDEC_DOMDEC_NETWORK_H
 
 #include "gromacs/math/vectypes.h"
+#include "gromacs/utility/gmxmpi.h"
 
 struct gmx_domdec_t;
 
@@ -145,6 +146,96 @@ extern template void ddSendrecv<gmx::RVec>(const gmx_domdec_t*      dd,
                                            gmx::ArrayRef<gmx::RVec> sendBuffer,
                                            gmx::ArrayRef<gmx::RVec> receiveBuffer);
 
+/*! \libinternal \brief A send and receive along a domain decomposition dimension
+ * that reuses persistent communication requests
+ *
+ * With a real MPI library, the first start() creates persistent MPI
+ * requests for the buffers passed. These are reused by later calls with
+ * the same buffers, sizes and direction, which avoids the set-up cost
+ * of the messages for every exchange. The requests are re-created when
+ * any of these changes, which usually only happens at repartitioning.
+ * With thread-MPI, which does not support persistent requests, every
+ * start() posts a non-blocking send and receive instead.
+ */
+class DDPersistentSendrecv
+{
+public:
+    DDPersistentSendrecv() = default;
+    ~DDPersistentSendrecv();
+
+    //! Moving transfers the requests
+    DDPersistentSendrecv(DDPersistentSendrecv&& other) noexcept;
+    //! Moving transfers the requests
+    DDPersistentSendrecv& operator=(DDPersistentSendrecv&& other) noexcept;
+
+    /*! \brief Start moving a view of T values in the communication region
+     * one cell along the domain decomposition
+     *
+     * Starts a send and receive with the same communication pattern as
+     * ddSendrecv() and returns without waiting for completion.
+     * The buffers should not be accessed before wait() has been called.
+     */
+    template<typename T>
+    void start(const gmx_domdec_t* dd,
+               int                 ddDimensionIndex,
+               int                 direction,
+               gmx::ArrayRef<T>    sendBuffer,
+               gmx::ArrayRef<T>    receiveBuffer);
+
+    //! Waits for completion of the send and receive started with start()
+    void wait();
+
+    //! Returns whether a send and receive has been started and not waited for
+    bool isInFlight() const { return isInFlight_; }
+
+    //! Returns how often the communication has been set up for a (new) set of buffers
+    int numSetups() const { return numSetups_; }
+
+private:
+    //! Sets up the communication, when needed, and starts it, sizes are in bytes
+    void startBytes(const gmx_domdec_t* dd,
+                    int                 ddDimensionIndex,
+                    int                 direction,
+                    const void*         sendBuffer,
+                    int                 sendSize,
+                    void*               receiveBuffer,
+                    int                 receiveSize);
+
+    //! Frees the persistent requests, when present
+    void freeRequests();
+
+    //! The send buffer the requests were set up for
+    const void* sendBuffer_ = nullptr;
+    //! The number of bytes to send
+    int sendSize_ = 0;
+    //! The receive buffer the requests were set up for
+    void* receiveBuffer_ = nullptr;
+    //! The number of bytes to receive
+    int receiveSize_ = 0;
+    //! The rank to send to
+    int sendRank_ = -1;
+    //! The rank to receive from
+    int receiveRank_ = -1;
+    //! The MPI requests, the first \p numRequests_ are used
+    MPI_Request requests_[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    //! The number of requests
+    int numRequests_ = 0;
+    //! Whether the requests are persistent and need to be freed
+    bool havePersistentRequests_ = false;
+    //! Whether the communication has been started and not waited for
+    bool isInFlight_ = false;
+    //! The number of times the communication has been set up
+    int numSetups_ = 0;
+};
+
+//! Extern declaration for gmx::RVec specialization
+extern template void
+DDPersistentSendrecv::start<gmx::RVec>(const gmx_domdec_t*      dd,
+                                       int                      ddDimensionIndex,
+                                       int                      direction,
+                                       gmx::ArrayRef<gmx::RVec> sendBuffer,
+                                       gmx::ArrayRef<gmx::RVec> receiveBuffer);
+
 /*! \brief Move revc's in the comm. region one cell along the domain decomposition
  *
  * Moves in dimension indexed by ddimind, simultaneously in the forward
@@ -45,6 +45,9 @@
 
 #include "ga2la.h"
 
+//! The minimum number of atoms for threading batch insertion in the direct list
+static constexpr int c_minNumAtomsForThreading = 4096;
+
 /*! \brief Returns whether to use a direct list only
  *
  * There are two methods implemented for finding the local atom number
@@ -80,3 +83,66 @@ gmx_ga2la_t::gmx_ga2la_t(int numAtomsTotal, int numAtomsLocal) :
         new (&(data_.hashed)) gmx::HashedMap<Entry>(numAtomsLocal);
     }
 }
+
+void gmx_ga2la_t::insertBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                              const int                localAtomBegin,
+                              const int                cell,
+                              const int                numThreads)
+{
+    if (usingDirect_)
+    {
+        /* Each global atom index occurs only once, so threads write disjoint entries */
+        const int numAtoms = globalAtomIndices.ssize();
+#pragma omp parallel for num_threads(numThreads) schedule(static) \
+        if (numAtoms >= c_minNumAtomsForThreading)
+        for (int i = 0; i < numAtoms; i++)
+        {
+            const int a_gl = globalAtomIndices[i];
+            GMX_ASSERT(a_gl >= 0, "Only global atom indices >= 0 are supported");
+            GMX_ASSERT(data_.direct[a_gl].cell == -1,
+                       "The key to be inserted should not be present");
+            data_.direct[a_gl] = { localAtomBegin + i, cell };
+        }
+    }
+    else
+    {
+        data_.hashed.insertBatch(
+                globalAtomIndices,
+                [localAtomBegin, cell](int i) -> Entry { return { localAtomBegin + i, cell }; },
+                numThreads);
+    }
+}
+
+void gmx_ga2la_t::findHomeBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                                std::vector<int>*        localAtomIndices,
+                                std::vector<int>*        listIndices) const
+{
+    localAtomIndices->clear();
+    listIndices->clear();
+
+    const int numIndices = globalAtomIndices.ssize();
+    if (usingDirect_)
+    {
+        for (int i = 0; i < numIndices; i++)
+        {
+            const Entry& entry = data_.direct[globalAtomIndices[i]];
+            if (entry.cell == 0)
+            {
+                localAtomIndices->push_back(entry.la);
+                listIndices->push_back(i);
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numIndices; i++)
+        {
+            const Entry* entry = data_.hashed.find(globalAtomIndices[i]);
+            if (entry && entry->cell == 0)
+            {
+                localAtomIndices->push_back(entry->la);
+                listIndices->push_back(i);
+            }
+        }
+    }
+}
@@ -52,6 +52,7 @@
 #include <vector>
 
 #include "gromacs/domdec/hashedmap.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/gmxassert.h"
 
 /*! \libinternal \brief Global to local atom mapping
@@ -97,6 +98,21 @@ public:
         }
     }
 
+    /*! \brief Inserts entries for consecutive local atoms, the global atoms should not be present
+     *
+     * Global atom \p globalAtomIndices[i] gets local atom index
+     * \p localAtomBegin + i and cell \p cell.
+     *
+     * \param[in] globalAtomIndices  The global atom indices
+     * \param[in] localAtomBegin     The local atom index for the first global atom index
+     * \param[in] cell               The cell for all entries
+     * \param[in] numThreads         The maximum number of OpenMP threads to use
+     */
+    void insertBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                     int                      localAtomBegin,
+                     int                      cell,
+                     int                      numThreads);
+
     //! Delete the entry for global atom a_gl
     void erase(int a_gl)
     {
@@ -130,6 +146,16 @@ public:
         return (e && e->cell == 0) ? &(e->la) : nullptr;
     }
 
+    /*! \brief Finds the home atoms in a list of global atom indices
+     *
+     * \param[in]  globalAtomIndices  The global atom indices to look up
+     * \param[out] localAtomIndices   The local indices of the home atoms found
+     * \param[out] listIndices        The indices in \p globalAtomIndices of these atoms
+     */
+    void findHomeBatch(gmx::ArrayRef<const int> globalAtomIndices,
+                       std::vector<int>*        localAtomIndices,
+                       std::vector<int>*        listIndices) const;
+
     /*! \brief Returns a reference to the entry for a_gl
      *
      * A non-release assert checks that a_gl is present.
@@ -48,12 +48,14 @@
 #define GMX_DOMDEC_HASHEDMAP_H
 
 #include <climits>
+#include <cstdint>
 
 #include <algorithm>
 #include <utility>
 #include <vector>
 
 #include "gromacs/compat/utility.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/exceptions.h"
 
@@ -84,6 +86,8 @@ private:
     static constexpr float c_relTableSizeThresholdMin = 1.3;
     /*! \brief Threshold for decreasing the table size */
     static constexpr float c_relTableSizeThresholdMax = 3.5;
+    /*! \brief The minimum number of keys per thread for threading batch insertion */
+    static constexpr int c_minNumKeysPerThread = 1024;
 
     /*! \brief Resizes the table
      *
@@ -220,6 +224,181 @@ public:
      */
     void insert_or_assign(int key, const T& value) { insert_assign<true>(key, value); }
 
+    /*! \brief Inserts a batch of entries, the keys should not already be present
+     *
+     * The value for \p keys[i] is given by \p valueForIndex(i).
+     * With \p numThreads > 1 and large batches the insertion is distributed
+     * over OpenMP threads without locks or atomics. The keys are sorted
+     * by hash over the threads, so each thread handles the keys for its
+     * own range of the table. First the keys that hash to an unused table
+     * entry are inserted. Then the calling thread collects free entries
+     * for the remaining keys, after which each thread adds these entries
+     * to the lists of its own range.
+     *
+     * \tparam    ValueForIndex  Function type, should be callable concurrently
+     * \param[in] keys           The keys for the entries
+     * \param[in] valueForIndex  Function that returns the value for key index i
+     * \param[in] numThreads     The maximum number of OpenMP threads to use
+     * \throws InvalidInputError from a debug build when attempting to insert a duplicate key
+     */
+    template<typename ValueForIndex>
+    void insertBatch(ArrayRef<const int> keys, const ValueForIndex& valueForIndex, int numThreads)
+    {
+        const int numKeys = keys.ssize();
+
+        numThreads = std::min(numThreads, numKeys / c_minNumKeysPerThread);
+        if (numThreads <= 1)
+        {
+            for (int i = 0; i < numKeys; i++)
+            {
+                insert(keys[i], valueForIndex(i));
+            }
+            return;
+        }
+
+        const int numBuckets     = bucket_count();
+        int       log2NumBuckets = 0;
+        while ((1 << log2NumBuckets) < numBuckets)
+        {
+            log2NumBuckets++;
+        }
+
+        threadBinnedKeyIndices_.resize(numThreads);
+        threadKeyIndicesForListEntries_.resize(numThreads);
+        threadListEntryOffsets_.resize(numThreads + 1);
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+        for (int thread = 0; thread < numThreads; thread++)
+        {
+            try
+            {
+                /* Sort our part of the keys by the thread that handles their bucket,
+                 * thread t handles a contiguous range of about numBuckets/numThreads buckets.
+                 */
+                std::vector<std::vector<int>>& binnedKeyIndices = threadBinnedKeyIndices_[thread];
+                binnedKeyIndices.resize(numThreads);
+                for (std::vector<int>& keyIndices : binnedKeyIndices)
+                {
+                    keyIndices.clear();
+                }
+                const int keyBegin = (numKeys * int64_t(thread)) / numThreads;
+                const int keyEnd   = (numKeys * int64_t(thread + 1)) / numThreads;
+                for (int i = keyBegin; i < keyEnd; i++)
+                {
+                    const int64_t ind = (keys[i] & bitMask_);
+                    binnedKeyIndices[(ind * numThreads) >> log2NumBuckets].push_back(i);
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        int  numInserted      = 0;
+        bool haveDuplicateKey = false;
+#pragma omp parallel for num_threads(numThreads) schedule(static) \
+        reduction(+ : numInserted) reduction(|| : haveDuplicateKey)
+        for (int thread = 0; thread < numThreads; thread++)
+        {
+            try
+            {
+                /* Insert the keys in our buckets when the entry is not in use */
+                std::vector<int>& keyIndicesForList = threadKeyIndicesForListEntries_[thread];
+                keyIndicesForList.clear();
+                for (int sourceThread = 0; sourceThread < numThreads; sourceThread++)
+                {
+                    for (const int i : threadBinnedKeyIndices_[sourceThread][thread])
+                    {
+                        const int ind = (keys[i] & bitMask_);
+                        if (table_[ind].key < 0)
+                        {
+                            table_[ind].key   = keys[i];
+                            table_[ind].value = valueForIndex(i);
+                            numInserted++;
+                        }
+                        else if (table_[ind].key == keys[i])
+                        {
+                            haveDuplicateKey = true;
+                        }
+                        else
+                        {
+                            keyIndicesForList.push_back(i);
+                        }
+                    }
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        /* Collect the free entries for the linked list entries */
+        threadListEntryOffsets_[0] = 0;
+        for (int thread = 0; thread < numThreads; thread++)
+        {
+            threadListEntryOffsets_[thread + 1] = threadListEntryOffsets_[thread]
+                                                  + threadKeyIndicesForListEntries_[thread].size();
+        }
+        const int numListEntries = threadListEntryOffsets_[numThreads];
+        freeListEntries_.resize(numListEntries);
+        int freeIndex = startIndexForSpaceForListEntry_;
+        for (int entry = 0; entry < numListEntries; entry++)
+        {
+            while (freeIndex < gmx::ssize(table_) && table_[freeIndex].key >= 0)
+            {
+                freeIndex++;
+            }
+            /* If we are at the end of the list we need to increase the size */
+            if (freeIndex == gmx::ssize(table_))
+            {
+                table_.resize(table_.size() + numListEntries - entry);
+            }
+            freeListEntries_[entry] = freeIndex;
+            freeIndex++;
+        }
+        startIndexForSpaceForListEntry_ = freeIndex;
+
+#pragma omp parallel for num_threads(numThreads) schedule(static) \
+        reduction(+ : numInserted) reduction(|| : haveDuplicateKey)
+        for (int thread = 0; thread < numThreads; thread++)
+        {
+            try
+            {
+                int entry = threadListEntryOffsets_[thread];
+                for (const int i : threadKeyIndicesForListEntries_[thread])
+                {
+                    const int key         = keys[i];
+                    const int head        = (key & bitMask_);
+                    bool      isDuplicate = false;
+                    for (int ind = head; ind >= 0; ind = table_[ind].next)
+                    {
+                        isDuplicate = isDuplicate || (table_[ind].key == key);
+                    }
+                    if (isDuplicate)
+                    {
+                        haveDuplicateKey = true;
+                        continue;
+                    }
+                    /* Link the new entry directly after the first entry of the list */
+                    const int ind     = freeListEntries_[entry++];
+                    table_[ind].key   = key;
+                    table_[ind].value = valueForIndex(i);
+                    table_[ind].next  = table_[head].next;
+                    table_[head].next = ind;
+                    numInserted++;
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        numElements_ += numInserted;
+
+#ifndef NDEBUG
+        if (haveDuplicateKey)
+        {
+            GMX_THROW(InvalidInputError("Attempt to insert duplicate key"));
+        }
+#else
+        GMX_UNUSED_VALUE(haveDuplicateKey);
+#endif
+    }
+
     /*! \brief Delete the entry for key \p key, when present
      *
      * \param[in] key  The key
@@ -235,7 +414,16 @@ public:
                 if (ind_prev >= 0)
                 {
                     table_[ind_prev].next = table_[ind].next;
-
+                }
+                else if (table_[ind].next >= 0)
+                {
+                    /* Move the second entry in the list to the first position */
+                    const int indFirst = ind;
+                    ind                = table_[indFirst].next;
+                    table_[indFirst]   = table_[ind];
+                }
+                if (ind >= bucket_count())
+                {
                     /* This index is a linked entry, so we free an entry.
                      * Check if we are creating the first empty space.
                      */
@@ -329,6 +517,14 @@ private:
     int startIndexForSpaceForListEntry_ = 0;
     /*! \brief The number of elements currently stored in the table */
     int numElements_ = 0;
+    /*! \brief Per thread, its part of the key indices of a batch sorted by inserting thread */
+    std::vector<std::vector<std::vector<int>>> threadBinnedKeyIndices_;
+    /*! \brief Per thread, the indices of keys in a batch that need a linked list entry */
+    std::vector<std::vector<int>> threadKeyIndicesForListEntries_;
+    /*! \brief The offsets of the threads in freeListEntries_ */
+    std::vector<int> threadListEntryOffsets_;
+    /*! \brief Free entries in table_ for the linked list entries for a batch */
+    std::vector<int> freeListEntries_;
 };
 
 } // namespace gmx
@@ -68,30 +68,14 @@ LocalAtomSetData::LocalAtomSetData(ArrayRef<const index> globalIndex) :
 
 void LocalAtomSetData::setLocalAndCollectiveIndices(const gmx_ga2la_t& ga2la)
 {
-    /* Loop over all the atom indices of the set to check which ones are local.
-     * cf. dd_make_local_group_indices in groupcoord.cpp
+    /* Check which atoms of the set are local, cf. dd_make_local_group_indices in groupcoord.cpp.
+     * The collective index keeps track of where this local atom belongs in the collective
+     * index array. This is needed when reducing the local arrays to a collective/global array
+     * in communicate_group_positions.
+     * The vectors are cleared without changing capacity,
+     * because we expect the size of the vectors to vary little.
      */
-    int numAtomsGlobal = globalIndex_.size();
-
-    /* Clear vector without changing capacity,
-     * because we expect the size of the vectors to vary little. */
-    localIndex_.resize(0);
-    collectiveIndex_.resize(0);
-
-    for (int iCollective = 0; iCollective < numAtomsGlobal; iCollective++)
-    {
-        if (const int* iLocal = ga2la.findHome(globalIndex_[iCollective]))
-        {
-            /* Save the atoms index in the local atom numbers array */
-            /* The atom with this index is a home atom. */
-            localIndex_.push_back(*iLocal);
-
-            /* Keep track of where this local atom belongs in the collective index array.
-             * This is needed when reducing the local arrays to a collective/global array
-             * in communicate_group_positions */
-            collectiveIndex_.push_back(iCollective);
-        }
-    }
+    ga2la.findHomeBatch(globalIndex_, &localIndex_, &collectiveIndex_);
 }
 
 } // namespace internal
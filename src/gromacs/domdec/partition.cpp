@@ -98,6 +98,7 @@
 #include "box.h"
 #include "cellsizes.h"
 #include "distribute.h"
+#include "dlbloadmodel.h"
 #include "domdec_constraints.h"
 #include "domdec_internal.h"
 #include "domdec_vsite.h"
@@ -506,35 +507,35 @@ static void make_dd_indices(gmx_domdec_t* dd, const int atomStart)
         gmx_incons("dd->ncg_zone is not up to date");
     }
 
-    /* Make the local to global and global to local atom index */
-    int a = atomStart;
-    globalAtomIndices.resize(a);
+    /* Make the local to global atom index, local atom indices are
+     * the same as the atom (group) indices here.
+     */
+    globalAtomIndices.resize(atomStart);
+    globalAtomIndices.insert(globalAtomIndices.end(),
+                             globalAtomGroupIndices.begin() + atomStart,
+                             globalAtomGroupIndices.begin() + zone2cg[numZones]);
+
+    /* Make the global to local atom index, in batches of atoms with the same cell */
+    gmx::ArrayRef<const int> localToGlobal = globalAtomIndices;
+    const int                numThreads    = gmx_omp_nthreads_get(ModuleMultiThread::Domdec);
     for (int zone = 0; zone < numZones; zone++)
     {
-        int cg0;
-        if (zone == 0)
-        {
-            cg0 = atomStart;
-        }
-        else
+        const int cg0    = (zone == 0) ? atomStart : zone2cg[zone];
+        const int cg1    = zone2cg[zone + 1];
+        const int cg1_p1 = std::min(cg0 + zone_ncg1[zone], cg1);
+
+        if (cg0 < cg1_p1)
         {
-            cg0 = zone2cg[zone];
+            ga2la.insertBatch(localToGlobal.subArray(cg0, cg1_p1 - cg0), cg0, zone, numThreads);
         }
-        int cg1    = zone2cg[zone + 1];
-        int cg1_p1 = cg0 + zone_ncg1[zone];
-
-        for (int cg = cg0; cg < cg1; cg++)
+        /* Signal that these atoms are from more than one pulse away */
+        const int cg0_p2 = std::max(cg0, cg1_p1);
+        if (cg0_p2 < cg1)
         {
-            int zone1 = zone;
-            if (cg >= cg1_p1)
-            {
-                /* Signal that this cg is from more than one pulse away */
-                zone1 += numZones;
-            }
-            int cg_gl = globalAtomGroupIndices[cg];
-            globalAtomIndices.push_back(cg_gl);
-            ga2la.insert(cg_gl, { a, zone1 });
-            a++;
+            ga2la.insertBatch(localToGlobal.subArray(cg0_p2, cg1 - cg0_p2),
+                              cg0_p2,
+                              zone + numZones,
+                              numThreads);
         }
     }
 }
@@ -761,7 +762,7 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle* wcycle)
 {
     gmx_domdec_comm_t* comm;
     domdec_load_t*     load;
-    float              cell_frac = 0, sbuf[DD_NLOAD_MAX];
+    float              cell_frac = 0, sbuf[DD_NLOAD_MAX + DIM * c_dlbLoadModelNumBins];
     gmx_bool           bSepPME;
 
     if (debug)
@@ -775,6 +776,8 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle* wcycle)
 
     bSepPME = (dd->pme_nodeid >= 0);
 
+    const bool useLoadModel = (isDlbOn(comm->dlbState) && comm->ddSettings.useDlbLoadModel);
+
     if (dd->ndim == 0 && bSepPME)
     {
         /* Without decomposition, but with PME nodes, we need the load */
@@ -839,6 +842,20 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle* wcycle)
                     sbuf[pos++] = comm->load[d + 1].pme;
                 }
             }
+            if (useLoadModel)
+            {
+                if (d == dd->ndim - 1)
+                {
+                    calibrateDlbLoadModelProfiles(sbuf[0], comm->dlbLoadModelProfiles);
+                }
+                /* Send the load profiles along dimensions 0 to d of our part of the row */
+                gmx::ArrayRef<const float> profiles =
+                        (d == dd->ndim - 1 ? comm->dlbLoadModelProfiles : comm->load[d + 1].profile);
+                for (int b = 0; b < (d + 1) * c_dlbLoadModelNumBins; b++)
+                {
+                    sbuf[pos++] = profiles[b];
+                }
+            }
             load->nload = pos;
             /* Communicate a row in DD direction d.
              * The communicators are setup such that the root always has rank 0.
@@ -869,7 +886,16 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle* wcycle)
                 load->flags    = 0;
                 load->mdf      = 0;
                 load->pme      = 0;
-                int pos        = 0;
+                if (useLoadModel)
+                {
+                    load->profile.assign(d * c_dlbLoadModelNumBins, 0.0F);
+                    load->cellProfiles.resize(dd->numCells[dim] * c_dlbLoadModelNumBins);
+                }
+                else
+                {
+                    load->cellProfiles.clear();
+                }
+                int pos = 0;
                 for (int i = 0; i < dd->numCells[dim]; i++)
                 {
                     load->sum += load->load[pos++];
@@ -908,6 +934,20 @@ static void get_load_distribution(gmx_domdec_t* dd, gmx_wallcycle* wcycle)
                         load->pme = std::max(load->pme, load->load[pos]);
                         pos++;
                     }
+                    if (useLoadModel)
+                    {
+                        /* Sum the profiles along the lower dimensions over the row
+                         * and store the profile of each cell along this dimension.
+                         */
+                        for (int b = 0; b < d * c_dlbLoadModelNumBins; b++)
+                        {
+                            load->profile[b] += load->load[pos++];
+                        }
+                        for (int b = 0; b < c_dlbLoadModelNumBins; b++)
+                        {
+                            load->cellProfiles[i * c_dlbLoadModelNumBins + b] = load->load[pos++];
+                        }
+                    }
                 }
                 if (isDlbOn(comm->dlbState) && rowMaster->dlbIsLimited)
                 {
@@ -1167,6 +1207,27 @@ static float dd_f_imbal(gmx_domdec_t* dd)
     }
 }
 
+/*! \brief Return the measured load imbalance along the first DD dimension
+ *
+ * Should only be called on the DD master rank with DLB on.
+ */
+static float dd_row_imbal(const gmx_domdec_t* dd)
+{
+    const domdec_load_t& load     = dd->comm->load[0];
+    const int            numCells = dd->numCells[dd->dim[0]];
+
+    float sum = 0;
+    float max = 0;
+    for (int i = 0; i < numCells; i++)
+    {
+        /* The third load value is the (limited) load sum of the cell */
+        sum += load.load[i * load.nload + 2];
+        max = std::max(max, load.load[i * load.nload + 2]);
+    }
+
+    return (sum > 0 ? max * numCells / sum - 1.0F : 0.0F);
+}
+
 //! Returns DD load balance report.
 static std::string dd_print_load(gmx_domdec_t* dd, int64_t step)
 {
@@ -1200,6 +1261,19 @@ static std::string dd_print_load(gmx_domdec_t* dd, int64_t step)
         log.writeStringFormatted("  pme mesh/force %5.3f", dd_pme_f_ratio(dd));
     }
     log.ensureLineBreak();
+    if (isDlbOn(dd->comm->dlbState) && dd->ndim > 0)
+    {
+        const RowMaster* rowMaster = dd->comm->cellsizesWithDlb[0].rowMaster.get();
+        if (rowMaster->predictedImbalance >= 0)
+        {
+            log.writeStringFormatted(
+                    "DD  load model imb. along %c: predicted %4.1f%% measured %4.1f%%",
+                    dim2char(dd->dim[0]),
+                    rowMaster->predictedImbalance * 100,
+                    dd_row_imbal(dd) * 100);
+            log.ensureLineBreak();
+        }
+    }
     return stream.toString();
 }
 
@@ -2504,21 +2578,28 @@ static void set_zones_size(gmx_domdec_t*      dd,
 template<typename T>
 static void orderVector(gmx::ArrayRef<const gmx_cgsort_t> sort,
                         gmx::ArrayRef<T>                  dataToSort,
-                        gmx::ArrayRef<T>                  sortBuffer)
+                        gmx::ArrayRef<T>                  sortBuffer,
+                        int                               numThreads)
 {
     GMX_ASSERT(dataToSort.size() >= sort.size(), "The vector needs to be sufficiently large");
     GMX_ASSERT(sortBuffer.size() >= sort.size(),
                "The sorting buffer needs to be sufficiently large");
 
+    const int numElements = sort.ssize();
+
     /* Order the data into the temporary buffer */
-    size_t i = 0;
-    for (const gmx_cgsort_t& entry : sort)
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numElements; i++)
     {
-        sortBuffer[i++] = dataToSort[entry.ind];
+        sortBuffer[i] = dataToSort[sort[i].ind];
     }
 
     /* Copy back to the original array */
-    std::copy(sortBuffer.begin(), sortBuffer.begin() + sort.size(), dataToSort.begin());
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < numElements; i++)
+    {
+        dataToSort[i] = sortBuffer[i];
+    }
 }
 
 /*! \brief Order data in \p dataToSort according to \p sort
@@ -2529,33 +2610,64 @@ static void orderVector(gmx::ArrayRef<const gmx_cgsort_t> sort,
 template<typename T>
 static void orderVector(gmx::ArrayRef<const gmx_cgsort_t> sort,
                         gmx::ArrayRef<T>                  vectorToSort,
-                        std::vector<T>*                   workVector)
+                        std::vector<T>*                   workVector,
+                        int                               numThreads)
 {
     if (gmx::index(workVector->size()) < sort.ssize())
     {
         workVector->resize(sort.size());
     }
-    orderVector<T>(sort, vectorToSort, *workVector);
+    orderVector<T>(sort, vectorToSort, *workVector, numThreads);
 }
 
 //! Returns the sorting order for atoms based on the nbnxn grid order in sort
-static void dd_sort_order_nbnxn(const t_forcerec* fr, std::vector<gmx_cgsort_t>* sort)
+static void dd_sort_order_nbnxn(const t_forcerec*          fr,
+                                std::vector<gmx_cgsort_t>* sort,
+                                int                        numThreads)
 {
     gmx::ArrayRef<const int> atomOrder = fr->nbv->getLocalAtomOrder();
 
     /* Using push_back() instead of this resize results in much slower code */
     sort->resize(atomOrder.size());
-    gmx::ArrayRef<gmx_cgsort_t> buffer    = *sort;
-    size_t                      numSorted = 0;
-    for (int i : atomOrder)
+    gmx::ArrayRef<gmx_cgsort_t> buffer = *sort;
+
+    /* The grid order contains filler entries, marked with -1, which we
+     * need to skip. Each thread handles a contiguous part of the order,
+     * so we first count the atoms per part to obtain the output offsets.
+     */
+    std::vector<int> threadOffsets(numThreads + 1, 0);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        const int start = (thread * atomOrder.ssize()) / numThreads;
+        const int end   = ((thread + 1) * atomOrder.ssize()) / numThreads;
+
+        threadOffsets[thread + 1] = std::count_if(
+                atomOrder.begin() + start, atomOrder.begin() + end, [](int i) { return i >= 0; });
+    }
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        threadOffsets[thread + 1] += threadOffsets[thread];
+    }
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
     {
-        if (i >= 0)
+        const int start = (thread * atomOrder.ssize()) / numThreads;
+        const int end   = ((thread + 1) * atomOrder.ssize()) / numThreads;
+
+        int numSorted = threadOffsets[thread];
+        for (int j = start; j < end; j++)
         {
-            /* The values of nsc and ind_gl are not used in this case */
-            buffer[numSorted++].ind = i;
+            const int i = atomOrder[j];
+            if (i >= 0)
+            {
+                /* The values of nsc and ind_gl are not used in this case */
+                buffer[numSorted++].ind = i;
+            }
         }
     }
-    sort->resize(numSorted);
+    sort->resize(threadOffsets[numThreads]);
 }
 
 //! Returns the sorting state for DD.
@@ -2563,7 +2675,9 @@ static void dd_sort_state(gmx_domdec_t* dd, t_forcerec* fr, t_state* state)
 {
     gmx_domdec_sort_t* sort = dd->comm->sort.get();
 
-    dd_sort_order_nbnxn(fr, &sort->sorted);
+    const int numThreads = gmx_omp_nthreads_get(ModuleMultiThread::Domdec);
+
+    dd_sort_order_nbnxn(fr, &sort->sorted, numThreads);
 
     /* We alloc with the old size, since cgindex is still old */
     DDBufferAccess<gmx::RVec> rvecBuffer(dd->comm->rvecBuffer, dd->numHomeAtoms);
@@ -2582,21 +2696,21 @@ static void dd_sort_state(gmx_domdec_t* dd, t_forcerec* fr, t_state* state)
 
     if (state->flags & enumValueToBitMask(StateEntry::X))
     {
-        orderVector(cgsort, makeArrayRef(state->x), rvecBuffer.buffer);
+        orderVector(cgsort, makeArrayRef(state->x), rvecBuffer.buffer, numThreads);
     }
     if (state->flags & enumValueToBitMask(StateEntry::V))
     {
-        orderVector(cgsort, makeArrayRef(state->v), rvecBuffer.buffer);
+        orderVector(cgsort, makeArrayRef(state->v), rvecBuffer.buffer, numThreads);
     }
     if (state->flags & enumValueToBitMask(StateEntry::Cgp))
     {
-        orderVector(cgsort, makeArrayRef(state->cg_p), rvecBuffer.buffer);
+        orderVector(cgsort, makeArrayRef(state->cg_p), rvecBuffer.buffer, numThreads);
     }
 
     /* Reorder the global cg index */
-    orderVector<int>(cgsort, dd->globalAtomGroupIndices, &sort->intBuffer);
+    orderVector<int>(cgsort, dd->globalAtomGroupIndices, &sort->intBuffer, numThreads);
     /* Reorder the atom info */
-    orderVector<int64_t>(cgsort, fr->atomInfo, &sort->int64Buffer);
+    orderVector<int64_t>(cgsort, fr->atomInfo, &sort->int64Buffer, numThreads);
     /* Set the home atom number */
     dd->comm->atomRanges.setEnd(DDAtomRanges::Type::Home, dd->numHomeAtoms);
 
@@ -2837,6 +2951,16 @@ void dd_partition_system(FILE*                     fplog,
         if (bDoDLB || bLogLoad || bCheckWhetherToTurnDlbOn
             || (bVerbose && (inputrec.nstlist == 0 || nstglobalcomm <= inputrec.nstlist)))
         {
+            if (isDlbOn(comm->dlbState) && comm->ddSettings.useDlbLoadModel)
+            {
+                comm->dlbLoadModelProfiles.resize(dd->ndim * c_dlbLoadModelNumBins);
+                computeDlbLoadModelProfiles(*dd,
+                                            state_local->box,
+                                            state_local->x,
+                                            *fr->nbv,
+                                            top_local->idef,
+                                            comm->dlbLoadModelProfiles);
+            }
             get_load_distribution(dd, wcycle);
             if (DDMASTER(dd))
             {
@@ -3132,6 +3256,10 @@ void dd_partition_system(FILE*                     fplog,
         {
             fprintf(debug, "Step %s, sorting the %d home charge groups\n", gmx_step_str(step, sbuf), dd->numHomeAtoms);
         }
+        wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDGrid);
+
+        wallcycle_sub_start(wcycle, WallCycleSubCounter::DDSortState);
+
         dd_sort_state(dd, fr, state_local);
 
         /* After sorting and compacting we set the correct size */
@@ -3141,7 +3269,7 @@ void dd_partition_system(FILE*                     fplog,
         dd->ga2la->clear(false);
         ncgindex_set = 0;
 
-        wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDGrid);
+        wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDSortState);
     }
     else
     {
@@ -3162,18 +3290,31 @@ void dd_partition_system(FILE*                     fplog,
         comm->updateGroupsCog->clear();
     }
 
-    wallcycle_sub_start(wcycle, WallCycleSubCounter::DDSetupComm);
+    wallcycle_sub_start(wcycle, WallCycleSubCounter::DDMakeIndices);
 
     /* Set the induces for the home atoms */
     set_zones_numHomeAtoms(dd);
     make_dd_indices(dd, ncgindex_set);
 
+    wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDMakeIndices);
+
+    wallcycle_sub_start(wcycle, WallCycleSubCounter::DDSetupComm);
+
     /* Setup up the communication and communicate the coordinates */
     setup_dd_communication(dd, state_local->box, &ddbox, fr, state_local);
 
+    wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDSetupComm);
+
+    /* The halo atom indices are part of the same, single counted, phase */
+    wallcycle_sub_start_nocount(wcycle, WallCycleSubCounter::DDMakeIndices);
+
     /* Set the indices for the halo atoms */
     make_dd_indices(dd, dd->numHomeAtoms);
 
+    wallcycle_sub_stop(wcycle, WallCycleSubCounter::DDMakeIndices);
+
+    wallcycle_sub_start_nocount(wcycle, WallCycleSubCounter::DDSetupComm);
+
     /* Set the charge group boundaries for neighbor searching */
     set_cg_boundaries(&comm->zones);
 
@@ -49,6 +49,10 @@
 
 #include <cstring>
 
+#include <algorithm>
+#include <array>
+#include <vector>
+
 #include "gromacs/domdec/domdec_network.h"
 #include "gromacs/domdec/ga2la.h"
 #include "gromacs/gmxlib/nrnb.h"
@@ -84,68 +88,89 @@ static inline int DD_FLAG_BW(int d)
     return 1 << (16 + d * 2 + 1);
 }
 
-static void copyMovedAtomsToBufferPerAtom(gmx::ArrayRef<const int> move,
-                                          int                      nvec,
-                                          int                      vec,
-                                          rvec*                    src,
-                                          gmx_domdec_comm_t*       comm)
+/*! \brief Counts the atoms in the range \p atomStart to \p atomEnd that move along each direction
+ *
+ * The counts are added to \p numMoved, which should have DIM*2 elements.
+ */
+static void countMovedAtoms(gmx::ArrayRef<const int> move, int atomStart, int atomEnd, int* numMoved)
 {
-    int pos_vec[DIM * 2] = { 0 };
-
-    for (gmx::index i = 0; i < move.ssize(); i++)
+    for (int a = atomStart; a < atomEnd; a++)
     {
-        /* Skip moved atoms */
-        const int m = move[i];
-        if (m >= 0)
+        if (move[a] >= 0)
         {
-            /* Copy to the communication buffer */
-            pos_vec[m] += 1 + vec;
-            copy_rvec(src[i], comm->cgcm_state[m][pos_vec[m]++]);
-            pos_vec[m] += nvec - vec - 1;
+            numMoved[move[a] & DD_FLAG_NRCG]++;
         }
     }
 }
 
-static void copyMovedUpdateGroupCogs(gmx::ArrayRef<const int>       move,
-                                     int                            nvec,
-                                     gmx::ArrayRef<const gmx::RVec> coordinates,
-                                     gmx_domdec_comm_t*             comm)
+/*! \brief Copies the atoms in the range \p atomStart to \p atomEnd that move to the communication buffers
+ *
+ * The moved atoms are stored in the buffers of their move direction starting
+ * at the buffer entries given by \p bufferOffset. This allows several threads
+ * to pack disjoint atom ranges into the same buffers.
+ *
+ * With update groups we send over their COGs.
+ * Without update groups we send the moved atom coordinates
+ * over twice. This is so the code that unpacks the buffers can be used
+ * without many conditionals both with and without update groups.
+ */
+static void packMovedAtoms(const gmx_domdec_t&      dd,
+                           const t_state&           state,
+                           int                      nvec,
+                           gmx::ArrayRef<const int> move,
+                           int                      atomStart,
+                           int                      atomEnd,
+                           const int*               bufferOffset,
+                           int*                     cell_index)
 {
-    int pos_vec[DIM * 2] = { 0 };
+    gmx_domdec_comm_t* comm = dd.comm.get();
+
+    const bool bV   = (state.flags & enumValueToBitMask(StateEntry::V)) != 0;
+    const bool bCGP = (state.flags & enumValueToBitMask(StateEntry::Cgp)) != 0;
 
-    for (gmx::index g = 0; g < move.ssize(); g++)
+    int pos[DIM * 2];
+    std::copy(bufferOffset, bufferOffset + DIM * 2, pos);
+
+    for (int a = atomStart; a < atomEnd; a++)
     {
-        /* Skip moved atoms */
-        const int m = move[g];
-        if (m >= 0)
+        if (move[a] < 0)
         {
-            /* Copy to the communication buffer */
-            const gmx::RVec& cog =
-                    (comm->systemInfo.useUpdateGroups ? comm->updateGroupsCog->cogForAtom(g)
-                                                      : coordinates[g]);
-            copy_rvec(cog, comm->cgcm_state[m][pos_vec[m]]);
-            pos_vec[m] += 1 + nvec;
+            continue;
         }
-    }
-}
 
-static void clear_and_mark_ind(gmx::ArrayRef<const int> move,
-                               gmx::ArrayRef<const int> globalAtomIndices,
-                               gmx_ga2la_t*             ga2la,
-                               int*                     cell_index)
-{
-    for (gmx::index a = 0; a < move.ssize(); a++)
-    {
-        if (move[a] >= 0)
+        // The value in move[a] was computed by computeMoveFlags
+        // and describes how this atom should move between domains.
+        const int flag = move[a] & ~DD_FLAG_NRCG;
+        // mc contains 4 bits that tell which is the first
+        // dimension (bit 1,2,3) that the group needs to be moved
+        // along, and in which direction (bit 0; not set for fw
+        // and set for bw). However the value is always in
+        // the range [0,6)
+        const int mc = move[a] & DD_FLAG_NRCG;
+        const int i  = pos[mc]++;
+
+        comm->cggl_flag[mc][i * DD_CGIBS]     = dd.globalAtomGroupIndices[a];
+        comm->cggl_flag[mc][i * DD_CGIBS + 1] = flag;
+
+        gmx::RVec* buffer = comm->cgcm_state[mc].data() + i * (1 + nvec);
+
+        *buffer++ = (comm->systemInfo.useUpdateGroups ? comm->updateGroupsCog->cogForAtom(a)
+                                                      : state.x[a]);
+        *buffer++ = state.x[a];
+        if (bV)
         {
-            /* Clear the global indices */
-            ga2la->erase(globalAtomIndices[a]);
-            /* Signal that this atom has moved using the ns cell index.
-             * Here we set it to -1. fill_grid will change it
-             * from -1 to NSGRID_SIGNAL_MOVED_FAC*grid->ncells.
-             */
-            cell_index[a] = -1;
+            *buffer++ = state.v[a];
+        }
+        if (bCGP)
+        {
+            *buffer++ = state.cg_p[a];
         }
+
+        /* Signal that this atom has moved using the ns cell index.
+         * Here we set it to -1. fill_grid will change it
+         * from -1 to NSGRID_SIGNAL_MOVED_FAC*grid->ncells.
+         */
+        cell_index[a] = -1;
     }
 }
 
@@ -677,34 +702,35 @@ void dd_redistribute_cg(FILE*         fplog,
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
+    /* Count the atoms to move per thread, so the threads can pack
+     * their moved atoms into the communication buffers independently.
+     */
+    std::vector<std::array<int, DIM * 2>> threadMoveCounts(nthread);
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        try
+        {
+            threadMoveCounts[thread].fill(0);
+            countMovedAtoms(move,
+                            (thread * dd->numHomeAtoms) / nthread,
+                            ((thread + 1) * dd->numHomeAtoms) / nthread,
+                            threadMoveCounts[thread].data());
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
     // The counts of atoms to move, forward or backward, over the
     // possible DIM dimensions.
     int nat[DIM * 2] = { 0 };
-    for (int cg = 0; cg < dd->numHomeAtoms; cg++)
+    // Convert the thread counts into offsets in the communication buffers
+    for (auto& threadCounts : threadMoveCounts)
     {
-        if (move[cg] >= 0)
+        for (int mc = 0; mc < DIM * 2; mc++)
         {
-            // The value in move[cg] was computed by computeMoveFlags
-            // and describes how this atom should move between domains.
-            const int flag = move[cg] & ~DD_FLAG_NRCG;
-            // mc contains 4 bits that tell which is the first
-            // dimension (bit 1,2,3) that the group needs to be moved
-            // along, and in which direction (bit 0; not set for fw
-            // and set for bw). However the value is always in
-            // the range [0,6)
-            const int mc = move[cg] & DD_FLAG_NRCG;
-            move[cg]     = mc;
-
-            std::vector<int>& cggl_flag = comm->cggl_flag[mc];
-
-            /* TODO: See if we can use push_back instead */
-            if ((nat[mc] + 1) * DD_CGIBS > gmx::index(cggl_flag.size()))
-            {
-                cggl_flag.resize((nat[mc] + 1) * DD_CGIBS);
-            }
-            cggl_flag[nat[mc] * DD_CGIBS]     = dd->globalAtomGroupIndices[cg];
-            cggl_flag[nat[mc] * DD_CGIBS + 1] = flag;
-            nat[mc]++;
+            const int count  = threadCounts[mc];
+            threadCounts[mc] = nat[mc];
+            nat[mc] += count;
         }
     }
 
@@ -730,6 +756,10 @@ void dd_redistribute_cg(FILE*         fplog,
     /* Make sure the communication buffers are large enough */
     for (int mc = 0; mc < dd->ndim * 2; mc++)
     {
+        if (gmx::index(comm->cggl_flag[mc].size()) < nat[mc] * DD_CGIBS)
+        {
+            comm->cggl_flag[mc].resize(nat[mc] * DD_CGIBS);
+        }
         size_t nvr = nat[mc] * (1 + nvec);
         if (nvr > comm->cgcm_state[mc].size())
         {
@@ -737,28 +767,37 @@ void dd_redistribute_cg(FILE*         fplog,
         }
     }
 
-    /* With update groups we send over their COGs.
-     * Without update groups we send the moved atom coordinates
-     * over twice. This is so the code further down can be used
-     * without many conditionals both with and without update groups.
-     */
-    copyMovedUpdateGroupCogs(move, nvec, state->x, comm);
+    int* moved = getMovedBuffer(comm, 0, dd->numHomeAtoms);
 
-    int vectorIndex = 0;
-    copyMovedAtomsToBufferPerAtom(move, nvec, vectorIndex++, state->x.rvec_array(), comm);
-    if (bV)
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
     {
-        copyMovedAtomsToBufferPerAtom(move, nvec, vectorIndex++, state->v.rvec_array(), comm);
+        try
+        {
+            packMovedAtoms(*dd,
+                           *state,
+                           nvec,
+                           move,
+                           (thread * dd->numHomeAtoms) / nthread,
+                           ((thread + 1) * dd->numHomeAtoms) / nthread,
+                           threadMoveCounts[thread].data(),
+                           moved);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
-    if (bCGP)
+
+    /* Clear the global indices of the moved atoms. This is not thread safe,
+     * but only involves the, usually few, moved atoms. For home atoms
+     * the global atom and atom group indices are identical.
+     */
+    for (int mc = 0; mc < dd->ndim * 2; mc++)
     {
-        copyMovedAtomsToBufferPerAtom(move, nvec, vectorIndex++, state->cg_p.rvec_array(), comm);
+        for (int i = 0; i < nat[mc]; i++)
+        {
+            dd->ga2la->erase(comm->cggl_flag[mc][i * DD_CGIBS]);
+        }
     }
 
-    int* moved = getMovedBuffer(comm, 0, dd->numHomeAtoms);
-
-    clear_and_mark_ind(move, dd->globalAtomIndices, dd->ga2la.get(), moved);
-
     /* Now we can remove the excess global atom-group indices from the list */
     dd->globalAtomGroupIndices.resize(dd->numHomeAtoms);
 
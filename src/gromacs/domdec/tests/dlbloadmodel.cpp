@@ -0,0 +1,137 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the DLB load model.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/dlbloadmodel.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Returns profiles for cells with uniform load density \p cellDensities
+std::vector<float> uniformProfiles(const std::vector<float>& cellDensities)
+{
+    std::vector<float> profiles;
+    for (const float density : cellDensities)
+    {
+        profiles.insert(profiles.end(), c_dlbLoadModelNumBins, density);
+    }
+    return profiles;
+}
+
+TEST(DlbLoadModelTest, BalancedLoadKeepsCellSizes)
+{
+    const std::vector<real>  cellFrac = { 0, 0.25, 0.5, 0.75, 1 };
+    const std::vector<float> profiles = uniformProfiles({ 1, 1, 1, 1 });
+
+    std::vector<real> cellSizes(4);
+    dlbLoadModelCellSizes(cellFrac, profiles, cellSizes);
+    for (const real size : cellSizes)
+    {
+        EXPECT_REAL_EQ_TOL(0.25, size, gmx::test::defaultRealTolerance());
+    }
+    EXPECT_REAL_EQ_TOL(0,
+                       dlbLoadModelImbalance(cellFrac, profiles, cellFrac),
+                       gmx::test::absoluteTolerance(1e-6));
+}
+
+TEST(DlbLoadModelTest, BalancesInOneStep)
+{
+    // The first cell has three times the load density of the second
+    const std::vector<real>  cellFrac = { 0, 0.5, 1 };
+    const std::vector<float> profiles = uniformProfiles({ 3, 1 });
+
+    EXPECT_REAL_EQ_TOL(0.5,
+                       dlbLoadModelImbalance(cellFrac, profiles, cellFrac),
+                       gmx::test::defaultRealTolerance());
+
+    std::vector<real> cellSizes(2);
+    dlbLoadModelCellSizes(cellFrac, profiles, cellSizes);
+    EXPECT_REAL_EQ_TOL(1.0 / 3.0, cellSizes[0], gmx::test::defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(2.0 / 3.0, cellSizes[1], gmx::test::defaultRealTolerance());
+
+    const std::vector<real> newCellFrac = { 0, cellSizes[0], 1 };
+    EXPECT_REAL_EQ_TOL(0,
+                       dlbLoadModelImbalance(cellFrac, profiles, newCellFrac),
+                       gmx::test::absoluteTolerance(1e-6));
+}
+
+TEST(DlbLoadModelTest, HandlesLoadWithinCells)
+{
+    // All load of the second cell is in its last bin, as for a membrane
+    const std::vector<real> cellFrac = { 0, 0.5, 1 };
+    std::vector<float>      profiles = uniformProfiles({ 0, 0 });
+    profiles[0]                             = 1;
+    profiles[2 * c_dlbLoadModelNumBins - 1] = 3;
+
+    std::vector<real> cellSizes(2);
+    dlbLoadModelCellSizes(cellFrac, profiles, cellSizes);
+    // The boundary should be placed at 1/3 into the last bin of the second cell
+    const real binSize = 0.5 / c_dlbLoadModelNumBins;
+    EXPECT_REAL_EQ_TOL(
+            1 - binSize + binSize / 3, cellSizes[0], gmx::test::defaultRealTolerance());
+
+    const std::vector<real> newCellFrac = { 0, cellSizes[0], 1 };
+    EXPECT_REAL_EQ_TOL(0,
+                       dlbLoadModelImbalance(cellFrac, profiles, newCellFrac),
+                       gmx::test::absoluteTolerance(1e-6));
+}
+
+TEST(DlbLoadModelTest, ZeroLoadGivesUniformCells)
+{
+    const std::vector<real>  cellFrac = { 0, 0.2, 1 };
+    const std::vector<float> profiles = uniformProfiles({ 0, 0 });
+
+    std::vector<real> cellSizes(2);
+    dlbLoadModelCellSizes(cellFrac, profiles, cellSizes);
+    EXPECT_REAL_EQ_TOL(0.5, cellSizes[0], gmx::test::defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.5, cellSizes[1], gmx::test::defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0,
+                       dlbLoadModelImbalance(cellFrac, profiles, cellFrac),
+                       gmx::test::absoluteTolerance(1e-6));
+}
+
+} // namespace
@@ -40,7 +40,8 @@
  *  pulse configirations. Each pulse involves a few non-contiguous
  *  indices. The sending rank, atom number and spatial 3D index are
  *  encoded in the x values, to allow correctness checking following
- *  the halo exchange.
+ *  the halo exchange. The non-blocking CPU coordinate and force halo
+ *  exchanges are also tested.
  *
  * \todo Add 3D case
  *
@@ -67,6 +68,8 @@
 #endif
 #include "gromacs/gpu_utils/gpueventsynchronizer.h"
 #include "gromacs/gpu_utils/hostallocator.h"
+#include "gromacs/math/paddedvector.h"
+#include "gromacs/mdtypes/forceoutput.h"
 #include "gromacs/mdtypes/inputrec.h"
 
 #include "testutils/mpitest.h"
@@ -737,6 +740,122 @@ TEST(HaloExchangeTest, Coordinates2dHaloWith2PulsesInDim1)
     }
 }
 
+TEST(HaloExchangeTest, CoordinatesNonBlocking2dHaloWith2PulsesInDim1)
+{
+    GMX_MPI_TEST(RequireRankCount<4>);
+
+    // Set up atom data
+    const int        numHomeAtoms  = 10;
+    const int        numHaloAtoms  = 7;
+    const int        numAtomsTotal = numHomeAtoms + numHaloAtoms;
+    HostVector<RVec> h_x;
+    h_x.resize(numAtomsTotal);
+
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+
+    // Set up dd
+    t_inputrec   ir;
+    gmx_domdec_t dd(ir);
+    dd.mpi_comm_all              = MPI_COMM_WORLD;
+    dd.comm                      = std::make_unique<gmx_domdec_comm_t>();
+    dd.unitCellInfo.haveScrewPBC = false;
+
+    DDAtomRanges atomRanges;
+    atomRanges.setEnd(DDAtomRanges::Type::Home, numHomeAtoms);
+    dd.comm->atomRanges = atomRanges;
+
+    define2dRankTopology(&dd);
+
+    std::vector<gmx_domdec_ind_t> indvec;
+    define2dHaloWith2PulsesInDim1(&dd, &indvec);
+
+    // Perform halo exchange, with the first pulse in flight while the
+    // home atom coordinates are used
+    matrix box = { { 0., 0., 0. } };
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    EXPECT_EQ(h_x[1][XX], encodedValue(rank, 1, XX));
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+
+    // Check results
+    checkResults2dHaloWith2PulsesInDim1(h_x.data(), &dd, numHomeAtoms);
+
+    // The exchange can be repeated
+    initHaloData(h_x.data(), numHomeAtoms, numAtomsTotal);
+    dd_move_x_start(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    dd_move_x_finish(&dd, box, static_cast<ArrayRef<RVec>>(h_x), nullptr);
+    checkResults2dHaloWith2PulsesInDim1(h_x.data(), &dd, numHomeAtoms);
+
+    // The communication of all three pulses is only set up once
+    ASSERT_EQ(3U, dd.comm->coordinateHalo.pulses.size());
+    for (const auto& pulse : dd.comm->coordinateHalo.pulses)
+    {
+        EXPECT_EQ(1, pulse.sendrecv.numSetups());
+    }
+}
+
+TEST(HaloExchangeTest, ForcesNonBlocking1dHaloWith2Pulses)
+{
+    GMX_MPI_TEST(RequireRankCount<4>);
+
+    // Set up force data, with the sending rank, atom number and spatial
+    // 3D index encoded in the forces on the halo atoms
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    const int          numHomeAtoms  = 10;
+    const int          numHaloAtoms  = 5;
+    const int          numAtomsTotal = numHomeAtoms + numHaloAtoms;
+    PaddedVector<RVec> f(numAtomsTotal);
+    for (int i = 0; i < numAtomsTotal; i++)
+    {
+        for (int j = 0; j < DIM; j++)
+        {
+            f[i][j] = i < numHomeAtoms ? 0 : encodedValue(rank, i, j);
+        }
+    }
+    // Without virial computation, no shift forces are needed
+    ForceWithShiftForces forceWithShiftForces(f.arrayRefWithPadding(), false, {});
+
+    // Set up dd
+    t_inputrec   ir;
+    gmx_domdec_t dd(ir);
+    dd.mpi_comm_all              = MPI_COMM_WORLD;
+    dd.comm                      = std::make_unique<gmx_domdec_comm_t>();
+    dd.unitCellInfo.haveScrewPBC = false;
+    dd.comm->zones.n             = 2;
+
+    DDAtomRanges atomRanges;
+    atomRanges.setEnd(DDAtomRanges::Type::Home, numHomeAtoms);
+    atomRanges.setEnd(DDAtomRanges::Type::Zones, numAtomsTotal);
+    dd.comm->atomRanges = atomRanges;
+
+    define1dRankTopology(&dd);
+
+    std::vector<gmx_domdec_ind_t> indvec;
+    define1dHaloWith2Pulses(&dd, &indvec);
+
+    // Sum the halo forces, with the first pulse in flight while
+    // forces on home atoms are modified
+    dd_move_f_start(&dd, &forceWithShiftForces, nullptr);
+    f[0][XX] += 1;
+    dd_move_f_finish(&dd, &forceWithShiftForces, nullptr);
+
+    // Check results: the halo atoms of the backward neighbour are
+    // atoms 1 and 3 in the first and atoms 4, 5 and 7 in the second pulse
+    const int                sendRank       = dd.neighbor[0][1];
+    const std::array<int, 5> receivingAtoms = { 1, 3, 4, 5, 7 };
+    for (int j = 0; j < DIM; j++)
+    {
+        EXPECT_EQ(f[0][j], j == XX ? 1 : 0);
+        for (size_t h = 0; h < receivingAtoms.size(); h++)
+        {
+            EXPECT_EQ(f[receivingAtoms[h]][j], encodedValue(sendRank, numHomeAtoms + h, j));
+        }
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -43,6 +43,9 @@
 
 #include "gromacs/domdec/hashedmap.h"
 
+#include <numeric>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "testutils/testasserts.h"
@@ -163,6 +166,119 @@ TEST(HashedMap, LinkedEntries)
     checkFinds(map, 3 + 2 * largePowerOf2, 'c');
 }
 
+// Check that erasing the first entry with a hash keeps the other entries
+TEST(HashedMap, ErasesFirstLinkedEntry)
+{
+    gmx::HashedMap<char> map(20);
+
+    const int largePowerOf2 = 2048;
+
+    map.insert(3 + 0 * largePowerOf2, 'a');
+    map.insert(3 + 1 * largePowerOf2, 'b');
+    map.insert(3 + 2 * largePowerOf2, 'c');
+
+    map.erase(3 + 0 * largePowerOf2);
+
+    checkDoesNotFind(map, 3 + 0 * largePowerOf2);
+    checkFinds(map, 3 + 1 * largePowerOf2, 'b');
+    checkFinds(map, 3 + 2 * largePowerOf2, 'c');
+
+    // The freed entry should be reused
+    map.insert(3 + 3 * largePowerOf2, 'd');
+    checkFinds(map, 3 + 3 * largePowerOf2, 'd');
+    EXPECT_EQ(map.size(), 3);
+}
+
+//! Test fixture for batch insertion, parametrized on the number of threads
+class HashedMapBatchTest : public ::testing::TestWithParam<int>
+{
+};
+
+TEST_P(HashedMapBatchTest, InsertsBatch)
+{
+    const int numThreads = GetParam();
+
+    // Enough keys for using multiple threads, with many keys that have
+    // the same hash as keys that are already present or in the batch
+    const int        largePowerOf2 = 4096;
+    std::vector<int> keys;
+    for (int i = 0; i < largePowerOf2 / 2; i++)
+    {
+        keys.push_back(2 * i + 1);
+        keys.push_back(2 * i + 1 + (i % 3 + 1) * largePowerOf2);
+    }
+
+    gmx::HashedMap<int> map(keys.size());
+    map.insert(3, -1);
+    map.insert(3 + 5 * largePowerOf2, -2);
+    map.erase(3);
+    map.insertBatch(keys, [](int i) { return 2 * i; }, numThreads);
+
+    EXPECT_EQ(map.size(), 1 + static_cast<int>(keys.size()));
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        const int* value = map.find(keys[i]);
+        ASSERT_FALSE(value == nullptr);
+        EXPECT_EQ(*value, 2 * static_cast<int>(i));
+    }
+    const int* value = map.find(3 + 5 * largePowerOf2);
+    ASSERT_FALSE(value == nullptr);
+    EXPECT_EQ(*value, -2);
+    EXPECT_TRUE(map.find(2) == nullptr);
+
+    // Erasing should work for entries inserted by any thread
+    for (size_t i = 0; i < keys.size(); i += 2)
+    {
+        map.erase(keys[i]);
+    }
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        EXPECT_EQ(map.find(keys[i]) == nullptr, i % 2 == 0);
+    }
+}
+
+TEST_P(HashedMapBatchTest, InsertsAfterClear)
+{
+    const int numThreads = GetParam();
+
+    std::vector<int> keys(10000);
+    std::iota(keys.begin(), keys.end(), 0);
+
+    // The second batch uses the space for linked list entries of the first
+    gmx::HashedMap<int> map(100);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        map.insertBatch(keys, [pass](int i) { return i + pass; }, numThreads);
+        EXPECT_EQ(map.size(), static_cast<int>(keys.size()));
+        for (const int key : keys)
+        {
+            const int* value = map.find(key);
+            ASSERT_FALSE(value == nullptr);
+            EXPECT_EQ(*value, key + pass);
+        }
+        map.clear();
+    }
+}
+
+#ifndef NDEBUG
+
+TEST_P(HashedMapBatchTest, CatchesDuplicateKeyInBatch)
+{
+    const int numThreads = GetParam();
+
+    std::vector<int> keys(10000);
+    std::iota(keys.begin(), keys.end(), 0);
+    keys.back() = 1234;
+
+    gmx::HashedMap<int> map(100);
+    EXPECT_THROW_GMX(map.insertBatch(keys, [](int i) { return i; }, numThreads),
+                     gmx::InvalidInputError);
+}
+
+#endif // NDEBUG
+
+INSTANTIATE_TEST_SUITE_P(WithThreads, HashedMapBatchTest, ::testing::Values(1, 4));
+
 // HashedMap only throws in debug mode, so only test in debug mode
 #ifndef NDEBUG
 
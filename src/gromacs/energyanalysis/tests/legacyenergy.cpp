@@ -154,6 +154,14 @@ TEST_F(EnergyTest, ExtractEnergyMixed)
     runTest("Pressu\n7\nbox-z\nvol\n");
 }
 
+TEST_F(EnergyTest, ExtractEnergyWithFluctuations)
+{
+    // -fluc without -corr used to take the streaming path that does not
+    // store the energies of all frames, which are shifted by -fluc
+    commandLine().append("-fluc");
+    runTest("Potential\nKinetic-En.\n");
+}
+
 class ViscosityTest : public CommandLineTestBase
 {
 public:
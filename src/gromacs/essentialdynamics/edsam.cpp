@@ -44,7 +44,9 @@
 #include <cstring>
 #include <ctime>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -60,6 +62,7 @@
 #include "gromacs/math/vectypes.h"
 #include "gromacs/mdlib/broadcaststructs.h"
 #include "gromacs/mdlib/constr.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/groupcoord.h"
 #include "gromacs/mdlib/stat.h"
 #include "gromacs/mdlib/update.h"
@@ -71,6 +74,7 @@
 #include "gromacs/mdtypes/observableshistory.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/topology/mtop_lookup.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/cstringutil.h"
@@ -289,6 +293,13 @@ struct t_do_edsam
 };
 
 
+struct t_do_project
+{
+    rvec* xweighted; /* Mass-weighted displacements from the average
+                        positions, used for the projections */
+};
+
+
 /* definition of ED buffer structure */
 struct t_ed_buffer
 {
@@ -296,6 +307,7 @@ struct t_ed_buffer
     struct t_do_edfit*   do_edfit;
     struct t_do_edsam*   do_edsam;
     struct t_do_radcon*  do_radcon;
+    struct t_do_project* do_project;
 };
 
 namespace gmx
@@ -399,42 +411,189 @@ real projectx(const t_edpar& edi, rvec* xcoll, rvec* vec)
 
     return proj;
 }
+//! The number of eigenvectors that are projected on simultaneously
+constexpr int c_numEigvecsPerBlock = 4;
+
+//! The minimum number of multiply-adds for each OpenMP thread in the ED loops
+constexpr int64_t c_minEdWorkPerThread = 16384;
+
+/*! \brief Returns the number of OpenMP threads to use for the ED loops
+ * \param[in] work         The total number of multiply-adds
+ * \param[in] maxNumTasks  The number of tasks that can be distributed over threads
+ */
+int edNumThreads(int64_t work, int maxNumTasks)
+{
+    const int64_t numThreads =
+            std::min<int64_t>({ gmx_omp_nthreads_get(ModuleMultiThread::Default),
+                                maxNumTasks,
+                                work / c_minEdWorkPerThread });
+
+    return std::max(1, static_cast<int>(numThreads));
+}
+
+/*! \brief Returns the inner product of two flat arrays of length \p numReals */
+real innerProduct(const real* x, const real* v, int numReals)
+{
+    int  i    = 0;
+    real proj = 0;
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU
+    gmx::SimdReal projS = gmx::setZero();
+    for (; i + GMX_SIMD_REAL_WIDTH <= numReals; i += GMX_SIMD_REAL_WIDTH)
+    {
+        projS = gmx::fma(
+                gmx::loadU<gmx::SimdReal>(v + i), gmx::loadU<gmx::SimdReal>(x + i), projS);
+    }
+    proj = gmx::reduce(projS);
+#endif
+    for (; i < numReals; i++)
+    {
+        proj += v[i] * x[i];
+    }
+
+    return proj;
+}
+
+/*! \brief Computes the inner products of \p x with four vectors at once
+ *
+ * This loads \p x only once for four eigenvectors.
+ * \param[in]  x         Flat array of length \p numReals
+ * \param[in]  v         Four flat arrays of length \p numReals
+ * \param[in]  numReals  The length of the arrays
+ * \param[out] proj      The four inner products
+ */
+void innerProductsOfFour(const real*       x,
+                         const real* const v[c_numEigvecsPerBlock],
+                         int               numReals,
+                         real*             proj)
+{
+    int  i     = 0;
+    real proj0 = 0;
+    real proj1 = 0;
+    real proj2 = 0;
+    real proj3 = 0;
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU
+    gmx::SimdReal proj0S = gmx::setZero();
+    gmx::SimdReal proj1S = gmx::setZero();
+    gmx::SimdReal proj2S = gmx::setZero();
+    gmx::SimdReal proj3S = gmx::setZero();
+    for (; i + GMX_SIMD_REAL_WIDTH <= numReals; i += GMX_SIMD_REAL_WIDTH)
+    {
+        const gmx::SimdReal xS = gmx::loadU<gmx::SimdReal>(x + i);
+
+        proj0S = gmx::fma(gmx::loadU<gmx::SimdReal>(v[0] + i), xS, proj0S);
+        proj1S = gmx::fma(gmx::loadU<gmx::SimdReal>(v[1] + i), xS, proj1S);
+        proj2S = gmx::fma(gmx::loadU<gmx::SimdReal>(v[2] + i), xS, proj2S);
+        proj3S = gmx::fma(gmx::loadU<gmx::SimdReal>(v[3] + i), xS, proj3S);
+    }
+    proj0 = gmx::reduce(proj0S);
+    proj1 = gmx::reduce(proj1S);
+    proj2 = gmx::reduce(proj2S);
+    proj3 = gmx::reduce(proj3S);
+#endif
+    for (; i < numReals; i++)
+    {
+        proj0 += v[0][i] * x[i];
+        proj1 += v[1][i] * x[i];
+        proj2 += v[2][i] * x[i];
+        proj3 += v[3][i] * x[i];
+    }
+    proj[0] = proj0;
+    proj[1] = proj1;
+    proj[2] = proj2;
+    proj[3] = proj3;
+}
+
+/*! \brief Returns the mass-weighted displacements of \p x from the average positions.
+ *
+ * The displacements sqrt(m)*(x - x_av) are stored in a buffer of \p edi.
+ * \param[in] edi Essential dynamics parameters with average positions and masses
+ * \param[in] x   The positions of the atoms of the average structure
+ */
+rvec* weightedDisplacements(const t_edpar& edi, const rvec* x)
+{
+    if (edi.buf->do_project == nullptr)
+    {
+        snew(edi.buf->do_project, 1);
+        snew(edi.buf->do_project->xweighted, edi.sav.nr);
+    }
+    rvec* xWeighted = edi.buf->do_project->xweighted;
+
+    const int numThreads = edNumThreads(int64_t(edi.sav.nr) * DIM, edi.sav.nr);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < edi.sav.nr; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            xWeighted[i][d] = edi.sav.sqrtm[i] * (x[i][d] - edi.sav.x[i][d]);
+        }
+    }
+
+    return xWeighted;
+}
+
+/*! \brief Projects mass-weighted displacements onto all eigenvectors of \p vec.
+ *
+ * This is the matrix-vector product of the eigenvector matrix with the
+ * displacements. The eigenvectors are processed in blocks, such that the
+ * displacements are loaded once per block, and the blocks are distributed
+ * over OpenMP threads.
+ * \param[in]  xWeighted The mass-weighted displacements, from weightedDisplacements()
+ * \param[in]  numAtoms  The number of atoms in the average structure
+ * \param[in]  vec       The eigenvectors
+ * \param[out] proj      The projections, size vec.neig
+ */
+void projectOntoEigvectors(const rvec* xWeighted, int numAtoms, const t_eigvec& vec, real* proj)
+{
+    const int numReals  = numAtoms * DIM;
+    const int numBlocks = (vec.neig + c_numEigvecsPerBlock - 1) / c_numEigvecsPerBlock;
+
+    const int numThreads = edNumThreads(int64_t(vec.neig) * numReals, numBlocks);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int block = 0; block < numBlocks; block++)
+    {
+        const int eigBegin = block * c_numEigvecsPerBlock;
+        const int eigEnd   = std::min(eigBegin + c_numEigvecsPerBlock, vec.neig);
+        if (eigEnd - eigBegin == c_numEigvecsPerBlock)
+        {
+            const real* const v[c_numEigvecsPerBlock] = { vec.vec[eigBegin][0],
+                                                          vec.vec[eigBegin + 1][0],
+                                                          vec.vec[eigBegin + 2][0],
+                                                          vec.vec[eigBegin + 3][0] };
+            innerProductsOfFour(xWeighted[0], v, numReals, proj + eigBegin);
+        }
+        else
+        {
+            for (int eig = eigBegin; eig < eigEnd; eig++)
+            {
+                proj[eig] = innerProduct(xWeighted[0], vec.vec[eig][0], numReals);
+            }
+        }
+    }
+}
+
 /*!\brief Project coordinates onto vector after substracting average position.
  * projection is stored in vec->refproj which is used for radacc, radfix,
  * radcon and center of flooding potential.
- * Average positions are first substracted from x, then added back again.
  * \param[in] edi essential dynamics parameters with average position
  * \param[in] x Coordinates to be projected
  * \param[out] vec eigenvector, radius and refproj are overwritten here
  */
 void rad_project(const t_edpar& edi, rvec* x, t_eigvec* vec)
 {
-    int  i;
-    real rad = 0.0;
+    const rvec* xWeighted = weightedDisplacements(edi, x);
 
-    /* Subtract average positions */
-    for (i = 0; i < edi.sav.nr; i++)
-    {
-        rvec_dec(x[i], edi.sav.x[i]);
-    }
+    projectOntoEigvectors(xWeighted, edi.sav.nr, *vec, vec->refproj);
 
-    for (i = 0; i < vec->neig; i++)
+    real rad = 0.0;
+    for (int i = 0; i < vec->neig; i++)
     {
-        vec->refproj[i] = projectx(edi, x, vec->vec[i]);
         rad += gmx::square((vec->refproj[i] - vec->xproj[i]));
     }
     vec->radius = sqrt(rad);
-
-    /* Add average positions */
-    for (i = 0; i < edi.sav.nr; i++)
-    {
-        rvec_inc(x[i], edi.sav.x[i]);
-    }
 }
 
 /*!\brief Projects coordinates onto eigenvectors and stores result in vec->xproj.
- * Mass-weighting is applied. Subtracts average positions prior to projection and add
- * them afterwards to retain the unchanged vector.
+ * Mass-weighting is applied. The average positions are subtracted prior to projection.
  * \param[in] x The coordinates to project to an eigenvector
  * \param[in,out] vec The eigenvectors
  * \param[in] edi essential dynamics parameters holding average structure and masses
@@ -446,22 +605,9 @@ void project_to_eigvectors(rvec* x, t_eigvec* vec, const t_edpar& edi)
         return;
     }
 
-    /* Subtract average positions */
-    for (int i = 0; i < edi.sav.nr; i++)
-    {
-        rvec_dec(x[i], edi.sav.x[i]);
-    }
+    const rvec* xWeighted = weightedDisplacements(edi, x);
 
-    for (int i = 0; i < vec->neig; i++)
-    {
-        vec->xproj[i] = projectx(edi, x, vec->vec[i]);
-    }
-
-    /* Add average positions */
-    for (int i = 0; i < edi.sav.nr; i++)
-    {
-        rvec_inc(x[i], edi.sav.x[i]);
-    }
+    projectOntoEigvectors(xWeighted, edi.sav.nr, *vec, vec->xproj);
 }
 } // namespace
 
@@ -469,14 +615,18 @@ void project_to_eigvectors(rvec* x, t_eigvec* vec, const t_edpar& edi)
 static void project(rvec*    x,   /* positions to project */
                     t_edpar* edi) /* edi data set */
 {
-    /* It is not more work to subtract the average position in every
-     * subroutine again, because these routines are rarely used simultaneously */
-    project_to_eigvectors(x, &edi->vecs.mon, *edi);
-    project_to_eigvectors(x, &edi->vecs.linfix, *edi);
-    project_to_eigvectors(x, &edi->vecs.linacc, *edi);
-    project_to_eigvectors(x, &edi->vecs.radfix, *edi);
-    project_to_eigvectors(x, &edi->vecs.radacc, *edi);
-    project_to_eigvectors(x, &edi->vecs.radcon, *edi);
+    /* Compute the mass-weighted displacements once for all sets of vectors */
+    const rvec* xWeighted = weightedDisplacements(*edi, x);
+
+    for (t_eigvec* vec : { &edi->vecs.mon,
+                           &edi->vecs.linfix,
+                           &edi->vecs.linacc,
+                           &edi->vecs.radfix,
+                           &edi->vecs.radacc,
+                           &edi->vecs.radcon })
+    {
+        projectOntoEigvectors(xWeighted, edi->sav.nr, *vec, vec->xproj);
+    }
 }
 
 namespace
@@ -507,8 +657,8 @@ struct t_do_edfit
 static void do_edfit(int natoms, rvec* xp, rvec* x, matrix R, t_edpar* edi)
 {
     /* this is a copy of do_fit with some modifications */
-    int    c, r, n, j, i, irot;
-    double d[6], xnr, xpc;
+    int    c, r, j, i, irot;
+    double d[6];
     matrix vh, vk, u;
     int    index;
     real   max_d;
@@ -548,17 +698,37 @@ static void do_edfit(int natoms, rvec* xp, rvec* x, matrix R, t_edpar* edi)
         }
     }
 
-    /* calculate the matrix U */
+    /* calculate the matrix U, each thread sums over a block of atoms,
+     * the partial sums are reduced in a fixed order */
+    const int           numThreads = edNumThreads(int64_t(natoms) * DIM * DIM, natoms);
+    std::vector<double> uThread(numThreads * DIM * DIM, 0.0);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        double* uSum = uThread.data() + thread * DIM * DIM;
+
+        const int nBegin = (natoms * thread) / numThreads;
+        const int nEnd   = (natoms * (thread + 1)) / numThreads;
+        for (int n = nBegin; n < nEnd; n++)
+        {
+            for (int c = 0; c < DIM; c++)
+            {
+                const double xpc = xp[n][c];
+                for (int r = 0; r < DIM; r++)
+                {
+                    uSum[c * DIM + r] += x[n][r] * xpc;
+                }
+            }
+        }
+    }
     clear_mat(u);
-    for (n = 0; (n < natoms); n++)
+    for (int thread = 0; thread < numThreads; thread++)
     {
         for (c = 0; (c < DIM); c++)
         {
-            xpc = xp[n][c];
             for (r = 0; (r < DIM); r++)
             {
-                xnr = x[n][r];
-                u[c][r] += xnr * xpc;
+                u[c][r] += uThread[thread * DIM * DIM + c * DIM + r];
             }
         }
     }
@@ -857,23 +1027,34 @@ void flood_blowup(const t_edpar& edi, rvec* forces_cart)
     const real* forces_sub = edi.flood.vecs.fproj;
     /* Calculate the cartesian forces for the local atoms */
 
-    /* Clear forces first */
-    for (int j = 0; j < edi.sav.nr_loc; j++)
+    /* The atoms are distributed over the threads in blocks, within a block
+     * we loop over the eigenvectors and then over the atoms, such that
+     * each eigenvector is accessed sequentially */
+    const int numAtoms   = edi.sav.nr_loc;
+    const int numThreads = edNumThreads(int64_t(numAtoms) * edi.flood.vecs.neig * DIM, numAtoms);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
     {
-        clear_rvec(forces_cart[j]);
-    }
+        const int jBegin = (numAtoms * thread) / numThreads;
+        const int jEnd   = (numAtoms * (thread + 1)) / numThreads;
+
+        /* Clear forces first */
+        for (int j = jBegin; j < jEnd; j++)
+        {
+            clear_rvec(forces_cart[j]);
+        }
 
-    /* Now compute atomwise */
-    for (int j = 0; j < edi.sav.nr_loc; j++)
-    {
-        /* Compute forces_cart[edi.sav.anrs[j]] */
         for (int eig = 0; eig < edi.flood.vecs.neig; eig++)
         {
-            rvec addedForce;
-            /* Force vector is force * eigenvector (compute only atom j) */
-            svmul(forces_sub[eig], edi.flood.vecs.vec[eig][edi.sav.c_ind[j]], addedForce);
-            /* Add this vector to the cartesian forces */
-            rvec_inc(forces_cart[j], addedForce);
+            const rvec* eigvec = edi.flood.vecs.vec[eig];
+            for (int j = jBegin; j < jEnd; j++)
+            {
+                rvec addedForce;
+                /* Force vector is force * eigenvector (compute only atom j) */
+                svmul(forces_sub[eig], eigvec[edi.sav.c_ind[j]], addedForce);
+                /* Add this vector to the cartesian forces */
+                rvec_inc(forces_cart[j], addedForce);
+            }
         }
     }
 }
@@ -1950,11 +2131,22 @@ static void translate_and_rotate(rvec*  x,        /* The positions to be transla
                                  rvec   transvec, /* The translation vector */
                                  matrix rotmat)   /* The rotation matrix */
 {
-    /* Translation */
-    translate_x(x, nat, transvec);
-
-    /* Rotation */
-    rotate_x(x, nat, rotmat);
+    /* Translation and rotation, as translate_x() and rotate_x(), but threaded */
+    const int numThreads = edNumThreads(int64_t(nat) * DIM * DIM, nat);
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int i = 0; i < nat; i++)
+    {
+        rvec x_old;
+        rvec_add(x[i], transvec, x_old);
+        for (int j = 0; j < DIM; j++)
+        {
+            x[i][j] = 0;
+            for (int k = 0; k < DIM; k++)
+            {
+                x[i][j] += rotmat[k][j] * x_old[k];
+            }
+        }
+    }
 }
 
 
@@ -50,6 +50,7 @@
 
 #include "buildinfo.h"
 #include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/floatcompression.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/xdr_datatype.h"
@@ -81,6 +82,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/int64_to_int.h"
 #include "gromacs/utility/keyvaluetree.h"
 #include "gromacs/utility/keyvaluetreebuilder.h"
@@ -602,18 +604,18 @@ static inline unsigned int sizeOfXdrType(XdrDataType xdrType)
     return 0;
 }
 
-//! \brief Returns the XDR process function for i/o of an XDR type
-static inline xdrproc_t xdrProc(XdrDataType xdrType)
+//! \brief Does i/o of \p nf elements of an XDR type in \p data using the bulk XDR array routines
+static bool_t doXdrArray(XDR* xd, char* data, int nf, XdrDataType xdrType)
 {
     switch (xdrType)
     {
-        case XdrDataType::Int: return reinterpret_cast<xdrproc_t>(xdr_int);
-        case XdrDataType::Float: return reinterpret_cast<xdrproc_t>(xdr_float);
-        case XdrDataType::Double: return reinterpret_cast<xdrproc_t>(xdr_double);
+        case XdrDataType::Int: return xdr_int_array(xd, reinterpret_cast<int*>(data), nf);
+        case XdrDataType::Float: return xdr_float_array(xd, reinterpret_cast<float*>(data), nf);
+        case XdrDataType::Double: return xdr_double_array(xd, reinterpret_cast<double*>(data), nf);
         default: GMX_RELEASE_ASSERT(false, "XDR data type not implemented");
     }
 
-    return nullptr;
+    return 0;
 }
 
 /*! \brief Lists or only reads an xdr vector from checkpoint file
@@ -630,7 +632,7 @@ static bool_t listXdrVector(XDR* xd, Enum ecpt, int nf, XdrDataType xdrType, FIL
 
     const unsigned int elemSize = sizeOfXdrType(xdrType);
     std::vector<char>  data(nf * elemSize);
-    res = xdr_vector(xd, data.data(), nf, elemSize, xdrProc(xdrType));
+    res = doXdrArray(xd, data.data(), nf, xdrType);
 
     if (list != nullptr)
     {
@@ -842,8 +844,7 @@ static int doVectorLow(XDR*                           xd,
         {
             snew(vChar, numElemInTheFile * sizeOfXdrType(xdrTypeInTheFile));
         }
-        res = xdr_vector(
-                xd, vChar, numElemInTheFile, sizeOfXdrType(xdrTypeInTheFile), xdrProc(xdrTypeInTheFile));
+        res = doXdrArray(xd, vChar, numElemInTheFile, xdrTypeInTheFile);
         if (res == 0)
         {
             return -1;
@@ -891,12 +892,165 @@ static gmx::ArrayRef<real> realArrayRefFromRVecArrayRef(gmx::ArrayRef<gmx::RVec>
     return gmx::arrayRefFromArray<real>(reinterpret_cast<real*>(ofRVecs.data()), ofRVecs.size() * DIM);
 }
 
-//! \brief Read/Write a PaddedVector whose value_type is RVec.
+/*! \brief Reads/writes or lists an array of rvecs in compressed form
+ *
+ * The values are compressed with gmx::compressFloatingPointValues().
+ * The element count and type are stored as with doVectorLow(), followed by
+ * the number of compressed chunks, the size of each chunk and the chunks.
+ * The chunks are compressed and decompressed in parallel.
+ * On read, values stored with a different precision are converted.
+ */
+template<typename Enum>
+static int doCompressedRvecArrayRef(XDR* xd, Enum ecpt, gmx::ArrayRef<real> values, FILE* list)
+{
+    const bool bRead = (xd->x_op == XDR_DECODE);
+
+    int numElemInTheFile = values.ssize();
+    if (xdr_int(xd, &numElemInTheFile) == 0)
+    {
+        return -1;
+    }
+    int xdrTypeInTheFileAsInt = static_cast<int>(xdr_type<real>::value);
+    if (xdr_int(xd, &xdrTypeInTheFileAsInt) == 0)
+    {
+        return -1;
+    }
+    const XdrDataType xdrTypeInTheFile = static_cast<XdrDataType>(xdrTypeInTheFileAsInt);
+    if (xdrTypeInTheFile != XdrDataType::Float && xdrTypeInTheFile != XdrDataType::Double)
+    {
+        gmx_fatal(FARGS,
+                  "Type mismatch for state entry %s: incompatible checkpoint formats or corrupted "
+                  "checkpoint file.",
+                  enumValueToString(ecpt));
+    }
+    if (list == nullptr && numElemInTheFile != values.ssize())
+    {
+        gmx_fatal(FARGS,
+                  "Count mismatch for state entry %s, code count is %td, file count is %d\n",
+                  enumValueToString(ecpt),
+                  values.ssize(),
+                  numElemInTheFile);
+    }
+
+    const int numThreads = std::max(gmx_omp_get_max_threads(), 1);
+
+    std::vector<std::vector<char>> chunks;
+    if (!bRead)
+    {
+        chunks = gmx::compressFloatingPointValues(
+                gmx::constArrayRefFromArray(values.data(), values.size()), DIM, numThreads);
+    }
+    int numChunks = chunks.size();
+    if (xdr_int(xd, &numChunks) == 0 || numChunks < 0)
+    {
+        return -1;
+    }
+    std::vector<int> chunkSizes(numChunks);
+    for (int c = 0; c < numChunks && !bRead; c++)
+    {
+        chunkSizes[c] = chunks[c].size();
+    }
+    if (xdr_int_array(xd, chunkSizes.data(), numChunks) == 0)
+    {
+        return -1;
+    }
+    chunks.resize(numChunks);
+    for (int c = 0; c < numChunks; c++)
+    {
+        if (chunkSizes[c] < 0)
+        {
+            return -1;
+        }
+        chunks[c].resize(chunkSizes[c]);
+        if (xdr_opaque(xd, chunks[c].data(), chunkSizes[c]) == 0)
+        {
+            return -1;
+        }
+    }
+    if (!bRead)
+    {
+        return 0;
+    }
+
+    try
+    {
+        if (list == nullptr && xdrTypeInTheFile == xdr_type<real>::value)
+        {
+            gmx::decompressFloatingPointValues(chunks, DIM, values, numThreads);
+        }
+        else if (xdrTypeInTheFile == XdrDataType::Float)
+        {
+            std::vector<float> valuesInTheFile(numElemInTheFile);
+            gmx::decompressFloatingPointValues(chunks, DIM, valuesInTheFile, numThreads);
+            if (list != nullptr)
+            {
+                pr_fvec(list,
+                        0,
+                        enumValueToString(ecpt),
+                        valuesInTheFile.data(),
+                        numElemInTheFile,
+                        TRUE);
+            }
+            else
+            {
+                std::copy(valuesInTheFile.begin(), valuesInTheFile.end(), values.begin());
+            }
+        }
+        else
+        {
+            std::vector<double> valuesInTheFile(numElemInTheFile);
+            gmx::decompressFloatingPointValues(chunks, DIM, valuesInTheFile, numThreads);
+            if (list != nullptr)
+            {
+                pr_dvec(list,
+                        0,
+                        enumValueToString(ecpt),
+                        valuesInTheFile.data(),
+                        numElemInTheFile,
+                        TRUE);
+            }
+            else
+            {
+                std::copy(valuesInTheFile.begin(), valuesInTheFile.end(), values.begin());
+            }
+        }
+    }
+    catch (const gmx::InvalidInputError&)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*! \brief Read/Write a PaddedVector whose value_type is RVec.
+ *
+ * With \p compressed, the values are stored with doCompressedRvecArrayRef().
+ */
 template<typename PaddedVectorOfRVecType, typename Enum>
-static int doRvecVector(XDR* xd, Enum ecpt, int sflags, PaddedVectorOfRVecType* v, int numAtoms, FILE* list)
+static int doRvecVector(XDR*                    xd,
+                        Enum                    ecpt,
+                        int                     sflags,
+                        PaddedVectorOfRVecType* v,
+                        int                     numAtoms,
+                        bool                    compressed,
+                        FILE*                   list)
 {
     const int numReals = numAtoms * DIM;
 
+    if (compressed)
+    {
+        GMX_RELEASE_ASSERT(list != nullptr || v->size() == numAtoms,
+                           "v should have sufficient size for numAtoms");
+
+        gmx::ArrayRef<real> values;
+        if (list == nullptr)
+        {
+            values = realArrayRefFromRVecArrayRef(makeArrayRef(*v));
+        }
+        return doCompressedRvecArrayRef(xd, ecpt, values, list);
+    }
+
     if (list == nullptr)
     {
         GMX_RELEASE_ASSERT(
@@ -1290,6 +1444,15 @@ static void do_cpt_header(XDR* xd, gmx_bool bRead, FILE* list, CheckpointHeaderC
     {
         contents->isModularSimulatorCheckpoint = false;
     }
+
+    if (contents->file_version >= CheckPointVersion::CompressedStateVectors)
+    {
+        do_cpt_bool_err(xd, "Compressed state vectors", &contents->compressedStateVectors, list);
+    }
+    else
+    {
+        contents->compressedStateVectors = false;
+    }
 }
 
 static int do_cpt_footer(XDR* xd, CheckPointVersion file_version)
@@ -1314,7 +1477,7 @@ static int do_cpt_footer(XDR* xd, CheckPointVersion file_version)
     return 0;
 }
 
-static int do_cpt_state(XDR* xd, int fflags, t_state* state, FILE* list)
+static int do_cpt_state(XDR* xd, int fflags, bool compressedVectors, t_state* state, FILE* list)
 {
     int       ret    = 0;
     const int sflags = state->flags;
@@ -1376,10 +1539,12 @@ static int do_cpt_state(XDR* xd, int fflags, t_state* state, FILE* list)
                     ret = do_cpte_real(xd, *i, sflags, &state->vol0, list);
                     break;
                 case StateEntry::X:
-                    ret = doRvecVector(xd, *i, sflags, &state->x, state->natoms, list);
+                    ret = doRvecVector(
+                            xd, *i, sflags, &state->x, state->natoms, compressedVectors, list);
                     break;
                 case StateEntry::V:
-                    ret = doRvecVector(xd, *i, sflags, &state->v, state->natoms, list);
+                    ret = doRvecVector(
+                            xd, *i, sflags, &state->v, state->natoms, compressedVectors, list);
                     break;
                 /* The RNG entries are no longer written,
                  * the next 4 lines are only for reading old files.
@@ -2417,7 +2582,12 @@ void write_checkpoint_data(t_fileio*                         fp,
 
     do_cpt_header(gmx_fio_getxdr(fp), FALSE, nullptr, &headerContents);
 
-    if ((do_cpt_state(gmx_fio_getxdr(fp), state->flags, state, nullptr) < 0)
+    if ((do_cpt_state(gmx_fio_getxdr(fp),
+                      state->flags,
+                      headerContents.compressedStateVectors,
+                      state,
+                      nullptr)
+         < 0)
         || (do_cpt_ekinstate(gmx_fio_getxdr(fp), headerContents.flags_eks, &state->ekinstate, nullptr) < 0)
         || (do_cpt_enerhist(gmx_fio_getxdr(fp), FALSE, headerContents.flags_enh, enerhist, nullptr) < 0)
         || (doCptPullHist(gmx_fio_getxdr(fp), FALSE, headerContents.flagsPullHistory, pullHist, nullptr) < 0)
@@ -2732,7 +2902,11 @@ static void read_checkpoint(const char*                    fn,
         check_match(fplog, cr, dd_nc, *headerContents, reproducibilityRequested);
     }
 
-    ret             = do_cpt_state(gmx_fio_getxdr(fp), headerContents->flags_state, state, nullptr);
+    ret             = do_cpt_state(gmx_fio_getxdr(fp),
+                                   headerContents->flags_state,
+                                   headerContents->compressedStateVectors,
+                                   state,
+                                   nullptr);
     *init_fep_state = state->fep_state; /* there should be a better way to do this than setting it
                                            here. Investigate for 5.0. */
     if (ret)
@@ -2950,7 +3124,11 @@ static CheckpointHeaderContents read_checkpoint_data(t_fileio*
     state->nnhpres       = headerContents.nnhpres;
     state->nhchainlength = headerContents.nhchainlength;
     state->flags         = headerContents.flags_state;
-    int ret              = do_cpt_state(gmx_fio_getxdr(fp), state->flags, state, nullptr);
+    int ret              = do_cpt_state(gmx_fio_getxdr(fp),
+                                        state->flags,
+                                        headerContents.compressedStateVectors,
+                                        state,
+                                        nullptr);
     if (ret)
     {
         cp_error();
@@ -3078,7 +3256,8 @@ void list_checkpoint(const char* fn, FILE* out)
     state.nnhpres       = headerContents.nnhpres;
     state.nhchainlength = headerContents.nhchainlength;
     state.flags         = headerContents.flags_state;
-    ret                 = do_cpt_state(gmx_fio_getxdr(fp), state.flags, &state, out);
+    ret                 = do_cpt_state(
+            gmx_fio_getxdr(fp), state.flags, headerContents.compressedStateVectors, &state, out);
     if (ret)
     {
         cp_error();
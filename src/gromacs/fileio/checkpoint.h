@@ -164,6 +164,9 @@ struct MDModulesWriteCheckpointData
 /* the name of the environment variable to disable fsync failure checks with */
 #define GMX_IGNORE_FSYNC_FAILURE_ENV "GMX_IGNORE_FSYNC_FAILURE"
 
+/* the name of the environment variable to write compressed coordinates and velocities with */
+#define GMX_CPT_COMPRESS_ENV "GMX_CPT_COMPRESS"
+
 // TODO Replace this mechanism with std::array<char, 1024> or similar.
 #define CPTSTRLEN 1024
 
@@ -224,6 +227,8 @@ enum class CheckPointVersion : int
     MDModules,
     //! Added checkpointing for modular simulator.
     ModularSimulator,
+    //! Allow lossless compression of the coordinates and velocities.
+    CompressedStateVectors,
     //! The total number of checkpoint versions.
     Count,
     //! Current version
@@ -308,6 +313,8 @@ struct CheckpointHeaderContents
     SwapType eSwapCoords;
     //! Whether the checkpoint was written by modular simulator.
     bool isModularSimulatorCheckpoint = false;
+    //! Whether the coordinates and velocities are stored compressed.
+    bool compressedStateVectors = false;
 };
 
 /*! \brief Low-level checkpoint writing function */
@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
@@ -55,6 +56,7 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/energyframe.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/compare.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
@@ -95,6 +97,12 @@ struct ener_file
     t_fileio*  fio;
     int        framenr;
     real       frametime;
+    /* Which energy terms do_enx reads, all terms when empty */
+    std::vector<bool> bReadTerm;
+    /* Whether do_enx reads the data blocks */
+    gmx_bool bReadBlocks;
+    /* The file size, only updated when skipping data beyond it */
+    gmx_off_t fileSize;
 };
 
 static void enxsubblock_init(t_enxsubblock* sb)
@@ -778,7 +786,7 @@ void done_ener_file(ener_file_t ef)
 {
     // Free the contents, then the pointer itself
     close_enx(ef);
-    sfree(ef);
+    delete ef;
 }
 
 /*!\brief Return TRUE if a file exists but is empty, otherwise FALSE.
@@ -817,7 +825,8 @@ ener_file_t open_enx(const char* fn, const char* mode)
     gmx_bool          bWrongPrecision, bOK = TRUE;
     struct ener_file* ef;
 
-    snew(ef, 1);
+    ef              = new ener_file{};
+    ef->bReadBlocks = TRUE;
 
     if (mode[0] == 'r')
     {
@@ -959,6 +968,195 @@ static void convert_full_sums(ener_old_t* ener_old, t_enxframe* fr)
     ener_old->step_prev = fr->step;
 }
 
+/* Returns the current size of the file */
+static gmx_off_t enx_file_size(ener_file_t ef)
+{
+    FILE*           fp       = gmx_fio_getfp(ef->fio);
+    const gmx_off_t position = gmx_ftell(fp);
+    gmx_fseek(fp, 0, SEEK_END);
+    const gmx_off_t size = gmx_ftell(fp);
+    gmx_fseek(fp, position, SEEK_SET);
+
+    return size;
+}
+
+/* Moves the file position nbytes forward without reading,
+ * returns FALSE when that is beyond the end of the file.
+ */
+static gmx_bool enx_skip_bytes(ener_file_t ef, gmx_off_t nbytes)
+{
+    if (nbytes == 0)
+    {
+        return TRUE;
+    }
+    const gmx_off_t target = gmx_fio_ftell(ef->fio) + nbytes;
+    if (target > ef->fileSize)
+    {
+        /* The file might still be written to */
+        ef->fileSize = enx_file_size(ef);
+    }
+
+    return target <= ef->fileSize && gmx_fio_seek(ef->fio, target) == 0;
+}
+
+/* Returns the number of bytes each energy term takes in frame fr */
+static gmx_off_t enx_term_size(ener_file_t ef, const t_enxframe* fr, int file_version)
+{
+    int nvalues = 1;
+    if (file_version == 1 || fr->nsum > 0)
+    {
+        /* The average and the sum, plus an unused real in old files */
+        nvalues += (file_version == 1 ? 3 : 2);
+    }
+
+    return nvalues * (gmx_fio_is_double(ef->fio) ? sizeof(double) : sizeof(float));
+}
+
+/* Returns the number of bytes the data of subblock sub takes in the file,
+ * or -1 when this can not be known without reading it.
+ */
+static gmx_off_t enx_subblock_size(const t_enxsubblock* sub)
+{
+    /* XDR stores each char as a 4-byte integer */
+    switch (sub->type)
+    {
+        case XdrDataType::Float: return static_cast<gmx_off_t>(sub->nr) * 4;
+        case XdrDataType::Double: return static_cast<gmx_off_t>(sub->nr) * 8;
+        case XdrDataType::Int: return static_cast<gmx_off_t>(sub->nr) * 4;
+        case XdrDataType::Int64: return static_cast<gmx_off_t>(sub->nr) * 8;
+        case XdrDataType::Char: return static_cast<gmx_off_t>(sub->nr) * 4;
+        default: return -1;
+    }
+}
+
+/* Reads the data of subblock sub, which has been allocated when reading */
+static gmx_bool do_enx_subblock(ener_file_t ef, t_enxsubblock* sub)
+{
+    gmx_bool bOK = FALSE;
+
+    switch (sub->type)
+    {
+        case XdrDataType::Float: bOK = gmx_fio_ndo_float(ef->fio, sub->fval, sub->nr); break;
+        case XdrDataType::Double: bOK = gmx_fio_ndo_double(ef->fio, sub->dval, sub->nr); break;
+        case XdrDataType::Int: bOK = gmx_fio_ndo_int(ef->fio, sub->ival, sub->nr); break;
+        case XdrDataType::Int64: bOK = gmx_fio_ndo_int64(ef->fio, sub->lval, sub->nr); break;
+        case XdrDataType::Char: bOK = gmx_fio_ndo_uchar(ef->fio, sub->cval, sub->nr); break;
+        case XdrDataType::String: bOK = gmx_fio_ndo_string(ef->fio, sub->sval, sub->nr); break;
+        default:
+            gmx_incons(
+                    "Reading unknown block data type: this file is corrupted or from the "
+                    "future");
+    }
+
+    return bOK;
+}
+
+/* Skips the data of all blocks of fr, which has just had its header read.
+ * The blocks are removed from fr.
+ */
+static gmx_bool skip_enx_blocks(ener_file_t ef, t_enxframe* fr)
+{
+    gmx_bool  bOK   = TRUE;
+    gmx_off_t nskip = 0;
+    for (int b = 0; b < fr->nblock && bOK; b++)
+    {
+        for (int i = 0; i < fr->block[b].nsub && bOK; i++)
+        {
+            t_enxsubblock*  sub  = &(fr->block[b].sub[i]);
+            const gmx_off_t size = enx_subblock_size(sub);
+            if (size >= 0)
+            {
+                nskip += size;
+            }
+            else
+            {
+                /* Strings have to be read to find their length */
+                bOK   = enx_skip_bytes(ef, nskip);
+                nskip = 0;
+                enxsubblock_alloc(sub);
+                bOK = bOK && do_enx_subblock(ef, sub);
+            }
+        }
+    }
+    bOK        = bOK && enx_skip_bytes(ef, nskip);
+    fr->nblock = 0;
+
+    return bOK;
+}
+
+void enx_set_read_selection(ener_file_t ef, int nterms, const int terms[], gmx_bool bReadBlocks)
+{
+    ef->bReadTerm.clear();
+    if (nterms >= 0)
+    {
+        for (int i = 0; i < nterms; i++)
+        {
+            GMX_RELEASE_ASSERT(terms[i] >= 0, "Energy term indices should be non-negative");
+            if (terms[i] >= gmx::ssize(ef->bReadTerm))
+            {
+                ef->bReadTerm.resize(terms[i] + 1, false);
+            }
+            ef->bReadTerm[terms[i]] = true;
+        }
+        if (ef->bReadTerm.empty())
+        {
+            /* Keep the selection non-empty, so no terms are read */
+            ef->bReadTerm.push_back(false);
+        }
+    }
+    ef->bReadBlocks = bReadBlocks;
+}
+
+std::vector<t_enxindexentry> enx_make_index(ener_file_t ef)
+{
+    std::vector<t_enxindexentry> index;
+
+    if (ef->eo.bOldFileOpen)
+    {
+        return index;
+    }
+
+    /* Reading headers updates the counters of old files, which we restore */
+    const ener_old_t eo    = ef->eo;
+    const gmx_off_t  start = gmx_fio_ftell(ef->fio);
+    t_enxframe       fr;
+    init_enxframe(&fr);
+    while (true)
+    {
+        const gmx_off_t offset       = gmx_fio_ftell(ef->fio);
+        int             file_version = -1;
+        gmx_bool        bOK          = TRUE;
+        if (!do_eheader(ef, &file_version, &fr, -1, nullptr, &bOK))
+        {
+            break;
+        }
+        if (file_version == 1)
+        {
+            index.clear();
+            break;
+        }
+        if (!enx_skip_bytes(ef, fr.nre * enx_term_size(ef, &fr, file_version))
+            || !skip_enx_blocks(ef, &fr))
+        {
+            break;
+        }
+        index.push_back({ offset, fr.step, fr.t, fr.nre });
+    }
+    free_enxframe(&fr);
+    ef->eo = eo;
+    gmx_fio_seek(ef->fio, start);
+
+    return index;
+}
+
+void enx_seek_frame(ener_file_t ef, gmx_off_t offset)
+{
+    if (gmx_fio_seek(ef->fio, offset) != 0)
+    {
+        gmx_file(gmx_fio_getname(ef->fio));
+    }
+}
+
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
 {
     int      file_version = -1;
@@ -1033,8 +1231,26 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         fr->e_alloc = fr->nre;
     }
 
+    /* Terms that are not selected are skipped, but old files need all
+     * terms for converting the sums
+     */
+    const gmx_bool bSelectTerms = (bRead && !ef->bReadTerm.empty() && !ef->eo.bOldFileOpen);
+    gmx_off_t      nskip        = 0;
     for (i = 0; i < fr->nre; i++)
     {
+        if (bSelectTerms)
+        {
+            if (i >= gmx::ssize(ef->bReadTerm) || !ef->bReadTerm[i])
+            {
+                nskip += enx_term_size(ef, fr, file_version);
+                fr->ener[i].e    = 0;
+                fr->ener[i].eav  = 0;
+                fr->ener[i].esum = 0;
+                continue;
+            }
+            bOK   = bOK && enx_skip_bytes(ef, nskip);
+            nskip = 0;
+        }
         bOK = bOK && gmx_fio_do_real(ef->fio, fr->ener[i].e);
 
         /* Do not store sums of length 1,
@@ -1066,6 +1282,8 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         }
     }
 
+    bOK = bOK && enx_skip_bytes(ef, nskip);
+
     /* Here we can not check for file_version==1, since one could have
      * continued an old format simulation with a new one with mdrun -append.
      */
@@ -1074,6 +1292,10 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
         /* Convert old full simulation sums to sums between energy frames */
         convert_full_sums(&(ef->eo), fr);
     }
+    if (bRead && !ef->bReadBlocks)
+    {
+        bOK = bOK && skip_enx_blocks(ef, fr);
+    }
     /* read the blocks */
     for (b = 0; b < fr->nblock; b++)
     {
@@ -1091,30 +1313,8 @@ gmx_bool do_enx(ener_file_t ef, t_enxframe* fr)
             }
 
             /* read/write data */
-            switch (sub->type)
-            {
-                case XdrDataType::Float:
-                    bOK1 = gmx_fio_ndo_float(ef->fio, sub->fval, sub->nr);
-                    break;
-                case XdrDataType::Double:
-                    bOK1 = gmx_fio_ndo_double(ef->fio, sub->dval, sub->nr);
-                    break;
-                case XdrDataType::Int: bOK1 = gmx_fio_ndo_int(ef->fio, sub->ival, sub->nr); break;
-                case XdrDataType::Int64:
-                    bOK1 = gmx_fio_ndo_int64(ef->fio, sub->lval, sub->nr);
-                    break;
-                case XdrDataType::Char:
-                    bOK1 = gmx_fio_ndo_uchar(ef->fio, sub->cval, sub->nr);
-                    break;
-                case XdrDataType::String:
-                    bOK1 = gmx_fio_ndo_string(ef->fio, sub->sval, sub->nr);
-                    break;
-                default:
-                    gmx_incons(
-                            "Reading unknown block data type: this file is corrupted or from the "
-                            "future");
-            }
-            bOK = bOK && bOK1;
+            bOK1 = do_enx_subblock(ef, sub);
+            bOK  = bOK && bOK1;
         }
     }
 
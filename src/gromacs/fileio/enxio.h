@@ -38,8 +38,13 @@
 #ifndef GMX_FILEIO_ENXIO_H
 #define GMX_FILEIO_ENXIO_H
 
+#include <cstdint>
+
+#include <vector>
+
 #include "gromacs/fileio/xdr_datatype.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/futil.h"
 #include "gromacs/utility/real.h"
 
 struct SimulationGroups;
@@ -179,6 +184,35 @@ void free_enxnms(int n, gmx_enxnm_t* nms);
 gmx_bool do_enx(ener_file_t ef, t_enxframe* fr);
 /* Reads enx_frames, memory in fr is (re)allocated if necessary */
 
+void enx_set_read_selection(ener_file_t ef, int nterms, const int terms[], gmx_bool bReadBlocks);
+/* Makes subsequent calls to do_enx only read the nterms energy terms
+ * with indices terms[] and, when bReadBlocks=FALSE, none of the data blocks.
+ * The data of the other terms is skipped over in the file without decoding;
+ * those terms are set to zero and frames are returned without blocks.
+ * Passing nterms < 0 reads all terms again.
+ */
+
+/* Location, step and time of a frame in an energy file */
+struct t_enxindexentry
+{
+    gmx_off_t offset; /* Offset of the frame in the file */
+    int64_t   step;   /* MD step of the frame */
+    double    t;      /* Time of the frame */
+    int       nre;    /* Number of energy terms in the frame */
+};
+
+std::vector<t_enxindexentry> enx_make_index(ener_file_t ef);
+/* Returns the index of all complete frames from the current position in the
+ * file to its end. Only the frame headers are decoded. On return the file
+ * is at the same position as on entry. An empty index is returned for
+ * files from GROMACS versions before 4.1, which can only be read in order.
+ */
+
+void enx_seek_frame(ener_file_t ef, gmx_off_t offset);
+/* Positions ef such that the next call to do_enx reads the frame
+ * starting at offset, which should be taken from enx_make_index.
+ */
+
 void get_enx_state(const char* fn, real t, const SimulationGroups& groups, t_inputrec* ir, t_state* state);
 /*
  * Reads state variables from enx file fn at time t.
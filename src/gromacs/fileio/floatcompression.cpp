@@ -0,0 +1,264 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements lightweight lossless compression of floating-point arrays.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "floatcompression.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Unsigned integer type with the same size as ValueType
+template<typename ValueType>
+using BitsType = std::conditional_t<sizeof(ValueType) == sizeof(uint32_t), uint32_t, uint64_t>;
+
+//! Returns the bit pattern of \p value
+template<typename ValueType>
+BitsType<ValueType> toBits(ValueType value)
+{
+    BitsType<ValueType> bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+//! Returns the value with bit pattern \p bits
+template<typename ValueType>
+ValueType fromBits(BitsType<ValueType> bits)
+{
+    ValueType value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//! Returns the number of values in each chunk
+int chunkSize(int stride)
+{
+    return stride * c_floatCompressionStridesPerChunk;
+}
+
+//! Returns the number of chunks for \p numValues values
+int numChunks(int numValues, int stride)
+{
+    return (numValues + chunkSize(stride) - 1) / chunkSize(stride);
+}
+
+/*! \brief Compresses one chunk of values
+ *
+ * Each pair of values is stored as a header byte with the number of
+ * leading zero bytes of both residuals in its low and high nibble,
+ * followed by the remaining bytes of each residual, most significant first.
+ */
+template<typename ValueType>
+std::vector<char> compressChunk(ArrayRef<const ValueType> values, int stride)
+{
+    using Bits               = BitsType<ValueType>;
+    constexpr int c_numBytes = sizeof(Bits);
+    const int     numValues  = values.ssize();
+
+    std::vector<char> compressed;
+    compressed.reserve(numValues * c_numBytes + (numValues + 1) / 2);
+    for (int i = 0; i < numValues; i += 2)
+    {
+        const size_t headerIndex = compressed.size();
+        int          header      = 0;
+        compressed.push_back(0);
+        for (int j = i; j < std::min(i + 2, numValues); j++)
+        {
+            const Bits residual = toBits(values[j]) ^ (j >= stride ? toBits(values[j - stride]) : 0);
+            int        numZeroBytes = 0;
+            while (numZeroBytes < c_numBytes
+                   && (residual >> (8 * (c_numBytes - 1 - numZeroBytes))) == 0)
+            {
+                numZeroBytes++;
+            }
+            header |= numZeroBytes << (4 * (j - i));
+            for (int b = c_numBytes - 1 - numZeroBytes; b >= 0; b--)
+            {
+                compressed.push_back(static_cast<char>((residual >> (8 * b)) & 0xff));
+            }
+        }
+        compressed[headerIndex] = static_cast<char>(header);
+    }
+
+    return compressed;
+}
+
+/*! \brief Decompresses one chunk of values
+ *
+ * \returns whether the compressed data exactly matched the number of values
+ */
+template<typename ValueType>
+bool decompressChunk(ArrayRef<const char> compressed, int stride, ArrayRef<ValueType> values)
+{
+    using Bits               = BitsType<ValueType>;
+    constexpr int c_numBytes = sizeof(Bits);
+    const int     numValues  = values.ssize();
+
+    const auto* data     = reinterpret_cast<const unsigned char*>(compressed.data());
+    size_t      position = 0;
+    for (int i = 0; i < numValues; i += 2)
+    {
+        if (position >= compressed.size())
+        {
+            return false;
+        }
+        const int header = data[position++];
+        for (int j = i; j < std::min(i + 2, numValues); j++)
+        {
+            const int numBytes = c_numBytes - ((header >> (4 * (j - i))) & 0xf);
+            if (numBytes < 0 || position + numBytes > compressed.size())
+            {
+                return false;
+            }
+            Bits residual = 0;
+            for (int b = 0; b < numBytes; b++)
+            {
+                residual = (residual << 8) | data[position++];
+            }
+            values[j] = fromBits<ValueType>(residual
+                                            ^ (j >= stride ? toBits(values[j - stride]) : 0));
+        }
+    }
+
+    return position == compressed.size();
+}
+
+//! Compresses \p values in chunks using \p numThreads threads
+template<typename ValueType>
+std::vector<std::vector<char>> compressValues(ArrayRef<const ValueType> values, int stride, int numThreads)
+{
+    GMX_RELEASE_ASSERT(stride > 0, "The stride should be positive");
+
+    const int                      numValues = values.ssize();
+    std::vector<std::vector<char>> chunks(numChunks(numValues, stride));
+    const int                      numChunksToDo = chunks.size();
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+    for (int c = 0; c < numChunksToDo; c++)
+    {
+        try
+        {
+            const int start = c * chunkSize(stride);
+            const int end   = std::min(start + chunkSize(stride), numValues);
+            chunks[c]       = compressChunk(values.subArray(start, end - start), stride);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    return chunks;
+}
+
+//! Decompresses \p chunks into \p values using \p numThreads threads
+template<typename ValueType>
+void decompressValues(ArrayRef<const std::vector<char>> chunks,
+                      int                               stride,
+                      ArrayRef<ValueType>               values,
+                      int                               numThreads)
+{
+    GMX_RELEASE_ASSERT(stride > 0, "The stride should be positive");
+
+    const int numValues = values.ssize();
+    if (chunks.ssize() != numChunks(numValues, stride))
+    {
+        GMX_THROW(InvalidInputError("The number of compressed chunks does not match the array size"));
+    }
+    const int numChunksToDo = chunks.ssize();
+    int       numFailures   = 0;
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic) reduction(+ : numFailures)
+    for (int c = 0; c < numChunksToDo; c++)
+    {
+        const int start = c * chunkSize(stride);
+        const int end   = std::min(start + chunkSize(stride), numValues);
+        if (!decompressChunk(chunks[c], stride, values.subArray(start, end - start)))
+        {
+            numFailures++;
+        }
+    }
+    if (numFailures > 0)
+    {
+        GMX_THROW(InvalidInputError("Compressed data is corrupted"));
+    }
+}
+
+} // namespace
+
+std::vector<std::vector<char>> compressFloatingPointValues(ArrayRef<const float> values,
+                                                           int                   stride,
+                                                           int                   numThreads)
+{
+    return compressValues(values, stride, numThreads);
+}
+
+std::vector<std::vector<char>> compressFloatingPointValues(ArrayRef<const double> values,
+                                                           int                    stride,
+                                                           int                    numThreads)
+{
+    return compressValues(values, stride, numThreads);
+}
+
+void decompressFloatingPointValues(ArrayRef<const std::vector<char>> chunks,
+                                   int                               stride,
+                                   ArrayRef<float>                   values,
+                                   int                               numThreads)
+{
+    decompressValues(chunks, stride, values, numThreads);
+}
+
+void decompressFloatingPointValues(ArrayRef<const std::vector<char>> chunks,
+                                   int                               stride,
+                                   ArrayRef<double>                  values,
+                                   int                               numThreads)
+{
+    decompressValues(chunks, stride, values, numThreads);
+}
+
+} // namespace gmx
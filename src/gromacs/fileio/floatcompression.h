@@ -0,0 +1,106 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares lightweight lossless compression of floating-point arrays.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_FLOATCOMPRESSION_H
+#define GMX_FILEIO_FLOATCOMPRESSION_H
+
+#include <vector>
+
+#include "gromacs/utility/arrayref.h"
+
+namespace gmx
+{
+
+/*! \brief Number of strides of values in each independently compressed chunk
+ *
+ * Each chunk holds this number times the stride values, so chunks always
+ * start at the same component of a vector.
+ */
+constexpr int c_floatCompressionStridesPerChunk = 16384;
+
+/*! \libinternal \brief
+ * Losslessly compresses an array of floating-point values.
+ *
+ * The bit pattern of each value is predicted by that of the value \p stride
+ * elements before it, which for per-atom vectors of neighboring atoms is
+ * usually close. Only the bytes of the XOR of value and prediction after
+ * its leading zero bytes are stored, together with a 4-bit count of these
+ * zero bytes. The result does not depend on the byte order of the machine.
+ *
+ * The values are split in chunks of \c c_floatCompressionStridesPerChunk
+ * times \p stride values which are compressed independently, in parallel
+ * using \p numThreads OpenMP threads.
+ *
+ * \param[in] values      The values to compress
+ * \param[in] stride      The distance between a value and its prediction
+ * \param[in] numThreads  The number of OpenMP threads to use
+ * \returns The compressed chunks
+ */
+std::vector<std::vector<char>> compressFloatingPointValues(ArrayRef<const float> values,
+                                                           int                   stride,
+                                                           int                   numThreads);
+//! \copydoc compressFloatingPointValues
+std::vector<std::vector<char>> compressFloatingPointValues(ArrayRef<const double> values,
+                                                           int                    stride,
+                                                           int                    numThreads);
+
+/*! \libinternal \brief
+ * Decompresses the output of compressFloatingPointValues().
+ *
+ * \param[in]  chunks      The compressed chunks
+ * \param[in]  stride      The stride used for compression
+ * \param[out] values      The decompressed values, the size should match the compressed array
+ * \param[in]  numThreads  The number of OpenMP threads to use
+ * \throws InvalidInputError when the data does not match the size of \p values.
+ */
+void decompressFloatingPointValues(ArrayRef<const std::vector<char>> chunks,
+                                   int                               stride,
+                                   ArrayRef<float>                   values,
+                                   int                               numThreads);
+//! \copydoc decompressFloatingPointValues
+void decompressFloatingPointValues(ArrayRef<const std::vector<char>> chunks,
+                                   int                               stride,
+                                   ArrayRef<double>                  values,
+                                   int                               numThreads);
+
+} // namespace gmx
+
+#endif
@@ -163,7 +163,6 @@ static gmx_bool do_xdr(t_fileio*       fio,
     int            m, *iptr, idum;
     int32_t        s32dum;
     int64_t        s64dum;
-    real*          ptr;
     unsigned short us;
     double         d = 0;
     float          f = 0;
@@ -353,16 +352,10 @@ static gmx_bool do_xdr(t_fileio*       fio,
             }
             break;
         case InputOutputType::RVecArray:
-            ptr = nullptr;
-            res = 1;
-            for (std::size_t j = 0; j < nitem && res; j++)
-            {
-                if (item)
-                {
-                    ptr = (static_cast<rvec*>(item))[j];
-                }
-                res = static_cast<bool_t>(do_xdr(fio, ptr, 1, InputOutputType::RVec, desc, srcfile, line));
-            }
+            GMX_RELEASE_ASSERT(nitem < std::numeric_limits<unsigned int>::max() / DIM,
+                               "The XDR interface cannot handle array lengths > 2^32/DIM");
+            res = xdr_real_array(
+                    fio->xdr, static_cast<real*>(item), static_cast<unsigned int>(nitem * DIM), fio->bDouble);
             break;
         case InputOutputType::IVec:
             iptr = static_cast<int*>(item);
@@ -627,43 +620,49 @@ gmx_bool gmx_fio_doe_opaque(t_fileio* fio, char* data, std::size_t size, const c
 
 /* Array reading & writing */
 
-gmx_bool gmx_fio_ndoe_real(t_fileio* fio, real* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_real(t_fileio*              fio,
+                           real*                  item,
+                           int                    n,
+                           const char gmx_unused* desc,
+                           const char gmx_unused* srcfile,
+                           int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::Real, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_real_array(fio->xdr, item, std::max(n, 0), fio->bDouble) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
 
 
-gmx_bool gmx_fio_ndoe_float(t_fileio* fio, float* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_float(t_fileio*              fio,
+                            float*                 item,
+                            int                    n,
+                            const char gmx_unused* desc,
+                            const char gmx_unused* srcfile,
+                            int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::Float, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_float_array(fio->xdr, item, std::max(n, 0)) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
 
 
-gmx_bool gmx_fio_ndoe_double(t_fileio* fio, double* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_double(t_fileio*              fio,
+                             double*                item,
+                             int                    n,
+                             const char gmx_unused* desc,
+                             const char gmx_unused* srcfile,
+                             int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::Double, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_double_array(fio->xdr, item, std::max(n, 0)) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
@@ -693,29 +692,49 @@ gmx_bool gmx_fio_ndoe_gmx_bool(t_fileio* fio, gmx_bool* item, int n, const char*
     return ret;
 }
 
-gmx_bool gmx_fio_ndoe_int(t_fileio* fio, int* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_int(t_fileio*              fio,
+                          int*                   item,
+                          int                    n,
+                          const char gmx_unused* desc,
+                          const char gmx_unused* srcfile,
+                          int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::Int, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_int_array(fio->xdr, item, std::max(n, 0)) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
 
 
-gmx_bool gmx_fio_ndoe_int64(t_fileio* fio, int64_t* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_int32(t_fileio*              fio,
+                            int32_t*               item,
+                            int                    n,
+                            const char gmx_unused* desc,
+                            const char gmx_unused* srcfile,
+                            int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::Int64, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_int32_array(fio->xdr, item, std::max(n, 0)) != 0);
+    gmx_fio_unlock(fio);
+    return ret;
+}
+
+
+gmx_bool gmx_fio_ndoe_int64(t_fileio*              fio,
+                            int64_t*               item,
+                            int                    n,
+                            const char gmx_unused* desc,
+                            const char gmx_unused* srcfile,
+                            int gmx_unused         line)
+{
+    gmx_bool ret;
+    gmx_fio_lock(fio);
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_int64_array(fio->xdr, item, std::max(n, 0)) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
@@ -764,15 +783,17 @@ gmx_bool gmx_fio_ndoe_rvec(t_fileio* fio, rvec* item, int n, const char* desc, c
 }
 
 
-gmx_bool gmx_fio_ndoe_ivec(t_fileio* fio, ivec* item, int n, const char* desc, const char* srcfile, int line)
+gmx_bool gmx_fio_ndoe_ivec(t_fileio*              fio,
+                           ivec*                  item,
+                           int                    n,
+                           const char gmx_unused* desc,
+                           const char gmx_unused* srcfile,
+                           int gmx_unused         line)
 {
-    gmx_bool ret = TRUE;
-    int      i;
+    gmx_bool ret;
     gmx_fio_lock(fio);
-    for (i = 0; i < n; i++)
-    {
-        ret = ret && do_xdr(fio, &(item[i]), 1, InputOutputType::IVec, desc, srcfile, line);
-    }
+    GMX_RELEASE_ASSERT(fio->xdr != nullptr, "Implementation error: NULL XDR pointers");
+    ret = (xdr_int_array(fio->xdr, reinterpret_cast<int*>(item), std::max(n, 0) * DIM) != 0);
     gmx_fio_unlock(fio);
     return ret;
 }
@@ -874,6 +895,41 @@ void FileIOXdrSerializer::doUCharArray(unsigned char* values, int elements)
     gmx_fio_ndo_uchar(fio_, values, elements);
 }
 
+void FileIOXdrSerializer::doIntArray(int* values, int elements)
+{
+    gmx_fio_ndo_int(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doInt32Array(int32_t* values, int elements)
+{
+    gmx_fio_ndo_int32(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doInt64Array(int64_t* values, int elements)
+{
+    gmx_fio_ndo_int64(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doFloatArray(float* values, int elements)
+{
+    gmx_fio_ndo_float(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doDoubleArray(double* values, int elements)
+{
+    gmx_fio_ndo_double(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doRealArray(real* values, int elements)
+{
+    gmx_fio_ndo_real(fio_, values, elements);
+}
+
+void FileIOXdrSerializer::doIvecArray(ivec* values, int elements)
+{
+    gmx_fio_ndo_ivec(fio_, values, elements);
+}
+
 void FileIOXdrSerializer::doRvecArray(rvec* values, int elements)
 {
     gmx_fio_ndo_rvec(fio_, values, elements);
@@ -205,6 +205,20 @@ public:
     void doCharArray(char* values, int elements) override;
     //! Special case for handling I/O of a vector of unsigned characters.
     void doUCharArray(unsigned char* values, int elements) override;
+    //! Handle I/O of integer vector of size \p elements in bulk.
+    void doIntArray(int* values, int elements) override;
+    //! Handle I/O of integer vector of size \p elements in bulk.
+    void doInt32Array(int32_t* values, int elements) override;
+    //! Handle I/O of integer vector of size \p elements in bulk.
+    void doInt64Array(int64_t* values, int elements) override;
+    //! Handle I/O of float vector of size \p elements in bulk.
+    void doFloatArray(float* values, int elements) override;
+    //! Handle I/O of double vector of size \p elements in bulk.
+    void doDoubleArray(double* values, int elements) override;
+    //! Handle I/O of real vector of size \p elements in bulk.
+    void doRealArray(real* values, int elements) override;
+    //! Handle I/O of ivec vector of size \p elements in bulk.
+    void doIvecArray(ivec* values, int elements) override;
     //! Special case for handling I/O of a vector of rvecs.
     void doRvecArray(rvec* values, int elements) override;
 
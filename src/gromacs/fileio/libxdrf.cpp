@@ -1041,6 +1041,9 @@ int xdr3dfcoord(XDR* xdrs, float* fp, int* size, float* precision)
 #ifndef XTC_MAGIC
 #    define XTC_MAGIC 1995
 #endif
+#ifndef XTC_GROUP_PRECISION_MAGIC
+#    define XTC_GROUP_PRECISION_MAGIC 1997
+#endif
 
 static const int header_size = 16;
 
@@ -1068,7 +1071,7 @@ static int xtc_at_header_start(FILE* fp, XDR* xdrs, int natoms, int* timestep, f
         }
     }
     /* quick return */
-    if (i_inp[0] != XTC_MAGIC)
+    if (i_inp[0] != XTC_MAGIC && i_inp[0] != XTC_GROUP_PRECISION_MAGIC)
     {
         if (gmx_fseek(fp, off + XDR_INT_SIZE, SEEK_SET))
         {
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::MappedFile.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "mappedfile.h"
+
+#include "config.h"
+
+#include <cstdio>
+
+#include <vector>
+
+#if HAVE_MMAP
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+
+namespace gmx
+{
+
+class MappedFile::Impl
+{
+public:
+    explicit Impl(const std::string& fileName);
+    ~Impl();
+
+    //! Start of the mapped region, nullptr when the file is not mapped
+    void* mappedData_ = nullptr;
+    //! Size of the mapped region
+    size_t mappedSize_ = 0;
+    //! Contents of the file when it is not mapped
+    std::vector<char> buffer_;
+};
+
+MappedFile::Impl::Impl(const std::string& fileName)
+{
+#if HAVE_MMAP
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        GMX_THROW(FileIOError("Could not open file '" + fileName + "' for reading"));
+    }
+    struct stat fileStatus;
+    if (fstat(fd, &fileStatus) == 0 && fileStatus.st_size > 0)
+    {
+        void* data = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mappedData_ = data;
+            mappedSize_ = fileStatus.st_size;
+        }
+    }
+    close(fd);
+    if (mappedData_ != nullptr)
+    {
+        return;
+    }
+#endif
+    /* Fall back to reading the whole file into memory */
+    FILE* fp = gmx_ffopen(fileName, "rb");
+    gmx_fseek(fp, 0, SEEK_END);
+    const gmx_off_t fileSize = gmx_ftell(fp);
+    gmx_fseek(fp, 0, SEEK_SET);
+    buffer_.resize(fileSize);
+    const bool readFailed = (fileSize > 0 && std::fread(buffer_.data(), 1, fileSize, fp) != size_t(fileSize));
+    gmx_ffclose(fp);
+    if (readFailed)
+    {
+        GMX_THROW(FileIOError("Could not read the contents of file '" + fileName + "'"));
+    }
+}
+
+MappedFile::Impl::~Impl()
+{
+#if HAVE_MMAP
+    if (mappedData_ != nullptr)
+    {
+        munmap(mappedData_, mappedSize_);
+    }
+#endif
+}
+
+MappedFile::MappedFile(const std::string& fileName) : impl_(new Impl(fileName)) {}
+
+MappedFile::~MappedFile() = default;
+
+ArrayRef<const char> MappedFile::data() const
+{
+    if (impl_->mappedData_ != nullptr)
+    {
+        const char* begin = static_cast<const char*>(impl_->mappedData_);
+        return { begin, begin + impl_->mappedSize_ };
+    }
+    return impl_->buffer_;
+}
+
+bool MappedFile::isMemoryMapped() const
+{
+    return impl_->mappedData_ != nullptr;
+}
+
+} // namespace gmx
@@ -43,11 +43,27 @@
 
 #include "gromacs/fileio/checkpoint.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/fileio/floatcompression.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/mdtypes/checkpointdata.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/observableshistory.h"
+#include "gromacs/mdtypes/pullhistory.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/mdmodulesnotifiers.h"
+#include "gromacs/utility/smalloc.h"
 
 #include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
 
 namespace gmx
 {
@@ -103,6 +119,79 @@ TEST(Checkpoint, KvtRoundTripReal)
     EXPECT_EQ(value, readValue);
 }
 
+//! Tests writing and reading the state vectors, with and without compression
+class CheckpointStateVectorsTest : public ::testing::TestWithParam<bool>
+{
+};
+
+TEST_P(CheckpointStateVectorsTest, RoundTrips)
+{
+    // Use more atoms than fit in one compressed chunk
+    const int natoms = c_floatCompressionStridesPerChunk + 1000;
+
+    t_state state;
+    state.flags = enumValueToBitMask(StateEntry::X) | enumValueToBitMask(StateEntry::V);
+    state_change_natoms(&state, natoms);
+    for (int i = 0; i < natoms; i++)
+    {
+        state.x[i] = { 0.01_real * i, 5.0_real - 0.003_real * i, 2.5_real + 0.1_real * (i % 17) };
+        state.v[i] = { 0.5_real - 0.2_real * (i % 7), -1.25_real, 0.001_real * i };
+    }
+
+    CheckpointHeaderContents headerContents = {};
+    headerContents.double_prec              = GMX_DOUBLE;
+    headerContents.eIntegrator              = IntegrationAlgorithm::MD;
+    headerContents.natoms                   = state.natoms;
+    headerContents.ngtc                     = state.ngtc;
+    headerContents.nnhpres                  = state.nnhpres;
+    headerContents.nhchainlength            = state.nhchainlength;
+    headerContents.flags_state              = state.flags;
+    headerContents.eSwapCoords              = SwapType::No;
+    headerContents.compressedStateVectors   = GetParam();
+
+    TestFileManager                  fileManager;
+    const std::string                fileName = fileManager.getTemporaryFilePath("state.cpt");
+    ObservablesHistory               observablesHistory;
+    MDModulesNotifiers               mdModulesNotifiers;
+    std::vector<gmx_file_position_t> outputFiles;
+    WriteCheckpointDataHolder        modularSimulatorCheckpointData;
+    // mdrun always sets up a pull history, which the writer expects
+    observablesHistory.pullHistory = std::make_unique<PullHistory>();
+
+    t_fileio* fp = gmx_fio_open(fileName.c_str(), "w");
+    write_checkpoint_data(fp,
+                          headerContents,
+                          false,
+                          LambdaWeightCalculation::No,
+                          &state,
+                          &observablesHistory,
+                          mdModulesNotifiers,
+                          &outputFiles,
+                          &modularSimulatorCheckpointData);
+    gmx_fio_close(fp);
+
+    t_trxframe frame;
+    clear_trxframe(&frame, true);
+    fp = gmx_fio_open(fileName.c_str(), "r");
+    read_checkpoint_trxframe(fp, &frame);
+    gmx_fio_close(fp);
+
+    ASSERT_EQ(natoms, frame.natoms);
+    ASSERT_TRUE(frame.bX);
+    ASSERT_TRUE(frame.bV);
+    for (int i = 0; i < natoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            ASSERT_EQ(state.x[i][d], frame.x[i][d]) << "for atom " << i;
+            ASSERT_EQ(state.v[i][d], frame.v[i][d]) << "for atom " << i;
+        }
+    }
+    sfree(frame.x);
+    sfree(frame.v);
+}
+
+INSTANTIATE_TEST_SUITE_P(WithAndWithoutCompression, CheckpointStateVectorsTest, ::testing::Bool());
 
 } // namespace
 } // namespace test
@@ -42,10 +42,14 @@
 
 #include "gmxpre.h"
 
+#include <numeric>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
+#include "gromacs/fileio/xdrf.h"
 #include "gromacs/utility/futil.h"
 
 #include "testutils/testfilemanager.h"
@@ -147,6 +151,66 @@ TEST_F(FileIOXdrSerializerTest, SizeIsCorrect)
     EXPECT_EQ(fileSize, 72);
 }
 
+TEST_F(FileIOXdrSerializerTest, ArraysRoundtrip)
+{
+    std::vector<int>     intBuffer(2500);
+    std::vector<int64_t> int64Buffer(1500);
+    std::vector<float>   floatBuffer(3000);
+    std::vector<double>  doubleBuffer(1200);
+    std::vector<real>    realBuffer(3 * 1100);
+    std::iota(intBuffer.begin(), intBuffer.end(), -1000);
+    std::iota(int64Buffer.begin(), int64Buffer.end(), c_int64Value);
+    std::iota(floatBuffer.begin(), floatBuffer.end(), -0.5F);
+    std::iota(doubleBuffer.begin(), doubleBuffer.end(), c_intAndFloat64.doubleValue_);
+    std::iota(realBuffer.begin(), realBuffer.end(), 0.25_real);
+
+    file_ = gmx_fio_open(filename_.c_str(), "w");
+    {
+        FileIOXdrSerializer serializer(file_);
+        serializer.doIntArray(intBuffer.data(), intBuffer.size());
+        serializer.doInt64Array(int64Buffer.data(), int64Buffer.size());
+        serializer.doFloatArray(floatBuffer.data(), floatBuffer.size());
+        serializer.doDoubleArray(doubleBuffer.data(), doubleBuffer.size());
+        serializer.doRvecArray(reinterpret_cast<rvec*>(realBuffer.data()), realBuffer.size() / DIM);
+        // The bulk routines must produce the same stream as element-wise i/o
+        for (int i = 0; i < 3; i++)
+        {
+            serializer.doInt(&intBuffer[i]);
+            serializer.doDouble(&doubleBuffer[i]);
+        }
+    }
+    gmx_fio_close(file_);
+
+    file_ = gmx_fio_open(filename_.c_str(), "r");
+    FileIOXdrSerializer serializer(file_);
+    std::vector<int>     intRead(intBuffer.size());
+    std::vector<int64_t> int64Read(int64Buffer.size());
+    std::vector<float>   floatRead(floatBuffer.size());
+    std::vector<double>  doubleRead(doubleBuffer.size());
+    std::vector<real>    realRead(realBuffer.size());
+    serializer.doIntArray(intRead.data(), intRead.size());
+    serializer.doInt64Array(int64Read.data(), int64Read.size());
+    serializer.doFloatArray(floatRead.data(), floatRead.size());
+    serializer.doDoubleArray(doubleRead.data(), doubleRead.size());
+    serializer.doRvecArray(reinterpret_cast<rvec*>(realRead.data()), realRead.size() / DIM);
+    EXPECT_EQ(intRead, intBuffer);
+    EXPECT_EQ(int64Read, int64Buffer);
+    EXPECT_EQ(floatRead, floatBuffer);
+    EXPECT_EQ(doubleRead, doubleBuffer);
+    EXPECT_EQ(realRead, realBuffer);
+
+    std::vector<int>    intElements(3);
+    std::vector<double> doubleElements(3);
+    XDR*                xd = gmx_fio_getxdr(file_);
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(xdr_int_array(xd, &intElements[i], 1));
+        ASSERT_TRUE(xdr_double_array(xd, &doubleElements[i], 1));
+        EXPECT_EQ(intElements[i], intBuffer[i]);
+        EXPECT_EQ(doubleElements[i], doubleBuffer[i]);
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
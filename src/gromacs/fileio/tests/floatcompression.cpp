@@ -0,0 +1,168 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for lossless compression of floating-point arrays.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/floatcompression.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/exceptions.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns coordinates of a chain of atoms, which are spatially correlated like real systems
+template<typename ValueType>
+std::vector<ValueType> makeChainCoordinates(int numAtoms)
+{
+    std::vector<ValueType> values(numAtoms * DIM);
+    for (int a = 0; a < numAtoms; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            values[a * DIM + d] = 2 + static_cast<ValueType>(0.1 * a * (d + 1) / numAtoms)
+                                  + static_cast<ValueType>(0.1 * std::sin(a + d));
+        }
+    }
+    return values;
+}
+
+//! Returns whether \p a and \p b have identical bit patterns
+template<typename ValueType>
+bool bitwiseEqual(const std::vector<ValueType>& a, const std::vector<ValueType>& b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(ValueType)) == 0;
+}
+
+template<typename ValueType>
+class FloatCompressionTest : public ::testing::Test
+{
+};
+
+using FloatingPointTypes = ::testing::Types<float, double>;
+TYPED_TEST_SUITE(FloatCompressionTest, FloatingPointTypes);
+
+TYPED_TEST(FloatCompressionTest, RoundtripsAcrossChunks)
+{
+    // Use more than two chunks and a partial last chunk
+    const int numAtoms = 2 * c_floatCompressionStridesPerChunk + 123;
+    const auto values  = makeChainCoordinates<TypeParam>(numAtoms);
+
+    const auto chunks = compressFloatingPointValues(values, DIM, 2);
+    EXPECT_EQ(chunks.size(), 3);
+    size_t compressedSize = 0;
+    for (const auto& chunk : chunks)
+    {
+        compressedSize += chunk.size();
+    }
+    EXPECT_LT(compressedSize, values.size() * sizeof(TypeParam));
+
+    std::vector<TypeParam> decompressed(values.size());
+    decompressFloatingPointValues(chunks, DIM, decompressed, 2);
+    EXPECT_TRUE(bitwiseEqual(decompressed, values));
+}
+
+TYPED_TEST(FloatCompressionTest, RoundtripsSpecialValues)
+{
+    using Limits = std::numeric_limits<TypeParam>;
+
+    const std::vector<TypeParam> values = { 0,
+                                            -0.0,
+                                            Limits::infinity(),
+                                            -Limits::infinity(),
+                                            Limits::quiet_NaN(),
+                                            Limits::denorm_min(),
+                                            Limits::max(),
+                                            Limits::lowest(),
+                                            Limits::min(),
+                                            1,
+                                            -1 };
+
+    const auto             chunks = compressFloatingPointValues(values, DIM, 1);
+    std::vector<TypeParam> decompressed(values.size());
+    decompressFloatingPointValues(chunks, DIM, decompressed, 1);
+    EXPECT_TRUE(bitwiseEqual(decompressed, values));
+}
+
+TYPED_TEST(FloatCompressionTest, IsIndependentOfThreadCount)
+{
+    const auto values = makeChainCoordinates<TypeParam>(3 * c_floatCompressionStridesPerChunk);
+
+    EXPECT_EQ(compressFloatingPointValues(values, DIM, 1), compressFloatingPointValues(values, DIM, 3));
+}
+
+TYPED_TEST(FloatCompressionTest, HandlesEmptyArray)
+{
+    const std::vector<TypeParam> values;
+
+    const auto chunks = compressFloatingPointValues(values, DIM, 1);
+    EXPECT_TRUE(chunks.empty());
+    std::vector<TypeParam> decompressed;
+    EXPECT_NO_THROW(decompressFloatingPointValues(chunks, DIM, decompressed, 1));
+}
+
+TYPED_TEST(FloatCompressionTest, ThrowsOnMismatchingData)
+{
+    const auto values = makeChainCoordinates<TypeParam>(100);
+    auto       chunks = compressFloatingPointValues(values, DIM, 1);
+
+    std::vector<TypeParam> tooMany(values.size() + DIM);
+    EXPECT_THROW(decompressFloatingPointValues(chunks, DIM, tooMany, 1), InvalidInputError);
+
+    chunks[0].pop_back();
+    std::vector<TypeParam> decompressed(values.size());
+    EXPECT_THROW(decompressFloatingPointValues(chunks, DIM, decompressed, 1), InvalidInputError);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -45,9 +45,12 @@
 #include "gromacs/fileio/tngio.h"
 
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/path.h"
 
 #include "testutils/simulationdatabase.h"
@@ -76,4 +79,55 @@ TEST_F(TngTest, CloseBeforeOpenIsNotFatal)
     gmx_tng_close(&tng);
 }
 
+//! Returns the path of a TNG file with coordinate frames
+std::string trajectoryWithFrames()
+{
+    return gmx::Path::join(gmx::test::TestFileManager::getTestSimulationDatabaseDirectory(),
+                           "spc2-traj.tng");
+}
+
+//! Reads all frames of a TNG file and returns the steps and the coordinates
+void readAllTngFrames(bool prefetch, std::vector<int64_t>* steps, std::vector<real>* coordinates)
+{
+    gmx_tng_trajectory_t tng;
+    gmx_tng_open(trajectoryWithFrames().c_str(), 'r', &tng);
+    gmx_tng_set_frame_prefetching(tng, prefetch);
+    t_trxframe fr;
+    clear_trxframe(&fr, TRUE);
+    while (gmx_read_next_tng_frame(tng, &fr, nullptr, 0))
+    {
+        steps->push_back(fr.step);
+        ASSERT_TRUE(fr.bX);
+        for (int i = 0; i < fr.natoms; i++)
+        {
+            coordinates->insert(coordinates->end(), fr.x[i], fr.x[i] + DIM);
+        }
+    }
+    done_frame(&fr);
+    gmx_tng_close(&tng);
+}
+
+TEST_F(TngTest, PrefetchingReadsTheSameFrames)
+{
+    std::vector<int64_t> steps, prefetchedSteps;
+    std::vector<real>    coordinates, prefetchedCoordinates;
+    readAllTngFrames(false, &steps, &coordinates);
+    readAllTngFrames(true, &prefetchedSteps, &prefetchedCoordinates);
+    EXPECT_GT(steps.size(), 1);
+    EXPECT_EQ(prefetchedSteps, steps);
+    EXPECT_EQ(prefetchedCoordinates, coordinates);
+}
+
+TEST_F(TngTest, CanCloseWhilePrefetching)
+{
+    gmx_tng_trajectory_t tng;
+    gmx_tng_open(trajectoryWithFrames().c_str(), 'r', &tng);
+    gmx_tng_set_frame_prefetching(tng, true);
+    t_trxframe fr;
+    clear_trxframe(&fr, TRUE);
+    EXPECT_TRUE(gmx_read_next_tng_frame(tng, &fr, nullptr, 0));
+    done_frame(&fr);
+    gmx_tng_close(&tng);
+}
+
 } // namespace
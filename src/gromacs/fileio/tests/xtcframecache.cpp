@@ -0,0 +1,201 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the cache of decoded XTC frames.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcframecache.h"
+
+#include <cmath>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/path.h"
+
+#include "testutils/setenv.h"
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! The step, time, box and coordinates of a frame
+struct FrameContents
+{
+    int64_t           step;
+    real              time;
+    std::vector<real> boxAndX;
+};
+
+class XtcFrameCacheTest : public ::testing::Test
+{
+public:
+    XtcFrameCacheTest()
+    {
+        gmxSetenv("GMX_XTC_CACHE_DIR", fileManager_.getOutputTempDirectory(), 1);
+        output_env_init_default(&oenv_);
+
+        std::vector<RVec> x(c_numAtoms);
+        matrix            box = { { 3, 0, 0 }, { 0, 3, 0 }, { 0, 0, 3 } };
+        t_fileio*         fio = open_xtc(filename_.c_str(), "w");
+        for (int frame = 0; frame < c_numFrames; frame++)
+        {
+            for (int i = 0; i < c_numAtoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x[i][d] = 0.1 + 2.8 * std::fabs(std::sin(0.37 * i + 1.3 * d + 0.1 * frame));
+                }
+            }
+            box[XX][XX] = 3 + 0.01 * frame;
+            write_xtc(fio, c_numAtoms, 10 * frame, 0.5 * frame, box, as_rvec_array(x.data()), 1000);
+        }
+        close_xtc(fio);
+    }
+    ~XtcFrameCacheTest() override
+    {
+        output_env_done(oenv_);
+        gmxUnsetenv("GMX_XTC_CACHE_DIR");
+    }
+
+    /*! \brief Reads up to \p maxNumFrames frames of \p fileName with trxio
+     *
+     * Returns the contents of the frames and whether a cache was
+     * available when the reading started.
+     */
+    std::vector<FrameContents> readFrames(const std::string& fileName, int maxNumFrames,
+                                          bool* usedCache)
+    {
+        std::vector<FrameContents> frames;
+        t_trxstatus*               status = nullptr;
+        t_trxframe                 fr;
+        bool bOK   = read_first_frame(oenv_, &status, fileName.c_str(), &fr, TRX_NEED_X);
+        *usedCache = (bOK && XtcFrameCache::open(fileName, fr) != nullptr);
+        while (bOK && gmx::ssize(frames) < maxNumFrames)
+        {
+            FrameContents frame = { fr.step, fr.time, {} };
+            for (int d = 0; d < DIM; d++)
+            {
+                frame.boxAndX.insert(frame.boxAndX.end(), fr.box[d], fr.box[d] + DIM);
+            }
+            for (int i = 0; i < fr.natoms; i++)
+            {
+                frame.boxAndX.insert(frame.boxAndX.end(), fr.x[i], fr.x[i] + DIM);
+            }
+            frames.push_back(frame);
+            bOK = read_next_frame(oenv_, status, &fr);
+        }
+        close_trx(status);
+        done_frame(&fr);
+        return frames;
+    }
+
+    static constexpr int c_numAtoms  = 50;
+    static constexpr int c_numFrames = 5;
+    TestFileManager      fileManager_;
+    std::string          filename_ = fileManager_.getTemporaryFilePath("traj.xtc");
+    gmx_output_env_t*    oenv_     = nullptr;
+};
+
+TEST_F(XtcFrameCacheTest, LaterReadsUseCachedFrames)
+{
+    bool                             usedCache = true;
+    const std::vector<FrameContents> decoded   = readFrames(filename_, c_numFrames, &usedCache);
+    EXPECT_FALSE(usedCache);
+    ASSERT_EQ(c_numFrames, decoded.size());
+
+    const std::vector<FrameContents> cached = readFrames(filename_, c_numFrames, &usedCache);
+    EXPECT_TRUE(usedCache);
+    ASSERT_EQ(decoded.size(), cached.size());
+    for (size_t frame = 0; frame < decoded.size(); frame++)
+    {
+        EXPECT_EQ(decoded[frame].step, cached[frame].step);
+        EXPECT_EQ(decoded[frame].time, cached[frame].time);
+        EXPECT_EQ(decoded[frame].boxAndX, cached[frame].boxAndX);
+    }
+}
+
+TEST_F(XtcFrameCacheTest, PartialReadDoesNotCreateCache)
+{
+    bool usedCache = true;
+    EXPECT_EQ(2, readFrames(filename_, 2, &usedCache).size());
+    EXPECT_FALSE(usedCache);
+    readFrames(filename_, 2, &usedCache);
+    EXPECT_FALSE(usedCache);
+}
+
+TEST_F(XtcFrameCacheTest, IsNotSharedWithSameNamedFileInOtherDirectory)
+{
+    bool usedCache = true;
+    readFrames(filename_, c_numFrames, &usedCache);
+    readFrames(filename_, c_numFrames, &usedCache);
+    EXPECT_TRUE(usedCache);
+
+    const std::string otherDirectory = fileManager_.getTemporaryFilePath("other");
+    ASSERT_EQ(0, Directory::create(otherDirectory));
+    const std::string otherFilename = Path::join(otherDirectory, Path::getFilename(filename_));
+    ASSERT_EQ(0, gmx_file_copy(filename_.c_str(), otherFilename.c_str(), TRUE));
+    EXPECT_EQ(c_numFrames, readFrames(otherFilename, c_numFrames, &usedCache).size());
+    EXPECT_FALSE(usedCache);
+}
+
+TEST_F(XtcFrameCacheTest, IsNotUsedWhenDisabled)
+{
+    gmxUnsetenv("GMX_XTC_CACHE_DIR");
+    bool usedCache = true;
+    EXPECT_EQ(c_numFrames, readFrames(filename_, c_numFrames, &usedCache).size());
+    readFrames(filename_, c_numFrames, &usedCache);
+    EXPECT_FALSE(usedCache);
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
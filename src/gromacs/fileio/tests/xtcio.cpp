@@ -0,0 +1,290 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for writing and reading XTC frames, including frames with
+ * per-group precision.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Returns the contents of the binary file \p filename
+std::string readFileContents(const std::string& filename)
+{
+    std::ifstream stream(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+class XtcIOTest : public ::testing::Test
+{
+public:
+    XtcIOTest() : x_(c_numAtoms), atomGroup_(c_numAtoms)
+    {
+        clear_mat(box_);
+        box_[XX][XX] = 3;
+        box_[YY][YY] = 3;
+        box_[ZZ][ZZ] = 3;
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                x_[i][d] = 0.1 + 2.8 * std::fabs(std::sin(0.37 * i + 1.3 * d));
+            }
+            // Interleave runs of different lengths of the two groups
+            atomGroup_[i] = (i % 7 < 3 || i > 80) ? 0 : 1;
+        }
+    }
+
+    //! Reads the two frames from the file and checks them against x_
+    void readAndCheckFrame(const std::vector<real>& expectedPrecisions, bool useGroups)
+    {
+        t_fileio* fio    = open_xtc(filename_.c_str(), "r");
+        int       natoms = 0;
+        int64_t   step   = 0;
+        real      time   = 0;
+        matrix    box;
+        rvec*     x    = nullptr;
+        real      prec = 0;
+        gmx_bool  bOK  = FALSE;
+        ASSERT_TRUE(read_first_xtc(fio, &natoms, &step, &time, box, &x, &prec, &bOK));
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(c_numAtoms, natoms);
+        EXPECT_EQ(42, step);
+        EXPECT_FLOAT_EQ(1.5, time);
+        EXPECT_FLOAT_EQ(box_[YY][YY], box[YY][YY]);
+        real maxPrecision = 0;
+        for (const real groupPrecision : expectedPrecisions)
+        {
+            maxPrecision = std::max(maxPrecision, groupPrecision);
+        }
+        EXPECT_FLOAT_EQ(maxPrecision, prec);
+        for (int i = 0; i < c_numAtoms; i++)
+        {
+            const real groupPrecision = expectedPrecisions[useGroups ? atomGroup_[i] : 0];
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(x_[i][d], x[i][d], 0.5 / groupPrecision + 1e-5)
+                        << "atom " << i << " dim " << d;
+            }
+        }
+
+        // A second frame with the same contents reads back the same
+        ASSERT_TRUE(read_next_xtc(fio, natoms, &step, &time, box, x, &prec, &bOK));
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(43, step);
+        EXPECT_FLOAT_EQ(maxPrecision, prec);
+        EXPECT_FALSE(read_next_xtc(fio, natoms, &step, &time, box, x, &prec, &bOK));
+
+        sfree(x);
+        close_xtc(fio);
+    }
+
+    static constexpr int       c_numAtoms = 100;
+    TestFileManager            fileManager_;
+    std::string                filename_ = fileManager_.getTemporaryFilePath("traj.xtc");
+    matrix                     box_;
+    std::vector<RVec>          x_;
+    std::vector<unsigned char> atomGroup_;
+};
+
+TEST_F(XtcIOTest, SinglePrecisionFramesRoundtrip)
+{
+    t_fileio* fio = open_xtc(filename_.c_str(), "w");
+    EXPECT_TRUE(write_xtc(fio, c_numAtoms, 42, 1.5, box_, as_rvec_array(x_.data()), 1000));
+    EXPECT_TRUE(write_xtc(fio, c_numAtoms, 43, 2.5, box_, as_rvec_array(x_.data()), 1000));
+    close_xtc(fio);
+
+    readAndCheckFrame({ 1000 }, false);
+}
+
+TEST_F(XtcIOTest, GroupPrecisionFramesRoundtrip)
+{
+    const std::vector<real> precisions = { 1000, 10 };
+    t_fileio*               fio        = open_xtc(filename_.c_str(), "w");
+    for (int64_t step = 42; step <= 43; step++)
+    {
+        EXPECT_TRUE(write_xtc_group_precision(fio,
+                                              c_numAtoms,
+                                              step,
+                                              step - 40.5,
+                                              box_,
+                                              as_rvec_array(x_.data()),
+                                              precisions,
+                                              atomGroup_));
+    }
+    close_xtc(fio);
+
+    readAndCheckFrame(precisions, true);
+}
+
+TEST_F(XtcIOTest, GroupPrecisionFramesSkipEmptyGroups)
+{
+    // The third group has no atoms and should not affect the reported precision
+    const std::vector<real> precisions = { 100, 50, 10000 };
+    t_fileio*               fio        = open_xtc(filename_.c_str(), "w");
+    for (int64_t step = 42; step <= 43; step++)
+    {
+        EXPECT_TRUE(write_xtc_group_precision(fio,
+                                              c_numAtoms,
+                                              step,
+                                              step - 40.5,
+                                              box_,
+                                              as_rvec_array(x_.data()),
+                                              precisions,
+                                              atomGroup_));
+    }
+    close_xtc(fio);
+
+    readAndCheckFrame({ 100, 50 }, true);
+}
+
+TEST_F(XtcIOTest, GroupPrecisionFramesMustCoverAllAtoms)
+{
+    // A single group with a single range of all atoms
+    const std::vector<real>          precisions = { 1000 };
+    const std::vector<unsigned char> atomGroup(c_numAtoms, 0);
+    t_fileio*                        fio = open_xtc(filename_.c_str(), "w");
+    write_xtc_group_precision(
+            fio, c_numAtoms, 42, 1.5, box_, as_rvec_array(x_.data()), precisions, atomGroup);
+    close_xtc(fio);
+
+    // Shorten the range, stored after the header, the box, the number of
+    // groups, the precision, the number of ranges and the range start
+    const int    countOffset   = 4 * (4 + DIM * DIM + 4);
+    const char   shortCount[4] = { 0, 0, 0, c_numAtoms - 1 };
+    std::fstream stream(filename_, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(countOffset);
+    stream.write(shortCount, sizeof(shortCount));
+    stream.close();
+
+    fio = open_xtc(filename_.c_str(), "r");
+
+    int      natoms = 0;
+    int64_t  step   = 0;
+    real     time   = 0;
+    matrix   box;
+    rvec*    x    = nullptr;
+    real     prec = 0;
+    gmx_bool bOK  = TRUE;
+    read_first_xtc(fio, &natoms, &step, &time, box, &x, &prec, &bOK);
+    EXPECT_FALSE(bOK);
+    sfree(x);
+    close_xtc(fio);
+}
+
+TEST_F(XtcIOTest, GroupPrecisionFramesAreSmaller)
+{
+    const std::string singleFilename = fileManager_.getTemporaryFilePath("single.xtc");
+    t_fileio*         fio            = open_xtc(singleFilename.c_str(), "w");
+    write_xtc(fio, c_numAtoms, 42, 1.5, box_, as_rvec_array(x_.data()), 1000);
+    const gmx_off_t singleSize = gmx_fio_ftell(fio);
+    close_xtc(fio);
+
+    // Like a solute followed by solvent that is written with low precision
+    const std::vector<real>    precisions = { 1000, 10 };
+    std::vector<unsigned char> atomGroup(c_numAtoms, 1);
+    std::fill(atomGroup.begin(), atomGroup.begin() + c_numAtoms / 5, 0);
+    fio = open_xtc(filename_.c_str(), "w");
+    write_xtc_group_precision(
+            fio, c_numAtoms, 42, 1.5, box_, as_rvec_array(x_.data()), precisions, atomGroup);
+    const gmx_off_t groupSize = gmx_fio_ftell(fio);
+    close_xtc(fio);
+
+    EXPECT_LT(groupSize, singleSize);
+}
+
+TEST_F(XtcIOTest, RawFramesAreCopiedExactly)
+{
+    // Mix normal frames, group precision frames and a small system
+    const std::vector<real> precisions = { 1000, 10 };
+    t_fileio*               fio        = open_xtc(filename_.c_str(), "w");
+    write_xtc(fio, c_numAtoms, 42, 1.5, box_, as_rvec_array(x_.data()), 1000);
+    write_xtc_group_precision(
+            fio, c_numAtoms, 43, 2.5, box_, as_rvec_array(x_.data()), precisions, atomGroup_);
+    write_xtc(fio, 5, 44, 3.5, box_, as_rvec_array(x_.data()), 1000);
+    close_xtc(fio);
+
+    const std::string copyFilename = fileManager_.getTemporaryFilePath("copy.xtc");
+    t_fileio*         fioIn        = open_xtc(filename_.c_str(), "r");
+    t_fileio*         fioOut       = open_xtc(copyFilename.c_str(), "w");
+    XtcRawFrame       frame;
+    gmx_bool          bOK       = FALSE;
+    int               numFrames = 0;
+    while (read_next_xtc_raw(fioIn, &frame, &bOK))
+    {
+        EXPECT_TRUE(bOK);
+        EXPECT_EQ(42 + numFrames, frame.step);
+        EXPECT_TRUE(write_xtc_raw(fioOut, frame));
+        numFrames++;
+    }
+    EXPECT_TRUE(bOK);
+    EXPECT_EQ(3, numFrames);
+    close_xtc(fioIn);
+    close_xtc(fioOut);
+
+    const std::string original = readFileContents(filename_);
+    EXPECT_FALSE(original.empty());
+    EXPECT_EQ(original, readFileContents(copyFilename));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
@@ -0,0 +1,228 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for writing and reading binary columnar data files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xvgbinary.h"
+
+#include <cmath>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/xvgr.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+class XvgBinaryTest : public ::testing::TestWithParam<bool>
+{
+public:
+    XvgBinaryTest()
+    {
+        header_.title    = "Distance";
+        header_.subtitle = "Average";
+        header_.xLabel   = "Time (ps)";
+        header_.yLabel   = "Distance (nm)";
+        header_.legends  = { "d1", "d2" };
+    }
+
+    //! Returns the value in \p column of \p row as written by writeFile()
+    static double value(int row, int column)
+    {
+        return column == 0 ? 0.002 * row : std::sin(0.01 * row + column);
+    }
+
+    //! Writes \p numRows rows of three columns
+    void writeFile(int numRows)
+    {
+        XvgBinaryWriter writer(filename_, header_, GetParam());
+        for (int row = 0; row < numRows; row++)
+        {
+            for (int column = 0; column < c_numColumns; column++)
+            {
+                writer.addValue(value(row, column));
+            }
+            writer.finishRow();
+        }
+        writer.close();
+    }
+
+    static constexpr int c_numColumns = 3;
+    TestFileManager      fileManager_;
+    std::string          filename_ = fileManager_.getTemporaryFilePath("data.xvg");
+    XvgBinaryHeader      header_;
+};
+
+TEST_P(XvgBinaryTest, Roundtrips)
+{
+    // Spans several blocks, with a partial last block
+    const int numRows = 10000;
+    writeFile(numRows);
+
+    EXPECT_TRUE(isXvgBinaryFile(filename_));
+    const XvgBinaryData data = readXvgBinary(filename_);
+    EXPECT_EQ(header_.title, data.header.title);
+    EXPECT_EQ(header_.subtitle, data.header.subtitle);
+    EXPECT_EQ(header_.xLabel, data.header.xLabel);
+    EXPECT_EQ(header_.yLabel, data.header.yLabel);
+    EXPECT_EQ(header_.legends, data.header.legends);
+    ASSERT_EQ(c_numColumns, static_cast<int>(data.columns.size()));
+    for (int column = 0; column < c_numColumns; column++)
+    {
+        ASSERT_EQ(numRows, static_cast<int>(data.columns[column].size()));
+        for (int row = 0; row < numRows; row++)
+        {
+            // The first column is stored in double precision, the others in float
+            const double expected = column == 0 ? value(row, column)
+                                                : static_cast<float>(value(row, column));
+            EXPECT_EQ(expected, data.columns[column][row]) << "row " << row << " column " << column;
+        }
+    }
+}
+
+TEST_P(XvgBinaryTest, IsReadByXvgReaders)
+{
+    const int numRows = 5;
+    writeFile(numRows);
+
+    double** values     = nullptr;
+    int      numColumns = 0;
+    EXPECT_EQ(numRows, read_xvg(filename_.c_str(), &values, &numColumns));
+    ASSERT_EQ(c_numColumns, numColumns);
+    for (int column = 0; column < c_numColumns; column++)
+    {
+        EXPECT_FLOAT_EQ(value(numRows - 1, column), values[column][numRows - 1]);
+        sfree(values[column]);
+    }
+    sfree(values);
+
+    const auto xvgData = readXvgData(filename_);
+    EXPECT_EQ(c_numColumns, xvgData.extent(0));
+    EXPECT_EQ(numRows, xvgData.extent(1));
+    EXPECT_FLOAT_EQ(value(2, 1), xvgData(1, 2));
+
+    double** readBack = nullptr;
+    int      numSets  = 0;
+    char*    subtitle = nullptr;
+    char**   legends  = nullptr;
+    EXPECT_EQ(numRows, read_xvg_legend(filename_.c_str(), &readBack, &numSets, &subtitle, &legends));
+    EXPECT_EQ(c_numColumns, numSets);
+    EXPECT_STREQ("Average", subtitle);
+    ASSERT_NE(nullptr, legends);
+    EXPECT_STREQ("d1", legends[0]);
+    EXPECT_STREQ("d2", legends[1]);
+    for (int column = 0; column < c_numColumns; column++)
+    {
+        sfree(readBack[column]);
+    }
+    for (int set = 0; set < c_numColumns - 1; set++)
+    {
+        sfree(legends[set]);
+    }
+    sfree(readBack);
+    sfree(legends);
+    sfree(subtitle);
+}
+
+TEST_P(XvgBinaryTest, ShortRowsArePadded)
+{
+    XvgBinaryWriter writer(filename_, header_, GetParam());
+    writer.addValue(1);
+    writer.addValue(2);
+    writer.addValue(3);
+    writer.finishRow();
+    writer.addValue(4);
+    writer.addValue(5);
+    writer.finishRow();
+    writer.close();
+
+    const XvgBinaryData data = readXvgBinary(filename_);
+    ASSERT_EQ(3U, data.columns.size());
+    EXPECT_EQ((std::vector<double>{ 1, 4 }), data.columns[0]);
+    EXPECT_EQ((std::vector<double>{ 2, 5 }), data.columns[1]);
+    EXPECT_EQ((std::vector<double>{ 3, 0 }), data.columns[2]);
+}
+
+TEST_P(XvgBinaryTest, WiderRowsAddColumns)
+{
+    const std::vector<std::vector<double>> rows = { { 1, 2 }, { 3, 4, 5 }, { 6 }, { 7, 8, 9, 10 } };
+    XvgBinaryWriter                        writer(filename_, header_, GetParam());
+    for (const auto& row : rows)
+    {
+        for (double value : row)
+        {
+            writer.addValue(value);
+        }
+        writer.finishRow();
+    }
+    writer.close();
+
+    const XvgBinaryData data = readXvgBinary(filename_);
+    ASSERT_EQ(4U, data.columns.size());
+    EXPECT_EQ((std::vector<double>{ 1, 3, 6, 7 }), data.columns[0]);
+    EXPECT_EQ((std::vector<double>{ 2, 4, 0, 8 }), data.columns[1]);
+    EXPECT_EQ((std::vector<double>{ 0, 5, 0, 9 }), data.columns[2]);
+    EXPECT_EQ((std::vector<double>{ 0, 0, 0, 10 }), data.columns[3]);
+}
+
+TEST(XvgBinaryFileTest, TextFilesAreNotBinary)
+{
+    TestFileManager   fileManager;
+    const std::string filename = fileManager.getTemporaryFilePath("text.xvg");
+    TextWriter::writeFileFromString(filename, "1 2 3\n");
+    EXPECT_FALSE(isXvgBinaryFile(filename));
+}
+
+INSTANTIATE_TEST_SUITE_P(WithAndWithoutCompression, XvgBinaryTest, ::testing::Bool());
+
+} // namespace
+} // namespace test
+} // namespace gmx
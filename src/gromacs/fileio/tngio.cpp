@@ -41,6 +41,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <future>
 #include <iterator>
 #include <memory>
 #include <numeric>
@@ -70,6 +71,49 @@
 using tng_trajectory_t = void*;
 #endif
 
+#if GMX_USE_TNG
+namespace
+{
+
+//! A data block of a frame as read from a TNG file, before conversion
+struct TngFrameBlock
+{
+    //! The ID of the block
+    int64_t id = -1;
+    //! The TNG data type of the values
+    char datatype = -1;
+    //! The values, allocated by the TNG library
+    gmx::unique_cptr<void, gmx::free_wrapper> values;
+    //! The compression codec of the block, only set for positions and velocities
+    int64_t codecId = -1;
+    //! The compression precision of the block, only set for positions and velocities
+    double precision = 0;
+};
+
+/*! \brief A frame as read from a TNG file, before conversion to a t_trxframe
+ *
+ * Holds everything that is needed for the conversion, so that the
+ * conversion does not need to access the TNG handle.
+ */
+struct TngRawFrame
+{
+    //! Whether a next frame was found
+    bool exists = false;
+    //! The number of particles in the frame
+    int64_t numParticles = -1;
+    //! The TNG frame number
+    int64_t frameNumber = -1;
+    //! The time of the frame in seconds
+    double frameTime = -1.0;
+    //! Factor to convert distances to nm
+    real distanceScaleFactor = 1;
+    //! The data blocks that were read
+    std::vector<TngFrameBlock> blocks;
+};
+
+} // namespace
+#endif
+
 /*! \brief Gromacs Wrapper around tng datatype
  *
  * This could in principle hold any GROMACS-specific requirements not yet
@@ -95,8 +139,29 @@ struct gmx_tng_trajectory
     bool             timePerFrameIsSet;    //!< True if we have set the time per frame
     int              boxOutputInterval;    //!< Number of steps between the output of box size
     int              lambdaOutputInterval; //!< Number of steps between the output of lambdas
+#if GMX_USE_TNG
+    //! Whether gmx_read_next_tng_frame reads the next frame in the background
+    bool prefetchFrames = false;
+    //! The frame being read in the background, when valid
+    std::future<TngRawFrame> prefetchedFrame;
+#endif
 };
 
+#if GMX_USE_TNG
+/*! \brief Waits for a frame that is being read in the background
+ *
+ * Must be called before accessing the TNG handle outside of the reading of
+ * frames. The frame is kept for the next call to gmx_read_next_tng_frame().
+ */
+static void waitForPrefetchedTngFrame(gmx_tng_trajectory_t gmx_tng)
+{
+    if (gmx_tng->prefetchedFrame.valid())
+    {
+        gmx_tng->prefetchedFrame.wait();
+    }
+}
+#endif
+
 #if GMX_USE_TNG
 static const char* modeToVerb(char mode)
 {
@@ -200,6 +265,7 @@ void gmx_tng_close(gmx_tng_trajectory_t* gmx_tng)
     {
         return;
     }
+    waitForPrefetchedTngFrame(*gmx_tng);
     tng_trajectory_t* tng = &(*gmx_tng)->tng;
 
     if (tng)
@@ -1001,6 +1067,7 @@ float gmx_tng_get_time_of_final_frame(gmx_tng_trajectory_t gmx_tng)
     float            fTime;
     tng_trajectory_t tng = gmx_tng->tng;
 
+    waitForPrefetchedTngFrame(gmx_tng);
     tng_num_frames_get(tng, &nFrames);
     tng_util_time_of_frame_get(tng, nFrames - 1, &time);
 
@@ -1047,6 +1114,8 @@ void gmx_prepare_tng_writing(const char*              filename,
        more data we can copy over, rather than having to improvise. */
     if (gmx_tng_input && *gmx_tng_input)
     {
+        waitForPrefetchedTngFrame(*gmx_tng_input);
+
         /* Set parameters (compression, time per frame, molecule
          * information, number of frames per frame set and writing
          * intervals of positions, box shape and lambdas) of the
@@ -1388,6 +1457,102 @@ void gmx_tng_setup_atom_subgroup(gmx_tng_trajectory_t gmx_tng, gmx::ArrayRef<con
 #endif
 }
 
+#if GMX_USE_TNG
+/*! \brief Reads the blocks \p requestedIds of the next frame after \p fromFrame
+ *
+ * Only this function accesses the TNG handle while reading frames, so that
+ * it can run in a background thread.
+ */
+static TngRawFrame readNextTngRawFrame(gmx_tng_trajectory_t gmx_tng_input,
+                                       int64_t              fromFrame,
+                                       std::vector<int64_t> requestedIds)
+{
+    tng_trajectory_t    input = gmx_tng_input->tng;
+    tng_function_status stat;
+    TngRawFrame         frame;
+    int64_t             nBlocks, *blockIds = nullptr;
+    int                 blockDependency;
+
+    stat = tng_num_particles_get(input, &frame.numParticles);
+    if (stat != TNG_SUCCESS)
+    {
+        gmx_file("Cannot determine number of atoms from TNG file.");
+    }
+    frame.distanceScaleFactor = getDistanceScaleFactor(gmx_tng_input);
+
+    stat = tng_util_trajectory_next_frame_present_data_blocks_find(input,
+                                                                   static_cast<int>(fromFrame),
+                                                                   requestedIds.size(),
+                                                                   requestedIds.data(),
+                                                                   &frame.frameNumber,
+                                                                   &nBlocks,
+                                                                   &blockIds);
+    gmx::unique_cptr<int64_t, gmx::free_wrapper> blockIdsGuard(blockIds);
+    if (stat == TNG_CRITICAL)
+    {
+        gmx_file("Cannot read TNG file. Cannot find data blocks of next frame.");
+    }
+    if (stat == TNG_FAILURE || nBlocks == 0)
+    {
+        return frame;
+    }
+    frame.exists = true;
+
+    for (int64_t i = 0; i < nBlocks; i++)
+    {
+        TngFrameBlock block;
+        void*         values = nullptr;
+        block.id             = blockIds[i];
+        tng_data_block_dependency_get(input, block.id, &blockDependency);
+        if (blockDependency & TNG_PARTICLE_DEPENDENT)
+        {
+            stat = tng_util_particle_data_next_frame_read(input,
+                                                          block.id,
+                                                          &values,
+                                                          &block.datatype,
+                                                          &frame.frameNumber,
+                                                          &frame.frameTime);
+        }
+        else
+        {
+            stat = tng_util_non_particle_data_next_frame_read(input,
+                                                              block.id,
+                                                              &values,
+                                                              &block.datatype,
+                                                              &frame.frameNumber,
+                                                              &frame.frameTime);
+        }
+        block.values.reset(values);
+        if (stat == TNG_CRITICAL)
+        {
+            gmx_file("Cannot read positions from TNG file.");
+        }
+        else if (stat == TNG_FAILURE)
+        {
+            continue;
+        }
+        if (block.id == TNG_TRAJ_POSITIONS || block.id == TNG_TRAJ_VELOCITIES)
+        {
+            tng_util_frame_current_compression_get(
+                    input, block.id, &block.codecId, &block.precision);
+        }
+        frame.blocks.push_back(std::move(block));
+    }
+
+    return frame;
+}
+#endif
+
+void gmx_tng_set_frame_prefetching(gmx_tng_trajectory_t gmx_tng, bool prefetch)
+{
+#if GMX_USE_TNG
+    gmx_tng->prefetchFrames = prefetch;
+#else
+    GMX_UNUSED_VALUE(gmx_tng);
+    GMX_UNUSED_VALUE(prefetch);
+#endif
+}
+
 /* TODO: If/when TNG acquires the ability to copy data blocks without
  * uncompressing them, then this implemenation should be reconsidered.
  * Ideally, gmx trjconv -f a.tng -o b.tng -b 10 -e 20 would be fast
@@ -1398,18 +1563,9 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                                  int                  numRequestedIds)
 {
 #if GMX_USE_TNG
-    tng_trajectory_t    input = gmx_tng_input->tng;
-    gmx_bool            bOK   = TRUE;
-    tng_function_status stat;
-    int64_t             numberOfAtoms = -1, frameNumber = -1;
-    int64_t             nBlocks, blockId, *blockIds = nullptr, codecId;
-    char                datatype  = -1;
-    void*               values    = nullptr;
-    double              frameTime = -1.0;
-    int                 size, blockDependency;
-    double              prec;
-    const int           defaultNumIds                       = 5;
-    static int64_t      fallbackRequestedIds[defaultNumIds] = {
+    int            size;
+    const int      defaultNumIds                       = 5;
+    static int64_t fallbackRequestedIds[defaultNumIds] = {
         TNG_TRAJ_BOX_SHAPE, TNG_TRAJ_POSITIONS, TNG_TRAJ_VELOCITIES, TNG_TRAJ_FORCES, TNG_GMX_LAMBDA
     };
 
@@ -1431,54 +1587,53 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
         numRequestedIds = defaultNumIds;
         requestedIds    = fallbackRequestedIds;
     }
-
-    stat = tng_num_particles_get(input, &numberOfAtoms);
-    if (stat != TNG_SUCCESS)
+    std::vector<int64_t> requestedIdList(requestedIds, requestedIds + numRequestedIds);
+
+    /* With prefetching, the frame was read in the background during the
+     * previous call, with the block IDs of that call. */
+    TngRawFrame frame;
+    if (gmx_tng_input->prefetchedFrame.valid())
+    {
+        // This rethrows exceptions from reading the frame
+        frame = gmx_tng_input->prefetchedFrame.get();
+        frame.blocks.erase(std::remove_if(frame.blocks.begin(),
+                                          frame.blocks.end(),
+                                          [&requestedIdList](const TngFrameBlock& block) {
+                                              return std::find(requestedIdList.begin(),
+                                                               requestedIdList.end(),
+                                                               block.id)
+                                                     == requestedIdList.end();
+                                          }),
+                           frame.blocks.end());
+    }
+    else
     {
-        gmx_file("Cannot determine number of atoms from TNG file.");
+        frame = readNextTngRawFrame(gmx_tng_input, fr->step, requestedIdList);
     }
-    fr->natoms = numberOfAtoms;
-
-    bool nextFrameExists = gmx_get_tng_data_block_types_of_next_frame(
-            gmx_tng_input, fr->step, numRequestedIds, requestedIds, &frameNumber, &nBlocks, &blockIds);
-    gmx::unique_cptr<int64_t, gmx::free_wrapper> blockIdsGuard(blockIds);
-    if (!nextFrameExists)
+    fr->natoms = frame.numParticles;
+    if (!frame.exists)
     {
         return FALSE;
     }
-
-    if (nBlocks == 0)
+    if (gmx_tng_input->prefetchFrames)
     {
-        return FALSE;
+        /* Read and decompress the next frame while the caller processes
+         * this one. The TNG handle is only accessed by that thread until
+         * the frame is retrieved. */
+        gmx_tng_input->prefetchedFrame = std::async(std::launch::async,
+                                                    readNextTngRawFrame,
+                                                    gmx_tng_input,
+                                                    frame.frameNumber,
+                                                    requestedIdList);
     }
 
-    for (int64_t i = 0; i < nBlocks; i++)
+    for (const TngFrameBlock& block : frame.blocks)
     {
-        blockId = blockIds[i];
-        tng_data_block_dependency_get(input, blockId, &blockDependency);
-        if (blockDependency & TNG_PARTICLE_DEPENDENT)
-        {
-            stat = tng_util_particle_data_next_frame_read(
-                    input, blockId, &values, &datatype, &frameNumber, &frameTime);
-        }
-        else
-        {
-            stat = tng_util_non_particle_data_next_frame_read(
-                    input, blockId, &values, &datatype, &frameNumber, &frameTime);
-        }
-        if (stat == TNG_CRITICAL)
-        {
-            gmx_file("Cannot read positions from TNG file.");
-            return FALSE;
-        }
-        else if (stat == TNG_FAILURE)
-        {
-            continue;
-        }
-        switch (blockId)
+        void* values = block.values.get();
+        switch (block.id)
         {
             case TNG_TRAJ_BOX_SHAPE:
-                switch (datatype)
+                switch (block.datatype)
                 {
                     case TNG_INT_DATA: size = sizeof(int64_t); break;
                     case TNG_FLOAT_DATA: size = sizeof(float); break;
@@ -1489,10 +1644,10 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                 {
                     convert_array_to_real_array(reinterpret_cast<char*>(values) + size * i * DIM,
                                                 reinterpret_cast<real*>(fr->box[i]),
-                                                getDistanceScaleFactor(gmx_tng_input),
+                                                frame.distanceScaleFactor,
                                                 1,
                                                 DIM,
-                                                datatype);
+                                                block.datatype);
                 }
                 fr->bBox = TRUE;
                 break;
@@ -1500,16 +1655,15 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                 srenew(fr->x, fr->natoms);
                 convert_array_to_real_array(values,
                                             reinterpret_cast<real*>(fr->x),
-                                            getDistanceScaleFactor(gmx_tng_input),
+                                            frame.distanceScaleFactor,
                                             fr->natoms,
                                             DIM,
-                                            datatype);
+                                            block.datatype);
                 fr->bX = TRUE;
-                tng_util_frame_current_compression_get(input, blockId, &codecId, &prec);
                 /* This must be updated if/when more lossy compression methods are added */
-                if (codecId == TNG_TNG_COMPRESSION)
+                if (block.codecId == TNG_TNG_COMPRESSION)
                 {
-                    fr->prec  = prec;
+                    fr->prec  = block.precision;
                     fr->bPrec = TRUE;
                 }
                 break;
@@ -1517,16 +1671,15 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                 srenew(fr->v, fr->natoms);
                 convert_array_to_real_array(values,
                                             reinterpret_cast<real*>(fr->v),
-                                            getDistanceScaleFactor(gmx_tng_input),
+                                            frame.distanceScaleFactor,
                                             fr->natoms,
                                             DIM,
-                                            datatype);
+                                            block.datatype);
                 fr->bV = TRUE;
-                tng_util_frame_current_compression_get(input, blockId, &codecId, &prec);
                 /* This must be updated if/when more lossy compression methods are added */
-                if (codecId == TNG_TNG_COMPRESSION)
+                if (block.codecId == TNG_TNG_COMPRESSION)
                 {
-                    fr->prec  = prec;
+                    fr->prec  = block.precision;
                     fr->bPrec = TRUE;
                 }
                 break;
@@ -1534,14 +1687,14 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                 srenew(fr->f, fr->natoms);
                 convert_array_to_real_array(values,
                                             reinterpret_cast<real*>(fr->f),
-                                            getDistanceScaleFactor(gmx_tng_input),
+                                            frame.distanceScaleFactor,
                                             fr->natoms,
                                             DIM,
-                                            datatype);
+                                            block.datatype);
                 fr->bF = TRUE;
                 break;
             case TNG_GMX_LAMBDA:
-                switch (datatype)
+                switch (block.datatype)
                 {
                     case TNG_FLOAT_DATA: fr->lambda = *(reinterpret_cast<float*>(values)); break;
                     case TNG_DOUBLE_DATA: fr->lambda = *(reinterpret_cast<double*>(values)); break;
@@ -1554,22 +1707,16 @@ gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t gmx_tng_input,
                         "Illegal block type! Currently GROMACS tools can only handle certain data "
                         "types. Skipping block.");
         }
-        /* values does not have to be freed before reading next frame. It will
-         * be reallocated if it is not NULL. */
     }
 
-    fr->step  = frameNumber;
+    fr->step  = frame.frameNumber;
     fr->bStep = TRUE;
 
     // Convert the time to ps
-    fr->time  = frameTime / gmx::c_pico;
-    fr->bTime = (frameTime > 0);
-
-    // TODO This does not leak, but is not exception safe.
-    /* values must be freed before leaving this function */
-    sfree(values);
+    fr->time  = frame.frameTime / gmx::c_pico;
+    fr->bTime = (frame.frameTime > 0);
 
-    return bOK;
+    return TRUE;
 #else
     GMX_UNUSED_VALUE(gmx_tng_input);
     GMX_UNUSED_VALUE(fr);
@@ -1597,6 +1744,8 @@ void gmx_print_tng_molecule_system(gmx_tng_trajectory_t gmx_tng_input, FILE* str
     std::vector<real>   atomMasses;
     tng_trajectory_t    input = gmx_tng_input->tng;
 
+    waitForPrefetchedTngFrame(gmx_tng_input);
+
     tng_num_molecule_types_get(input, &nMolecules);
     tng_molecule_cnt_list_get(input, &molCntList);
     /* Can the number of particles change in the trajectory or is it constant? */
@@ -1747,6 +1896,8 @@ gmx_bool gmx_get_tng_data_block_types_of_next_frame(gmx_tng_trajectory_t gmx_tng
     tng_function_status stat;
     tng_trajectory_t    input = gmx_tng_input->tng;
 
+    waitForPrefetchedTngFrame(gmx_tng_input);
+
     stat = tng_util_trajectory_next_frame_present_data_blocks_find(
             input, frame, nRequestedIds, requestedIds, nextFrame, nBlocks, blockIds);
 
@@ -1792,6 +1943,8 @@ gmx_bool gmx_get_tng_data_next_frame_of_block_type(gmx_tng_trajectory_t gmx_tng_
     double              localPrec;
     tng_trajectory_t    input = gmx_tng_input->tng;
 
+    waitForPrefetchedTngFrame(gmx_tng_input);
+
     stat = tng_data_block_name_get(input, blockId, name, maxLen);
     if (stat != TNG_SUCCESS)
     {
@@ -166,6 +166,19 @@ void gmx_write_tng_from_trxframe(gmx_tng_trajectory_t output, const t_trxframe*
  * selection group. */
 void gmx_tng_setup_atom_subgroup(gmx_tng_trajectory_t tng, gmx::ArrayRef<const int> ind, const char* name);
 
+/*! \brief Sets whether gmx_read_next_tng_frame() reads ahead in the background
+ *
+ * With prefetching, after each frame that is returned, the next frame is
+ * read and decompressed in a background thread, with the same requested
+ * block IDs, while the caller processes the current frame. Later requests
+ * for other blocks only see the blocks that were prefetched.
+ * Prefetching is off by default.
+ *
+ * \param tng      Valid handle to a TNG trajectory opened for reading
+ * \param prefetch Whether to read the next frame in the background
+ */
+void gmx_tng_set_frame_prefetching(gmx_tng_trajectory_t tng, bool prefetch);
+
 /*! \brief Read the first/next TNG frame. */
 gmx_bool gmx_read_next_tng_frame(gmx_tng_trajectory_t input,
                                  struct t_trxframe*   fr,
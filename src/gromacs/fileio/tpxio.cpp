@@ -53,6 +53,7 @@
 #include "gromacs/fileio/filetypes.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
+#include "gromacs/fileio/mappedfile.h"
 #include "gromacs/math/units.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/awh_history.h"
@@ -142,6 +143,7 @@ enum tpxv
     tpxv_ReaddedConstantAcceleration, /**< Re-added support for constant acceleration NEMD. */
     tpxv_RemoveTholeRfac,             /**< Remove unused rfac parameter from thole listed force */
     tpxv_RemoveAtomtypes,             /**< Remove unused atomtypes parameter from mtop */
+    tpxv_CompressedXPrecisionOther,   /**< Added compressed-x-precision-other mdp option */
     tpxv_Count                        /**< the total number of tpxv versions */
 };
 
@@ -1156,6 +1158,14 @@ static void do_inputrec(gmx::ISerializer* serializer, t_inputrec* ir, int file_v
         ir->delta_t = rdum;
     }
     serializer->doReal(&ir->x_compression_precision);
+    if (file_version >= tpxv_CompressedXPrecisionOther)
+    {
+        serializer->doReal(&ir->x_compression_precision_other);
+    }
+    else
+    {
+        ir->x_compression_precision_other = 0;
+    }
     if (file_version >= 81)
     {
         serializer->doReal(&ir->verletbuf_tol);
@@ -2905,6 +2915,16 @@ static void do_tpx_state_first(gmx::ISerializer* serializer, TpxFileHeader* tpx,
     }
 }
 
+/*! \brief
+ * Returns whether the TPR body is stored as a single block with its size in the header.
+ *
+ * \param[in] tpx The file header data.
+ */
+static bool tprBodyHasSizeField(const TpxFileHeader& tpx)
+{
+    return tpx.fileVersion >= tpxv_AddSizeField && tpx.fileGeneration >= 27;
+}
+
 /*! \brief
  * Process global topology data.
  *
@@ -3020,6 +3040,34 @@ static void do_tpx_state_second(gmx::ISerializer* serializer, TpxFileHeader* tpx
         serializer->doRvecArray(as_rvec_array(dummyForces.data()), tpx->natoms);
     }
 }
+
+/*! \brief
+ * Read past the coordinate, velocity and force vectors without storing them.
+ *
+ * Used instead of do_tpx_state_second when the caller does not need the
+ * state vectors. Reads in chunks, so no memory proportional to the number
+ * of atoms is needed.
+ *
+ * \param[in] serializer Abstract serializer used to read data.
+ * \param[in] tpx The file header data.
+ */
+static void skip_tpx_state_vectors(gmx::ISerializer* serializer, const TpxFileHeader* tpx)
+{
+    GMX_RELEASE_ASSERT(serializer->reading(), "Can only skip state vectors when reading");
+
+    constexpr int c_chunkSize = 4096;
+
+    const int numVectors = (tpx->bX ? 1 : 0) + (tpx->bV ? 1 : 0) + (tpx->bF ? 1 : 0);
+    std::vector<gmx::RVec> scratch(std::min(tpx->natoms, c_chunkSize));
+    for (int vector = 0; vector < numVectors; vector++)
+    {
+        for (int start = 0; start < tpx->natoms; start += c_chunkSize)
+        {
+            serializer->doRvecArray(as_rvec_array(scratch.data()),
+                                    std::min(c_chunkSize, tpx->natoms - start));
+        }
+    }
+}
 /*! \brief
  * Process simulation parameters.
  *
@@ -3135,6 +3183,8 @@ static void do_tpx_finalize(TpxFileHeader* tpx, t_inputrec* ir, t_state* state,
  * \param[in,out] x Individual coordinates for processing, deprecated.
  * \param[in,out] v Individual velocities for processing, deprecated.
  * \param[in,out] mtop Global topology.
+ * \param[in] skipStateVectors When reading, skip the coordinates and velocities
+ *                             instead of storing them in \p state.
  */
 static PbcType do_tpx_body(gmx::ISerializer* serializer,
                            TpxFileHeader*    tpx,
@@ -3142,14 +3192,19 @@ static PbcType do_tpx_body(gmx::ISerializer* serializer,
                            t_state*          state,
                            rvec*             x,
                            rvec*             v,
-                           gmx_mtop_t*       mtop)
+                           gmx_mtop_t*       mtop,
+                           bool              skipStateVectors = false)
 {
     if (state)
     {
         do_tpx_state_first(serializer, tpx, state);
     }
     do_tpx_mtop(serializer, tpx, mtop);
-    if (state)
+    if (state && skipStateVectors)
+    {
+        skip_tpx_state_vectors(serializer, tpx);
+    }
+    else if (state)
     {
         do_tpx_state_second(serializer, tpx, state, x, v);
     }
@@ -3239,47 +3294,74 @@ static void doTpxBodyBuffer(gmx::ISerializer* serializer, gmx::ArrayRef<char> bu
  * Here the information from the serialization interface \p serializer
  * is used to first populate the datastructures containing the simulation
  * information. Depending on the version found in the header \p tpx,
- * this is done using the new reading of the data as one block from disk,
+ * this is done using the new reading of the data as one block,
  * followed by complete deserialization of the information read from there.
+ * When \p mappedBody is not empty, it holds that block, mapped directly
+ * from the file, and is deserialized without copying.
  * Otherwise, the datastructures are populated as before one by one from disk.
  * The second version is the default for the legacy tools that read the
  * coordinates and velocities separate from the state.
  *
- * After reading in the data, a separate buffer is populated from them
- * containing only \p ir and \p mtop that can be communicated directly
- * to nodes needing the information to set up a simulation.
+ * After reading in the data, when \p prepareBroadcastBody is true,
+ * a separate buffer is populated from them containing only \p ir and
+ * \p mtop that can be communicated directly to nodes needing the
+ * information to set up a simulation.
  *
  * \param[in] tpx The file header.
  * \param[in] serializer The Serialization interface used to read the TPR.
+ * \param[in] mappedBody The memory mapped TPR body, or empty.
  * \param[out] ir Input rec to populate.
  * \param[out] state State vectors to populate.
  * \param[out] x Coordinates to populate if needed.
  * \param[out] v Velocities to populate if needed.
  * \param[out] mtop Global topology to populate.
+ * \param[in] skipStateVectors Whether to skip the state vectors when \p x is nullptr.
+ * \param[in] prepareBroadcastBody Whether to populate the buffer for communication.
  *
  * \returns Partial de-serialized TPR used for communication to nodes.
  */
-static PartialDeserializedTprFile readTpxBody(TpxFileHeader*    tpx,
-                                              gmx::ISerializer* serializer,
-                                              t_inputrec*       ir,
-                                              t_state*          state,
-                                              rvec*             x,
-                                              rvec*             v,
-                                              gmx_mtop_t*       mtop)
+static PartialDeserializedTprFile readTpxBody(TpxFileHeader*            tpx,
+                                              gmx::ISerializer*         serializer,
+                                              gmx::ArrayRef<const char> mappedBody,
+                                              t_inputrec*               ir,
+                                              t_state*                  state,
+                                              rvec*                     x,
+                                              rvec*                     v,
+                                              gmx_mtop_t*               mtop,
+                                              bool                      skipStateVectors,
+                                              bool                      prepareBroadcastBody)
 {
     PartialDeserializedTprFile partialDeserializedTpr;
-    if (tpx->fileVersion >= tpxv_AddSizeField && tpx->fileGeneration >= 27)
+    if (tprBodyHasSizeField(*tpx) && !mappedBody.empty())
+    {
+        // The body is big endian, see the comment on serializing it below.
+        gmx::InMemoryDeserializer tprBodyDeserializer(
+                mappedBody, tpx->isDouble, gmx::EndianSwapBehavior::SwapIfHostIsLittleEndian);
+        partialDeserializedTpr.pbcType =
+                do_tpx_body(&tprBodyDeserializer, tpx, ir, state, x, v, mtop, skipStateVectors);
+    }
+    else if (tprBodyHasSizeField(*tpx))
     {
         partialDeserializedTpr.body.resize(tpx->sizeOfTprBody);
         partialDeserializedTpr.header = *tpx;
         doTpxBodyBuffer(serializer, partialDeserializedTpr.body);
 
-        partialDeserializedTpr.pbcType =
-                completeTprDeserialization(&partialDeserializedTpr, ir, state, x, v, mtop);
+        gmx::InMemoryDeserializer tprBodyDeserializer(partialDeserializedTpr.body,
+                                                      partialDeserializedTpr.header.isDouble,
+                                                      gmx::EndianSwapBehavior::SwapIfHostIsLittleEndian);
+        partialDeserializedTpr.pbcType = do_tpx_body(
+                &tprBodyDeserializer, &partialDeserializedTpr.header, ir, state, x, v, mtop, skipStateVectors);
     }
     else
     {
-        partialDeserializedTpr.pbcType = do_tpx_body(serializer, tpx, ir, state, x, v, mtop);
+        partialDeserializedTpr.pbcType =
+                do_tpx_body(serializer, tpx, ir, state, x, v, mtop, skipStateVectors);
+    }
+    if (!prepareBroadcastBody)
+    {
+        partialDeserializedTpr.header = *tpx;
+        partialDeserializedTpr.body.clear();
+        return partialDeserializedTpr;
     }
     // Update header to system info for communication to nodes.
     // As we only need to communicate the inputrec and mtop to other nodes,
@@ -3298,6 +3380,59 @@ static PartialDeserializedTprFile readTpxBody(TpxFileHeader*    tpx,
     return partialDeserializedTpr;
 }
 
+/*! \brief
+ * Reads the TPR file \p fn.
+ *
+ * The header is read through XDR. When the body is stored as a single
+ * block, the file is memory mapped and the body is deserialized directly
+ * from the mapping, so it is never copied and only the parts of the file
+ * that are needed are read from disk.
+ *
+ * \param[in] fn Input file name.
+ * \param[out] ir Input rec to populate, or nullptr.
+ * \param[out] state State to populate.
+ * \param[out] x Coordinates to populate, or nullptr.
+ * \param[out] v Velocities to populate, or nullptr.
+ * \param[out] mtop Global topology to populate, or nullptr.
+ * \param[in] skipStateVectors Whether to skip the state vectors when \p x is nullptr.
+ * \param[in] prepareBroadcastBody Whether to populate the buffer for communication.
+ *
+ * \returns Partial de-serialized TPR, with a body only with \p prepareBroadcastBody.
+ */
+static PartialDeserializedTprFile readTpxFile(const char* fn,
+                                              t_inputrec* ir,
+                                              t_state*    state,
+                                              rvec*       x,
+                                              rvec*       v,
+                                              gmx_mtop_t* mtop,
+                                              bool        skipStateVectors,
+                                              bool        prepareBroadcastBody)
+{
+    t_fileio* fio = open_tpx(fn, "r");
+    gmx::FileIOXdrSerializer serializer(fio);
+    TpxFileHeader            tpx;
+    do_tpxheader(&serializer, &tpx, fn, fio, ir == nullptr);
+
+    std::unique_ptr<gmx::MappedFile> mappedFile;
+    gmx::ArrayRef<const char>        mappedBody;
+    if (tprBodyHasSizeField(tpx))
+    {
+        const gmx_off_t bodyOffset = gmx_fio_ftell(fio);
+        mappedFile                 = std::make_unique<gmx::MappedFile>(fn);
+        // With a truncated file we fall back to reading through XDR, which reports the error
+        if (bodyOffset + tpx.sizeOfTprBody <= mappedFile->data().ssize())
+        {
+            mappedBody = mappedFile->data().subArray(bodyOffset, tpx.sizeOfTprBody);
+        }
+    }
+
+    PartialDeserializedTprFile partialDeserializedTpr = readTpxBody(
+            &tpx, &serializer, mappedBody, ir, state, x, v, mtop, skipStateVectors, prepareBroadcastBody);
+    close_tpx(fio);
+
+    return partialDeserializedTpr;
+}
+
 /************************************************************
  *
  *  The following routines are the exported ones
@@ -3381,29 +3516,19 @@ PbcType completeTprDeserialization(PartialDeserializedTprFile* partialDeserializ
 
 PartialDeserializedTprFile read_tpx_state(const char* fn, t_inputrec* ir, t_state* state, gmx_mtop_t* mtop)
 {
-    t_fileio* fio;
-    fio = open_tpx(fn, "r");
-    gmx::FileIOXdrSerializer   serializer(fio);
-    PartialDeserializedTprFile partialDeserializedTpr;
-    do_tpxheader(&serializer, &partialDeserializedTpr.header, fn, fio, ir == nullptr);
-    partialDeserializedTpr =
-            readTpxBody(&partialDeserializedTpr.header, &serializer, ir, state, nullptr, nullptr, mtop);
-    close_tpx(fio);
-    return partialDeserializedTpr;
+    return readTpxFile(fn, ir, state, nullptr, nullptr, mtop, false, true);
 }
 
 PbcType read_tpx(const char* fn, t_inputrec* ir, matrix box, int* natoms, rvec* x, rvec* v, gmx_mtop_t* mtop)
 {
-    t_fileio* fio;
-    t_state   state;
+    t_state state;
 
-    TpxFileHeader tpx;
-    fio = open_tpx(fn, "r");
-    gmx::FileIOXdrSerializer serializer(fio);
-    do_tpxheader(&serializer, &tpx, fn, fio, ir == nullptr);
+    // The state is local, so when the caller does not want coordinates
+    // or velocities there is no need to store them.
+    const bool skipStateVectors = (x == nullptr && v == nullptr);
+    // Only mdrun needs the body for communication, which uses read_tpx_state()
     PartialDeserializedTprFile partialDeserializedTpr =
-            readTpxBody(&tpx, &serializer, ir, &state, x, v, mtop);
-    close_tpx(fio);
+            readTpxFile(fn, ir, &state, x, v, mtop, skipStateVectors, false);
     if (mtop != nullptr && natoms != nullptr)
     {
         *natoms = mtop->natoms;
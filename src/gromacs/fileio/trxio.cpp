@@ -59,6 +59,7 @@
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/fileio/xtcframecache.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/md_enums.h"
@@ -94,6 +95,10 @@ struct t_trxstatus
     double               DT, BOX[3];
     gmx_bool             bReadBox;
     char*                persistent_line; /* Persistent line for reading g96 trajectories */
+
+    /* Decoded xtc frames from an earlier read, or the cache being built */
+    gmx::XtcFrameCache*        xtcCache;
+    gmx::XtcFrameCacheBuilder* xtcCacheBuilder;
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t* vmdplugin;
 #endif
@@ -174,6 +179,8 @@ static void status_init(t_trxstatus* status)
     status->tf              = 0;
     status->persistent_line = nullptr;
     status->tng             = nullptr;
+    status->xtcCache        = nullptr;
+    status->xtcCacheBuilder = nullptr;
 }
 
 
@@ -638,6 +645,12 @@ void close_trx(t_trxstatus* status)
         return;
     }
     gmx_tng_close(&status->tng);
+    if (status->xtcCacheBuilder)
+    {
+        status->xtcCacheBuilder->finish();
+    }
+    delete status->xtcCacheBuilder;
+    delete status->xtcCache;
     if (status->fio)
     {
         gmx_fio_close(status->fio);
@@ -863,9 +876,29 @@ bool read_next_frame(const gmx_output_env_t* oenv, t_trxstatus* status, t_trxfra
                     }
                     initcount(status);
                 }
-                bRet      = (read_next_xtc(
-                                status->fio, fr->natoms, &fr->step, &fr->time, fr->box, fr->x, &fr->prec, &bOK)
-                        != 0);
+                if (status->xtcCache && status->xtcCache->readFrame(status->fio, fr))
+                {
+                    bRet = true;
+                    bOK  = TRUE;
+                }
+                else
+                {
+                    const gmx_off_t frameStart = gmx_fio_ftell(status->fio);
+
+                    bRet = (read_next_xtc(status->fio,
+                                          fr->natoms,
+                                          &fr->step,
+                                          &fr->time,
+                                          fr->box,
+                                          fr->x,
+                                          &fr->prec,
+                                          &bOK)
+                            != 0);
+                    if (bRet && status->xtcCacheBuilder)
+                    {
+                        status->xtcCacheBuilder->addFrame(frameStart, gmx_fio_ftell(status->fio), *fr);
+                    }
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
@@ -952,6 +985,8 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
     {
         /* Special treatment for TNG files */
         gmx_tng_open(fn, 'r', &(*status)->tng);
+        /* Decompress the next frame while the caller processes the current one */
+        gmx_tng_set_frame_prefetching((*status)->tng, true);
     }
     else
     {
@@ -1008,6 +1043,20 @@ bool read_first_frame(const gmx_output_env_t* oenv, t_trxstatus** status, const
                 fr->bX    = TRUE;
                 fr->bBox  = TRUE;
                 printcount(*status, oenv, fr->time, FALSE);
+                /* Later frames are copied from the cache of decoded frames
+                 * when there is one, otherwise the cache is created when
+                 * caching is enabled.
+                 */
+                (*status)->xtcCache = gmx::XtcFrameCache::open(fn, *fr).release();
+                if (!(*status)->xtcCache)
+                {
+                    (*status)->xtcCacheBuilder =
+                            gmx::XtcFrameCacheBuilder::create(fn, fr->natoms).release();
+                    if ((*status)->xtcCacheBuilder)
+                    {
+                        (*status)->xtcCacheBuilder->addFrame(0, gmx_fio_ftell(fio), *fr);
+                    }
+                }
             }
             bFirst = FALSE;
             break;
@@ -37,6 +37,16 @@
 #include "gmxpre.h"
 
 #include "gromacs/fileio/xdrf.h"
+
+#include "config.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
@@ -128,3 +138,131 @@ int xdr_int64(XDR* xdrs, int64_t* i)
 
     return ret;
 }
+
+namespace
+{
+
+//! Number of values converted at once by the array routines
+constexpr unsigned int c_xdrArrayChunkSize = 1024;
+
+//! Returns \p bits converted between host and big-endian (XDR) byte order
+inline uint32_t swapToXdrByteOrder(uint32_t bits)
+{
+#if GMX_INTEGER_BIG_ENDIAN
+    return bits;
+#else
+    return (bits >> 24) | ((bits >> 8) & 0x0000FF00U) | ((bits << 8) & 0x00FF0000U) | (bits << 24);
+#endif
+}
+
+//! Returns \p bits converted between host and big-endian (XDR) byte order
+inline uint64_t swapToXdrByteOrder(uint64_t bits)
+{
+#if GMX_INTEGER_BIG_ENDIAN
+    return bits;
+#else
+    return (static_cast<uint64_t>(swapToXdrByteOrder(static_cast<uint32_t>(bits))) << 32)
+           | swapToXdrByteOrder(static_cast<uint32_t>(bits >> 32));
+#endif
+}
+
+/*! \brief Reads or writes \p n values stored in memory as \p MemoryType
+ * and in the stream as \p StreamType.
+ *
+ * The conversion loops work on a fixed-size chunk with plain integer
+ * operations, so compilers can vectorize the byte swapping.
+ */
+template<typename MemoryType, typename StreamType>
+int xdrArray(XDR* xdrs, MemoryType* values, unsigned int n)
+{
+    using Bits = std::conditional_t<sizeof(StreamType) == sizeof(uint32_t), uint32_t, uint64_t>;
+    static_assert(sizeof(StreamType) == sizeof(Bits), "XDR array values should have 4 or 8 bytes");
+
+    std::array<Bits, c_xdrArrayChunkSize> buffer;
+    char* bytes = reinterpret_cast<char*>(buffer.data());
+    for (unsigned int start = 0; start < n; start += c_xdrArrayChunkSize)
+    {
+        const unsigned int count = std::min(c_xdrArrayChunkSize, n - start);
+        switch (xdrs->x_op)
+        {
+            case XDR_ENCODE:
+                if (values != nullptr)
+                {
+                    for (unsigned int i = 0; i < count; i++)
+                    {
+                        const StreamType value = static_cast<StreamType>(values[start + i]);
+                        Bits             bits;
+                        std::memcpy(&bits, &value, sizeof(bits));
+                        buffer[i] = swapToXdrByteOrder(bits);
+                    }
+                }
+                else
+                {
+                    std::fill(buffer.begin(), buffer.begin() + count, 0);
+                }
+                if (!xdr_opaque(xdrs, bytes, count * sizeof(Bits)))
+                {
+                    return 0;
+                }
+                break;
+            case XDR_DECODE:
+                if (!xdr_opaque(xdrs, bytes, count * sizeof(Bits)))
+                {
+                    return 0;
+                }
+                if (values != nullptr)
+                {
+                    for (unsigned int i = 0; i < count; i++)
+                    {
+                        const Bits bits = swapToXdrByteOrder(buffer[i]);
+                        StreamType value;
+                        std::memcpy(&value, &bits, sizeof(value));
+                        values[start + i] = static_cast<MemoryType>(value);
+                    }
+                }
+                break;
+            default: return 1;
+        }
+    }
+
+    return 1;
+}
+
+} // namespace
+
+int xdr_float_array(XDR* xdrs, float* values, unsigned int n)
+{
+    return xdrArray<float, float>(xdrs, values, n);
+}
+
+int xdr_double_array(XDR* xdrs, double* values, unsigned int n)
+{
+    return xdrArray<double, double>(xdrs, values, n);
+}
+
+int xdr_int_array(XDR* xdrs, int* values, unsigned int n)
+{
+    return xdrArray<int, int32_t>(xdrs, values, n);
+}
+
+int xdr_int32_array(XDR* xdrs, int32_t* values, unsigned int n)
+{
+    return xdrArray<int32_t, int32_t>(xdrs, values, n);
+}
+
+int xdr_int64_array(XDR* xdrs, int64_t* values, unsigned int n)
+{
+    return xdrArray<int64_t, int64_t>(xdrs, values, n);
+}
+
+int xdr_real_array(XDR* xdrs, real* values, unsigned int n, gmx_bool bDouble)
+{
+    if (bDouble)
+    {
+        return xdrArray<real, double>(xdrs, values, n);
+    }
+    else
+    {
+        return xdrArray<real, float>(xdrs, values, n);
+    }
+}
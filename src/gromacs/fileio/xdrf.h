@@ -73,6 +73,23 @@ int xdr_int32(XDR* xdrs, int32_t* i);
 //! Read or write a int64_t value.
 int xdr_int64(XDR* xdrs, int64_t* i);
 
+/* Read or write arrays of n values. The data in the stream is identical to
+ * that of n calls to the corresponding single-value routine, but blocks of
+ * values are converted at once and passed to the stream as opaque data,
+ * which is much faster for large arrays. When reading, values can be
+ * nullptr to skip the data.
+ */
+int xdr_float_array(XDR* xdrs, float* values, unsigned int n);
+int xdr_double_array(XDR* xdrs, double* values, unsigned int n);
+int xdr_int_array(XDR* xdrs, int* values, unsigned int n);
+int xdr_int32_array(XDR* xdrs, int32_t* values, unsigned int n);
+int xdr_int64_array(XDR* xdrs, int64_t* values, unsigned int n);
+
+/* Read or write an array of n *real* values, stored as double when
+ * bDouble=TRUE and as float otherwise.
+ */
+int xdr_real_array(XDR* xdrs, real* values, unsigned int n, gmx_bool bDouble);
+
 int xdr_xtc_seek_time(real time, FILE* fp, XDR* xdrs, int natoms, gmx_bool bSeekForwardOnly);
 
 
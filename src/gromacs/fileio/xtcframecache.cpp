@@ -0,0 +1,458 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::XtcFrameCache and gmx::XtcFrameCacheBuilder.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "xtcframecache.h"
+
+#include "config.h"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <functional>
+
+#include <sys/stat.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/mappedfile.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/path.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/sysinfo.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Identifies cache files, also detects a different byte order
+constexpr int32_t c_cacheMagic = 0x43545847;
+//! Version of the cache file layout
+constexpr int32_t c_cacheVersion = 2;
+
+//! The header at the start of a cache file
+struct XtcFrameCacheHeader
+{
+    int32_t magic;
+    int32_t version;
+    int32_t natoms;
+    int32_t numFrames;
+    int64_t sourceSize;
+    int64_t sourceModificationTime;
+    //! The length of the canonical path of the XTC file, stored after the index
+    int64_t sourcePathLength;
+};
+
+//! The index entry of a frame, stored after the coordinates of all frames
+struct XtcFrameCacheIndexEntry
+{
+    int64_t offset;
+    int64_t step;
+    float   time;
+    float   prec;
+    float   box[DIM * DIM];
+};
+
+/*! \brief Returns the canonical absolute path of \p fileName
+ *
+ * Returns an empty string when the path can not be resolved.
+ */
+std::string canonicalPath(const std::string& fileName)
+{
+#if GMX_NATIVE_WINDOWS
+    char buffer[_MAX_PATH];
+    if (_fullpath(buffer, fileName.c_str(), _MAX_PATH) != nullptr)
+    {
+        return buffer;
+    }
+#else
+    char* resolved = realpath(fileName.c_str(), nullptr);
+    if (resolved != nullptr)
+    {
+        std::string result(resolved);
+        std::free(resolved);
+        return result;
+    }
+#endif
+    return std::string();
+}
+
+/*! \brief Returns the name of the cache file for XTC file \p fileName
+ *
+ * Returns an empty string when caching is not enabled or the file can
+ * not be accessed. Otherwise the canonical path, size and modification
+ * time of the file are returned, the cache name depends on all three.
+ */
+std::string cacheFileName(const std::string& fileName,
+                          std::string*       path,
+                          int64_t*           size,
+                          int64_t*           modificationTime)
+{
+    const char* cacheDir = std::getenv("GMX_XTC_CACHE_DIR");
+    if (cacheDir == nullptr || cacheDir[0] == '\0')
+    {
+        return std::string();
+    }
+    struct stat fileStatus;
+    if (stat(fileName.c_str(), &fileStatus) != 0)
+    {
+        return std::string();
+    }
+    *path = canonicalPath(fileName);
+    if (path->empty())
+    {
+        return std::string();
+    }
+    *size             = fileStatus.st_size;
+    *modificationTime = fileStatus.st_mtime;
+    /* Files with the same name in different directories get different caches */
+    const std::string base = Path::getFilename(fileName);
+    const size_t      key  = std::hash<std::string>{}(
+            formatString("%s %" PRId64 " %" PRId64, path->c_str(), *size, *modificationTime));
+    return Path::join(cacheDir, formatString("%s.%zx.xtccache", base.c_str(), key));
+}
+
+//! Returns the number of bytes of the coordinates of one frame
+size_t frameSize(int natoms)
+{
+    return static_cast<size_t>(natoms) * DIM * sizeof(float);
+}
+
+} // namespace
+
+XtcFrameCache::~XtcFrameCache() = default;
+
+std::unique_ptr<XtcFrameCache> XtcFrameCache::open(const std::string& fileName, const t_trxframe& firstFrame)
+{
+    std::string       sourcePath;
+    int64_t           sourceSize             = 0;
+    int64_t           sourceModificationTime = 0;
+    const std::string name =
+            cacheFileName(fileName, &sourcePath, &sourceSize, &sourceModificationTime);
+    if (name.empty() || !File::exists(name, File::returnFalseOnError))
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<XtcFrameCache> cache(new XtcFrameCache);
+    try
+    {
+        cache->file_ = std::make_unique<MappedFile>(name);
+    }
+    catch (const FileIOError&)
+    {
+        return nullptr;
+    }
+
+    ArrayRef<const char> data = cache->file_->data();
+    XtcFrameCacheHeader  header;
+    if (data.size() < sizeof(header))
+    {
+        return nullptr;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != c_cacheMagic || header.version != c_cacheVersion
+        || header.natoms != firstFrame.natoms || header.numFrames <= 0
+        || header.sourceSize != sourceSize || header.sourceModificationTime != sourceModificationTime
+        || header.sourcePathLength != static_cast<int64_t>(sourcePath.size())
+        || data.size()
+                   != sizeof(header)
+                              + header.numFrames
+                                        * (frameSize(header.natoms) + sizeof(XtcFrameCacheIndexEntry))
+                              + header.sourcePathLength)
+    {
+        return nullptr;
+    }
+    /* The cache should belong to this file, not to a file with the same
+     * name, size and time elsewhere that happens to have the same key */
+    const char* storedPath = data.data() + data.size() - sourcePath.size();
+    if (sourcePath.compare(0, sourcePath.size(), storedPath, sourcePath.size()) != 0)
+    {
+        return nullptr;
+    }
+    cache->natoms_     = header.natoms;
+    cache->numFrames_  = header.numFrames;
+    cache->sourceSize_ = header.sourceSize;
+
+    const char* index = data.data() + sizeof(header) + header.numFrames * frameSize(header.natoms);
+    cache->frameOffsets_.resize(header.numFrames);
+    for (int frame = 0; frame < header.numFrames; frame++)
+    {
+        XtcFrameCacheIndexEntry entry;
+        std::memcpy(&entry, index + frame * sizeof(entry), sizeof(entry));
+        cache->frameOffsets_[frame] = entry.offset;
+        if (frame == 0
+            && (entry.offset != 0 || entry.step != firstFrame.step
+                || entry.time != static_cast<float>(firstFrame.time)))
+        {
+            return nullptr;
+        }
+    }
+    if (!cache->matchesFirstFrame(firstFrame))
+    {
+        return nullptr;
+    }
+    /* The first frame was decoded by the caller */
+    cache->nextFrame_ = 1;
+
+    return cache;
+}
+
+bool XtcFrameCache::matchesFirstFrame(const t_trxframe& firstFrame) const
+{
+    if (!firstFrame.bX || !firstFrame.bBox)
+    {
+        return false;
+    }
+    const char*             data = file_->data().data() + sizeof(XtcFrameCacheHeader);
+    XtcFrameCacheIndexEntry entry;
+    std::memcpy(&entry, data + numFrames_ * frameSize(natoms_), sizeof(entry));
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            if (entry.box[d1 * DIM + d2] != static_cast<float>(firstFrame.box[d1][d2]))
+            {
+                return false;
+            }
+        }
+    }
+    const float* components = reinterpret_cast<const float*>(data);
+    for (int d = 0; d < DIM; d++)
+    {
+        const float* component = components + d * natoms_;
+        for (int i = 0; i < natoms_; i++)
+        {
+            if (component[i] != static_cast<float>(firstFrame.x[i][d]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool XtcFrameCache::readFrame(t_fileio* fio, t_trxframe* fr)
+{
+    const gmx_off_t position = gmx_fio_ftell(fio);
+    int             frame    = nextFrame_;
+    if (frame >= numFrames_ || frameOffsets_[frame] != position)
+    {
+        /* The file was repositioned, e.g. when seeking to a start time */
+        const auto found = std::lower_bound(frameOffsets_.begin(), frameOffsets_.end(), position);
+        if (found == frameOffsets_.end() || *found != position)
+        {
+            return false;
+        }
+        frame = found - frameOffsets_.begin();
+    }
+    const gmx_off_t end = (frame + 1 < numFrames_) ? frameOffsets_[frame + 1] : sourceSize_;
+    if (gmx_fio_seek(fio, end) != 0)
+    {
+        return false;
+    }
+
+    const char* data = file_->data().data() + sizeof(XtcFrameCacheHeader);
+    XtcFrameCacheIndexEntry entry;
+    std::memcpy(&entry,
+                data + numFrames_ * frameSize(natoms_) + frame * sizeof(entry),
+                sizeof(entry));
+    fr->natoms = natoms_;
+    fr->step   = entry.step;
+    fr->time   = entry.time;
+    fr->prec   = entry.prec;
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            fr->box[d1][d2] = entry.box[d1 * DIM + d2];
+        }
+    }
+    /* The coordinates are stored as x, y and z components for all atoms */
+    const float* components = reinterpret_cast<const float*>(data + frame * frameSize(natoms_));
+    for (int d = 0; d < DIM; d++)
+    {
+        const float* component = components + d * natoms_;
+        for (int i = 0; i < natoms_; i++)
+        {
+            fr->x[i][d] = component[i];
+        }
+    }
+    nextFrame_ = frame + 1;
+
+    return true;
+}
+
+XtcFrameCacheBuilder::~XtcFrameCacheBuilder()
+{
+    abandon();
+}
+
+std::unique_ptr<XtcFrameCacheBuilder> XtcFrameCacheBuilder::create(const std::string& fileName, int natoms)
+{
+    std::unique_ptr<XtcFrameCacheBuilder> builder(new XtcFrameCacheBuilder);
+    builder->cacheFileName_ = cacheFileName(fileName,
+                                            &builder->sourcePath_,
+                                            &builder->sourceSize_,
+                                            &builder->sourceModificationTime_);
+    if (builder->cacheFileName_.empty() || natoms <= 0)
+    {
+        return nullptr;
+    }
+    builder->natoms_ = natoms;
+    /* Write to a file that is private to this process and rename it
+     * when complete, so concurrent tools never see a partial cache.
+     */
+    builder->temporaryFileName_ =
+            formatString("%s.%d.tmp", builder->cacheFileName_.c_str(), gmx_getpid());
+    builder->fp_ = std::fopen(builder->temporaryFileName_.c_str(), "wb");
+    if (builder->fp_ == nullptr)
+    {
+        return nullptr;
+    }
+    /* Reserve space for the header, which is written when finishing */
+    const XtcFrameCacheHeader header = {};
+    if (std::fwrite(&header, sizeof(header), 1, builder->fp_) != 1)
+    {
+        return nullptr;
+    }
+
+    return builder;
+}
+
+void XtcFrameCacheBuilder::addFrame(gmx_off_t start, gmx_off_t end, const t_trxframe& fr)
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    if (start != nextOffset_ || fr.natoms != natoms_)
+    {
+        abandon();
+        return;
+    }
+
+    buffer_.resize(static_cast<size_t>(natoms_) * DIM);
+    for (int d = 0; d < DIM; d++)
+    {
+        float* component = buffer_.data() + d * natoms_;
+        for (int i = 0; i < natoms_; i++)
+        {
+            component[i] = fr.x[i][d];
+        }
+    }
+    if (std::fwrite(buffer_.data(), sizeof(float), buffer_.size(), fp_) != buffer_.size())
+    {
+        abandon();
+        return;
+    }
+
+    XtcFrameCacheIndexEntry entry;
+    entry.offset = start;
+    entry.step   = fr.step;
+    entry.time   = fr.time;
+    entry.prec   = fr.prec;
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            entry.box[d1 * DIM + d2] = fr.box[d1][d2];
+        }
+    }
+    const char* entryBytes = reinterpret_cast<const char*>(&entry);
+    index_.insert(index_.end(), entryBytes, entryBytes + sizeof(entry));
+    nextOffset_ = end;
+}
+
+void XtcFrameCacheBuilder::finish()
+{
+    if (fp_ == nullptr)
+    {
+        return;
+    }
+    /* Only a cache of all frames in the file can be used by other tools */
+    if (nextOffset_ != sourceSize_ || index_.empty())
+    {
+        abandon();
+        return;
+    }
+
+    XtcFrameCacheHeader header;
+    header.magic                  = c_cacheMagic;
+    header.version                = c_cacheVersion;
+    header.natoms                 = natoms_;
+    header.numFrames              = index_.size() / sizeof(XtcFrameCacheIndexEntry);
+    header.sourceSize             = sourceSize_;
+    header.sourceModificationTime = sourceModificationTime_;
+    header.sourcePathLength       = sourcePath_.size();
+    bool bOK = (std::fwrite(index_.data(), 1, index_.size(), fp_) == index_.size());
+    bOK      = bOK
+          && (std::fwrite(sourcePath_.data(), 1, sourcePath_.size(), fp_) == sourcePath_.size());
+    bOK      = bOK && (gmx_fseek(fp_, 0, SEEK_SET) == 0);
+    bOK      = bOK && (std::fwrite(&header, sizeof(header), 1, fp_) == 1);
+    bOK      = (std::fclose(fp_) == 0) && bOK;
+    fp_      = nullptr;
+    if (!bOK || std::rename(temporaryFileName_.c_str(), cacheFileName_.c_str()) != 0)
+    {
+        std::remove(temporaryFileName_.c_str());
+    }
+}
+
+void XtcFrameCacheBuilder::abandon()
+{
+    if (fp_ != nullptr)
+    {
+        std::fclose(fp_);
+        fp_ = nullptr;
+        std::remove(temporaryFileName_.c_str());
+    }
+    index_.clear();
+}
+
+} // namespace gmx
@@ -0,0 +1,182 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares a cache of decoded XTC frames that is shared between tools.
+ *
+ * When the environment variable GMX_XTC_CACHE_DIR names a directory, the
+ * frames decoded while a tool reads an XTC file from start to end are
+ * stored in that directory. Later reads of the same file, also by other
+ * tools, copy the coordinates from a memory mapping of the cache instead
+ * of decompressing them again.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_XTCFRAMECACHE_H
+#define GMX_FILEIO_XTCFRAMECACHE_H
+
+#include <cstdio>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/futil.h"
+
+struct t_fileio;
+struct t_trxframe;
+
+namespace gmx
+{
+
+class MappedFile;
+
+/*! \libinternal \brief
+ * Read access to the cached decoded frames of an XTC file.
+ *
+ * The cache stores the coordinates of each frame as single precision
+ * arrays of x, y and z components, followed by an index with the file
+ * offset, step, time, precision and box of each frame and by the
+ * canonical path of the XTC file.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class XtcFrameCache
+{
+public:
+    /*! \brief Opens the cache for the XTC file \p fileName
+     *
+     * Returns nullptr when caching is not enabled, when there is no cache
+     * for the current contents of the file or when the cache does not
+     * match \p firstFrame, the first frame decoded from the file. The
+     * coordinates and box of the first frame are compared exactly.
+     */
+    static std::unique_ptr<XtcFrameCache> open(const std::string& fileName, const t_trxframe& firstFrame);
+
+    ~XtcFrameCache();
+
+    /*! \brief Copies the frame that starts at the current position of \p fio into \p fr
+     *
+     * On success, \p fio is positioned at the start of the next frame, as
+     * when the frame would have been read from the file. Returns false,
+     * without changing \p fio, when no cached frame starts at the
+     * current position.
+     */
+    bool readFrame(t_fileio* fio, t_trxframe* fr);
+
+private:
+    XtcFrameCache() = default;
+
+    //! Returns whether the first cached frame has the same coordinates and box as \p firstFrame
+    bool matchesFirstFrame(const t_trxframe& firstFrame) const;
+
+    //! The memory mapped cache file
+    std::unique_ptr<MappedFile> file_;
+    //! The number of atoms per frame
+    int natoms_ = 0;
+    //! The number of frames
+    int numFrames_ = 0;
+    //! The size of the XTC file
+    gmx_off_t sourceSize_ = 0;
+    //! The offsets of the frames in the XTC file
+    std::vector<gmx_off_t> frameOffsets_;
+    //! The index of the frame expected to be read next
+    int nextFrame_ = 0;
+};
+
+/*! \libinternal \brief
+ * Creates the cache of decoded frames of an XTC file while it is read.
+ *
+ * Frames should be added in the order they are read from the file.
+ * The cache is only stored when all frames of the file were added.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class XtcFrameCacheBuilder
+{
+public:
+    /*! \brief Starts a cache for the XTC file \p fileName
+     *
+     * Returns nullptr when caching is not enabled or the cache file
+     * can not be created.
+     */
+    static std::unique_ptr<XtcFrameCacheBuilder> create(const std::string& fileName, int natoms);
+
+    ~XtcFrameCacheBuilder();
+
+    /*! \brief Adds frame \p fr which was read from offsets \p start up to \p end in the file
+     *
+     * Frames that are not consecutive to the previous frame, e.g. after
+     * seeking in the file, make the cache incomplete, so it is abandoned.
+     */
+    void addFrame(gmx_off_t start, gmx_off_t end, const t_trxframe& fr);
+
+    //! Stores the cache when all frames of the file were added, removes it otherwise
+    void finish();
+
+private:
+    XtcFrameCacheBuilder() = default;
+
+    //! Closes and removes the incomplete cache file
+    void abandon();
+
+    //! The name of the cache file
+    std::string cacheFileName_;
+    //! The name of the file the cache is written to until it is complete
+    std::string temporaryFileName_;
+    //! The canonical path of the XTC file
+    std::string sourcePath_;
+    //! The cache file being written, nullptr after finishing or abandoning
+    FILE* fp_ = nullptr;
+    //! The number of atoms per frame
+    int natoms_ = 0;
+    //! The size of the XTC file
+    gmx_off_t sourceSize_ = 0;
+    //! The modification time of the XTC file
+    int64_t sourceModificationTime_ = 0;
+    //! The offset in the XTC file where the next frame should start
+    gmx_off_t nextOffset_ = 0;
+    //! The index entries of the frames added so far
+    std::vector<char> index_;
+    //! Buffer for converting coordinates to single precision components
+    std::vector<float> buffer_;
+};
+
+} // namespace gmx
+
+#endif
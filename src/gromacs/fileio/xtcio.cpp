@@ -41,6 +41,9 @@
 
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio_xdr.h"
 #include "gromacs/fileio/xdrf.h"
@@ -50,6 +53,10 @@
 #include "gromacs/utility/smalloc.h"
 
 #define XTC_MAGIC 1995
+/* Magic number of frames that store groups of atoms with different precisions */
+#define XTC_GROUP_PRECISION_MAGIC 1997
+/* The maximum number of precision groups in a frame */
+#define XTC_MAX_PRECISION_GROUPS 256
 
 
 static int xdr_r2f(XDR* xdrs, real* r, gmx_bool gmx_unused bRead)
@@ -87,9 +94,13 @@ void close_xtc(t_fileio* fio)
 
 static void check_xtc_magic(int magic)
 {
-    if (magic != XTC_MAGIC)
+    if (magic != XTC_MAGIC && magic != XTC_GROUP_PRECISION_MAGIC)
     {
-        gmx_fatal(FARGS, "Magic Number Error in XTC file (read %d, should be %d)", magic, XTC_MAGIC);
+        gmx_fatal(FARGS,
+                  "Magic Number Error in XTC file (read %d, should be %d or %d)",
+                  magic,
+                  XTC_MAGIC,
+                  XTC_GROUP_PRECISION_MAGIC);
     }
 }
 
@@ -199,6 +210,180 @@ static int xtc_coord(XDR* xd, int* natoms, rvec* box, rvec* x, real* prec, gmx_b
     return result;
 }
 
+/*! \brief Reads or writes the box and the coordinates of a frame with precision groups
+ *
+ * After the box, the frame stores the number of groups, the precision of
+ * each group and, for each group, its atoms as ranges of consecutive atom
+ * indices. Then the coordinates of the atoms of each group follow, in the
+ * normal compressed format with the precision of the group.
+ * On write, atom i is in group \p atomGroup[i]. On read, \p prec is set
+ * to the highest precision of the groups.
+ */
+static int xtc_group_coord(XDR*                               xd,
+                           int                                natoms,
+                           rvec*                              box,
+                           rvec*                              x,
+                           gmx::ArrayRef<const real>          precisions,
+                           gmx::ArrayRef<const unsigned char> atomGroup,
+                           real*                              prec,
+                           gmx_bool                           bRead)
+{
+    int result = 1;
+    for (int i = 0; ((i < DIM) && result); i++)
+    {
+        for (int j = 0; ((j < DIM) && result); j++)
+        {
+            result = XTC_CHECK("box", xdr_r2f(xd, &(box[i][j]), bRead));
+        }
+    }
+    if (!result)
+    {
+        return result;
+    }
+
+    /* On write, only groups that contain atoms are stored */
+    std::vector<float>            groupPrecision;
+    std::vector<std::vector<int>> groupRanges;
+    if (!bRead)
+    {
+        std::vector<int> groupIndex(precisions.size(), -1);
+        for (int i = 0; i < natoms; i++)
+        {
+            const int g = atomGroup[i];
+            GMX_RELEASE_ASSERT(g < precisions.ssize(), "Atom groups should have a precision");
+            if (groupIndex[g] < 0)
+            {
+                groupIndex[g] = groupPrecision.size();
+                groupPrecision.push_back(precisions[g]);
+                groupRanges.emplace_back();
+            }
+            std::vector<int>& ranges = groupRanges[groupIndex[g]];
+            if (!ranges.empty() && ranges[ranges.size() - 2] + ranges.back() == i)
+            {
+                ranges.back()++;
+            }
+            else
+            {
+                ranges.push_back(i);
+                ranges.push_back(1);
+            }
+        }
+    }
+
+    int numGroups = groupPrecision.size();
+    result        = XTC_CHECK("number of groups", xdr_int(xd, &numGroups));
+    if (!result || numGroups < 0 || numGroups > XTC_MAX_PRECISION_GROUPS)
+    {
+        return 0;
+    }
+    groupPrecision.resize(numGroups);
+    groupRanges.resize(numGroups);
+    result = XTC_CHECK("group precisions", xdr_float_array(xd, groupPrecision.data(), numGroups));
+    std::vector<int> groupNumAtoms(numGroups, 0);
+    for (int g = 0; g < numGroups && result; g++)
+    {
+        int numRanges = groupRanges[g].size() / 2;
+        result        = XTC_CHECK("number of ranges", xdr_int(xd, &numRanges));
+        if (!result || numRanges < 0 || numRanges > natoms)
+        {
+            return 0;
+        }
+        groupRanges[g].resize(2 * numRanges);
+        result = XTC_CHECK("ranges", xdr_int_array(xd, groupRanges[g].data(), 2 * numRanges));
+        for (int r = 0; r < numRanges && result; r++)
+        {
+            const int start = groupRanges[g][2 * r];
+            const int count = groupRanges[g][2 * r + 1];
+            if (start < 0 || count < 0 || start > natoms - count)
+            {
+                return 0;
+            }
+            groupNumAtoms[g] += count;
+        }
+    }
+    if (bRead && result)
+    {
+        /* The ranges of all groups together should cover each atom exactly once */
+        std::vector<bool> isCovered(natoms, false);
+        int               numCovered = 0;
+        for (int g = 0; g < numGroups; g++)
+        {
+            for (size_t r = 0; r < groupRanges[g].size(); r += 2)
+            {
+                for (int i = groupRanges[g][r]; i < groupRanges[g][r] + groupRanges[g][r + 1]; i++)
+                {
+                    if (isCovered[i])
+                    {
+                        return 0;
+                    }
+                    isCovered[i] = true;
+                    numCovered++;
+                }
+            }
+        }
+        if (numCovered != natoms)
+        {
+            return 0;
+        }
+    }
+
+    std::vector<float> groupX;
+    if (bRead)
+    {
+        *prec = 0;
+    }
+    for (int g = 0; g < numGroups && result; g++)
+    {
+        int numAtoms = groupNumAtoms[g];
+        groupX.resize(numAtoms * DIM);
+        if (!bRead)
+        {
+            float* xp = groupX.data();
+            for (size_t r = 0; r < groupRanges[g].size(); r += 2)
+            {
+                for (int i = groupRanges[g][r]; i < groupRanges[g][r] + groupRanges[g][r + 1]; i++)
+                {
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        *xp++ = x[i][d];
+                    }
+                }
+            }
+        }
+        if (numAtoms > 0)
+        {
+            result = XTC_CHECK("x", xdr3dfcoord(xd, groupX.data(), &numAtoms, &groupPrecision[g]));
+        }
+        if (bRead && result)
+        {
+            const float* xp = groupX.data();
+            for (size_t r = 0; r < groupRanges[g].size(); r += 2)
+            {
+                for (int i = groupRanges[g][r]; i < groupRanges[g][r] + groupRanges[g][r + 1]; i++)
+                {
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        x[i][d] = *xp++;
+                    }
+                }
+            }
+            *prec = std::max(*prec, static_cast<real>(groupPrecision[g]));
+        }
+    }
+
+    return result;
+}
+
+/*! \brief Reads the box and coordinates of a frame with header \p magic */
+static int xtc_read_frame_coord(XDR* xd, int magic, int* natoms, rvec* box, rvec* x, real* prec)
+{
+    if (magic == XTC_GROUP_PRECISION_MAGIC)
+    {
+        return xtc_group_coord(xd, *natoms, box, x, {}, {}, prec, TRUE);
+    }
+    return xtc_coord(xd, natoms, box, x, prec, TRUE);
+}
+
 
 int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec)
 {
@@ -235,6 +420,45 @@ int write_xtc(t_fileio* fio, int natoms, int64_t step, real time, const rvec* bo
     return bOK; /* 0 if bad, 1 if writing went well */
 }
 
+int write_xtc_group_precision(t_fileio*                          fio,
+                              int                                natoms,
+                              int64_t                            step,
+                              real                               time,
+                              const rvec*                        box,
+                              const rvec*                        x,
+                              gmx::ArrayRef<const real>          precisions,
+                              gmx::ArrayRef<const unsigned char> atomGroup)
+{
+    int      magic_number = XTC_GROUP_PRECISION_MAGIC;
+    XDR*     xd;
+    gmx_bool bDum;
+    int      bOK;
+    real     prec;
+
+    if (!fio)
+    {
+        return 1;
+    }
+
+    xd = gmx_fio_getxdr(fio);
+    if (xtc_header(xd, &magic_number, &natoms, &step, &time, FALSE, &bDum) == 0)
+    {
+        return 0;
+    }
+
+    bOK = xtc_group_coord(
+            xd, natoms, const_cast<rvec*>(box), const_cast<rvec*>(x), precisions, atomGroup, &prec, FALSE);
+
+    if (bOK)
+    {
+        if (gmx_fio_flush(fio) != 0)
+        {
+            bOK = 0;
+        }
+    }
+    return bOK;
+}
+
 int read_first_xtc(t_fileio* fio, int* natoms, int64_t* step, real* time, matrix box, rvec** x, real* prec, gmx_bool* bOK)
 {
     int  magic;
@@ -254,7 +478,7 @@ int read_first_xtc(t_fileio* fio, int* natoms, int64_t* step, real* time, matrix
 
     snew(*x, *natoms);
 
-    *bOK = (xtc_coord(xd, natoms, box, *x, prec, TRUE) != 0);
+    *bOK = (xtc_read_frame_coord(xd, magic, natoms, box, *x, prec) != 0);
 
     return static_cast<int>(*bOK);
 }
@@ -282,7 +506,164 @@ int read_next_xtc(t_fileio* fio, int natoms, int64_t* step, real* time, matrix b
         gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)", n, natoms);
     }
 
-    *bOK = (xtc_coord(xd, &natoms, box, x, prec, TRUE) != 0);
+    *bOK = (xtc_read_frame_coord(xd, magic, &natoms, box, x, prec) != 0);
+
+    return static_cast<int>(*bOK);
+}
+
+/*! \brief Reads \p numBytes bytes, rounded up to a multiple of four, and appends them to \p body
+ *
+ * Returns a pointer to the first appended byte, or nullptr on failure.
+ */
+static const unsigned char* xtc_read_raw_bytes(XDR* xd, std::vector<char>* body, int numBytes)
+{
+    if (numBytes < 0)
+    {
+        return nullptr;
+    }
+    const unsigned int alignedNumBytes = (static_cast<unsigned int>(numBytes) + 3U) & ~3U;
+    const size_t       offset          = body->size();
+    body->resize(offset + alignedNumBytes);
+    if (alignedNumBytes > 0 && xdr_opaque(xd, body->data() + offset, alignedNumBytes) == 0)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<const unsigned char*>(body->data() + offset);
+}
+
+/*! \brief Reads an XDR integer and appends its raw bytes to \p body, returns FALSE on failure */
+static gmx_bool xtc_read_raw_int(XDR* xd, std::vector<char>* body, int* value)
+{
+    const unsigned char* bytes = xtc_read_raw_bytes(xd, body, 4);
+    if (bytes == nullptr)
+    {
+        return FALSE;
+    }
+    /* XDR stores integers as big-endian */
+    *value = static_cast<int>((static_cast<unsigned int>(bytes[0]) << 24U)
+                              | (static_cast<unsigned int>(bytes[1]) << 16U)
+                              | (static_cast<unsigned int>(bytes[2]) << 8U)
+                              | static_cast<unsigned int>(bytes[3]));
+    return TRUE;
+}
+
+/*! \brief Appends the raw bytes of \p natoms coordinates stored by xdr3dfcoord to \p body
+ *
+ * This follows the layout written by xdr3dfcoord without decompressing.
+ */
+static gmx_bool xtc_read_raw_coord(XDR* xd, std::vector<char>* body, int natoms)
+{
+    int size = 0;
+    if (!xtc_read_raw_int(xd, body, &size) || size != natoms)
+    {
+        return FALSE;
+    }
+    if (size <= 9)
+    {
+        /* Small systems are stored uncompressed */
+        return xtc_read_raw_bytes(xd, body, size * DIM * sizeof(float)) != nullptr;
+    }
+    /* The precision, minimum and maximum integer coordinates and smallidx */
+    if (xtc_read_raw_bytes(xd, body, (1 + 2 * DIM + 1) * 4) == nullptr)
+    {
+        return FALSE;
+    }
+    int numBytes = 0;
+    if (!xtc_read_raw_int(xd, body, &numBytes) || numBytes < 0)
+    {
+        return FALSE;
+    }
+    return xtc_read_raw_bytes(xd, body, numBytes) != nullptr;
+}
+
+/*! \brief Appends the raw bytes of the coordinates of a frame with precision groups to \p body */
+static gmx_bool xtc_read_raw_group_coord(XDR* xd, std::vector<char>* body, int natoms)
+{
+    int numGroups = 0;
+    if (!xtc_read_raw_int(xd, body, &numGroups) || numGroups < 0 || numGroups > XTC_MAX_PRECISION_GROUPS)
+    {
+        return FALSE;
+    }
+    if (xtc_read_raw_bytes(xd, body, numGroups * sizeof(float)) == nullptr)
+    {
+        return FALSE;
+    }
+    std::vector<int> groupNumAtoms(numGroups, 0);
+    for (int g = 0; g < numGroups; g++)
+    {
+        int numRanges = 0;
+        if (!xtc_read_raw_int(xd, body, &numRanges) || numRanges < 0 || numRanges > natoms)
+        {
+            return FALSE;
+        }
+        for (int r = 0; r < numRanges; r++)
+        {
+            int start = 0;
+            int count = 0;
+            if (!xtc_read_raw_int(xd, body, &start) || !xtc_read_raw_int(xd, body, &count)
+                || start < 0 || count < 0 || start > natoms - count)
+            {
+                return FALSE;
+            }
+            groupNumAtoms[g] += count;
+        }
+    }
+    for (int g = 0; g < numGroups; g++)
+    {
+        if (groupNumAtoms[g] > 0 && !xtc_read_raw_coord(xd, body, groupNumAtoms[g]))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+int read_next_xtc_raw(t_fileio* fio, XtcRawFrame* frame, gmx_bool* bOK)
+{
+    XDR* xd = gmx_fio_getxdr(fio);
+
+    *bOK = TRUE;
+    if (!xtc_header(xd, &frame->magic, &frame->natoms, &frame->step, &frame->time, TRUE, bOK))
+    {
+        return 0;
+    }
+    check_xtc_magic(frame->magic);
+
+    frame->body.clear();
+    *bOK = (xtc_read_raw_bytes(xd, &frame->body, DIM * DIM * sizeof(float)) != nullptr);
+    if (*bOK)
+    {
+        if (frame->magic == XTC_GROUP_PRECISION_MAGIC)
+        {
+            *bOK = xtc_read_raw_group_coord(xd, &frame->body, frame->natoms);
+        }
+        else
+        {
+            *bOK = xtc_read_raw_coord(xd, &frame->body, frame->natoms);
+        }
+    }
 
     return static_cast<int>(*bOK);
 }
+
+int write_xtc_raw(t_fileio* fio, const XtcRawFrame& frame)
+{
+    int      magic_number = frame.magic;
+    int      natoms       = frame.natoms;
+    int64_t  step         = frame.step;
+    real     time         = frame.time;
+    gmx_bool bDum;
+
+    XDR* xd = gmx_fio_getxdr(fio);
+    if (xtc_header(xd, &magic_number, &natoms, &step, &time, FALSE, &bDum) == 0)
+    {
+        return 0;
+    }
+    /* The body is a multiple of four bytes, so no padding is added */
+    if (xdr_opaque(xd, const_cast<char*>(frame.body.data()), frame.body.size()) == 0)
+    {
+        return 0;
+    }
+
+    return static_cast<int>(gmx_fio_flush(fio) == 0);
+}
@@ -39,7 +39,10 @@
 #ifndef GMX_FILEIO_XTCIO_H
 #define GMX_FILEIO_XTCIO_H
 
+#include <vector>
+
 #include "gromacs/math/vectypes.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
 
@@ -78,4 +81,49 @@ int read_next_xtc(struct t_fileio* fio, int natoms, int64_t* step, real* time, m
 int write_xtc(struct t_fileio* fio, int natoms, int64_t step, real time, const rvec* box, const rvec* x, real prec);
 /* Write a frame to xtc file */
 
+int write_xtc_group_precision(struct t_fileio*                   fio,
+                              int                                natoms,
+                              int64_t                            step,
+                              real                               time,
+                              const rvec*                        box,
+                              const rvec*                        x,
+                              gmx::ArrayRef<const real>          precisions,
+                              gmx::ArrayRef<const unsigned char> atomGroup);
+/* Write a frame to xtc file where atom i is stored with precision
+ * precisions[atomGroup[i]]. Such frames use a different magic number
+ * and are read transparently by read_first_xtc and read_next_xtc,
+ * which return the highest precision of the groups in prec.
+ */
+
+/*! \brief A frame of an xtc file with the coordinates kept in compressed form
+ *
+ * Used to copy frames between files without decompressing and
+ * recompressing the coordinates.
+ */
+struct XtcRawFrame
+{
+    //! The magic number of the frame, which determines its layout
+    int magic = 0;
+    //! The number of atoms
+    int natoms = 0;
+    //! The step number
+    int64_t step = 0;
+    //! The time
+    real time = 0;
+    //! The box and the compressed coordinates, as stored in the file
+    std::vector<char> body;
+};
+
+int read_next_xtc_raw(struct t_fileio* fio, XtcRawFrame* frame, gmx_bool* bOK);
+/* Read the next frame from an xtc file without decompressing the
+ * coordinates. The header is returned in the fields of frame and the
+ * box and compressed coordinates are stored as bytes in frame->body.
+ * Returns 0 at the end of the file or when the frame is corrupted.
+ */
+
+int write_xtc_raw(struct t_fileio* fio, const XtcRawFrame& frame);
+/* Write a frame read with read_next_xtc_raw to xtc file. The step and
+ * time of the frame may be modified before writing.
+ */
+
 #endif
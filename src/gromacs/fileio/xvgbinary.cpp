@@ -0,0 +1,447 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements reading and writing of binary columnar data files.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "xvgbinary.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <type_traits>
+
+#include "gromacs/fileio/floatcompression.h"
+#include "gromacs/fileio/mappedfile.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/inmemoryserializer.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Identifies binary data files
+constexpr char c_xvgBinaryMagic[] = "GMXXVGB\n";
+//! The number of bytes of the magic
+constexpr size_t c_xvgBinaryMagicSize = sizeof(c_xvgBinaryMagic) - 1;
+//! Version of the file layout
+constexpr int32_t c_xvgBinaryVersion = 1;
+//! The number of rows that are collected in a block
+constexpr int c_xvgBinaryRowsPerBlock = 4096;
+//! All values are stored in little-endian byte order
+constexpr EndianSwapBehavior c_xvgBinaryEndianSwap = EndianSwapBehavior::SwapIfHostIsBigEndian;
+
+//! Serializes the values of a column, compressed when \p compress is set
+template<typename T>
+void serializeColumn(InMemorySerializer* serializer, std::vector<T>* values, bool compress)
+{
+    if (compress)
+    {
+        const std::vector<std::vector<char>> chunks =
+                compressFloatingPointValues(ArrayRef<const T>(*values), 1, 1);
+        int32_t numChunks = chunks.size();
+        serializer->doInt32(&numChunks);
+        for (const auto& chunk : chunks)
+        {
+            int32_t size = chunk.size();
+            serializer->doInt32(&size);
+            serializer->doOpaque(const_cast<char*>(chunk.data()), chunk.size());
+        }
+    }
+    else
+    {
+        for (T& value : *values)
+        {
+            if constexpr (std::is_same_v<T, double>)
+            {
+                serializer->doDouble(&value);
+            }
+            else
+            {
+                serializer->doFloat(&value);
+            }
+        }
+    }
+}
+
+//! Deserializes the values of a column, the size of \p values should match
+template<typename T>
+void deserializeColumn(InMemoryDeserializer* deserializer, std::vector<T>* values, bool compressed)
+{
+    if (compressed)
+    {
+        int32_t numChunks = 0;
+        deserializer->doInt32(&numChunks);
+        std::vector<std::vector<char>> chunks(std::max(numChunks, 0));
+        for (auto& chunk : chunks)
+        {
+            int32_t size = 0;
+            deserializer->doInt32(&size);
+            chunk.resize(std::max(size, 0));
+            deserializer->doOpaque(chunk.data(), chunk.size());
+        }
+        decompressFloatingPointValues(chunks, 1, *values, 1);
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        deserializer->doDoubleArray(values->data(), values->size());
+    }
+    else
+    {
+        deserializer->doFloatArray(values->data(), values->size());
+    }
+}
+
+} // namespace
+
+/********************************************************************
+ * XvgBinaryWriter::Impl
+ */
+
+class XvgBinaryWriter::Impl
+{
+public:
+    Impl(const std::string& fileName, const XvgBinaryHeader& header, bool compress);
+    ~Impl();
+
+    //! Writes a block of \p bytes, preceded by its size
+    void writeBlock(const std::vector<char>& bytes);
+    //! Writes the collected rows as a block
+    void flushRows();
+    //! Closes the file after writing the remaining rows
+    void close();
+
+    std::string fileName_;
+    FILE*       fp_;
+    bool        compress_;
+    //! The values of the collected rows, row by row
+    std::vector<double> values_;
+    //! The number of values in the current row
+    int numValuesInRow_ = 0;
+    //! The number of columns of the collected rows
+    int numColumns_ = -1;
+    //! The number of collected rows
+    int numRows_ = 0;
+};
+
+XvgBinaryWriter::Impl::Impl(const std::string& fileName, const XvgBinaryHeader& header, bool compress) :
+    fileName_(fileName), fp_(gmx_ffopen(fileName, "wb")), compress_(compress)
+{
+    if (std::fwrite(c_xvgBinaryMagic, 1, c_xvgBinaryMagicSize, fp_) != c_xvgBinaryMagicSize)
+    {
+        gmx_ffclose(fp_);
+        GMX_THROW(FileIOError("Could not write to file '" + fileName + "'"));
+    }
+    InMemorySerializer serializer(c_xvgBinaryEndianSwap);
+    int32_t            version    = c_xvgBinaryVersion;
+    int32_t            compressed = compress ? 1 : 0;
+    serializer.doInt32(&version);
+    serializer.doInt32(&compressed);
+    XvgBinaryHeader headerCopy = header;
+    serializer.doString(&headerCopy.title);
+    serializer.doString(&headerCopy.subtitle);
+    serializer.doString(&headerCopy.xLabel);
+    serializer.doString(&headerCopy.yLabel);
+    int32_t numLegends = headerCopy.legends.size();
+    serializer.doInt32(&numLegends);
+    for (std::string& legend : headerCopy.legends)
+    {
+        serializer.doString(&legend);
+    }
+    writeBlock(serializer.finishAndGetBuffer());
+}
+
+XvgBinaryWriter::Impl::~Impl()
+{
+    if (fp_ != nullptr)
+    {
+        try
+        {
+            close();
+        }
+        catch (const FileIOError&)
+        {
+        }
+    }
+}
+
+void XvgBinaryWriter::Impl::writeBlock(const std::vector<char>& bytes)
+{
+    InMemorySerializer sizeSerializer(c_xvgBinaryEndianSwap);
+    int64_t            size = bytes.size();
+    sizeSerializer.doInt64(&size);
+    const std::vector<char> sizeBytes = sizeSerializer.finishAndGetBuffer();
+    if (std::fwrite(sizeBytes.data(), 1, sizeBytes.size(), fp_) != sizeBytes.size()
+        || std::fwrite(bytes.data(), 1, bytes.size(), fp_) != bytes.size())
+    {
+        GMX_THROW(FileIOError("Could not write to file '" + fileName_ + "'"));
+    }
+}
+
+void XvgBinaryWriter::Impl::flushRows()
+{
+    if (numRows_ == 0)
+    {
+        return;
+    }
+    InMemorySerializer serializer(c_xvgBinaryEndianSwap);
+    int32_t            numRows    = numRows_;
+    int32_t            numColumns = numColumns_;
+    serializer.doInt32(&numRows);
+    serializer.doInt32(&numColumns);
+    /* The first column is often time, which needs double precision */
+    std::vector<double> firstColumn(numRows_);
+    std::vector<float>  column(numRows_);
+    for (int c = 0; c < numColumns_; c++)
+    {
+        if (c == 0)
+        {
+            for (int row = 0; row < numRows_; row++)
+            {
+                firstColumn[row] = values_[row * numColumns_ + c];
+            }
+            serializeColumn(&serializer, &firstColumn, compress_);
+        }
+        else
+        {
+            for (int row = 0; row < numRows_; row++)
+            {
+                column[row] = values_[row * numColumns_ + c];
+            }
+            serializeColumn(&serializer, &column, compress_);
+        }
+    }
+    writeBlock(serializer.finishAndGetBuffer());
+    values_.clear();
+    numRows_ = 0;
+}
+
+void XvgBinaryWriter::Impl::close()
+{
+    flushRows();
+    FILE* fp = fp_;
+    fp_      = nullptr;
+    if (gmx_ffclose(fp) != 0)
+    {
+        GMX_THROW(FileIOError("Could not close file '" + fileName_ + "'"));
+    }
+}
+
+/********************************************************************
+ * XvgBinaryWriter
+ */
+
+XvgBinaryWriter::XvgBinaryWriter(const std::string& fileName, const XvgBinaryHeader& header, bool compress) :
+    impl_(new Impl(fileName, header, compress))
+{
+}
+
+XvgBinaryWriter::~XvgBinaryWriter() = default;
+
+void XvgBinaryWriter::addValue(double value)
+{
+    impl_->values_.push_back(value);
+    impl_->numValuesInRow_++;
+}
+
+void XvgBinaryWriter::finishRow()
+{
+    const int numValues = impl_->numValuesInRow_;
+    if (numValues != impl_->numColumns_ && impl_->numRows_ > 0)
+    {
+        /* Store the values of this row in a block of its own size */
+        std::vector<double> row(impl_->values_.end() - numValues, impl_->values_.end());
+        impl_->values_.resize(impl_->values_.size() - numValues);
+        impl_->flushRows();
+        impl_->values_ = row;
+    }
+    impl_->numColumns_     = numValues;
+    impl_->numValuesInRow_ = 0;
+    impl_->numRows_++;
+    if (impl_->numRows_ == c_xvgBinaryRowsPerBlock)
+    {
+        impl_->flushRows();
+    }
+}
+
+void XvgBinaryWriter::close()
+{
+    if (impl_->fp_ != nullptr)
+    {
+        impl_->close();
+    }
+}
+
+/********************************************************************
+ * Reading
+ */
+
+bool isXvgBinaryFile(const std::string& fileName)
+{
+    FILE* fp = std::fopen(fileName.c_str(), "rb");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    char         magic[c_xvgBinaryMagicSize];
+    const size_t numRead = std::fread(magic, 1, c_xvgBinaryMagicSize, fp);
+    std::fclose(fp);
+    return numRead == c_xvgBinaryMagicSize
+           && std::memcmp(magic, c_xvgBinaryMagic, c_xvgBinaryMagicSize) == 0;
+}
+
+XvgBinaryData readXvgBinary(const std::string& fileName)
+{
+    const MappedFile           file(fileName);
+    const ArrayRef<const char> contents = file.data();
+    if (contents.size() < c_xvgBinaryMagicSize
+        || std::memcmp(contents.data(), c_xvgBinaryMagic, c_xvgBinaryMagicSize) != 0)
+    {
+        GMX_THROW(FileIOError("File '" + fileName + "' is not a binary data file"));
+    }
+
+    /* Returns the next block, or an empty block at the end of the contents */
+    size_t offset    = c_xvgBinaryMagicSize;
+    auto   nextBlock = [&contents, &offset, &fileName]() -> ArrayRef<const char> {
+        int64_t size = 0;
+        if (contents.size() - offset >= sizeof(size))
+        {
+            InMemoryDeserializer sizeDeserializer(
+                    contents.subArray(offset, sizeof(size)), false, c_xvgBinaryEndianSwap);
+            sizeDeserializer.doInt64(&size);
+            offset += sizeof(size);
+        }
+        if (size <= 0 || static_cast<uint64_t>(size) > contents.size() - offset)
+        {
+            if (offset < contents.size())
+            {
+                std::fprintf(stderr,
+                             "WARNING: Incomplete data at the end of file %s\n",
+                             fileName.c_str());
+                offset = contents.size();
+            }
+            return {};
+        }
+        ArrayRef<const char> block = contents.subArray(offset, size);
+        offset += size;
+        return block;
+    };
+
+    XvgBinaryData        data;
+    ArrayRef<const char> headerBlock = nextBlock();
+    if (headerBlock.empty())
+    {
+        GMX_THROW(FileIOError("File '" + fileName + "' has no header"));
+    }
+    InMemoryDeserializer headerDeserializer(headerBlock, false, c_xvgBinaryEndianSwap);
+    int32_t              version    = 0;
+    int32_t              compressed = 0;
+    headerDeserializer.doInt32(&version);
+    if (version != c_xvgBinaryVersion)
+    {
+        GMX_THROW(FileIOError("File '" + fileName + "' has an unsupported version"));
+    }
+    headerDeserializer.doInt32(&compressed);
+    headerDeserializer.doString(&data.header.title);
+    headerDeserializer.doString(&data.header.subtitle);
+    headerDeserializer.doString(&data.header.xLabel);
+    headerDeserializer.doString(&data.header.yLabel);
+    int32_t numLegends = 0;
+    headerDeserializer.doInt32(&numLegends);
+    data.header.legends.resize(std::max(numLegends, 0));
+    for (std::string& legend : data.header.legends)
+    {
+        headerDeserializer.doString(&legend);
+    }
+
+    std::vector<double> firstColumn;
+    std::vector<float>  column;
+    for (ArrayRef<const char> block = nextBlock(); !block.empty(); block = nextBlock())
+    {
+        InMemoryDeserializer deserializer(block, false, c_xvgBinaryEndianSwap);
+        int32_t              numRows    = 0;
+        int32_t              numColumns = 0;
+        deserializer.doInt32(&numRows);
+        deserializer.doInt32(&numColumns);
+        if (numRows <= 0 || numColumns < 0)
+        {
+            GMX_THROW(FileIOError("File '" + fileName + "' contains an invalid block"));
+        }
+        if (data.columns.empty() && numColumns == 0)
+        {
+            continue;
+        }
+        /* Columns that are new in this block are zero for the earlier rows */
+        const size_t firstRow = data.columns.empty() ? 0 : data.columns[0].size();
+        if (numColumns > gmx::ssize(data.columns))
+        {
+            data.columns.resize(numColumns, std::vector<double>(firstRow, 0.0));
+        }
+        for (auto& values : data.columns)
+        {
+            values.resize(firstRow + numRows, 0.0);
+        }
+        for (int c = 0; c < numColumns; c++)
+        {
+            std::vector<double>& values = data.columns[c];
+            if (c == 0)
+            {
+                firstColumn.resize(numRows);
+                deserializeColumn(&deserializer, &firstColumn, compressed != 0);
+                std::copy(firstColumn.begin(), firstColumn.end(), values.begin() + firstRow);
+            }
+            else
+            {
+                column.resize(numRows);
+                deserializeColumn(&deserializer, &column, compressed != 0);
+                std::copy(column.begin(), column.end(), values.begin() + firstRow);
+            }
+        }
+    }
+
+    return data;
+}
+
+} // namespace gmx
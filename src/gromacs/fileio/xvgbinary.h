@@ -0,0 +1,140 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2023, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares reading and writing of data files in a binary columnar format.
+ *
+ * Tools can write their data files in this format instead of as xvg text,
+ * which avoids the cost of formatting and parsing large amounts of data.
+ * The xvg reading functions in xvgr.h detect and read such files.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_XVGBINARY_H
+#define GMX_FILEIO_XVGBINARY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gmx
+{
+
+//! The metadata stored at the start of a binary data file
+struct XvgBinaryHeader
+{
+    //! The title of the plot
+    std::string title;
+    //! The subtitle of the plot, can be empty
+    std::string subtitle;
+    //! The label of the first column
+    std::string xLabel;
+    //! The label of the other columns
+    std::string yLabel;
+    //! The legends of the data sets, i.e. of the columns after the first
+    std::vector<std::string> legends;
+};
+
+//! The contents of a binary data file
+struct XvgBinaryData
+{
+    //! The metadata
+    XvgBinaryHeader header;
+    //! The values of each column, all columns have the same number of rows
+    std::vector<std::vector<double>> columns;
+};
+
+/*! \libinternal \brief
+ * Writes rows of values to a binary columnar data file.
+ *
+ * Rows are collected in blocks, which are stored column by column. The
+ * first column, usually time, is stored in double precision, the other
+ * columns in single precision. With compression, each column of a block
+ * is compressed losslessly with compressFloatingPointValues(). All values
+ * are stored in little-endian byte order.
+ *
+ * Each block is preceded by its size, so the complete blocks of a file
+ * that was not closed properly can still be read.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class XvgBinaryWriter
+{
+public:
+    /*! \brief Creates the file \p fileName and writes \p header
+     *
+     * \throws FileIOError if the file can not be created.
+     */
+    XvgBinaryWriter(const std::string& fileName, const XvgBinaryHeader& header, bool compress);
+    //! Writes the remaining rows and closes the file
+    ~XvgBinaryWriter();
+
+    //! Appends \p value to the current row
+    void addValue(double value);
+    /*! \brief Finishes the current row
+     *
+     * Rows are expected to have the same number of values. A row with a
+     * different number of values starts a new block.
+     */
+    void finishRow();
+    /*! \brief Writes the remaining rows and closes the file
+     *
+     * \throws FileIOError on write errors.
+     */
+    void close();
+
+private:
+    class Impl;
+
+    std::unique_ptr<Impl> impl_;
+};
+
+//! Returns whether \p fileName is a binary columnar data file
+bool isXvgBinaryFile(const std::string& fileName);
+
+/*! \brief Reads the binary columnar data file \p fileName
+ *
+ * The number of columns is that of the widest row. Values missing
+ * from narrower rows, before or after it, are set to zero.
+ *
+ * \throws FileIOError if the file can not be read or is not a binary data file.
+ */
+XvgBinaryData readXvgBinary(const std::string& fileName);
+
+} // namespace gmx
+
+#endif
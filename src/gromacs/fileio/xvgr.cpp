@@ -39,6 +39,7 @@
 
 #include "xvgr.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cctype>
@@ -48,6 +49,7 @@
 
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/xvgbinary.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/binaryinformation.h"
@@ -556,6 +558,39 @@ static char* read_xvgr_string(const char* line)
     return str;
 }
 
+/*! \brief Reads the binary data file \p fn like read_xvg_legend() reads an xvg file */
+static int read_xvg_legend_binary(const char* fn, double*** y, int* ny, char** subtitle, char*** legend)
+{
+    const gmx::XvgBinaryData data = gmx::readXvgBinary(fn);
+
+    *ny = data.columns.size();
+    snew(*y, *ny);
+    for (int column = 0; column < *ny; column++)
+    {
+        snew((*y)[column], data.columns[column].size());
+        std::copy(data.columns[column].begin(), data.columns[column].end(), (*y)[column]);
+    }
+    if (subtitle != nullptr)
+    {
+        *subtitle = data.header.subtitle.empty() ? nullptr : gmx_strdup(data.header.subtitle.c_str());
+    }
+    if (legend != nullptr)
+    {
+        *legend = nullptr;
+        if (!data.header.legends.empty())
+        {
+            const int numLegends = std::max<int>(data.header.legends.size(), *ny - 1);
+            snew(*legend, numLegends);
+            for (size_t set = 0; set < data.header.legends.size(); set++)
+            {
+                (*legend)[set] = gmx_strdup(data.header.legends[set].c_str());
+            }
+        }
+    }
+
+    return data.columns.empty() ? 0 : data.columns[0].size();
+}
+
 int read_xvg_legend(const char* fn, double*** y, int* ny, char** subtitle, char*** legend)
 {
     FILE*    fp;
@@ -567,11 +602,17 @@ int read_xvg_legend(const char* fn, double*** y, int* ny, char** subtitle, char*
     double** yy = nullptr;
     char*    tmpbuf;
     int      len = STRLEN;
-    *ny          = 0;
-    nny          = 0;
-    nx           = 0;
-    maxx         = 0;
-    fp           = gmx_fio_fopen(fn, "r");
+
+    if (gmx::isXvgBinaryFile(fn))
+    {
+        return read_xvg_legend_binary(fn, y, ny, subtitle, legend);
+    }
+
+    *ny  = 0;
+    nny  = 0;
+    nx   = 0;
+    maxx = 0;
+    fp   = gmx_fio_fopen(fn, "r");
 
     snew(tmpbuf, len);
     if (subtitle != nullptr)
@@ -737,8 +778,36 @@ int read_xvg(const char* fn, double*** y, int* ny)
     return nx;
 }
 
+/*! \brief Reads the binary data file \p fn like readXvgData() reads an xvg file */
+static gmx::MultiDimArray<std::vector<double>, gmx::dynamicExtents2D> readXvgBinaryData(const std::string& fn)
+{
+    const gmx::XvgBinaryData data = gmx::readXvgBinary(fn);
+    if (data.columns.empty())
+    {
+        return {};
+    }
+
+    const std::ptrdiff_t numColumns = data.columns.size();
+    const std::ptrdiff_t numRows    = data.columns[0].size();
+    gmx::MultiDimArray<std::vector<double>, gmx::dynamicExtents2D> xvgData(numColumns, numRows);
+    for (std::ptrdiff_t column = 0; column < numColumns; ++column)
+    {
+        for (std::ptrdiff_t row = 0; row < numRows; ++row)
+        {
+            xvgData(column, row) = data.columns[column][row];
+        }
+    }
+
+    return xvgData;
+}
+
 gmx::MultiDimArray<std::vector<double>, gmx::dynamicExtents2D> readXvgData(const std::string& fn)
 {
+    if (gmx::isXvgBinaryFile(fn))
+    {
+        return readXvgBinaryData(fn);
+    }
+
     FILE* fp = gmx_fio_fopen(fn.c_str(), "r");
     char* ptr;
     char* base = nullptr;
@@ -842,6 +911,71 @@ void write_xvg(const char* fn, const char* title, int nx, int ny, real** y, cons
     xvgrclose(fp);
 }
 
+/*! \brief Reads the binary data file \p fn like read_xvg_time() reads an xvg file with one set */
+static real** read_xvg_time_binary(const char* fn,
+                                   gmx_bool    bHaveT,
+                                   gmx_bool    bTB,
+                                   real        tb,
+                                   gmx_bool    bTE,
+                                   real        te,
+                                   int*        nset,
+                                   int*        nval,
+                                   real*       dt,
+                                   real**      t)
+{
+    const gmx::XvgBinaryData data       = gmx::readXvgBinary(fn);
+    const int                numColumns = data.columns.size();
+    const int                numRows    = (numColumns > 0) ? data.columns[0].size() : 0;
+    if (bHaveT && numColumns == 1)
+    {
+        fprintf(stderr, "Found only 1 column, assuming no time is present.\n");
+        bHaveT = FALSE;
+    }
+    const int firstSet = bHaveT ? 1 : 0;
+
+    *nset = std::max(numColumns - firstSet, 0);
+    real** val;
+    snew(val, *nset);
+    for (int set = 0; set < *nset; set++)
+    {
+        snew(val[set], numRows);
+    }
+    snew(*t, numRows);
+    int n = 0;
+    for (int row = 0; row < numRows; row++)
+    {
+        if (bHaveT)
+        {
+            const double time = data.columns[0][row];
+            if ((bTB && time < tb) || (bTE && time > te))
+            {
+                continue;
+            }
+            (*t)[n] = time;
+        }
+        else
+        {
+            (*t)[n] = n;
+        }
+        for (int set = 0; set < *nset; set++)
+        {
+            val[set][n] = data.columns[firstSet + set][row];
+        }
+        n++;
+    }
+    *nval = n;
+    if (n > 1)
+    {
+        *dt = static_cast<real>((*t)[n - 1] - (*t)[0]) / (n - 1.0);
+    }
+    else
+    {
+        *dt = 1;
+    }
+
+    return val;
+}
+
 real** read_xvg_time(const char* fn,
                      gmx_bool    bHaveT,
                      gmx_bool    bTB,
@@ -863,6 +997,15 @@ real** read_xvg_time(const char* fn,
     gmx_bool bEndOfSet, bTimeInRange, bFirstLine = TRUE;
     real**   val;
 
+    if (gmx::isXvgBinaryFile(fn))
+    {
+        if (nsets_in != 1)
+        {
+            gmx_fatal(FARGS, "Binary data file %s can only be read as a single data set", fn);
+        }
+        return read_xvg_time_binary(fn, bHaveT, bTB, tb, bTE, te, nset, nval, dt, t);
+    }
+
     t_nalloc   = 0;
     *t         = nullptr;
     val        = nullptr;
@@ -42,12 +42,14 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
 #include "gromacs/correlationfunctions/autocorr.h"
 #include "gromacs/fileio/enxio.h"
 #include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -442,16 +444,221 @@ static void set_ee_av(ener_ee_t* eee)
     eee->nst = 0;
 }
 
+/*! \brief Sums for the average, RMSD, drift and error estimate of an energy term
+ *
+ * These are accumulated frame by frame, so they can be computed both from
+ * stored energies and while reading an energy file.
+ */
+typedef struct
+{
+    double     sum;
+    double     sum2;
+    int64_t    np;
+    double     sx;
+    double     sy;
+    double     sxx;
+    double     sxy;
+    ener_ee_t* eee;
+} ener_stat_t;
+
+static void init_ener_stat(ener_stat_t* st, int nbmin, int nbmax)
+{
+    st->sum  = 0;
+    st->sum2 = 0;
+    st->np   = 0;
+    st->sx   = 0;
+    st->sy   = 0;
+    st->sxx  = 0;
+    st->sxy  = 0;
+    snew(st->eee, nbmax + 1);
+    for (int nb = nbmin; nb <= nbmax; nb++)
+    {
+        st->eee[nb].b = 0;
+        clear_ee_sum(&st->eee[nb].sum);
+        st->eee[nb].nst     = 0;
+        st->eee[nb].nst_min = 0;
+    }
+}
+
+static void done_ener_stat(ener_stat_t* st)
+{
+    sfree(st->eee);
+}
+
+/*! \brief Adds the data of one frame to the sums in \p st
+ *
+ * \param[in,out] st        The sums
+ * \param[in]     nbmin     Minimum number of blocks for the error estimate
+ * \param[in]     nbmax     Maximum number of blocks for the error estimate
+ * \param[in]     firstStep The step of the first frame
+ * \param[in]     nsteps    The number of steps from the first to the last frame
+ * \param[in]     bFirst    Whether this is the first frame
+ * \param[in]     step      The step of this frame
+ * \param[in]     prevStep  The step of the previous frame, unused for the first frame
+ * \param[in]     steps     The number of steps since the previous frame
+ * \param[in]     bExact    Whether to use the exact sums in \p es instead of \p ener
+ * \param[in]     points    The number of points in the exact sums
+ * \param[in]     es        The exact sums of this frame
+ * \param[in]     ener      The energy of this frame
+ */
+static void add_ener_stat(ener_stat_t*      st,
+                          int               nbmin,
+                          int               nbmax,
+                          int64_t           firstStep,
+                          int64_t           nsteps,
+                          gmx_bool          bFirst,
+                          int64_t           step,
+                          int64_t           prevStep,
+                          int64_t           steps,
+                          gmx_bool          bExact,
+                          int64_t           points,
+                          const exactsum_t& es,
+                          real              ener)
+{
+    int64_t p, bound_nb;
+    double  sump, x;
+
+    if (bExact)
+    {
+        /* Add the sum and the sum of variances to the totals. */
+        p    = points;
+        sump = es.sum;
+        st->sum2 += es.sum2;
+        if (st->np > 0)
+        {
+            st->sum2 += gmx::square(st->sum / st->np - (st->sum + es.sum) / (st->np + p)) * st->np
+                        * (st->np + p) / p;
+        }
+    }
+    else
+    {
+        /* Add a single value to the sum and sum of squares. */
+        p    = 1;
+        sump = ener;
+        st->sum2 += gmx::square(sump);
+    }
+
+    /* sum has to be increased after sum2 */
+    st->np += p;
+    st->sum += sump;
+
+    /* For the linear regression use variance 1/p.
+     * Note that sump is the sum, not the average, so we don't need p*.
+     */
+    x = step - 0.5 * (steps - 1);
+    st->sx += p * x;
+    st->sy += sump;
+    st->sxx += p * x * x;
+    st->sxy += x * sump;
+
+    for (int nb = nbmin; nb <= nbmax; nb++)
+    {
+        ener_ee_t* eee = &st->eee[nb];
+
+        /* Check if the current end step is closer to the desired
+         * block boundary than the next end step.
+         */
+        bound_nb = (firstStep - 1) * nb + nsteps * (eee->b + 1);
+        if (eee->nst > 0 && bound_nb - prevStep * nb < step * nb - bound_nb)
+        {
+            set_ee_av(eee);
+        }
+        if (bFirst)
+        {
+            eee->nst = 1;
+        }
+        else
+        {
+            eee->nst += step - prevStep;
+        }
+        if (bExact)
+        {
+            add_ee_sum(&eee->sum, es.sum, points);
+        }
+        else
+        {
+            add_ee_sum(&eee->sum, ener, 1);
+        }
+        bound_nb = (firstStep - 1) * nb + nsteps * (eee->b + 1);
+        if (step * nb >= bound_nb)
+        {
+            set_ee_av(eee);
+        }
+    }
+}
+
+/*! \brief Computes the average, RMSD, slope and error estimate in \p ed from the sums in \p st
+ *
+ * \p ed->bExactStat should be set to whether the sums were exact.
+ */
+static void finish_ener_stat(const ener_stat_t* st,
+                             int                nbmin,
+                             int                nbmax,
+                             int64_t            nsteps,
+                             int                nframes,
+                             enerdat_t*         ed)
+{
+    int    nee;
+    double see2;
+
+    ed->av = st->sum / st->np;
+    if (ed->bExactStat)
+    {
+        ed->rmsd = std::sqrt(st->sum2 / st->np);
+    }
+    else
+    {
+        ed->rmsd = std::sqrt(st->sum2 / st->np - gmx::square(ed->av));
+    }
+
+    if (nframes > 1)
+    {
+        ed->slope = (st->np * st->sxy - st->sx * st->sy) / (st->np * st->sxx - st->sx * st->sx);
+    }
+    else
+    {
+        ed->slope = 0;
+    }
+
+    nee  = 0;
+    see2 = 0;
+    for (int nb = nbmin; nb <= nbmax; nb++)
+    {
+        /* Check if we actually got nb blocks and if the smallest
+         * block is not shorter than 80% of the average.
+         */
+        if (debug)
+        {
+            char buf1[STEPSTRSIZE], buf2[STEPSTRSIZE];
+            fprintf(debug,
+                    "Requested %d blocks, we have %d blocks, min %s nsteps %s\n",
+                    nb,
+                    st->eee[nb].b,
+                    gmx_step_str(st->eee[nb].nst_min, buf1),
+                    gmx_step_str(nsteps, buf2));
+        }
+        if (st->eee[nb].b == nb && 5 * nb * st->eee[nb].nst_min >= 4 * nsteps)
+        {
+            see2 += calc_ee2(nb, &st->eee[nb].sum);
+            nee++;
+        }
+    }
+    if (nee > 0)
+    {
+        ed->ee = std::sqrt(see2 / nee);
+    }
+    else
+    {
+        ed->ee = -1;
+    }
+}
+
 static void calc_averages(int nset, enerdata_t* edat, int nbmin, int nbmax)
 {
-    int         nb, i, f, nee;
-    double      sum, sum2, sump, see2;
-    int64_t     np, p, bound_nb;
+    int         i, f;
     enerdat_t*  ed;
-    exactsum_t* es;
     gmx_bool    bAllZero;
-    double      x, sx, sy, sxx, sxy;
-    ener_ee_t*  eee;
+    ener_stat_t st;
 
     /* Check if we have exact statistics over all points */
     for (i = 0; i < nset; i++)
@@ -479,147 +686,125 @@ static void calc_averages(int nset, enerdata_t* edat, int nbmin, int nbmax)
         }
     }
 
-    snew(eee, nbmax + 1);
     for (i = 0; i < nset; i++)
     {
         ed = &edat->s[i];
 
-        sum  = 0;
-        sum2 = 0;
-        np   = 0;
-        sx   = 0;
-        sy   = 0;
-        sxx  = 0;
-        sxy  = 0;
-        for (nb = nbmin; nb <= nbmax; nb++)
-        {
-            eee[nb].b = 0;
-            clear_ee_sum(&eee[nb].sum);
-            eee[nb].nst     = 0;
-            eee[nb].nst_min = 0;
-        }
+        init_ener_stat(&st, nbmin, nbmax);
         for (f = 0; f < edat->nframes; f++)
         {
-            es = &ed->es[f];
+            add_ener_stat(&st,
+                          nbmin,
+                          nbmax,
+                          edat->step[0],
+                          edat->nsteps,
+                          f == 0,
+                          edat->step[f],
+                          f > 0 ? edat->step[f - 1] : 0,
+                          edat->steps[f],
+                          ed->bExactStat,
+                          edat->points[f],
+                          ed->es[f],
+                          ed->ener[f]);
+        }
+        finish_ener_stat(&st, nbmin, nbmax, edat->nsteps, edat->nframes, ed);
+        done_ener_stat(&st);
+    }
+}
 
-            if (ed->bExactStat)
-            {
-                /* Add the sum and the sum of variances to the totals. */
-                p    = edat->points[f];
-                sump = es->sum;
-                sum2 += es->sum2;
-                if (np > 0)
-                {
-                    sum2 += gmx::square(sum / np - (sum + es->sum) / (np + p)) * np * (np + p) / p;
-                }
-            }
-            else
-            {
-                /* Add a single value to the sum and sum of squares. */
-                p    = 1;
-                sump = ed->ener[f];
-                sum2 += gmx::square(sump);
-            }
+/*! \brief Statistics of an energy term accumulated while reading the energy file
+ *
+ * Whether the exact sums can be used is only known after the last frame,
+ * so the sums are accumulated both ways.
+ */
+typedef struct
+{
+    ener_stat_t exact;        /* Sums over the exact averages in the file */
+    ener_stat_t single;       /* Sums over the single energy values */
+    gmx_bool    bNonZeroSum;  /* Whether any exact sum was non-zero */
+    gmx_bool    bNonZeroEner; /* Whether any energy value was non-zero */
+} ener_stream_t;
 
-            /* sum has to be increased after sum2 */
-            np += p;
-            sum += sump;
+static void init_ener_stream(ener_stream_t* es, int nbmin, int nbmax)
+{
+    init_ener_stat(&es->exact, nbmin, nbmax);
+    init_ener_stat(&es->single, nbmin, nbmax);
+    es->bNonZeroSum  = FALSE;
+    es->bNonZeroEner = FALSE;
+}
 
-            /* For the linear regression use variance 1/p.
-             * Note that sump is the sum, not the average, so we don't need p*.
-             */
-            x = edat->step[f] - 0.5 * (edat->steps[f] - 1);
-            sx += p * x;
-            sy += sump;
-            sxx += p * x * x;
-            sxy += x * sump;
+static void done_ener_stream(ener_stream_t* es)
+{
+    done_ener_stat(&es->exact);
+    done_ener_stat(&es->single);
+}
 
-            for (nb = nbmin; nb <= nbmax; nb++)
-            {
-                /* Check if the current end step is closer to the desired
-                 * block boundary than the next end step.
-                 */
-                bound_nb = (edat->step[0] - 1) * nb + edat->nsteps * (eee[nb].b + 1);
-                if (eee[nb].nst > 0 && bound_nb - edat->step[f - 1] * nb < edat->step[f] * nb - bound_nb)
-                {
-                    set_ee_av(&eee[nb]);
-                }
-                if (f == 0)
-                {
-                    eee[nb].nst = 1;
-                }
-                else
-                {
-                    eee[nb].nst += edat->step[f] - edat->step[f - 1];
-                }
-                if (ed->bExactStat)
-                {
-                    add_ee_sum(&eee[nb].sum, es->sum, edat->points[f]);
-                }
-                else
-                {
-                    add_ee_sum(&eee[nb].sum, edat->s[i].ener[f], 1);
-                }
-                bound_nb = (edat->step[0] - 1) * nb + edat->nsteps * (eee[nb].b + 1);
-                if (edat->step[f] * nb >= bound_nb)
-                {
-                    set_ee_av(&eee[nb]);
-                }
-            }
-        }
+/*! \brief Adds the frame that was stored in the first element of \p edat for set \p i
+ *
+ * \p edat->bHaveSums should be up to date for this frame.
+ */
+static void add_ener_stream(ener_stream_t*    es,
+                            const enerdata_t* edat,
+                            int               i,
+                            int               nbmin,
+                            int               nbmax,
+                            int64_t           firstStep,
+                            int64_t           nsteps,
+                            gmx_bool          bFirst,
+                            int64_t           step,
+                            int64_t           prevStep)
+{
+    const enerdat_t* ed = &edat->s[i];
 
-        edat->s[i].av = sum / np;
-        if (ed->bExactStat)
-        {
-            edat->s[i].rmsd = std::sqrt(sum2 / np);
-        }
-        else
-        {
-            edat->s[i].rmsd = std::sqrt(sum2 / np - gmx::square(edat->s[i].av));
-        }
+    es->bNonZeroSum  = es->bNonZeroSum || ed->es[0].sum != 0;
+    es->bNonZeroEner = es->bNonZeroEner || ed->ener[0] != 0;
+    /* Without sums in all frames, the exact sums are not used */
+    if (edat->bHaveSums)
+    {
+        add_ener_stat(&es->exact,
+                      nbmin,
+                      nbmax,
+                      firstStep,
+                      nsteps,
+                      bFirst,
+                      step,
+                      prevStep,
+                      edat->steps[0],
+                      TRUE,
+                      edat->points[0],
+                      ed->es[0],
+                      ed->ener[0]);
+    }
+    add_ener_stat(&es->single,
+                  nbmin,
+                  nbmax,
+                  firstStep,
+                  nsteps,
+                  bFirst,
+                  step,
+                  prevStep,
+                  edat->steps[0],
+                  FALSE,
+                  edat->points[0],
+                  ed->es[0],
+                  ed->ener[0]);
+}
 
-        if (edat->nframes > 1)
-        {
-            edat->s[i].slope = (np * sxy - sx * sy) / (np * sxx - sx * sx);
-        }
-        else
-        {
-            edat->s[i].slope = 0;
-        }
+/*! \brief Sets the averages in \p edat for set \p i from the statistics in \p es */
+static void finish_ener_stream(const ener_stream_t* es,
+                               int                  i,
+                               int                  nbmin,
+                               int                  nbmax,
+                               enerdata_t*          edat)
+{
+    enerdat_t* ed = &edat->s[i];
 
-        nee  = 0;
-        see2 = 0;
-        for (nb = nbmin; nb <= nbmax; nb++)
-        {
-            /* Check if we actually got nb blocks and if the smallest
-             * block is not shorter than 80% of the average.
-             */
-            if (debug)
-            {
-                char buf1[STEPSTRSIZE], buf2[STEPSTRSIZE];
-                fprintf(debug,
-                        "Requested %d blocks, we have %d blocks, min %s nsteps %s\n",
-                        nb,
-                        eee[nb].b,
-                        gmx_step_str(eee[nb].nst_min, buf1),
-                        gmx_step_str(edat->nsteps, buf2));
-            }
-            if (eee[nb].b == nb && 5 * nb * eee[nb].nst_min >= 4 * edat->nsteps)
-            {
-                see2 += calc_ee2(nb, &eee[nb].sum);
-                nee++;
-            }
-        }
-        if (nee > 0)
-        {
-            edat->s[i].ee = std::sqrt(see2 / nee);
-        }
-        else
-        {
-            edat->s[i].ee = -1;
-        }
-    }
-    sfree(eee);
+    /* All energy file sum entries 0 signals no exact sums.
+     * But if all energy values are 0, we still have exact sums.
+     */
+    ed->bExactStat = edat->bHaveSums && (es->bNonZeroSum || !es->bNonZeroEner);
+    finish_ener_stat(
+            ed->bExactStat ? &es->exact : &es->single, nbmin, nbmax, edat->nsteps, edat->nframes, ed);
 }
 
 static enerdata_t* calc_sum(int nset, enerdata_t* edat, int nbmin, int nbmax)
@@ -886,6 +1071,7 @@ static void analyse_ener(gmx_bool                bCorr,
                          double                  t,
                          real                    reftemp,
                          enerdata_t*             edat,
+                         gmx_bool                bHaveAverages,
                          int                     nset,
                          const int               set[],
                          const gmx_bool*         bIsEner,
@@ -926,7 +1112,10 @@ static void analyse_ener(gmx_bool                bCorr,
                 t,
                 nset);
 
-        calc_averages(nset, edat, nbmin, nbmax);
+        if (!bHaveAverages)
+        {
+            calc_averages(nset, edat, nbmin, nbmax);
+        }
 
         if (bSum)
         {
@@ -1812,6 +2001,9 @@ int gmx_energy(int argc, char* argv[])
     char              buf[256];
     gmx_output_env_t* oenv;
     int               dh_blocks = 0, dh_hists = 0, dh_samples = 0, dh_lambdas = 0;
+    gmx_bool          bStreamStatistics;
+    ener_stream_t*    stream     = nullptr;
+    int64_t           nstepsLast = 0, prevStep = 0;
 
     t_filenm fnm[] = {
         { efEDR, "-f", nullptr, ffREAD },        { efEDR, "-f2", nullptr, ffOPTRD },
@@ -1949,6 +2141,59 @@ int gmx_energy(int argc, char* argv[])
         get_dhdl_parms(ftp2fn(efTPR, NFILE, fnm), ir);
     }
 
+    if (!bDHDL)
+    {
+        /* Only decode the selected terms, we do not need the blocks */
+        enx_set_read_selection(fp, nset, set, FALSE);
+    }
+
+    /* When only the averages are needed, the statistics are computed while
+     * reading, so the energies of the frames are not stored. This requires
+     * the number of steps up to the last frame, which we get from an index.
+     * The index is also used to skip frames before the start time.
+     * With -fluc the stored energies are shifted by their averages after
+     * the analysis, so the frames need to be stored.
+     */
+    bStreamStatistics = (!bDHDL && !opt2bSet("-corr", NFILE, fnm) && !bFee && !bSum && !bVisco
+                         && !bFluct && !bFluctProps && !opt2bSet("-f2", NFILE, fnm));
+    if (bStreamStatistics || bTimeSet(TimeControl::Begin))
+    {
+        std::vector<t_enxindexentry> index = enx_make_index(fp);
+
+        bool    bFoundFirst    = false;
+        bool    bFoundEnergies = false;
+        int64_t firstStep      = 0;
+        for (const t_enxindexentry& entry : index)
+        {
+            timecheck = check_times(entry.t);
+            if (timecheck < 0)
+            {
+                continue;
+            }
+            if (timecheck > 0)
+            {
+                break;
+            }
+            if (!bFoundFirst)
+            {
+                bFoundFirst = true;
+                enx_seek_frame(fp, entry.offset);
+            }
+            if (entry.nre > 0)
+            {
+                if (!bFoundEnergies)
+                {
+                    bFoundEnergies = true;
+                    firstStep      = entry.step;
+                }
+                nstepsLast = entry.step - firstStep + 1;
+            }
+        }
+        timecheck = 0;
+        /* Files from old versions can not be indexed */
+        bStreamStatistics = bStreamStatistics && !index.empty();
+    }
+
     /* Initiate energies and set them to zero */
     edat.nsteps    = 0;
     edat.npoints   = 0;
@@ -1987,7 +2232,28 @@ int gmx_energy(int argc, char* argv[])
                 /* The frame contains energies, so update cur */
                 cur = NEXT;
 
-                if (edat.nframes % 1000 == 0)
+                if (bStreamStatistics)
+                {
+                    /* Only the current frame is stored, in the first element */
+                    if (edat.nframes == 0)
+                    {
+                        snew(edat.step, 1);
+                        snew(edat.steps, 1);
+                        snew(edat.points, 1);
+                        for (i = 0; i < nset; i++)
+                        {
+                            snew(edat.s[i].ener, 1);
+                            snew(edat.s[i].es, 1);
+                        }
+                    }
+                    edat.points[0] = 0;
+                    for (i = 0; i < nset; i++)
+                    {
+                        edat.s[i].es[0].sum  = 0;
+                        edat.s[i].es[0].sum2 = 0;
+                    }
+                }
+                else if (edat.nframes % 1000 == 0)
                 {
                     srenew(edat.step, edat.nframes + 1000);
                     std::memset(&(edat.step[edat.nframes]), 0, 1000 * sizeof(edat.step[0]));
@@ -2005,7 +2271,7 @@ int gmx_energy(int argc, char* argv[])
                     }
                 }
 
-                nfr            = edat.nframes;
+                nfr            = bStreamStatistics ? 0 : edat.nframes;
                 edat.step[nfr] = fr->step;
 
                 if (!bFoundStart)
@@ -2071,17 +2337,45 @@ int gmx_energy(int argc, char* argv[])
                 {
                     edat.s[i].ener[nfr] = fr->ener[set[i]].e;
                 }
+                if (bStreamStatistics)
+                {
+                    if (edat.nframes == 0)
+                    {
+                        snew(stream, nset);
+                        for (i = 0; i < nset; i++)
+                        {
+                            init_ener_stream(&stream[i], nbmin, nbmax);
+                        }
+                    }
+                    for (i = 0; i < nset; i++)
+                    {
+                        add_ener_stream(&stream[i],
+                                        &edat,
+                                        i,
+                                        nbmin,
+                                        nbmax,
+                                        start_step,
+                                        nstepsLast,
+                                        edat.nframes == 0,
+                                        fr->step,
+                                        prevStep);
+                    }
+                    prevStep = fr->step;
+                }
             }
             /*
              * Store energies for analysis afterwards...
              */
             if (!bDHDL && (fr->nre > 0))
             {
-                if (edat.nframes % 1000 == 0)
+                if (!bStreamStatistics)
                 {
-                    srenew(time, edat.nframes + 1000);
+                    if (edat.nframes % 1000 == 0)
+                    {
+                        srenew(time, edat.nframes + 1000);
+                    }
+                    time[edat.nframes] = fr->t;
                 }
-                time[edat.nframes] = fr->t;
                 edat.nframes++;
             }
             if (bDHDL)
@@ -2173,6 +2467,15 @@ int gmx_energy(int argc, char* argv[])
     }
     else
     {
+        if (bStreamStatistics)
+        {
+            for (i = 0; i < nset && edat.nframes > 0; i++)
+            {
+                finish_ener_stream(&stream[i], i, nbmin, nbmax, &edat);
+                done_ener_stream(&stream[i]);
+            }
+            sfree(stream);
+        }
         double dt = (frame[cur].t - start_t) / (edat.nframes - 1);
         analyse_ener(opt2bSet("-corr", NFILE, fnm),
                      opt2fn("-corr", NFILE, fnm),
@@ -2190,6 +2493,7 @@ int gmx_energy(int argc, char* argv[])
                      frame[cur].t,
                      reftemp,
                      &edat,
+                     bStreamStatistics,
                      nset,
                      set,
                      bIsEner,
@@ -40,12 +40,19 @@
 #include "config.h"
 
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 
+#include <vector>
+
 #include "gromacs/math/vec.h"
 #include "gromacs/random/threefry.h"
 #include "gromacs/random/uniformintdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/topology/topology.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/exceptions.h"
@@ -189,6 +196,96 @@ gmx_sans_t* gmx_sans_init(const t_topology* top, gmx_neutron_atomic_structurefac
     return gsans;
 }
 
+namespace
+{
+
+/*! \brief Coordinates and scattering lengths of the analysed atoms in SIMD-friendly layout
+ *
+ * The coordinate arrays are aligned and padded to the SIMD width so that
+ * the pair loop can use aligned loads on any block of atoms.
+ */
+struct PackedScatterers
+{
+    //! Number of atoms
+    int numAtoms = 0;
+    //! x coordinates
+    std::vector<real, gmx::AlignedAllocator<real>> x;
+    //! y coordinates
+    std::vector<real, gmx::AlignedAllocator<real>> y;
+    //! z coordinates
+    std::vector<real, gmx::AlignedAllocator<real>> z;
+    //! Scattering lengths
+    std::vector<double> slength;
+};
+
+//! Copies the coordinates and scattering lengths of the atoms in \p index into \p packed
+void packScatterers(const rvec* x, const double* slength, const int* index, int isize, PackedScatterers* packed)
+{
+#if GMX_SIMD_HAVE_REAL
+    const int paddedSize = ((isize + GMX_SIMD_REAL_WIDTH - 1) / GMX_SIMD_REAL_WIDTH) * GMX_SIMD_REAL_WIDTH;
+#else
+    const int paddedSize = isize;
+#endif
+    packed->numAtoms = isize;
+    packed->x.assign(paddedSize, 0);
+    packed->y.assign(paddedSize, 0);
+    packed->z.assign(paddedSize, 0);
+    packed->slength.resize(isize);
+    for (int i = 0; i < isize; i++)
+    {
+        packed->x[i]       = x[index[i]][XX];
+        packed->y[i]       = x[index[i]][YY];
+        packed->z[i]       = x[index[i]][ZZ];
+        packed->slength[i] = slength[index[i]];
+    }
+}
+
+/*! \brief Adds the weighted distances between atom \p i and all atoms j < i to \p gr
+ *
+ * The distances and bin indices are computed with SIMD over j,
+ * only the histogram update itself is scalar.
+ */
+void accumulatePairsOfAtom(const PackedScatterers& packed, int i, real invBinwidth, double* gr)
+{
+    const double si = packed.slength[i];
+    int          j  = 0;
+#if GMX_SIMD_HAVE_REAL
+    using namespace gmx;
+
+    const SimdReal xi(packed.x[i]);
+    const SimdReal yi(packed.y[i]);
+    const SimdReal zi(packed.z[i]);
+    const SimdReal invBinwidthS(invBinwidth);
+
+    alignas(GMX_SIMD_ALIGNMENT) std::int32_t bin[GMX_SIMD_REAL_WIDTH];
+
+    for (; j + GMX_SIMD_REAL_WIDTH <= i; j += GMX_SIMD_REAL_WIDTH)
+    {
+        SimdReal dx = xi - load<SimdReal>(packed.x.data() + j);
+        SimdReal dy = yi - load<SimdReal>(packed.y.data() + j);
+        SimdReal dz = zi - load<SimdReal>(packed.z.data() + j);
+        SimdReal r2 = norm2(dx, dy, dz);
+
+        store(bin, cvttR2I(sqrt(r2) * invBinwidthS));
+
+        for (int k = 0; k < GMX_SIMD_REAL_WIDTH; k++)
+        {
+            gr[bin[k]] += si * packed.slength[j + k];
+        }
+    }
+#endif
+    for (; j < i; j++)
+    {
+        const real dx = packed.x[i] - packed.x[j];
+        const real dy = packed.y[i] - packed.y[j];
+        const real dz = packed.z[i] - packed.z[j];
+
+        gr[static_cast<int>(std::sqrt(dx * dx + dy * dy + dz * dz) * invBinwidth)] += si * packed.slength[j];
+    }
+}
+
+} // namespace
+
 gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans_t*  gsans,
                                                                         rvec*        x,
                                                                         matrix       box,
@@ -303,6 +400,10 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
     }
     else
     {
+        /* Store the coordinates contiguously, so the pair loop can use SIMD */
+        PackedScatterers packed;
+        packScatterers(x, gsans->slength, index, isize, &packed);
+        const real invBinwidth = 1.0 / binwidth;
 #if GMX_OPENMP
         nthreads = gmx_omp_get_max_threads();
         /* Allocating memory for tgr arrays */
@@ -311,20 +412,16 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
         {
             snew(tgr[i], pr->grn);
         }
-#    pragma omp parallel shared(tgr) private(tid, i, j)
+#    pragma omp parallel shared(tgr, packed) private(tid, i)
         {
             tid = gmx_omp_get_thread_num();
-/* starting parallel threads */
-#    pragma omp for
+/* starting parallel threads, the work per i grows linearly with i */
+#    pragma omp for schedule(dynamic, 64)
             for (i = 0; i < isize; i++)
             {
                 try
                 {
-                    for (j = 0; j < i; j++)
-                    {
-                        tgr[tid][static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                                gsans->slength[index[i]] * gsans->slength[index[j]];
-                    }
+                    accumulatePairsOfAtom(packed, i, invBinwidth, tgr[tid]);
                 }
                 GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
             }
@@ -346,11 +443,7 @@ gmx_radial_distribution_histogram_t* calc_radial_distribution_histogram(gmx_sans
 #else
         for (i = 0; i < isize; i++)
         {
-            for (j = 0; j < i; j++)
-            {
-                pr->gr[static_cast<int>(std::floor(std::sqrt(distance2(x[index[i]], x[index[j]])) / binwidth))] +=
-                        gsans->slength[index[i]] * gsans->slength[index[j]];
-            }
+            accumulatePairsOfAtom(packed, i, invBinwidth, pr->gr);
         }
 #endif
     }
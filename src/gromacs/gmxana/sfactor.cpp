@@ -57,8 +57,10 @@
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/strdb.h"
 
@@ -192,15 +194,11 @@ extern void compute_structure_factor(structure_factor_t* sft,
 
     tmpSF = rc_tensor_allocation(maxkx, maxky, maxkz);
     /*
-     * The big loop...
-     * compute real and imaginary part of the structure factor for every
-     * (kx,ky,kz))
+     * count the number of k vectors contributing to each |k| bin,
+     * will be used for the computation of the average
      */
-    fprintf(stderr, "\n");
     for (i = 0; i < maxkx; i++)
     {
-        fprintf(stderr, "\rdone %3.1f%%     ", (100.0 * (i + 1)) / maxkx);
-        fflush(stderr);
         kx = i * k_factor[XX];
         for (j = 0; j < maxky; j++)
         {
@@ -216,22 +214,70 @@ extern void compute_structure_factor(structure_factor_t* sft,
                         kr = gmx::roundToInt(krr / sf->ref_k);
                         if (kr < sf->n_angles)
                         {
-                            counter[kr]++; /* will be used for the copmutation
-                                              of the average*/
-                            for (p = 0; p < isize; p++)
+                            counter[kr]++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    /*
+     * The big loop...
+     * compute real and imaginary part of the structure factor for every
+     * (kx,ky,kz)), every kx plane is handled by a single thread
+     */
+    fprintf(stderr, "\n");
+    int numPlanesDone = 0;
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(dynamic) private( \
+        kx, ky, kz, krr, kr, j, k, p, asf, kdotx)
+    for (i = 0; i < maxkx; i++)
+    {
+        try
+        {
+            kx = i * k_factor[XX];
+            for (j = 0; j < maxky; j++)
+            {
+                ky = j * k_factor[YY];
+                for (k = 0; k < maxkz; k++)
+                {
+                    if (i != 0 || j != 0 || k != 0)
+                    {
+                        kz  = k * k_factor[ZZ];
+                        krr = std::sqrt(gmx::square(kx) + gmx::square(ky) + gmx::square(kz));
+                        if (krr >= start_q && krr <= end_q)
+                        {
+                            kr = gmx::roundToInt(krr / sf->ref_k);
+                            if (kr < sf->n_angles)
                             {
-                                asf = sf_table[redt[p].t][kr];
-
-                                kdotx = kx * redt[p].x[XX] + ky * redt[p].x[YY] + kz * redt[p].x[ZZ];
-
-                                tmpSF[i][j][k].re += std::cos(kdotx) * asf;
-                                tmpSF[i][j][k].im += std::sin(kdotx) * asf;
+                                real sfRe = 0;
+                                real sfIm = 0;
+                                for (p = 0; p < isize; p++)
+                                {
+                                    asf = sf_table[redt[p].t][kr];
+
+                                    kdotx = kx * redt[p].x[XX] + ky * redt[p].x[YY]
+                                            + kz * redt[p].x[ZZ];
+
+                                    sfRe += std::cos(kdotx) * asf;
+                                    sfIm += std::sin(kdotx) * asf;
+                                }
+                                tmpSF[i][j][k].re = sfRe;
+                                tmpSF[i][j][k].im = sfIm;
                             }
                         }
                     }
                 }
             }
+            int numDone;
+#pragma omp atomic capture
+            numDone = ++numPlanesDone;
+            if (gmx_omp_get_thread_num() == 0)
+            {
+                fprintf(stderr, "\rdone %3.1f%%     ", (100.0 * numDone) / maxkx);
+                fflush(stderr);
+            }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     } /* end loop on i */
       /*
        *  compute the square modulus of the structure factor, averaging on the surface
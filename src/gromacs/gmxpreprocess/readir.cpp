@@ -268,6 +268,12 @@ void check_ir(const char*                    mdparin,
         warning_error(wi, message);
     }
 
+    /* OUTPUT */
+    if (ir->x_compression_precision_other < 0)
+    {
+        warning_error(wi, "compressed-x-precision-other should be >= 0");
+    }
+
     /* BASIC CUT-OFF STUFF */
     if (ir->rcoulomb < 0)
     {
@@ -2090,6 +2096,9 @@ void get_ir(const char*     mdparin,
     printStringNoNewline(&inp, "trajectory file. You can select multiple groups. By");
     printStringNoNewline(&inp, "default, all atoms will be written.");
     setStringEntry(&inp, "compressed-x-grps", inputrecStrings->x_compressed_groups, nullptr);
+    printStringNoNewline(&inp, "Precision for the atoms not in compressed-x-grps, 0 means");
+    printStringNoNewline(&inp, "these atoms are not written to the compressed trajectory file");
+    ir->x_compression_precision_other = get_ereal(&inp, "compressed-x-precision-other", 0.0, wi);
     printStringNoNewline(&inp, "Selection of energy groups");
     setStringEntry(&inp, "energygrps", inputrecStrings->energy, nullptr);
 
@@ -292,6 +292,12 @@ TEST_F(GetIrTest, AcceptsMimic)
     runTest(joinStrings(inputMdpFile, "\n"));
 }
 
+TEST_F(GetIrTest, RejectsNegativeCompressedXPrecisionOther)
+{
+    const char* inputMdpFile = "compressed-x-precision-other = -10";
+    runTest(inputMdpFile, TestBehavior::ErrorAndDoNotCompareOutput);
+}
+
 #if HAVE_MUPARSER
 
 TEST_F(GetIrTest, AcceptsTransformationCoord)
@@ -48,12 +48,17 @@
 
 #include <algorithm>
 #include <array>
+#include <numeric>
 
 #include "gromacs/math/functions.h"
 #include "gromacs/math/multidimarray.h"
 #include "gromacs/math/units.h"
 #include "gromacs/math/utilities.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
 
 namespace gmx
 {
@@ -243,6 +248,32 @@ IVec rangeEndWithinLattice(const IVec& index, const dynamicExtents3D& extents, c
     return elementWiseMin(extentAsIvec, index + range);
 }
 
+/*! \brief Adds \p prefactor times \p values to \p lattice
+ *
+ * \param[in,out] lattice    Contiguous lattice values
+ * \param[in]     values     The values to add, same size as lattice
+ * \param[in]     prefactor  The factor to scale the values with
+ * \param[in]     numValues  The number of values
+ */
+void addScaledRow(float* gmx_restrict       lattice,
+                  const float* gmx_restrict values,
+                  float                     prefactor,
+                  int                       numValues)
+{
+    int i = 0;
+#if GMX_SIMD_HAVE_FLOAT && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+    const SimdFloat prefactorSimd(prefactor);
+    for (; i + GMX_SIMD_FLOAT_WIDTH <= numValues; i += GMX_SIMD_FLOAT_WIDTH)
+    {
+        const SimdFloat latticeSimd = loadU<SimdFloat>(lattice + i);
+        storeU(lattice + i, latticeSimd + prefactorSimd * loadU<SimdFloat>(values + i));
+    }
+#endif
+    for (; i < numValues; i++)
+    {
+        lattice[i] += prefactor * values[i];
+    }
+}
 
 } // namespace
 
@@ -321,72 +352,163 @@ public:
     Impl& operator=(const Impl& other) = default;
     //! Add another gaussian
     void add(const GaussianSpreadKernelParameters::PositionAndAmplitude& localParamters);
+    //! \copydoc GaussTransform3D::add(ArrayRef<const RVec>, ArrayRef<const real>, int)
+    void add(ArrayRef<const RVec> coordinates, ArrayRef<const real> amplitudes, int numThreads);
     //! The width of the Gaussian in lattice spacing units
     BasicVector<double> sigma_;
     //! The spread range in lattice points
     IVec spreadRange_;
     //! The result of the Gauss transform
     MultiDimArray<std::vector<float>, dynamicExtents3D> data_;
-    //! The outer product of a Gaussian along the z and y dimension
-    OuterProductEvaluator outerProductZY_;
-    //! The three one-dimensional Gaussians, whose outer product is added to the Gauss transform
-    std::array<GaussianOn1DLattice, DIM> gauss1d_;
+
+private:
+    //! Temporary storage for spreading a single Gaussian
+    struct SpreadWorkspace
+    {
+        //! The outer product of a Gaussian along the z and y dimension
+        OuterProductEvaluator outerProductZY_;
+        //! The three one-dimensional Gaussians, whose outer product is added to the Gauss transform
+        std::array<GaussianOn1DLattice, DIM> gauss1d_;
+    };
+
+    /*! \brief Add a Gaussian, but only to the lattice planes along z in [zBegin, zEnd)
+     *
+     * The lattice values are identical to adding the Gaussian to the whole
+     * lattice, which allows threads to add Gaussians to separate parts of the lattice.
+     */
+    void add(const GaussianSpreadKernelParameters::PositionAndAmplitude& localParameters,
+             int                                                         zBegin,
+             int                                                         zEnd,
+             SpreadWorkspace*                                            workspace);
+
+    //! Spreading workspaces, one per thread
+    std::vector<SpreadWorkspace> workspaces_;
 };
 
 GaussTransform3D::Impl::Impl(const dynamicExtents3D&                      extent,
                              const GaussianSpreadKernelParameters::Shape& kernelShapeParameters) :
     sigma_{ kernelShapeParameters.sigma_ },
     spreadRange_{ kernelShapeParameters.latticeSpreadRange() },
-    data_{ extent },
-    gauss1d_({ GaussianOn1DLattice(spreadRange_[XX], sigma_[XX]),
-               GaussianOn1DLattice(spreadRange_[YY], sigma_[YY]),
-               GaussianOn1DLattice(spreadRange_[ZZ], sigma_[ZZ]) })
+    data_{ extent }
 {
+    workspaces_.push_back({ OuterProductEvaluator(),
+                            { GaussianOn1DLattice(spreadRange_[XX], sigma_[XX]),
+                              GaussianOn1DLattice(spreadRange_[YY], sigma_[YY]),
+                              GaussianOn1DLattice(spreadRange_[ZZ], sigma_[ZZ]) } });
 }
 
 void GaussTransform3D::Impl::add(const GaussianSpreadKernelParameters::PositionAndAmplitude& localParameters)
+{
+    // The lattice is stored with z as the slowest varying index
+    add(localParameters, 0, data_.asView().extent(0), &workspaces_[0]);
+}
+
+void GaussTransform3D::Impl::add(const GaussianSpreadKernelParameters::PositionAndAmplitude& localParameters,
+                                 int              zBegin,
+                                 int              zEnd,
+                                 SpreadWorkspace* workspace)
 {
     const IVec closestLatticePoint = closestIntegerPoint(localParameters.coordinate_);
     const auto spreadRange =
             spreadRangeWithinLattice(closestLatticePoint, data_.asView().extents(), spreadRange_);
+    const int zRangeBegin = std::max(spreadRange.begin()[ZZ], zBegin);
+    const int zRangeEnd   = std::min(spreadRange.end()[ZZ], zEnd);
 
-    // do nothing if the added Gaussian will never reach the lattice
-    if (spreadRange.empty())
+    // do nothing if the added Gaussian will never reach the lattice or this part of it
+    if (spreadRange.empty() || zRangeBegin >= zRangeEnd)
     {
         return;
     }
 
+    std::array<GaussianOn1DLattice, DIM>& gauss1d = workspace->gauss1d_;
     for (int dimension = XX; dimension <= ZZ; ++dimension)
     {
         // multiply with amplitude so that Gauss3D = (amplitude * Gauss_x) * Gauss_y * Gauss_z
         const float gauss1DAmplitude = dimension > XX ? 1.0 : localParameters.amplitude_;
-        gauss1d_[dimension].spread(
+        gauss1d[dimension].spread(
                 gauss1DAmplitude, localParameters.coordinate_[dimension] - closestLatticePoint[dimension]);
     }
 
-    const auto spreadZY         = outerProductZY_(gauss1d_[ZZ].view(), gauss1d_[YY].view());
-    const auto spreadX          = gauss1d_[XX].view();
+    const auto spreadZY = workspace->outerProductZY_(gauss1d[ZZ].view(), gauss1d[YY].view());
+    const auto spreadX  = gauss1d[XX].view();
     const IVec spreadGridOffset = spreadRange_ - closestLatticePoint;
+    const int  xBegin           = spreadRange.begin()[XX];
+    const int  numX             = spreadRange.end()[XX] - xBegin;
 
-    // \todo optimize these loops if performance critical
     // The looping strategy uses that the last, x-dimension is contiguous in the memory layout
-    for (int zLatticeIndex = spreadRange.begin()[ZZ]; zLatticeIndex < spreadRange.end()[ZZ]; ++zLatticeIndex)
+    for (int zLatticeIndex = zRangeBegin; zLatticeIndex < zRangeEnd; ++zLatticeIndex)
     {
         const auto zSlice = data_.asView()[zLatticeIndex];
 
         for (int yLatticeIndex = spreadRange.begin()[YY]; yLatticeIndex < spreadRange.end()[YY]; ++yLatticeIndex)
         {
-            const auto  ySlice      = zSlice[yLatticeIndex];
             const float zyPrefactor = spreadZY(zLatticeIndex + spreadGridOffset[ZZ],
                                                yLatticeIndex + spreadGridOffset[YY]);
 
-            for (int xLatticeIndex = spreadRange.begin()[XX]; xLatticeIndex < spreadRange.end()[XX];
-                 ++xLatticeIndex)
+            addScaledRow(zSlice[yLatticeIndex].data() + xBegin,
+                         spreadX.data() + xBegin + spreadGridOffset[XX],
+                         zyPrefactor,
+                         numX);
+        }
+    }
+}
+
+void GaussTransform3D::Impl::add(ArrayRef<const RVec> coordinates,
+                                 ArrayRef<const real> amplitudes,
+                                 int                  numThreads)
+{
+    GMX_ASSERT(coordinates.size() == amplitudes.size(),
+               "Need as many amplitudes as coordinates to spread");
+
+    // The lattice is stored with z as the slowest varying index
+    const int numPlanes = data_.asView().extent(0);
+    if (numPlanes == 0)
+    {
+        return;
+    }
+    numThreads = std::clamp(numThreads, 1, numPlanes);
+    while (gmx::ssize(workspaces_) < numThreads)
+    {
+        workspaces_.push_back(workspaces_[0]);
+    }
+
+    /* Divide the lattice into slabs along z that contain about equal numbers of
+     * Gaussian centers. Each thread adds all Gaussians, but only to its own slab.
+     * This avoids a reduction over thread-local lattices and gives results
+     * that are identical to adding the Gaussians serially.
+     */
+    std::vector<int> numCentersBelowPlane(numPlanes + 1, 0);
+    for (const RVec& coordinate : coordinates)
+    {
+        numCentersBelowPlane[std::clamp(roundToInt(coordinate[ZZ]), 0, numPlanes - 1) + 1]++;
+    }
+    std::partial_sum(
+            numCentersBelowPlane.begin(), numCentersBelowPlane.end(), numCentersBelowPlane.begin());
+    auto slabBoundary = [&numCentersBelowPlane, numThreads, numPlanes](int thread) {
+        if (thread == numThreads)
+        {
+            return numPlanes;
+        }
+        const int numCenters =
+                (numCentersBelowPlane.back() * static_cast<int64_t>(thread)) / numThreads;
+        const auto boundary = std::lower_bound(
+                numCentersBelowPlane.begin(), numCentersBelowPlane.end(), numCenters);
+        return static_cast<int>(boundary - numCentersBelowPlane.begin());
+    };
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            const int zBegin = slabBoundary(thread);
+            const int zEnd   = slabBoundary(thread + 1);
+            for (gmx::index i = 0; i < coordinates.ssize(); i++)
             {
-                const float xPrefactor = spreadX[xLatticeIndex + spreadGridOffset[XX]];
-                ySlice[xLatticeIndex] += zyPrefactor * xPrefactor;
+                add({ coordinates[i], amplitudes[i] }, zBegin, zEnd, &workspaces_[thread]);
             }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 }
 
@@ -405,6 +527,13 @@ void GaussTransform3D::add(const GaussianSpreadKernelParameters::PositionAndAmpl
     impl_->add(localParameters);
 }
 
+void GaussTransform3D::add(ArrayRef<const RVec> coordinates,
+                           ArrayRef<const real> amplitudes,
+                           int                  numThreads)
+{
+    impl_->add(coordinates, amplitudes, numThreads);
+}
+
 void GaussTransform3D::setZero()
 {
     std::fill(begin(impl_->data_), end(impl_->data_), 0.);
@@ -193,6 +193,18 @@ public:
      */
     void add(const GaussianSpreadKernelParameters::PositionAndAmplitude& localParameters);
 
+    /*! \brief Add three dimensional Gaussians with given amplitudes at coordinates.
+     *
+     * The lattice is divided into slabs along z with about equal numbers of
+     * Gaussian centers and each OpenMP thread adds all Gaussians to its own slab.
+     * The result is identical to adding the Gaussians one by one.
+     *
+     * \param[in] coordinates  The centers of the Gaussians
+     * \param[in] amplitudes   The amplitudes of the Gaussians, same size as coordinates
+     * \param[in] numThreads   The number of OpenMP threads to use
+     */
+    void add(ArrayRef<const RVec> coordinates, ArrayRef<const real> amplitudes, int numThreads);
+
     //! \brief Set all values on the lattice to zero.
     void setZero();
 
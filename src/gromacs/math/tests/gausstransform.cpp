@@ -43,6 +43,8 @@
 
 #include "gromacs/math/gausstransform.h"
 
+#include <cmath>
+
 #include <array>
 #include <numeric>
 #include <vector>
@@ -281,6 +283,44 @@ TEST_F(GaussTransformTest, view)
     EXPECT_THAT(expectedValues, testing::Pointwise(FloatEq(tolerance_), gaussTransformVector));
 }
 
+TEST(GaussTransformThreadedTest, addingManyGaussiansIsIndependentOfNumberOfThreads)
+{
+    const extents<dynamic_extent, dynamic_extent, dynamic_extent> latticeExtent = { 23, 17, 20 };
+    const GaussianSpreadKernelParameters::Shape                   kernelShape   = {
+        DVec{ 1.5, 1.2, 1.7 }, 3.0
+    };
+
+    // Gaussians clustered along z, some partly or fully outside the lattice
+    std::vector<RVec> coordinates;
+    std::vector<real> amplitudes;
+    for (int i = 0; i < 200; i++)
+    {
+        coordinates.emplace_back(
+                -3 + 26 * std::fabs(std::sin(0.37 * i)), 8 * (1 + std::cos(1.3 * i)), 6 + 3 * std::sin(0.11 * i));
+        amplitudes.push_back(0.5 + std::fabs(std::cos(0.7 * i)));
+    }
+
+    GaussTransform3D serialTransform(latticeExtent, kernelShape);
+    for (size_t i = 0; i < coordinates.size(); i++)
+    {
+        serialTransform.add({ coordinates[i], amplitudes[i] });
+    }
+    const auto serialView = serialTransform.constView();
+
+    for (int numThreads : { 1, 2, 3, 8, 64 })
+    {
+        GaussTransform3D threadedTransform(latticeExtent, kernelShape);
+        threadedTransform.add(coordinates, amplitudes, numThreads);
+
+        const auto threadedView = threadedTransform.constView();
+        for (int i = 0; i < serialView.mapping().required_span_size(); i++)
+        {
+            EXPECT_EQ(serialView.data()[i], threadedView.data()[i])
+                    << "with " << numThreads << " threads at lattice index " << i;
+        }
+    }
+}
+
 } // namespace
 
 } // namespace test
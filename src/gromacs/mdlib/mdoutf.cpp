@@ -77,10 +77,12 @@ struct gmx_mdoutf
     t_fileio*                      fp_xtc;
     gmx_tng_trajectory_t           tng;
     gmx_tng_trajectory_t           tng_low_prec;
-    int                            x_compression_precision; /* only used by XTC output */
+    int                            x_compression_precision;       /* only used by XTC output */
+    real                           x_compression_precision_other; /* only used by XTC output */
     ener_file_t                    fp_ene;
     const char*                    fn_cpt;
     gmx_bool                       bKeepAndNumCPT;
+    bool                           compressCheckpointStateVectors;
     IntegrationAlgorithm           eIntegrator;
     gmx_bool                       bExpanded;
     LambdaWeightCalculation        elamstats;
@@ -88,7 +90,8 @@ struct gmx_mdoutf
     FILE*                          fp_dhdl;
     int                            natoms_global;
     int                            natoms_x_compressed;
-    const SimulationGroups*        groups; /* for compressed position writing */
+    unsigned char*                 x_compression_group; /* XTC precision group per atom */
+    const SimulationGroups*        groups;              /* for compressed position writing */
     gmx_wallcycle*                 wcycle;
     rvec*                          f_global;
     gmx::IMDOutputProvider*        outputProvider;
@@ -128,14 +131,17 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
     of->tng_low_prec = nullptr;
     of->fp_dhdl      = nullptr;
 
-    of->eIntegrator             = ir->eI;
-    of->bExpanded               = ir->bExpanded;
-    of->elamstats               = ir->expandedvals->elamstats;
-    of->simulation_part         = ir->simulation_part;
-    of->x_compression_precision = static_cast<int>(ir->x_compression_precision);
-    of->wcycle                  = wcycle;
-    of->f_global                = nullptr;
-    of->outputProvider          = outputProvider;
+    of->eIntegrator                   = ir->eI;
+    of->bExpanded                     = ir->bExpanded;
+    of->elamstats                     = ir->expandedvals->elamstats;
+    of->simulation_part               = ir->simulation_part;
+    of->x_compression_precision       = static_cast<int>(ir->x_compression_precision);
+    of->x_compression_precision_other = ir->x_compression_precision_other;
+    of->wcycle                        = wcycle;
+    of->f_global                      = nullptr;
+    of->outputProvider                = outputProvider;
+
+    of->compressCheckpointStateVectors = (getenv(GMX_CPT_COMPRESS_ENV) != nullptr);
 
     GMX_RELEASE_ASSERT(!simulationsShareState || ms != nullptr,
                        "Need valid multisim object when simulations share state");
@@ -234,6 +240,21 @@ gmx_mdoutf_t init_mdoutf(FILE*                          fplog,
                 of->natoms_x_compressed++;
             }
         }
+        of->x_compression_group = nullptr;
+        if (of->fp_xtc != nullptr && of->x_compression_precision_other > 0
+            && of->natoms_x_compressed < of->natoms_global)
+        {
+            /* The atoms outside the compressed groups are written to
+               the XTC file as a second group with their own precision */
+            snew(of->x_compression_group, top_global.natoms);
+            for (i = 0; (i < top_global.natoms); i++)
+            {
+                of->x_compression_group[i] =
+                        (getGroupType(*of->groups, SimulationAtomGroupType::CompressedPositionOutput, i) == 0)
+                                ? 0
+                                : 1;
+            }
+        }
 
         if (ir->nstfout && haveDDAtomOrdering(*cr))
         {
@@ -291,6 +312,7 @@ static void write_checkpoint(const char*                     fn,
                              int                             simulation_part,
                              gmx_bool                        bExpanded,
                              LambdaWeightCalculation         elamstats,
+                             bool                            compressStateVectors,
                              int64_t                         step,
                              double                          t,
                              t_state*                        state,
@@ -391,6 +413,7 @@ static void write_checkpoint(const char*                     fn,
     {
         copy_ivec(domdecCells, headerContents.dd_nc);
     }
+    headerContents.compressedStateVectors = compressStateVectors;
 
     write_checkpoint_data(fp,
                           headerContents,
@@ -524,6 +547,7 @@ void mdoutf_write_checkpoint(gmx_mdoutf_t                    of,
                      of->simulation_part,
                      of->bExpanded,
                      of->elamstats,
+                     of->compressCheckpointStateVectors,
                      step,
                      t,
                      state_global,
@@ -557,25 +581,28 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
         }
         else
         {
+            /* Start all gathers before waiting, so the other ranks can continue
+             * while the master rank receives the data.
+             */
             if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
             {
                 auto globalXRef = MASTER(cr) ? state_global->x : gmx::ArrayRef<gmx::RVec>();
-                dd_collect_vec(cr->dd,
-                               state_local->ddp_count,
-                               state_local->ddp_count_cg_gl,
-                               state_local->cg_gl,
-                               state_local->x,
-                               globalXRef);
+                dd_collect_vec_start(cr->dd,
+                                     state_local->ddp_count,
+                                     state_local->ddp_count_cg_gl,
+                                     state_local->cg_gl,
+                                     state_local->x,
+                                     globalXRef);
             }
             if (mdof_flags & MDOF_V)
             {
                 auto globalVRef = MASTER(cr) ? state_global->v : gmx::ArrayRef<gmx::RVec>();
-                dd_collect_vec(cr->dd,
-                               state_local->ddp_count,
-                               state_local->ddp_count_cg_gl,
-                               state_local->cg_gl,
-                               state_local->v,
-                               globalVRef);
+                dd_collect_vec_start(cr->dd,
+                                     state_local->ddp_count,
+                                     state_local->ddp_count_cg_gl,
+                                     state_local->cg_gl,
+                                     state_local->v,
+                                     globalVRef);
             }
         }
         f_global = of->f_global;
@@ -584,13 +611,14 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
             auto globalFRef = MASTER(cr) ? gmx::arrayRefFromArray(
                                       reinterpret_cast<gmx::RVec*>(of->f_global), of->natoms_global)
                                          : gmx::ArrayRef<gmx::RVec>();
-            dd_collect_vec(cr->dd,
-                           state_local->ddp_count,
-                           state_local->ddp_count_cg_gl,
-                           state_local->cg_gl,
-                           f_local,
-                           globalFRef);
+            dd_collect_vec_start(cr->dd,
+                                 state_local->ddp_count,
+                                 state_local->ddp_count_cg_gl,
+                                 state_local->cg_gl,
+                                 f_local,
+                                 globalFRef);
         }
+        dd_collect_vec_wait(cr->dd);
     }
     else
     {
@@ -666,13 +694,15 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
         {
             rvec* xxtc = nullptr;
 
+            /* With XTC precision groups all atoms are written, so then
+               no copy of the subset is needed */
             if (of->natoms_x_compressed == of->natoms_global)
             {
                 /* We are writing the positions of all of the atoms to
                    the compressed output */
                 xxtc = state_global->x.rvec_array();
             }
-            else
+            else if (of->x_compression_group == nullptr)
             {
                 /* We are writing the positions of only a subset of
                    the atoms to the compressed output, so we have to
@@ -689,8 +719,32 @@ void mdoutf_write_to_trajectory_files(FILE*                           fplog,
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t, state_local->box, xxtc, of->x_compression_precision)
-                == 0)
+            int xtcResult;
+            if (of->x_compression_group != nullptr)
+            {
+                const real precisions[] = { static_cast<real>(of->x_compression_precision),
+                                            of->x_compression_precision_other };
+                xtcResult               = write_xtc_group_precision(
+                        of->fp_xtc,
+                        of->natoms_global,
+                        step,
+                        t,
+                        state_local->box,
+                        state_global->x.rvec_array(),
+                        precisions,
+                        gmx::arrayRefFromArray(of->x_compression_group, of->natoms_global));
+            }
+            else
+            {
+                xtcResult = write_xtc(of->fp_xtc,
+                                      of->natoms_x_compressed,
+                                      step,
+                                      t,
+                                      state_local->box,
+                                      xxtc,
+                                      of->x_compression_precision);
+            }
+            if (xtcResult == 0)
             {
                 gmx_fatal(FARGS,
                           "XTC error. This indicates you are out of disk space, or a "
@@ -793,6 +847,7 @@ void done_mdoutf(gmx_mdoutf_t of)
     {
         sfree(of->f_global);
     }
+    sfree(of->x_compression_group);
 
     gmx_tng_close(&of->tng);
     gmx_tng_close(&of->tng_low_prec);
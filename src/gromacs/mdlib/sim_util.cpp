@@ -1747,6 +1747,14 @@ void do_force(FILE*                               fplog,
         hipRangePop();
     }
 
+    /* With non-bonded work on the CPU, the coordinate halo exchange is started
+     * here and finished after the local non-bonded work, which only needs
+     * home atom coordinates, so the communication overlaps with computation.
+     */
+    const bool overlapCpuHaloXWithLocalNonbonded =
+            (simulationWork.havePpDomainDecomposition && !stepWork.doNeighborSearch
+             && !stepWork.useGpuXHalo && !simulationWork.useGpuNonbonded && !nbv->emulateGpu());
+
     /* Communicate coordinates and sum dipole if necessary +
        do non-local pair search */
     if (simulationWork.havePpDomainDecomposition)
@@ -1808,7 +1816,14 @@ void do_force(FILE*                               fplog,
                     }
                 }
                 hipRangePush("dd_move_x");
-                dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                if (overlapCpuHaloXWithLocalNonbonded)
+                {
+                    dd_move_x_start(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
+                else
+                {
+                    dd_move_x(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+                }
                 hipRangePop();
             }
 
@@ -1828,7 +1843,7 @@ void do_force(FILE*                               fplog,
                                 AtomLocality::NonLocal, simulationWork, stepWork, gpuCoordinateHaloLaunched));
                 hipRangePop();
             }
-            else
+            else if (!overlapCpuHaloXWithLocalNonbonded)
             {
                 hipRangePush("convertCoordinates_notGpuXHalo");
                 nbv->convertCoordinates(AtomLocality::NonLocal, x.unpaddedArrayRef());
@@ -2026,6 +2041,16 @@ void do_force(FILE*                               fplog,
         hipRangePop();
     }
 
+    if (overlapCpuHaloXWithLocalNonbonded)
+    {
+        hipRangePush("dd_move_x_finish");
+        wallcycle_stop(wcycle, WallCycleCounter::Force);
+        dd_move_x_finish(cr->dd, box, x.unpaddedArrayRef(), wcycle);
+        nbv->convertCoordinates(AtomLocality::NonLocal, x.unpaddedArrayRef());
+        wallcycle_start_nocount(wcycle, WallCycleCounter::Force);
+        hipRangePop();
+    }
+
     if (fr->efep != FreeEnergyPerturbationType::No && stepWork.computeNonbondedForces)
     {
         /* Calculate the local and non-local free energy interactions here.
@@ -2178,6 +2203,23 @@ void do_force(FILE*                               fplog,
         }
     }
 
+    /* With all non-bonded and listed work on the CPU, the forces on non-local atoms
+     * are complete here. The remaining force contributions only act on home atoms,
+     * so we start the force halo exchange to overlap with their computation.
+     */
+    const bool overlapCpuHaloFWithLocalForces =
+            (simulationWork.havePpDomainDecomposition && stepWork.computeForces
+             && !useOrEmulateGpuNb && !stepWork.useGpuFHalo && !stepWork.useGpuFBufferOps
+             && !simulationWork.useMts);
+    if (overlapCpuHaloFWithLocalForces)
+    {
+        hipRangePush("dd_move_f_start");
+        wallcycle_stop(wcycle, WallCycleCounter::Force);
+        dd_move_f_start(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+        wallcycle_start_nocount(wcycle, WallCycleCounter::Force);
+        hipRangePop();
+    }
+
     if (stepWork.computeSlowForces)
     {
         hipRangePush("longRangeNonbonded->calculate_ifComputeSlowForces");
@@ -2417,7 +2459,14 @@ void do_force(FILE*                               fplog,
                 if (!simulationWork.useMts || !stepWork.combineMtsForcesBeforeHaloExchange)
                 {
                     hipRangePush("dd_move_f_ifNotMTS_orNotCombineBeforeHalo");
-                    dd_move_f(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+                    if (overlapCpuHaloFWithLocalForces)
+                    {
+                        dd_move_f_finish(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+                    }
+                    else
+                    {
+                        dd_move_f(cr->dd, &forceOutMtsLevel0.forceWithShiftForces(), wcycle);
+                    }
                     hipRangePop();
                 }
                 // With MTS we need to communicate the slow or combined (in forceOutMtsLevel1) forces
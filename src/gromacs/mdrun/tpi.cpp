@@ -51,6 +51,9 @@
 
 #include <algorithm>
 #include <cfenv>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/dlbtiming.h"
@@ -66,6 +69,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/constr.h"
 #include "gromacs/mdlib/dispersioncorrection.h"
+#include "gromacs/mdlib/enerdata_utils.h"
 #include "gromacs/mdlib/energyoutput.h"
 #include "gromacs/mdlib/force.h"
 #include "gromacs/mdlib/force_flags.h"
@@ -100,6 +104,7 @@
 #include "gromacs/utility/smalloc.h"
 
 #include "legacysimulator.h"
+#include "tpibatch.h"
 
 //! Global max algorithm
 static void global_max(t_commrec* cr, int* n)
@@ -473,6 +478,53 @@ void LegacySimulator::do_tpi()
     }
     snew(sum_UgembU, nener);
 
+    /* When possible, we compute the insertion energies with a batched
+     * evaluation against a list of environment atoms that is gathered
+     * once per insertion center, instead of calling do_force for every
+     * insertion. This gives identical results (apart from rounding),
+     * but is much faster.
+     */
+    std::unique_ptr<TpiBatchedEnergies> batchedEnergies;
+    std::vector<real>                   vdwGroupEnergies(ngid);
+    std::vector<real>                   coulombGroupEnergies(ngid);
+    {
+        std::string reason;
+        if (getenv("GMX_TPI_NO_BATCH") != nullptr)
+        {
+            reason = "GMX_TPI_NO_BATCH is set";
+        }
+        else if (batchedInsertionIsSupported(*inputrec, *fr, *mdatoms, a_tp0, &reason))
+        {
+            /* The inserted atoms are at most drmax plus the molecule extent
+             * away from the insertion center.
+             */
+            real molExtent = 0;
+            if (a_tp1 - a_tp0 > 1)
+            {
+                for (i = 0; i < a_tp1 - a_tp0; i++)
+                {
+                    molExtent = std::max(molExtent, norm(x_mol[i]));
+                }
+            }
+            batchedEnergies = std::make_unique<TpiBatchedEnergies>(
+                    *mdatoms, *fr, a_tp0, ngid, maxCutoff + drmax + molExtent);
+        }
+        if (fplog)
+        {
+            if (batchedEnergies)
+            {
+                fprintf(fplog, "\nWill compute the insertion energies in batches\n");
+            }
+            else
+            {
+                fprintf(fplog,
+                        "\nWill compute the insertion energies with the force routines, since "
+                        "%s\n",
+                        reason.c_str());
+            }
+        }
+    }
+
     /* Copy the random seed set by the user */
     seed = inputrec->ld_seed;
 
@@ -614,11 +666,21 @@ void LegacySimulator::do_tpi()
 
         put_atoms_in_box(fr->pbcType, box, x);
 
+        /* The batched evaluation only supports rectangular boxes */
+        const bool bBatched = (batchedEnergies != nullptr && !TRICLINIC(box));
+
         /* Put all atoms except for the inserted ones on the grid */
-        rvec vzero       = { 0, 0, 0 };
-        rvec boxDiagonal = { box[XX][XX], box[YY][YY], box[ZZ][ZZ] };
-        nbnxn_put_on_grid(
-                fr->nbv.get(), box, 0, vzero, boxDiagonal, nullptr, { 0, a_tp0 }, -1, fr->atomInfo, x, 0, nullptr);
+        if (bBatched)
+        {
+            batchedEnergies->setEnvironment(box, x);
+        }
+        else
+        {
+            rvec vzero       = { 0, 0, 0 };
+            rvec boxDiagonal = { box[XX][XX], box[YY][YY], box[ZZ][ZZ] };
+            nbnxn_put_on_grid(
+                    fr->nbv.get(), box, 0, vzero, boxDiagonal, nullptr, { 0, a_tp0 }, -1, fr->atomInfo, x, 0, nullptr);
+        }
 
         step = cr->nodeid * stepblocksize;
         while (step < nsteps)
@@ -681,7 +743,13 @@ void LegacySimulator::do_tpi()
                 }
             }
 
-            if (bNS)
+            if (bNS && bBatched)
+            {
+                batchedEnergies->gatherNeighbors(x_init);
+
+                bNS = FALSE;
+            }
+            else if (bNS)
             {
                 for (int a = a_tp0; a < a_tp1; a++)
                 {
@@ -750,60 +818,82 @@ void LegacySimulator::do_tpi()
                 }
             }
 
-            /* Note: NonLocal refers to the inserted molecule */
-            fr->nbv->convertCoordinates(AtomLocality::NonLocal, x);
-            fr->longRangeNonbondeds->updateAfterPartition(*mdatoms);
-
-            /* Clear some matrix variables  */
-            clear_mat(force_vir);
-            clear_mat(shake_vir);
-            clear_mat(vir);
-            clear_mat(pres);
-
-            /* Calc energy (no forces) on new positions. */
-            /* Make do_force do a single node force calculation */
-            cr->nnodes = 1;
-
             // TPI might place a particle so close that the potential
             // is infinite. Since this is intended to happen, we
             // temporarily suppress any exceptions that the processor
             // might raise, then restore the old behaviour.
             std::fenv_t floatingPointEnvironment;
-            std::feholdexcept(&floatingPointEnvironment);
-            do_force(fplog,
-                     cr,
-                     ms,
-                     *inputrec,
-                     nullptr,
-                     nullptr,
-                     imdSession,
-                     pull_work,
-                     step,
-                     nrnb,
-                     wcycle,
-                     top,
-                     state_global->box,
-                     state_global->x.arrayRefWithPadding(),
-                     &state_global->hist,
-                     &f.view(),
-                     force_vir,
-                     mdatoms,
-                     enerd,
-                     state_global->lambda,
-                     fr,
-                     runScheduleWork,
-                     nullptr,
-                     mu_tot,
-                     t,
-                     nullptr,
-                     fr->longRangeNonbondeds.get(),
-                     GMX_FORCE_NONBONDED | GMX_FORCE_ENERGY | (bStateChanged ? GMX_FORCE_STATECHANGED : 0),
-                     DDBalanceRegionHandler(nullptr));
-            std::feclearexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
-            std::feupdateenv(&floatingPointEnvironment);
-
-            cr->nnodes    = nnodes;
-            bStateChanged = FALSE;
+            if (bBatched)
+            {
+                std::feholdexcept(&floatingPointEnvironment);
+                batchedEnergies->computeEnergies(
+                        x.subArray(a_tp0, a_tp1 - a_tp0), vdwGroupEnergies, coulombGroupEnergies);
+                std::feclearexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+                std::feupdateenv(&floatingPointEnvironment);
+
+                /* Store the energies as do_force would */
+                reset_enerdata(enerd);
+                for (i = 0; i < ngid; i++)
+                {
+                    enerd->grpp.energyGroupPairTerms[NonBondedEnergyTerms::LJSR][GID(i, gid_tp, ngid)] =
+                            vdwGroupEnergies[i];
+                    enerd->grpp.energyGroupPairTerms[NonBondedEnergyTerms::CoulombSR][GID(i, gid_tp, ngid)] =
+                            coulombGroupEnergies[i];
+                }
+                sum_epot(enerd->grpp, enerd->term.data());
+            }
+            else
+            {
+                /* Note: NonLocal refers to the inserted molecule */
+                fr->nbv->convertCoordinates(AtomLocality::NonLocal, x);
+                fr->longRangeNonbondeds->updateAfterPartition(*mdatoms);
+
+                /* Clear some matrix variables  */
+                clear_mat(force_vir);
+                clear_mat(shake_vir);
+                clear_mat(vir);
+                clear_mat(pres);
+
+                /* Calc energy (no forces) on new positions. */
+                /* Make do_force do a single node force calculation */
+                cr->nnodes = 1;
+
+                std::feholdexcept(&floatingPointEnvironment);
+                do_force(fplog,
+                         cr,
+                         ms,
+                         *inputrec,
+                         nullptr,
+                         nullptr,
+                         imdSession,
+                         pull_work,
+                         step,
+                         nrnb,
+                         wcycle,
+                         top,
+                         state_global->box,
+                         state_global->x.arrayRefWithPadding(),
+                         &state_global->hist,
+                         &f.view(),
+                         force_vir,
+                         mdatoms,
+                         enerd,
+                         state_global->lambda,
+                         fr,
+                         runScheduleWork,
+                         nullptr,
+                         mu_tot,
+                         t,
+                         nullptr,
+                         fr->longRangeNonbondeds.get(),
+                         GMX_FORCE_NONBONDED | GMX_FORCE_ENERGY | (bStateChanged ? GMX_FORCE_STATECHANGED : 0),
+                         DDBalanceRegionHandler(nullptr));
+                std::feclearexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+                std::feupdateenv(&floatingPointEnvironment);
+
+                cr->nnodes    = nnodes;
+                bStateChanged = FALSE;
+            }
 
             if (fr->dispersionCorrection)
             {
@@ -1011,6 +1101,13 @@ void LegacySimulator::do_tpi()
         const double mu = -log(VembU_all / V_all) / beta;
         fprintf(fplog, "  <mu> = %12.5e kJ/mol\n", mu);
 
+        const double numInsertions = static_cast<double>(frame) * nsteps;
+        const double elapsedTime   = walltime_accounting_get_time_since_start(walltime_accounting);
+        fprintf(fplog,
+                "\n  Performed %.6g insertions at %.4g insertions/s\n",
+                numInsertions,
+                elapsedTime > 0 ? numInsertions / elapsedTime : 0.0);
+
         if (!std::isfinite(mu))
         {
             fprintf(fplog,
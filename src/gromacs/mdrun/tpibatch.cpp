@@ -0,0 +1,430 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Defines the batched energy evaluation for test particle insertion
+ *
+ * \ingroup module_mdrun
+ */
+#include "gmxpre.h"
+
+#include "tpibatch.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/inputrec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+#if GMX_SIMD_HAVE_REAL
+//! The padding of the packed neighbor list
+constexpr int c_packSize = GMX_SIMD_REAL_WIDTH;
+#else
+//! The padding of the packed neighbor list
+constexpr int c_packSize = 1;
+#endif
+
+//! Returns whether \p eeltype is handled by the reaction-field code path of nbnxm
+bool isReactionFieldType(CoulombInteractionType eeltype)
+{
+    return EEL_RF(eeltype) || eeltype == CoulombInteractionType::Cut;
+}
+
+//! Returns whether the molecule starting at \p firstInsertedAtom has charges
+bool insertedMoleculeHasCharges(const t_mdatoms& mdatoms, int firstInsertedAtom)
+{
+    for (int a = firstInsertedAtom; a < mdatoms.nr; a++)
+    {
+        if (mdatoms.chargeA[a] != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool batchedInsertionIsSupported(const t_inputrec& ir,
+                                 const t_forcerec& fr,
+                                 const t_mdatoms&  mdatoms,
+                                 int               firstInsertedAtom,
+                                 std::string*      reason)
+{
+    const interaction_const_t& ic = *fr.ic;
+
+    if (ir.efep != FreeEnergyPerturbationType::No)
+    {
+        *reason = "free-energy perturbation is used";
+        return false;
+    }
+    if (ir.bPull || ir.bRot || ir.nwall > 0 || ir.bIMD)
+    {
+        *reason = "pulling, enforced rotation, walls or IMD are used";
+        return false;
+    }
+    if (fr.haveBuckingham || ic.vdwtype != VanDerWaalsType::Cut
+        || !(ic.vdw_modifier == InteractionModifiers::None
+             || ic.vdw_modifier == InteractionModifiers::ExactCutoff
+             || ic.vdw_modifier == InteractionModifiers::PotShift))
+    {
+        *reason = "only Lennard-Jones with a plain or potential-shifted cut-off is supported";
+        return false;
+    }
+    if (insertedMoleculeHasCharges(mdatoms, firstInsertedAtom) && !isReactionFieldType(ic.eeltype))
+    {
+        *reason = "only cut-off and reaction-field electrostatics are supported";
+        return false;
+    }
+    const int64_t energyGroup = fr.atomInfo[firstInsertedAtom] & sc_atomInfo_EnergyGroupIdMask;
+    for (int a = firstInsertedAtom + 1; a < mdatoms.nr; a++)
+    {
+        if ((fr.atomInfo[a] & sc_atomInfo_EnergyGroupIdMask) != energyGroup)
+        {
+            *reason = "the inserted atoms belong to different energy groups";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+TpiBatchedEnergies::TpiBatchedEnergies(const t_mdatoms&  mdatoms,
+                                       const t_forcerec& fr,
+                                       const int         firstInsertedAtom,
+                                       const int         numEnergyGroups,
+                                       const real        gatherRadius) :
+    numEnvironmentAtoms_(firstInsertedAtom),
+    numEnergyGroups_(numEnergyGroups),
+    gatherRadius_(gatherRadius),
+    boxSize_({ 0, 0, 0 }),
+    numCells_({ 0, 0, 0 }),
+    cellSize_({ 0, 0, 0 }),
+    groupNeighbors_(numEnergyGroups),
+    groupNeighborX_(numEnergyGroups),
+    groupStart_(numEnergyGroups + 1, 0)
+{
+    const interaction_const_t& ic = *fr.ic;
+
+    GMX_RELEASE_ASSERT(ic.rvdw <= ic.rcoulomb, "The nbnxm kernels require rvdw <= rcoulomb");
+
+    rVdwSquared_              = ic.rvdw * ic.rvdw;
+    rCoulombSquared_          = ic.rcoulomb * ic.rcoulomb;
+    epsfac_                   = ic.epsfac;
+    reactionFieldCoefficient_ = ic.reactionFieldCoefficient;
+    reactionFieldShift_       = ic.reactionFieldShift;
+    dispersionShift_          = ic.dispersion_shift.cpot;
+    repulsionShift_           = ic.repulsion_shift.cpot;
+    haveCharges_              = insertedMoleculeHasCharges(mdatoms, firstInsertedAtom);
+
+    /* The nbfp matrix stores 6*C6 and 12*C12, we store C6 and C12 */
+    const int numInserted = mdatoms.nr - firstInsertedAtom;
+    c6Inserted_.resize(numInserted);
+    c12Inserted_.resize(numInserted);
+    for (int i = 0; i < numInserted; i++)
+    {
+        const int typeI = mdatoms.typeA[firstInsertedAtom + i];
+        c6Inserted_[i].resize(fr.ntype);
+        c12Inserted_[i].resize(fr.ntype);
+        for (int typeJ = 0; typeJ < fr.ntype; typeJ++)
+        {
+            c6Inserted_[i][typeJ]  = C6(fr.nbfp, fr.ntype, typeI, typeJ) / 6.0_real;
+            c12Inserted_[i][typeJ] = C12(fr.nbfp, fr.ntype, typeI, typeJ) / 12.0_real;
+        }
+        chargesInserted_.push_back(mdatoms.chargeA[firstInsertedAtom + i]);
+    }
+    nbC6_.resize(numInserted);
+    nbC12_.resize(numInserted);
+
+    typeEnvironment_.resize(numEnvironmentAtoms_);
+    chargeEnvironment_.resize(numEnvironmentAtoms_);
+    energyGroupEnvironment_.resize(numEnvironmentAtoms_);
+    for (int a = 0; a < numEnvironmentAtoms_; a++)
+    {
+        typeEnvironment_[a]        = mdatoms.typeA[a];
+        chargeEnvironment_[a]      = mdatoms.chargeA[a];
+        energyGroupEnvironment_[a] = fr.atomInfo[a] & sc_atomInfo_EnergyGroupIdMask;
+    }
+}
+
+void TpiBatchedEnergies::setEnvironment(const matrix box, ArrayRef<const RVec> x)
+{
+    /* Use cells of at least half the gather radius, so we only need
+     * to search a few cells along each dimension.
+     */
+    int numCellsTotal = 1;
+    for (int d = 0; d < DIM; d++)
+    {
+        boxSize_[d]  = box[d][d];
+        numCells_[d] = std::max(1, static_cast<int>(boxSize_[d] / (0.5_real * gatherRadius_)));
+        cellSize_[d] = boxSize_[d] / numCells_[d];
+        numCellsTotal *= numCells_[d];
+    }
+
+    std::vector<int> cellOfAtom(numEnvironmentAtoms_);
+    cellStart_.assign(numCellsTotal + 1, 0);
+    for (int a = 0; a < numEnvironmentAtoms_; a++)
+    {
+        IVec cellIndex;
+        for (int d = 0; d < DIM; d++)
+        {
+            cellIndex[d] = std::clamp(
+                    static_cast<int>(std::floor(x[a][d] / cellSize_[d])), 0, numCells_[d] - 1);
+        }
+        cellOfAtom[a] = (cellIndex[XX] * numCells_[YY] + cellIndex[YY]) * numCells_[ZZ] + cellIndex[ZZ];
+        cellStart_[cellOfAtom[a] + 1]++;
+    }
+    for (int c = 0; c < numCellsTotal; c++)
+    {
+        cellStart_[c + 1] += cellStart_[c];
+    }
+    cellAtoms_.resize(numEnvironmentAtoms_);
+    cellX_.resize(numEnvironmentAtoms_);
+    std::vector<int> cellFill(cellStart_.begin(), cellStart_.end() - 1);
+    for (int a = 0; a < numEnvironmentAtoms_; a++)
+    {
+        const int index  = cellFill[cellOfAtom[a]]++;
+        cellAtoms_[index] = a;
+        cellX_[index]     = x[a];
+    }
+}
+
+void TpiBatchedEnergies::gatherNeighbors(const rvec center)
+{
+    for (int g = 0; g < numEnergyGroups_; g++)
+    {
+        groupNeighbors_[g].clear();
+        groupNeighborX_[g].clear();
+    }
+
+    const real gatherRadius2 = gatherRadius_ * gatherRadius_;
+    IVec       cellRangeBegin;
+    IVec       cellRangeEnd;
+    for (int d = 0; d < DIM; d++)
+    {
+        cellRangeBegin[d] = static_cast<int>(std::floor((center[d] - gatherRadius_) / cellSize_[d]));
+        cellRangeEnd[d] = static_cast<int>(std::floor((center[d] + gatherRadius_) / cellSize_[d])) + 1;
+    }
+
+    /* Loop over the cell range without wrapping the cell index, so each
+     * periodic image of a cell gets its own shift. This also handles
+     * gather radii larger than half the box correctly.
+     */
+    for (int cx = cellRangeBegin[XX]; cx < cellRangeEnd[XX]; cx++)
+    {
+        const int  wx     = ((cx % numCells_[XX]) + numCells_[XX]) % numCells_[XX];
+        const real shiftX = ((cx - wx) / numCells_[XX]) * boxSize_[XX];
+        for (int cy = cellRangeBegin[YY]; cy < cellRangeEnd[YY]; cy++)
+        {
+            const int  wy     = ((cy % numCells_[YY]) + numCells_[YY]) % numCells_[YY];
+            const real shiftY = ((cy - wy) / numCells_[YY]) * boxSize_[YY];
+            for (int cz = cellRangeBegin[ZZ]; cz < cellRangeEnd[ZZ]; cz++)
+            {
+                const int  wz     = ((cz % numCells_[ZZ]) + numCells_[ZZ]) % numCells_[ZZ];
+                const real shiftZ = ((cz - wz) / numCells_[ZZ]) * boxSize_[ZZ];
+                const int  cell   = (wx * numCells_[YY] + wy) * numCells_[ZZ] + wz;
+                for (int i = cellStart_[cell]; i < cellStart_[cell + 1]; i++)
+                {
+                    const RVec xShifted = { cellX_[i][XX] + shiftX,
+                                            cellX_[i][YY] + shiftY,
+                                            cellX_[i][ZZ] + shiftZ };
+                    if (distance2(xShifted, center) < gatherRadius2)
+                    {
+                        const int a = cellAtoms_[i];
+                        const int g = energyGroupEnvironment_[a];
+                        groupNeighbors_[g].push_back(a);
+                        groupNeighborX_[g].push_back(xShifted);
+                    }
+                }
+            }
+        }
+    }
+
+    /* Pack the neighbors per energy group, padded to the SIMD width.
+     * Padding entries are placed so far away that they are beyond
+     * the cut-off and they have zero parameters.
+     */
+    numNeighbors_ = 0;
+    groupStart_[0] = 0;
+    for (int g = 0; g < numEnergyGroups_; g++)
+    {
+        const int numInGroup = groupNeighbors_[g].size();
+        numNeighbors_ += numInGroup;
+        groupStart_[g + 1] =
+                groupStart_[g] + ((numInGroup + c_packSize - 1) / c_packSize) * c_packSize;
+    }
+    const int numPacked = groupStart_[numEnergyGroups_];
+    const RVec farAway = { center[XX] + 3 * gatherRadius_, center[YY], center[ZZ] };
+    nbX_.assign(numPacked, farAway[XX]);
+    nbY_.assign(numPacked, farAway[YY]);
+    nbZ_.assign(numPacked, farAway[ZZ]);
+    nbQ_.assign(numPacked, 0);
+    for (size_t i = 0; i < nbC6_.size(); i++)
+    {
+        nbC6_[i].assign(numPacked, 0);
+        nbC12_[i].assign(numPacked, 0);
+    }
+    for (int g = 0; g < numEnergyGroups_; g++)
+    {
+        for (size_t n = 0; n < groupNeighbors_[g].size(); n++)
+        {
+            const int j = groupStart_[g] + n;
+            const int a = groupNeighbors_[g][n];
+            nbX_[j]     = groupNeighborX_[g][n][XX];
+            nbY_[j]     = groupNeighborX_[g][n][YY];
+            nbZ_[j]     = groupNeighborX_[g][n][ZZ];
+            nbQ_[j]     = chargeEnvironment_[a];
+            for (size_t i = 0; i < nbC6_.size(); i++)
+            {
+                nbC6_[i][j]  = c6Inserted_[i][typeEnvironment_[a]];
+                nbC12_[i][j] = c12Inserted_[i][typeEnvironment_[a]];
+            }
+        }
+    }
+}
+
+void TpiBatchedEnergies::computeEnergies(ArrayRef<const RVec> xInserted,
+                                         ArrayRef<real>       vdwEnergies,
+                                         ArrayRef<real>       coulombEnergies) const
+{
+    GMX_ASSERT(xInserted.ssize() == gmx::ssize(nbC6_), "Need coordinates for all inserted atoms");
+    GMX_ASSERT(vdwEnergies.ssize() == numEnergyGroups_ && coulombEnergies.ssize() == numEnergyGroups_,
+               "Need energy buffers for all energy groups");
+
+    std::fill(vdwEnergies.begin(), vdwEnergies.end(), 0);
+    std::fill(coulombEnergies.begin(), coulombEnergies.end(), 0);
+
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal rVdw2(rVdwSquared_);
+    const SimdReal rCoulomb2(rCoulombSquared_);
+    const SimdReal dispersionShift(dispersionShift_);
+    const SimdReal repulsionShift(repulsionShift_);
+    const SimdReal reactionFieldCoefficient(reactionFieldCoefficient_);
+    const SimdReal reactionFieldShift(reactionFieldShift_);
+#endif
+
+    for (int i = 0; i < xInserted.ssize(); i++)
+    {
+        const real  qi  = epsfac_ * chargesInserted_[i];
+        const real* c6  = nbC6_[i].data();
+        const real* c12 = nbC12_[i].data();
+
+#if GMX_SIMD_HAVE_REAL
+        const SimdReal ix(xInserted[i][XX]);
+        const SimdReal iy(xInserted[i][YY]);
+        const SimdReal iz(xInserted[i][ZZ]);
+#endif
+
+        for (int g = 0; g < numEnergyGroups_; g++)
+        {
+#if GMX_SIMD_HAVE_REAL
+            SimdReal vVdw(0.0_real);
+            SimdReal vCoulomb(0.0_real);
+            for (int j = groupStart_[g]; j < groupStart_[g + 1]; j += GMX_SIMD_REAL_WIDTH)
+            {
+                const SimdReal dx = ix - load<SimdReal>(nbX_.data() + j);
+                const SimdReal dy = iy - load<SimdReal>(nbY_.data() + j);
+                const SimdReal dz = iz - load<SimdReal>(nbZ_.data() + j);
+                const SimdReal r2 = norm2(dx, dy, dz);
+
+                const SimdBool withinCoulomb = (r2 < rCoulomb2);
+                const SimdBool withinVdw     = (r2 < rVdw2);
+
+                const SimdReal rInv   = maskzInvsqrt(r2, withinCoulomb);
+                const SimdReal rInv2  = rInv * rInv;
+                const SimdReal rInv6  = rInv2 * rInv2 * rInv2;
+                const SimdReal vLJ    = load<SimdReal>(c12 + j) * (rInv6 * rInv6 + repulsionShift)
+                                     - load<SimdReal>(c6 + j) * (rInv6 + dispersionShift);
+                vVdw = vVdw + selectByMask(vLJ, withinVdw);
+
+                if (haveCharges_)
+                {
+                    const SimdReal vC = load<SimdReal>(nbQ_.data() + j)
+                                        * (rInv + reactionFieldCoefficient * r2 - reactionFieldShift);
+                    vCoulomb = vCoulomb + selectByMask(vC, withinCoulomb);
+                }
+            }
+            vdwEnergies[g] += reduce(vVdw);
+            coulombEnergies[g] += qi * reduce(vCoulomb);
+#else
+            real vVdw     = 0;
+            real vCoulomb = 0;
+            for (int j = groupStart_[g]; j < groupStart_[g + 1]; j++)
+            {
+                const real dx = xInserted[i][XX] - nbX_[j];
+                const real dy = xInserted[i][YY] - nbY_[j];
+                const real dz = xInserted[i][ZZ] - nbZ_[j];
+                const real r2 = dx * dx + dy * dy + dz * dz;
+
+                if (r2 < rCoulombSquared_)
+                {
+                    const real rInv  = gmx::invsqrt(r2);
+                    const real rInv2 = rInv * rInv;
+                    const real rInv6 = rInv2 * rInv2 * rInv2;
+                    if (r2 < rVdwSquared_)
+                    {
+                        vVdw += c12[j] * (rInv6 * rInv6 + repulsionShift_)
+                                - c6[j] * (rInv6 + dispersionShift_);
+                    }
+                    if (haveCharges_)
+                    {
+                        vCoulomb += nbQ_[j]
+                                    * (rInv + reactionFieldCoefficient_ * r2 - reactionFieldShift_);
+                    }
+                }
+            }
+            vdwEnergies[g] += vVdw;
+            coulombEnergies[g] += qi * vCoulomb;
+#endif
+        }
+    }
+}
+
+} // namespace gmx
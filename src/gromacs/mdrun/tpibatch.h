@@ -0,0 +1,205 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2021, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief Declares the batched energy evaluation for test particle insertion
+ *
+ * \ingroup module_mdrun
+ */
+#ifndef GMX_MDRUN_TPIBATCH_H
+#define GMX_MDRUN_TPIBATCH_H
+
+#include <string>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/real.h"
+
+struct t_forcerec;
+struct t_inputrec;
+struct t_mdatoms;
+
+namespace gmx
+{
+
+/*! \libinternal
+ * \brief Computes insertion energies for test particle insertion without the force path
+ *
+ * The environment, i.e. all atoms except for the molecule to insert, is put
+ * on a cell grid once per frame. For each insertion center the environment
+ * atoms within the insertion radius are gathered once, in SIMD friendly
+ * layout, after which the energies of any number of insertions around
+ * that center are computed with SIMD against this packed list.
+ * The energies are identical to those computed by the nbnxm kernels
+ * in do_force(), apart from summation order.
+ *
+ * Only plain cut-off and reaction-field electrostatics and cut-off
+ * Lennard-Jones with at most a potential shift are supported, and only
+ * rectangular boxes. Use batchedInsertionIsSupported() to check whether
+ * this class can be used.
+ */
+class TpiBatchedEnergies
+{
+public:
+    /*! \brief Constructor
+     *
+     * \param[in] mdatoms            The atom data, the inserted molecule is at the end
+     * \param[in] fr                 The force record
+     * \param[in] firstInsertedAtom  The index of the first atom of the molecule to insert
+     * \param[in] numEnergyGroups    The number of energy groups
+     * \param[in] gatherRadius       Environment atoms within this distance of an insertion
+     *                               center are used for insertions around that center
+     */
+    TpiBatchedEnergies(const t_mdatoms&  mdatoms,
+                       const t_forcerec& fr,
+                       int               firstInsertedAtom,
+                       int               numEnergyGroups,
+                       real              gatherRadius);
+
+    //! Puts the environment atoms, the atoms before the inserted molecule in \p x, on the grid
+    void setEnvironment(const matrix box, ArrayRef<const RVec> x);
+
+    //! Gathers the environment atoms within the gather radius of \p center
+    void gatherNeighbors(const rvec center);
+
+    //! Returns the number of environment atoms gathered by the last call to gatherNeighbors()
+    int numNeighbors() const { return numNeighbors_; }
+
+    /*! \brief Computes the insertion energies for the inserted molecule at \p xInserted
+     *
+     * All inserted atoms should be within the gather radius minus the cut-off
+     * of the center passed to the last call of gatherNeighbors().
+     *
+     * \param[in]  xInserted        The coordinates of the atoms of the inserted molecule
+     * \param[out] vdwEnergies      The Van der Waals energies per environment energy group
+     * \param[out] coulombEnergies  The Coulomb energies per environment energy group
+     */
+    void computeEnergies(ArrayRef<const RVec> xInserted,
+                         ArrayRef<real>       vdwEnergies,
+                         ArrayRef<real>       coulombEnergies) const;
+
+private:
+    //! Aligned buffer type for the packed neighbor data
+    using AlignedRealVector = std::vector<real, AlignedAllocator<real>>;
+
+    //! The number of environment atoms
+    int numEnvironmentAtoms_;
+    //! The number of energy groups
+    int numEnergyGroups_;
+    //! The gather radius
+    real gatherRadius_;
+    //! The Van der Waals cut-off squared
+    real rVdwSquared_;
+    //! The Coulomb cut-off squared
+    real rCoulombSquared_;
+    //! The electrostatics conversion factor
+    real epsfac_;
+    //! The reaction-field coefficient
+    real reactionFieldCoefficient_;
+    //! The reaction-field shift
+    real reactionFieldShift_;
+    //! The dispersion potential shift
+    real dispersionShift_;
+    //! The repulsion potential shift
+    real repulsionShift_;
+    //! Whether the inserted molecule has charges
+    bool haveCharges_;
+    //! The charges of the inserted atoms
+    std::vector<real> chargesInserted_;
+    //! For each inserted atom the C6 parameter with each atom type
+    std::vector<std::vector<real>> c6Inserted_;
+    //! For each inserted atom the C12 parameter with each atom type
+    std::vector<std::vector<real>> c12Inserted_;
+    //! The atom types of the environment atoms
+    std::vector<int> typeEnvironment_;
+    //! The charges of the environment atoms
+    std::vector<real> chargeEnvironment_;
+    //! The energy groups of the environment atoms
+    std::vector<int> energyGroupEnvironment_;
+
+    //! The box size
+    RVec boxSize_;
+    //! The number of grid cells along each dimension
+    IVec numCells_;
+    //! The grid cell size along each dimension
+    RVec cellSize_;
+    //! The start of each cell in \p cellAtoms_, size number of cells + 1
+    std::vector<int> cellStart_;
+    //! The environment atom indices sorted on cell
+    std::vector<int> cellAtoms_;
+    //! The environment coordinates sorted on cell
+    std::vector<RVec> cellX_;
+
+    //! Temporary list of neighbor indices per energy group
+    std::vector<std::vector<int>> groupNeighbors_;
+    //! Temporary list of shifted neighbor coordinates per energy group
+    std::vector<std::vector<RVec>> groupNeighborX_;
+    //! The total number of gathered neighbors
+    int numNeighbors_ = 0;
+    //! The start of each energy group in the packed list, padded to the SIMD width
+    std::vector<int> groupStart_;
+    //! Packed neighbor x-coordinates
+    AlignedRealVector nbX_;
+    //! Packed neighbor y-coordinates
+    AlignedRealVector nbY_;
+    //! Packed neighbor z-coordinates
+    AlignedRealVector nbZ_;
+    //! Packed neighbor charges
+    AlignedRealVector nbQ_;
+    //! Packed neighbor C6 parameters, for each inserted atom
+    std::vector<AlignedRealVector> nbC6_;
+    //! Packed neighbor C12 parameters, for each inserted atom
+    std::vector<AlignedRealVector> nbC12_;
+};
+
+/*! \brief Returns whether TpiBatchedEnergies can be used for this setup
+ *
+ * \param[in]  ir                 The input record
+ * \param[in]  fr                 The force record
+ * \param[in]  mdatoms            The atom data
+ * \param[in]  firstInsertedAtom  The index of the first atom of the molecule to insert
+ * \param[out] reason             When not supported, the reason why
+ */
+bool batchedInsertionIsSupported(const t_inputrec& ir,
+                                 const t_forcerec& fr,
+                                 const t_mdatoms&  mdatoms,
+                                 int               firstInsertedAtom,
+                                 std::string*      reason);
+
+} // namespace gmx
+
+#endif
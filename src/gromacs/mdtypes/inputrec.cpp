@@ -884,6 +884,7 @@ void pr_inputrec(FILE* fp, int indent, const char* title, const t_inputrec* ir,
         PI("nstenergy", ir->nstenergy);
         PI("nstxout-compressed", ir->nstxout_compressed);
         PR("compressed-x-precision", ir->x_compression_precision);
+        PR("compressed-x-precision-other", ir->x_compression_precision_other);
 
         /* Neighborsearching parameters */
         PS("cutoff-scheme", enumValueToString(ir->cutoff_scheme));
@@ -1433,6 +1434,13 @@ void cmp_inputrec(FILE* fp, const t_inputrec* ir1, const t_inputrec* ir2, real f
              ir2->x_compression_precision,
              ftol,
              abstol);
+    cmp_real(fp,
+             "inputrec->x_compression_precision_other",
+             -1,
+             ir1->x_compression_precision_other,
+             ir2->x_compression_precision_other,
+             ftol,
+             abstol);
     cmp_real(fp, "inputrec->fourierspacing", -1, ir1->fourier_spacing, ir2->fourier_spacing, ftol, abstol);
     cmp_int(fp, "inputrec->nkx", -1, ir1->nkx, ir2->nkx);
     cmp_int(fp, "inputrec->nky", -1, ir1->nky, ir2->nky);
@@ -360,6 +360,8 @@ struct t_inputrec // NOLINT (clang-analyzer-optin.performance.Padding)
     std::vector<gmx::MtsLevel> mtsLevels;
     //! Precision of x in compressed trajectory file
     real x_compression_precision = 0;
+    //! Precision of x in compressed trajectory file for atoms outside the compressed groups
+    real x_compression_precision_other = 0;
     //! Requested fourier_spacing, when nk? not set
     real fourier_spacing = 0;
     //! Number of k vectors in x dimension for fourier methods for long range electrost.
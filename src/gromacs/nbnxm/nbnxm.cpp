@@ -45,12 +45,15 @@
 
 #include "nbnxm.h"
 
+#include <algorithm>
+
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/nbnxm/atomdata.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/utility/message_string_collector.h"
 
 #include "nbnxm_gpu.h"
+#include "pairlistset.h"
 #include "pairlistsets.h"
 #include "pairsearch.h"
 
@@ -138,6 +141,57 @@ void nonbonded_verlet_t::setLocalAtomOrder() const
     pairSearch_->setLocalAtomOrder();
 }
 
+void nonbonded_verlet_t::addPairlistCountsForHomeAtoms(gmx::ArrayRef<real> numPairs) const
+{
+    gmx::ArrayRef<const int> atomIndices      = pairSearch_->gridSet().atomIndices();
+    const int                numHomeGridAtoms = getLocalAtomOrder().ssize();
+
+    /* Adds count to the home atoms in grid order range [gridAtomStart, gridAtomEnd) */
+    auto addToAtoms = [&](int gridAtomStart, int gridAtomEnd, real count) {
+        for (int i = gridAtomStart; i < std::min(gridAtomEnd, numHomeGridAtoms); i++)
+        {
+            const int a = atomIndices[i];
+            if (a >= 0 && a < numPairs.ssize())
+            {
+                numPairs[a] += count;
+            }
+        }
+    };
+
+    const int numLocalities = (pairlistSets_->params().haveMultipleDomains ? 2 : 1);
+    for (int l = 0; l < numLocalities; l++)
+    {
+        const PairlistSet& pairlistSet = pairlistSets().pairlistSet(
+                l == 0 ? gmx::InteractionLocality::Local : gmx::InteractionLocality::NonLocal);
+
+        for (const NbnxnPairlistCpu& list : pairlistSet.cpuLists())
+        {
+            for (const nbnxn_ci_t& ciEntry : list.ci)
+            {
+                addToAtoms(ciEntry.ci * list.na_ci,
+                           (ciEntry.ci + 1) * list.na_ci,
+                           ciEntry.cj_length * list.na_cj);
+            }
+        }
+
+        if (const NbnxnPairlistGpu* list = pairlistSet.gpuList())
+        {
+            /* We ignore the i-cluster interaction masks, so we overestimate
+             * the counts, but only relative to other atoms.
+             */
+            constexpr int c_numAtomsPerSuperCluster =
+                    c_gpuNumClusterPerCell * c_nbnxnGpuClusterSize;
+            constexpr int c_numAtomsPerJGroup = c_nbnxnGpuJgroupSize * c_nbnxnGpuClusterSize;
+            for (const nbnxn_sci_t& sciEntry : list->sci)
+            {
+                addToAtoms(sciEntry.sci * c_numAtomsPerSuperCluster,
+                           (sciEntry.sci + 1) * c_numAtomsPerSuperCluster,
+                           sciEntry.numJClusterGroups() * c_numAtomsPerJGroup);
+            }
+        }
+    }
+}
+
 void nonbonded_verlet_t::setAtomProperties(gmx::ArrayRef<const int>     atomTypes,
                                            gmx::ArrayRef<const real>    atomCharges,
                                            gmx::ArrayRef<const int64_t> atomInfo) const
@@ -299,6 +299,14 @@ public:
     //! Returns the index position of the atoms on the search grid
     gmx::ArrayRef<const int> getGridIndices() const;
 
+    /*! \brief Adds the number of j-atoms in the pairlists of each home atom to \p numPairs
+     *
+     * Uses the local and non-local pairlists of the last search, which
+     * should have been done with the current local atom order. Only
+     * home atoms are counted. \p numPairs is indexed by local atom index.
+     */
+    void addPairlistCountsForHomeAtoms(gmx::ArrayRef<real> numPairs) const;
+
     /*! \brief Constructs the pairlist for the given locality
      *
      * When there are no non-self exclusions, \p exclusions can be empty.
@@ -47,6 +47,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/dlbtiming.h"
@@ -62,6 +63,7 @@
 #include "gromacs/math/units.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/groupcoord.h"
 #include "gromacs/mdlib/stat.h"
 #include "gromacs/mdrunutility/handlerestart.h"
@@ -71,12 +73,16 @@
 #include "gromacs/mdtypes/mdrunoptions.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/timing/cyclecounter.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/topology/mtop_lookup.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
@@ -134,6 +140,24 @@ struct gmx_potfit
 };
 
 
+//! Per-thread working data for the flexible rotation kernels
+struct gmx_flexthread
+{
+    //! Precalculated gaussians for a single atom
+    std::vector<real> gn_atom;
+    //! Tells to which slab each precalculated gaussian belongs
+    std::vector<int> gn_slabind;
+    //! Gaussian weights of the atoms contributing to the inner sum of a slab
+    std::vector<real> gaussians;
+    //! The torque contribution of this thread for each slab
+    std::vector<real> slab_torque_v;
+    //! The potential contribution of this thread for each fit angle
+    std::vector<real> potAngleV;
+    //! The rotation potential contribution of this thread
+    real V = 0;
+};
+
+
 //! Enforced rotation data for a single rotation group
 struct gmx_enfrotgrp
 {
@@ -226,10 +250,10 @@ struct gmx_enfrotgrp
     real* slab_torque_v;
     //! min_gaussian from t_rotgrp is the minimum value the gaussian must have so that the force is actually evaluated. max_beta is just another way to put it
     real max_beta;
-    //! Precalculated gaussians for a single atom
-    real* gn_atom;
-    //! Tells to which slab each precalculated gaussian belongs
-    int* gn_slabind;
+    //! Projections of the sorted positions on the rotation vector
+    std::vector<real> xc_proj;
+    //! Working data for each OpenMP thread
+    std::vector<gmx_flexthread> flexThreadData;
     //! Inner sum of the flexible2 potential per slab; this is precalculated for optimization reasons
     rvec* slab_innersumvec;
     //! Holds atom positions and gaussian weights of atoms belonging to a slab
@@ -1805,17 +1829,20 @@ static inline int get_homeslab(rvec curr_x, /* The position for which the home s
 /* For a local atom determine the relevant slabs, i.e. slabs in
  * which the gaussian is larger than min_gaussian
  */
-static int get_single_atom_gaussians(rvec curr_x, gmx_enfrotgrp* erg)
+static int get_single_atom_gaussians(rvec                 curr_x,
+                                     const gmx_enfrotgrp* erg,
+                                     real*                gn_atom,
+                                     int*                 gn_slabind)
 {
 
     /* Determine the 'home' slab of this atom: */
     int homeslab = get_homeslab(curr_x, erg->vec, erg->rotg->slab_dist);
 
     /* First determine the weight in the atoms home slab: */
-    real g                 = gaussian_weight(curr_x, erg, homeslab);
-    int  count             = 0;
-    erg->gn_atom[count]    = g;
-    erg->gn_slabind[count] = homeslab;
+    real g            = gaussian_weight(curr_x, erg, homeslab);
+    int  count        = 0;
+    gn_atom[count]    = g;
+    gn_slabind[count] = homeslab;
     count++;
 
 
@@ -1824,9 +1851,9 @@ static int get_single_atom_gaussians(rvec curr_x, gmx_enfrotgrp* erg)
     while (g > erg->rotg->min_gaussian)
     {
         slab++;
-        g                      = gaussian_weight(curr_x, erg, slab);
-        erg->gn_slabind[count] = slab;
-        erg->gn_atom[count]    = g;
+        g                 = gaussian_weight(curr_x, erg, slab);
+        gn_slabind[count] = slab;
+        gn_atom[count]    = g;
         count++;
     }
     count--;
@@ -1836,9 +1863,9 @@ static int get_single_atom_gaussians(rvec curr_x, gmx_enfrotgrp* erg)
     do
     {
         slab--;
-        g                      = gaussian_weight(curr_x, erg, slab);
-        erg->gn_slabind[count] = slab;
-        erg->gn_atom[count]    = g;
+        g                 = gaussian_weight(curr_x, erg, slab);
+        gn_slabind[count] = slab;
+        gn_atom[count]    = g;
         count++;
     } while (g > erg->rotg->min_gaussian);
     count--;
@@ -1847,29 +1874,81 @@ static int get_single_atom_gaussians(rvec curr_x, gmx_enfrotgrp* erg)
 }
 
 
-static void flex2_precalc_inner_sum(const gmx_enfrotgrp* erg)
+/* Calculates the Gaussian weights of slab n for the sorted positions with
+ * indices first to last, using the projections of the positions on the
+ * rotation vector. This is the SIMD version of gaussian_weight(). */
+static void get_slab_gaussians(const gmx_enfrotgrp* erg,
+                               int                  n,
+                               int                  first,
+                               int                  last,
+                               real*                gaussians)
 {
-    rvec xi;       /* positions in the i-sum                        */
-    rvec xcn, ycn; /* the current and the reference slab centers    */
-    real gaussian_xi;
-    rvec yi0;
-    rvec rin; /* Helper variables                              */
-    real fac, fac2;
-    rvec innersumvec;
-    real OOpsii, OOpsiistar;
-    real sin_rin; /* s_ii.r_ii */
-    rvec s_in, tmpvec, tmpvec2;
-    real mi, wi; /* Mass-weighting of the positions                 */
-    real N_M;    /* N/M                                             */
+    const real  sigma       = 0.7 * erg->rotg->slab_dist;
+    const real  prefactor   = -0.5 / (sigma * sigma);
+    const real  slabPos     = erg->rotg->slab_dist * n;
+    const real* proj        = erg->xc_proj.data() + first;
+    const int   numGaussian = last - first + 1;
+
+    int i = 0;
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_LOADU && GMX_SIMD_HAVE_STOREU
+    const gmx::SimdReal prefactorS(prefactor);
+    const gmx::SimdReal slabPosS(slabPos);
+    const gmx::SimdReal normS(GAUSS_NORM);
+    for (; i + GMX_SIMD_REAL_WIDTH <= numGaussian; i += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx::SimdReal beta = gmx::loadU<gmx::SimdReal>(proj + i) - slabPosS;
+        gmx::storeU(gaussians + i, normS * gmx::exp(prefactorS * beta * beta));
+    }
+#endif
+    for (; i < numGaussian; i++)
+    {
+        const real beta = proj[i] - slabPos;
+        gaussians[i]    = GAUSS_NORM * std::exp(prefactor * beta * beta);
+    }
+}
 
 
-    N_M = erg->rotg->nat * erg->invmass;
+/* Returns the number of OpenMP threads to use for the flexible rotation
+ * loops, such that each thread gets at least minWorkPerThread work items */
+static int get_flex_num_threads(const gmx_enfrotgrp* erg, int numWorkItems, int minWorkPerThread)
+{
+    const int numThreads = std::min(static_cast<int>(erg->flexThreadData.size()),
+                                    numWorkItems / minWorkPerThread);
+
+    return std::max(1, numThreads);
+}
+
+
+static void flex2_precalc_inner_sum(gmx_enfrotgrp* erg)
+{
+    const real N_M = erg->rotg->nat * erg->invmass; /* N/M */
+
+    /* The slabs are independent, so we can distribute them over the threads */
+    const int numThreads = get_flex_num_threads(erg, erg->slab_last - erg->slab_first + 1, 1);
 
     /* Loop over all slabs that contain something */
+#pragma omp parallel for num_threads(numThreads) schedule(static)
     for (int n = erg->slab_first; n <= erg->slab_last; n++)
     {
+        rvec xi;       /* positions in the i-sum                        */
+        rvec xcn, ycn; /* the current and the reference slab centers    */
+        real gaussian_xi;
+        rvec yi0;
+        rvec rin; /* Helper variables                              */
+        real fac, fac2;
+        rvec innersumvec;
+        real OOpsii, OOpsiistar;
+        real sin_rin; /* s_ii.r_ii */
+        rvec s_in, tmpvec, tmpvec2;
+        real mi, wi; /* Mass-weighting of the positions                 */
+
         int slabIndex = n - erg->slab_first; /* slab index */
 
+        /* Precompute the Gaussian weights of all atoms in the i-sum */
+        real* gaussians = erg->flexThreadData[gmx_omp_get_thread_num()].gaussians.data();
+        get_slab_gaussians(
+                erg, n, erg->firstatom[slabIndex], erg->lastatom[slabIndex], gaussians);
+
         /* The current center of this slab is saved in xcn: */
         copy_rvec(erg->slab_center[slabIndex], xcn);
         /* ... and the reference center in ycn: */
@@ -1887,7 +1966,7 @@ static void flex2_precalc_inner_sum(const gmx_enfrotgrp* erg)
             copy_rvec(erg->xc[i], xi);
 
             /* The i-weights */
-            gaussian_xi = gaussian_weight(xi, erg, n);
+            gaussian_xi = gaussians[i - erg->firstatom[slabIndex]];
             mi          = erg->mc_sorted[i]; /* need the sorted mass here */
             wi          = N_M * mi;
 
@@ -1937,25 +2016,33 @@ static void flex2_precalc_inner_sum(const gmx_enfrotgrp* erg)
 }
 
 
-static void flex_precalc_inner_sum(const gmx_enfrotgrp* erg)
+static void flex_precalc_inner_sum(gmx_enfrotgrp* erg)
 {
-    rvec xi;       /* position                                      */
-    rvec xcn, ycn; /* the current and the reference slab centers    */
-    rvec qin, rin; /* q_i^n and r_i^n                               */
-    real bin;
-    rvec tmpvec;
-    rvec innersumvec; /* Inner part of sum_n2                          */
-    real gaussian_xi; /* Gaussian weight gn(xi)                        */
-    real mi, wi;      /* Mass-weighting of the positions               */
-    real N_M;         /* N/M                                           */
+    const real N_M = erg->rotg->nat * erg->invmass; /* N/M */
 
-    N_M = erg->rotg->nat * erg->invmass;
+    /* The slabs are independent, so we can distribute them over the threads */
+    const int numThreads = get_flex_num_threads(erg, erg->slab_last - erg->slab_first + 1, 1);
 
     /* Loop over all slabs that contain something */
+#pragma omp parallel for num_threads(numThreads) schedule(static)
     for (int n = erg->slab_first; n <= erg->slab_last; n++)
     {
+        rvec xi;          /* position                                      */
+        rvec xcn, ycn;    /* the current and the reference slab centers    */
+        rvec qin, rin;    /* q_i^n and r_i^n                               */
+        real bin;
+        rvec tmpvec;
+        rvec innersumvec; /* Inner part of sum_n2                          */
+        real gaussian_xi; /* Gaussian weight gn(xi)                        */
+        real mi, wi;      /* Mass-weighting of the positions               */
+
         int slabIndex = n - erg->slab_first; /* slab index */
 
+        /* Precompute the Gaussian weights of all atoms in the i-sum */
+        real* gaussians = erg->flexThreadData[gmx_omp_get_thread_num()].gaussians.data();
+        get_slab_gaussians(
+                erg, n, erg->firstatom[slabIndex], erg->lastatom[slabIndex], gaussians);
+
         /* The current center of this slab is saved in xcn: */
         copy_rvec(erg->slab_center[slabIndex], xcn);
         /* ... and the reference center in ycn: */
@@ -1972,7 +2059,7 @@ static void flex_precalc_inner_sum(const gmx_enfrotgrp* erg)
             copy_rvec(erg->xc[i], xi);
 
             /* The i-weights */
-            gaussian_xi = gaussian_weight(xi, erg, n);
+            gaussian_xi = gaussians[i - erg->firstatom[slabIndex]];
             mi          = erg->mc_sorted[i]; /* need the sorted mass here */
             wi          = N_M * mi;
 
@@ -2015,8 +2102,11 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
                               real                           sigma, /* The Gaussian width sigma */
                               gmx::ArrayRef<const gmx::RVec> coords,
                               gmx_bool                       bOutstepRot,
-                              gmx_bool                       bOutstepSlab,
-                              const matrix                   box)
+                              gmx_bool                       bCalcPotFit,
+                              const matrix                   box,
+                              gmx::index                     jBegin,
+                              gmx::index                     jEnd,
+                              gmx_flexthread*                threadData)
 {
     int  count, ii, iigrp;
     rvec xj;          /* position in the i-sum                         */
@@ -2040,7 +2130,6 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
     real     mj, wj; /* Mass-weighting of the positions               */
     real     N_M;    /* N/M                                           */
     real     Wjn;    /* g_n(x_j) m_j / Mjn                            */
-    gmx_bool bCalcPotFit;
 
     /* To calculate the torque per slab */
     rvec slab_force; /* Single force from slab n on one atom          */
@@ -2048,12 +2137,6 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
     real slab_sum3part, slab_sum4part;
     rvec slab_sum1vec, slab_sum2vec, slab_sum3vec, slab_sum4vec;
 
-    /* Pre-calculate the inner sums, so that we do not have to calculate
-     * them again for every atom */
-    flex2_precalc_inner_sum(erg);
-
-    bCalcPotFit = (bOutstepRot || bOutstepSlab) && (RotationGroupFitting::Pot == erg->rotg->eFittype);
-
     /********************************************************/
     /* Main loop over all local atoms of the rotation group */
     /********************************************************/
@@ -2063,7 +2146,7 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
     const auto& localRotationGroupIndex      = erg->atomSet->localIndex();
     const auto& collectiveRotationGroupIndex = erg->atomSet->collectiveIndex();
 
-    for (gmx::index j = 0; j < localRotationGroupIndex.ssize(); j++)
+    for (gmx::index j = jBegin; j < jEnd; j++)
     {
         /* Local index of a rotation group atom  */
         ii = localRotationGroupIndex[j];
@@ -2084,7 +2167,8 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
 
         /* Determine the slabs to loop over, i.e. the ones with contributions
          * larger than min_gaussian */
-        count = get_single_atom_gaussians(xj, erg);
+        count = get_single_atom_gaussians(
+                xj, erg, threadData->gn_atom.data(), threadData->gn_slabind.data());
 
         clear_rvec(sum1vec_part);
         clear_rvec(sum2vec_part);
@@ -2093,10 +2177,10 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
         /* Loop over the relevant slabs for this atom */
         for (int ic = 0; ic < count; ic++)
         {
-            int n = erg->gn_slabind[ic];
+            int n = threadData->gn_slabind[ic];
 
             /* Get the precomputed Gaussian value of curr_slab for curr_x */
-            gaussian_xj = erg->gn_atom[ic];
+            gaussian_xj = threadData->gn_atom[ic];
 
             int slabIndex = n - erg->slab_first; /* slab index */
 
@@ -2148,7 +2232,7 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
                 {
                     mvmul(erg->PotAngleFit->rotmat[ifit], yj0_ycn, fit_rjn);
                     fit_numerator = gmx::square(iprod(tmpvec, fit_rjn));
-                    erg->PotAngleFit->V[ifit] +=
+                    threadData->potAngleV[ifit] +=
                             0.5 * erg->rotg->k * wj * gaussian_xj * fit_numerator / OOpsijstar;
                 }
             }
@@ -2229,7 +2313,7 @@ static real do_flex2_lowlevel(gmx_enfrotgrp*                 erg,
                                        + 0.5 * slab_sum4vec[m]);
                 }
 
-                erg->slab_torque_v[slabIndex] += torque(erg->vec, slab_force, xj, xcn);
+                threadData->slab_torque_v[slabIndex] += torque(erg->vec, slab_force, xj, xcn);
             }
         } /* END of loop over slabs */
 
@@ -2282,8 +2366,11 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
                              real sigma, /* The Gaussian width sigma                      */
                              gmx::ArrayRef<const gmx::RVec> coords,
                              gmx_bool                       bOutstepRot,
-                             gmx_bool                       bOutstepSlab,
-                             const matrix                   box)
+                             gmx_bool                       bCalcPotFit,
+                             const matrix                   box,
+                             gmx::index                     jBegin,
+                             gmx::index                     jEnd,
+                             gmx_flexthread*                threadData)
 {
     int      count, iigrp;
     rvec     xj, yj0;        /* current and reference position                */
@@ -2305,13 +2392,6 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
     real     betan_xj_sigma2;
     real     mj, wj; /* Mass-weighting of the positions               */
     real     N_M;    /* N/M                                           */
-    gmx_bool bCalcPotFit;
-
-    /* Pre-calculate the inner sums, so that we do not have to calculate
-     * them again for every atom */
-    flex_precalc_inner_sum(erg);
-
-    bCalcPotFit = (bOutstepRot || bOutstepSlab) && (RotationGroupFitting::Pot == erg->rotg->eFittype);
 
     /********************************************************/
     /* Main loop over all local atoms of the rotation group */
@@ -2322,7 +2402,7 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
     const auto& localRotationGroupIndex      = erg->atomSet->localIndex();
     const auto& collectiveRotationGroupIndex = erg->atomSet->collectiveIndex();
 
-    for (gmx::index j = 0; j < localRotationGroupIndex.ssize(); j++)
+    for (gmx::index j = jBegin; j < jEnd; j++)
     {
         /* Local index of a rotation group atom  */
         int ii = localRotationGroupIndex[j];
@@ -2343,7 +2423,8 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
 
         /* Determine the slabs to loop over, i.e. the ones with contributions
          * larger than min_gaussian */
-        count = get_single_atom_gaussians(xj, erg);
+        count = get_single_atom_gaussians(
+                xj, erg, threadData->gn_atom.data(), threadData->gn_slabind.data());
 
         clear_rvec(sum_n1);
         clear_rvec(sum_n2);
@@ -2351,10 +2432,10 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
         /* Loop over the relevant slabs for this atom */
         for (int ic = 0; ic < count; ic++)
         {
-            int n = erg->gn_slabind[ic];
+            int n = threadData->gn_slabind[ic];
 
             /* Get the precomputed Gaussian for xj in slab n */
-            gaussian_xj = erg->gn_atom[ic];
+            gaussian_xj = threadData->gn_atom[ic];
 
             int slabIndex = n - erg->slab_first; /* slab index */
 
@@ -2415,7 +2496,7 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
                                                       /*            |v x Omega.(yj0-ycn)|   */
                     fit_bjn = iprod(fit_qjn, xj_xcn); /* fit_bjn = fit_qjn * (xj - xcn) */
                     /* Add to the rotation potential for this angle */
-                    erg->PotAngleFit->V[ifit] +=
+                    threadData->potAngleV[ifit] +=
                             0.5 * erg->rotg->k * wj * gaussian_xj * gmx::square(fit_bjn);
                 }
             }
@@ -2457,7 +2538,7 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
                 svmul(-erg->rotg->k * wj, tmpvec2, force_n1);    /* part 1 */
                 svmul(erg->rotg->k * mj, innersumvec, force_n2); /* part 2 */
                 rvec_add(force_n1, force_n2, force_n);
-                erg->slab_torque_v[slabIndex] += torque(erg->vec, force_n, xj, xcn);
+                threadData->slab_torque_v[slabIndex] += torque(erg->vec, force_n, xj, xcn);
             }
         } /* END of loop over slabs */
 
@@ -2480,6 +2561,128 @@ static real do_flex_lowlevel(gmx_enfrotgrp* erg,
     return V;
 }
 
+/* Makes sure that each OpenMP thread has its working data for the flexible
+ * rotation kernels */
+static void init_flex_thread_data(gmx_enfrotgrp* erg)
+{
+    const int numThreads = std::max(1, gmx_omp_nthreads_get(ModuleMultiThread::Default));
+
+    if (gmx::ssize(erg->flexThreadData) < numThreads)
+    {
+        erg->flexThreadData.resize(numThreads);
+        for (gmx_flexthread& threadData : erg->flexThreadData)
+        {
+            threadData.gn_atom.resize(erg->nslabs_alloc);
+            threadData.gn_slabind.resize(erg->nslabs_alloc);
+            threadData.gaussians.resize(erg->rotg->nat);
+            threadData.slab_torque_v.resize(erg->nslabs_alloc);
+            threadData.potAngleV.resize(erg->rotg->PotAngle_nstep);
+        }
+    }
+}
+
+
+/* Calculates the flexible rotation forces on the local atoms and returns
+ * this rank's part of the rotation potential. The local atoms are
+ * distributed over the OpenMP threads, the per-slab torques and the
+ * potential fit energies are accumulated per thread and reduced
+ * afterwards in a fixed order. */
+static real do_flexible_lowlevel(gmx_enfrotgrp*                 erg,
+                                 real                           sigma,
+                                 gmx::ArrayRef<const gmx::RVec> coords,
+                                 gmx_bool                       bOutstepRot,
+                                 gmx_bool                       bOutstepSlab,
+                                 const matrix                   box)
+{
+    const bool bFlex2 = (erg->rotg->eType == EnforcedRotationGroupType::Flex2
+                         || erg->rotg->eType == EnforcedRotationGroupType::Flex2t);
+
+    /* Pre-calculate the inner sums, so that we do not have to calculate
+     * them again for every atom */
+    if (bFlex2)
+    {
+        flex2_precalc_inner_sum(erg);
+    }
+    else
+    {
+        flex_precalc_inner_sum(erg);
+    }
+
+    const gmx_bool bCalcPotFit =
+            (bOutstepRot || bOutstepSlab) && (RotationGroupFitting::Pot == erg->rotg->eFittype);
+
+    /* Only use multiple threads when each thread gets a reasonable amount of atoms */
+    constexpr int    c_minNumAtomsPerThread = 32;
+    const gmx::index numLocalAtoms          = erg->atomSet->numAtomsLocal();
+    const int numThreads = get_flex_num_threads(erg, numLocalAtoms, c_minNumAtomsPerThread);
+    const int nslabs     = erg->slab_last - erg->slab_first + 1;
+
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        try
+        {
+            gmx_flexthread& threadData = erg->flexThreadData[thread];
+
+            std::fill(threadData.slab_torque_v.begin(),
+                      threadData.slab_torque_v.begin() + nslabs,
+                      0);
+            std::fill(threadData.potAngleV.begin(), threadData.potAngleV.end(), 0);
+
+            const gmx::index jBegin = (numLocalAtoms * thread) / numThreads;
+            const gmx::index jEnd   = (numLocalAtoms * (thread + 1)) / numThreads;
+            if (bFlex2)
+            {
+                threadData.V = do_flex2_lowlevel(erg,
+                                                 sigma,
+                                                 coords,
+                                                 bOutstepRot,
+                                                 bCalcPotFit,
+                                                 box,
+                                                 jBegin,
+                                                 jEnd,
+                                                 &threadData);
+            }
+            else
+            {
+                threadData.V = do_flex_lowlevel(erg,
+                                                sigma,
+                                                coords,
+                                                bOutstepRot,
+                                                bCalcPotFit,
+                                                box,
+                                                jBegin,
+                                                jEnd,
+                                                &threadData);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+    }
+
+    /* Reduce the thread contributions */
+    real V = 0;
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        const gmx_flexthread& threadData = erg->flexThreadData[thread];
+
+        V += threadData.V;
+        for (int l = 0; l < nslabs; l++)
+        {
+            erg->slab_torque_v[l] += threadData.slab_torque_v[l];
+        }
+        if (bCalcPotFit)
+        {
+            for (int ifit = 0; ifit < erg->rotg->PotAngle_nstep; ifit++)
+            {
+                erg->PotAngleFit->V[ifit] += threadData.potAngleV[ifit];
+            }
+        }
+    }
+
+    return V;
+}
+
+
 static void sort_collective_coordinates(gmx_enfrotgrp*    erg,
                                         sort_along_vec_t* data) /* Buffer for sorting the positions */
 {
@@ -2503,6 +2706,7 @@ static void sort_collective_coordinates(gmx_enfrotgrp*    erg,
     {
         copy_rvec(data[i].x, erg->xc[i]);
         copy_rvec(data[i].x_ref, erg->xc_ref_sorted[i]);
+        erg->xc_proj[i]    = data[i].xcproj;
         erg->mc_sorted[i]  = data[i].m;
         erg->xc_sortind[i] = data[i].ind;
     }
@@ -2628,6 +2832,8 @@ static void do_flexible(gmx_bool       bMaster,
     /* Define the sigma value */
     sigma = 0.7 * erg->rotg->slab_dist;
 
+    init_flex_thread_data(erg);
+
     /* Sort the collective coordinates erg->xc along the rotation vector. This is
      * an optimization for the inner loop. */
     sort_collective_coordinates(erg, enfrot->data);
@@ -2657,20 +2863,11 @@ static void do_flexible(gmx_bool       bMaster,
     }
 
     /* Call the rotational forces kernel */
-    if (erg->rotg->eType == EnforcedRotationGroupType::Flex
-        || erg->rotg->eType == EnforcedRotationGroupType::Flext)
-    {
-        erg->V = do_flex_lowlevel(erg, sigma, coords, bOutstepRot, bOutstepSlab, box);
-    }
-    else if (erg->rotg->eType == EnforcedRotationGroupType::Flex2
-             || erg->rotg->eType == EnforcedRotationGroupType::Flex2t)
-    {
-        erg->V = do_flex2_lowlevel(erg, sigma, coords, bOutstepRot, bOutstepSlab, box);
-    }
-    else
+    if (!ISFLEX(erg->rotg))
     {
         gmx_fatal(FARGS, "Unknown flexible rotation type");
     }
+    erg->V = do_flexible_lowlevel(erg, sigma, coords, bOutstepRot, bOutstepSlab, box);
 
     /* Determine angle by RMSD fit to the reference - Let's hope this */
     /* only happens once in a while, since this is not parallelized! */
@@ -3370,8 +3567,6 @@ static void allocate_slabs(gmx_enfrotgrp* erg, FILE* fplog, gmx_bool bVerbose)
     snew(erg->slab_weights, nslabs);
     snew(erg->slab_torque_v, nslabs);
     snew(erg->slab_data, nslabs);
-    snew(erg->gn_atom, nslabs);
-    snew(erg->gn_slabind, nslabs);
     snew(erg->slab_innersumvec, nslabs);
     for (int i = 0; i < nslabs; i++)
     {
@@ -3381,6 +3576,7 @@ static void allocate_slabs(gmx_enfrotgrp* erg, FILE* fplog, gmx_bool bVerbose)
     }
     snew(erg->xc_ref_sorted, erg->rotg->nat);
     snew(erg->xc_sortind, erg->rotg->nat);
+    erg->xc_proj.resize(erg->rotg->nat);
     snew(erg->firstatom, nslabs);
     snew(erg->lastatom, nslabs);
 }
@@ -41,12 +41,23 @@
  * This file implements the \p distance, \p mindistance and \p within
  * selection methods.
  *
+ * With a \p skin, \p within keeps for each evaluated position a list of
+ * the reference positions within the cutoff plus the skin, and reuses it
+ * over frames until the positions have moved too much, in the same
+ * spirit as the Verlet buffer in mdrun.
+ *
  * \author Teemu Murtola <teemu.murtola@gmail.com>
  * \ingroup module_selection
  */
 #include "gmxpre.h"
 
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/exceptions.h"
@@ -65,7 +76,27 @@
  */
 struct t_methoddata_distance
 {
-    t_methoddata_distance() : cutoff(-1.0) {}
+    /*! \internal
+     * \brief
+     * Reference positions close to one evaluated position of \p within.
+     */
+    struct WithinCandidates
+    {
+        /** Value of t_methoddata_distance::generation when built, -1 if never. */
+        int generation = -1;
+        /** Evaluated position when the list was built. */
+        gmx::RVec x = { 0, 0, 0 };
+        /** Value of t_methoddata_distance::refDisplacement when built. */
+        real refDisplacement = 0;
+        /** Indices of reference positions within the cutoff plus the skin. */
+        std::vector<int> refIndices;
+    };
+
+    t_methoddata_distance() :
+        cutoff(-1.0), bSearchInitialized(false), skin(0.0), bPBC(false), generation(-1), refDisplacement(0)
+    {
+        clear_mat(refBox);
+    }
 
     /** Cutoff distance. */
     real cutoff;
@@ -75,6 +106,30 @@ struct t_methoddata_distance
     gmx::AnalysisNeighborhood nb;
     /** Neighborhood search for an invididual frame. */
     gmx::AnalysisNeighborhoodSearch nbsearch;
+    /** Whether \p nbsearch has been initialized for the current frame. */
+    bool bSearchInitialized;
+
+    /** Buffer for reusing the candidate lists of \p within over frames (0 if not used). */
+    real skin;
+    /** Whether PBC are used in the current frame. */
+    bool bPBC;
+    /** PBC information for the current frame (if \p bPBC). */
+    t_pbc pbc;
+    /** Incremented each time all candidate lists become invalid. */
+    int generation;
+    /** Reference positions at the start of the current generation. */
+    std::vector<gmx::RVec> refX;
+    /** First atoms of the reference positions at the start of the current generation. */
+    std::vector<int> refAtoms;
+    /** Box at the start of the current generation. */
+    matrix refBox;
+    /*! \brief
+     * Upper bound for how much the reference positions have moved in the
+     * current generation, including the effect of box changes.
+     */
+    real refDisplacement;
+    /** Candidate lists for \p within, indexed by the first atom of a position. */
+    std::vector<WithinCandidates> candidates;
 };
 
 /*! \brief
@@ -148,6 +203,7 @@ static gmx_ana_selparam_t smparams_mindistance[] = {
 static gmx_ana_selparam_t smparams_within[] = {
     { nullptr, { REAL_VALUE, 1, { nullptr } }, nullptr, 0 },
     { "of", { POS_VALUE, -1, { nullptr } }, nullptr, SPAR_DYNAMIC | SPAR_VARNUM },
+    { "skin", { REAL_VALUE, 1, { nullptr } }, nullptr, SPAR_OPTIONAL },
 };
 
 //! Help title for distance selection methods.
@@ -158,7 +214,7 @@ static const char* const help_distance[] = {
     "",
     "  distance from POS [cutoff REAL]",
     "  mindistance from POS_EXPR [cutoff REAL]",
-    "  within REAL of POS_EXPR",
+    "  within REAL of POS_EXPR [skin REAL]",
     "",
     "[TT]distance[tt] and [TT]mindistance[tt] calculate the distance from the",
     "given position(s), the only difference being in that [TT]distance[tt]",
@@ -170,7 +226,15 @@ static const char* const help_distance[] = {
 
     "For the first two keywords, it is possible to specify a cutoff to speed",
     "up the evaluation: all distances above the specified cutoff are",
-    "returned as equal to the cutoff.",
+    "returned as equal to the cutoff.[PAR]",
+
+    "For [TT]within[tt], it is possible to specify a skin to speed up",
+    "the evaluation over a trajectory: for each position, the positions in",
+    "[TT]POS_EXPR[tt] that are within [TT]REAL[tt] plus the skin are",
+    "remembered, and only these are checked in later frames until the",
+    "positions have moved more than the skin allows.",
+    "The result does not depend on the skin, but a skin that is too small or",
+    "too large is slower than no skin.",
 };
 
 /** Selection method data for the \p distance method. */
@@ -224,18 +288,22 @@ gmx_ana_selmethod_t sm_within = {
     &init_frame_common,
     nullptr,
     &evaluate_within,
-    { "within REAL of POS_EXPR", helptitle_distance, asize(help_distance), help_distance },
+    { "within REAL of POS_EXPR [skin REAL]", helptitle_distance, asize(help_distance), help_distance },
 };
 
-static void* init_data_common(int /* npar */, gmx_ana_selparam_t* param)
+static void* init_data_common(int npar, gmx_ana_selparam_t* param)
 {
     t_methoddata_distance* data = new t_methoddata_distance();
     param[0].val.u.r            = &data->cutoff;
     param[1].val.u.p            = &data->p;
+    if (npar > 2)
+    {
+        param[2].val.u.r = &data->skin;
+    }
     return data;
 }
 
-static void init_common(const gmx_mtop_t* /* top */, int /* npar */, gmx_ana_selparam_t* param, void* data)
+static void init_common(const gmx_mtop_t* /* top */, int npar, gmx_ana_selparam_t* param, void* data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
@@ -243,7 +311,11 @@ static void init_common(const gmx_mtop_t* /* top */, int /* npar */, gmx_ana_sel
     {
         GMX_THROW(gmx::InvalidInputError("Distance cutoff should be > 0"));
     }
-    d->nb.setCutoff(d->cutoff);
+    if (npar > 2 && (param[2].flags & SPAR_SET) && d->skin < 0)
+    {
+        GMX_THROW(gmx::InvalidInputError("Distance skin should be >= 0"));
+    }
+    d->nb.setCutoff(d->cutoff + d->skin);
 }
 
 /*!
@@ -257,13 +329,168 @@ static void free_data_common(void* data)
     delete static_cast<t_methoddata_distance*>(data);
 }
 
+/*! \brief
+ * Returns the first atom of position \p i in \p pos, or -1 if not available.
+ *
+ * This identifies a position across frames, also if the positions are
+ * evaluated for a different subset of atoms in a later frame.
+ */
+static int first_atom_of_position(const gmx_ana_pos_t& pos, int i)
+{
+    const t_blocka& b = pos.m.mapb;
+    if (b.a == nullptr || b.index[i] >= b.index[i + 1])
+    {
+        return -1;
+    }
+    return b.a[b.index[i]];
+}
+
+/*! \brief
+ * Updates the state used to reuse \p within candidate lists for a new frame.
+ *
+ * Computes how much the reference positions have moved since the start of
+ * the current generation of candidate lists, and starts a new generation
+ * (invalidating all lists) if the reference positions have changed identity
+ * or have moved more than half the skin.
+ */
+static void init_frame_skin(const gmx::SelMethodEvalContext& context, t_methoddata_distance* d)
+{
+    d->bPBC = (context.pbc != nullptr);
+    if (d->bPBC)
+    {
+        d->pbc = *context.pbc;
+    }
+    const int refCount = d->p.count();
+    bool      bReset   = (d->generation < 0 || refCount != gmx::ssize(d->refX));
+    for (int i = 0; i < refCount && !bReset; ++i)
+    {
+        bReset = (first_atom_of_position(d->p, i) != d->refAtoms[i]);
+    }
+    if (!bReset)
+    {
+        real maxDisplacement2 = 0;
+        for (int i = 0; i < refCount; ++i)
+        {
+            maxDisplacement2 = std::max(maxDisplacement2, distance2(d->p.x[i], d->refX[i]));
+        }
+        // A change in the box can move the periodic images of the
+        // reference positions by at most the change in the box vectors.
+        real boxChange = 0;
+        if (d->bPBC)
+        {
+            for (int dim = 0; dim < DIM; ++dim)
+            {
+                rvec dbox;
+                rvec_sub(d->pbc.box[dim], d->refBox[dim], dbox);
+                boxChange += norm(dbox);
+            }
+        }
+        d->refDisplacement = std::sqrt(maxDisplacement2) + boxChange;
+        bReset             = (2 * d->refDisplacement >= d->skin);
+    }
+    if (bReset)
+    {
+        ++d->generation;
+        d->refX.resize(refCount);
+        d->refAtoms.resize(refCount);
+        for (int i = 0; i < refCount; ++i)
+        {
+            copy_rvec(d->p.x[i], d->refX[i]);
+            d->refAtoms[i] = first_atom_of_position(d->p, i);
+        }
+        if (d->bPBC)
+        {
+            copy_mat(d->pbc.box, d->refBox);
+        }
+        d->refDisplacement = 0;
+    }
+}
+
 static void init_frame_common(const gmx::SelMethodEvalContext& context, void* data)
 {
     t_methoddata_distance* d = static_cast<t_methoddata_distance*>(data);
 
     d->nbsearch.reset();
+    d->bSearchInitialized = false;
+    if (d->skin > 0)
+    {
+        // With a skin, the search is only initialized if some candidate
+        // list needs to be rebuilt.
+        init_frame_skin(context, d);
+        return;
+    }
     gmx::AnalysisNeighborhoodPositions pos(d->p.x, d->p.count());
-    d->nbsearch = d->nb.initSearch(context.pbc, pos);
+    d->nbsearch           = d->nb.initSearch(context.pbc, pos);
+    d->bSearchInitialized = true;
+}
+
+/*! \brief
+ * Initializes the neighborhood search for the current frame if not yet done.
+ */
+static void init_frame_search(t_methoddata_distance* d)
+{
+    if (!d->bSearchInitialized)
+    {
+        gmx::AnalysisNeighborhoodPositions pos(d->p.x, d->p.count());
+        d->nbsearch           = d->nb.initSearch(d->bPBC ? &d->pbc : nullptr, pos);
+        d->bSearchInitialized = true;
+    }
+}
+
+/*! \brief
+ * Evaluates whether \p x is within the cutoff using its candidate list.
+ *
+ * Rebuilds the candidate list of \p x from a neighborhood search if the
+ * list is missing or no longer guaranteed to contain all reference
+ * positions within the cutoff.
+ */
+static bool is_within_with_skin(t_methoddata_distance* d, const rvec& x, int atom)
+{
+    const real cutoff2 = gmx::square(d->cutoff);
+    if (atom >= gmx::ssize(d->candidates))
+    {
+        d->candidates.resize(atom + 1);
+    }
+    t_methoddata_distance::WithinCandidates& list = d->candidates[atom];
+    // Any reference position not in the list was farther than
+    // cutoff + skin when the list was built, so it is still outside the
+    // cutoff if the total movement since then is below the skin.
+    if (list.generation == d->generation
+        && std::sqrt(distance2(x, list.x)) + d->refDisplacement + list.refDisplacement < d->skin)
+    {
+        for (const int r : list.refIndices)
+        {
+            rvec dx;
+            if (d->bPBC)
+            {
+                pbc_dx(&d->pbc, x, d->p.x[r], dx);
+            }
+            else
+            {
+                rvec_sub(x, d->p.x[r], dx);
+            }
+            if (norm2(dx) <= cutoff2)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    init_frame_search(d);
+    list.generation      = d->generation;
+    list.x               = x;
+    list.refDisplacement = d->refDisplacement;
+    list.refIndices.clear();
+    bool                                bWithin    = false;
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = d->nbsearch.startPairSearch(x);
+    gmx::AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        list.refIndices.push_back(pair.refIndex());
+        bWithin = bWithin || (pair.distance2() <= cutoff2);
+    }
+    return bWithin;
 }
 
 /*!
@@ -304,7 +531,27 @@ static void evaluate_within(const gmx::SelMethodEvalContext& /*context*/,
     out->u.g->isize = 0;
     for (int b = 0; b < pos->count(); ++b)
     {
-        if (d->nbsearch.isWithin(pos->x[b]))
+        bool bWithin = false;
+        if (d->skin > 0)
+        {
+            const int atom = first_atom_of_position(*pos, b);
+            if (atom >= 0)
+            {
+                bWithin = is_within_with_skin(d, pos->x[b], atom);
+            }
+            else
+            {
+                // Without an identity for the position, fall back to a
+                // search within the cutoff.
+                init_frame_search(d);
+                bWithin = (d->nbsearch.minimumDistance(pos->x[b]) <= d->cutoff);
+            }
+        }
+        else
+        {
+            bWithin = d->nbsearch.isWithin(pos->x[b]);
+        }
+        if (bWithin)
         {
             gmx_ana_pos_add_to_group(out->u.g, pos, b);
         }
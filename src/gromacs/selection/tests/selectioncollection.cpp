@@ -44,10 +44,15 @@
 
 #include "gromacs/selection/selectioncollection.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
 #include "gromacs/selection/indexutil.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/topology/topology.h"
@@ -677,6 +682,50 @@ TEST_F(SelectionCollectionTest, CopiedSelectionListsAreHandledSeparately)
 }
 
 
+/********************************************************************
+ * Tests for evaluation over several frames.
+ */
+TEST_F(SelectionCollectionTest, WithinSkinMatchesPlainWithinOverFrames)
+{
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    ASSERT_NO_THROW_GMX(
+            sel_ = sc_.parseFromString("within 1 of resnr 2; within 1 of resnr 2 skin 0.3"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_EQ(2U, sel_.size());
+
+    t_trxframe*                        frame = topManager_.frame();
+    gmx::DefaultRandomEngine           rng(12345);
+    gmx::UniformRealDistribution<real> displacement(-0.05, 0.05);
+    t_pbc                              pbc;
+    for (int step = 0; step < 40; ++step)
+    {
+        for (int i = 0; i < frame->natoms; ++i)
+        {
+            for (int d = 0; d < DIM; ++d)
+            {
+                frame->x[i][d] += displacement(rng);
+            }
+        }
+        // Exercise also the box-change tracking in the second half.
+        const bool bUsePbc = (step >= 20);
+        if (bUsePbc)
+        {
+            for (int d = 0; d < DIM; ++d)
+            {
+                frame->box[d][d] = 5.0 + displacement(rng);
+            }
+            set_pbc(&pbc, PbcType::Xyz, frame->box);
+        }
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame, bUsePbc ? &pbc : nullptr));
+        const gmx::ArrayRef<const int> plain = sel_[0].atomIndices();
+        const gmx::ArrayRef<const int> skin  = sel_[1].atomIndices();
+        EXPECT_EQ(std::vector<int>(plain.begin(), plain.end()),
+                  std::vector<int>(skin.begin(), skin.end()))
+                << "Mismatch at frame " << step;
+    }
+}
+
+
 /********************************************************************
  * Tests for interactive selection input
  */
@@ -131,7 +131,9 @@ const char* enumValuetoString(WallCycleSubCounter enumValue)
 {
     constexpr gmx::EnumerationArray<WallCycleSubCounter, const char*> wallCycleSubCounterNames = {
         "DD redist.",
-        "DD NS grid + sort",
+        "DD NS grid",
+        "DD sort state",
+        "DD atom indices",
         "DD setup comm.",
         "DD make top.",
         "DD make constr.",
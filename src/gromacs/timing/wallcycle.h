@@ -133,6 +133,8 @@ enum class WallCycleSubCounter : int
 {
     DDRedist,
     DDGrid,
+    DDSortState,
+    DDMakeIndices,
     DDSetupComm,
     DDMakeTop,
     DDMakeConstr,
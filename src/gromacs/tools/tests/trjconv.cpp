@@ -49,12 +49,17 @@
 
 #include <string>
 #include <tuple>
+#include <vector>
 
+#include "gromacs/gmxpreprocess/grompp.h"
+#include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
 
 #include "testutils/cmdlinetest.h"
 #include "testutils/simulationdatabase.h"
 #include "testutils/stdiohelper.h"
+#include "testutils/testfilemanager.h"
 #include "testutils/textblockmatchers.h"
 #include "testutils/trajectoryreader.h"
 
@@ -213,6 +218,125 @@ INSTANTIATE_TEST_SUITE_P(Works,
                          ::testing::Combine(::testing::ValuesIn(trajectoryFileNames),
                                             ::testing::Values(-1, 0, 0.3, 1, 999999)),
                          nameOfTrjconvDumpTest);
+
+//! Parameters for comparing the output with one and with multiple threads
+using ThreadsTestParameters = std::tuple<std::vector<const char*>, const char*>;
+
+class TrjconvWithThreads :
+    public gmx::test::CommandLineTestBase,
+    public ::testing::WithParamInterface<ThreadsTestParameters>
+{
+public:
+    //! Prepares a .tpr file for the solvated alanine system
+    std::string createTpr()
+    {
+        std::string tpr = fileManager().getTemporaryFilePath(".tpr");
+        std::string mdp = fileManager().getTemporaryFilePath(".mdp");
+        gmx::TextWriter::writeFileFromString(mdp,
+                                             "cutoff-scheme = verlet\n"
+                                             "rcoulomb      = 0.85\n"
+                                             "rvdw          = 0.85\n"
+                                             "rlist         = 0.85\n");
+
+        CommandLine caller;
+        caller.append("grompp");
+        caller.addOption("-maxwarn", 0);
+        caller.addOption("-f", mdp);
+        caller.addOption("-c", TestFileManager::getInputFilePath("alanine_vsite_solvated.gro"));
+        caller.addOption("-p", TestFileManager::getInputFilePath("alanine_vsite_solvated.top"));
+        caller.addOption("-o", tpr);
+        EXPECT_EQ(0, gmx_grompp(caller.argc(), caller.argv()));
+        return tpr;
+    }
+    //! Runs trjconv with \p numThreads threads and returns the name of the output file
+    std::string runTrjconv(const std::string& tpr, int numThreads)
+    {
+        std::string outputFile =
+                fileManager().getTemporaryFilePath(formatString("nt%d.xtc", numThreads));
+
+        CommandLine caller;
+        caller.append("trjconv");
+        caller.addOption("-s", tpr);
+        caller.addOption("-f", TestFileManager::getInputFilePath("alanine_vsite_solvated.xtc"));
+        caller.addOption("-o", outputFile);
+        caller.addOption("-nt", numThreads);
+        for (const char* option : std::get<0>(GetParam()))
+        {
+            caller.append(option);
+        }
+
+        StdioTestHelper stdioHelper(&fileManager());
+        stdioHelper.redirectStringToStdin(std::get<1>(GetParam()));
+
+        EXPECT_EQ(0, gmx_trjconv(caller.argc(), caller.argv()));
+        return outputFile;
+    }
+};
+
+TEST_P(TrjconvWithThreads, MatchesSingleThreadedOutput)
+{
+    const std::string tpr = createTpr();
+    ASSERT_FALSE(HasFailure());
+
+    const std::string serialFile = runTrjconv(tpr, 1);
+    ASSERT_FALSE(HasFailure());
+    const std::string threadedFile = runTrjconv(tpr, 2);
+    ASSERT_FALSE(HasFailure());
+
+    TrajectoryFrameReader serialReader(serialFile);
+    TrajectoryFrameReader threadedReader(threadedFile);
+    int                   frameIndex = 0;
+    while (serialReader.readNextFrame())
+    {
+        ASSERT_TRUE(threadedReader.readNextFrame())
+                << "Threaded output lacks frame " << frameIndex;
+        TrajectoryFrame serialFrame   = serialReader.frame();
+        TrajectoryFrame threadedFrame = threadedReader.frame();
+        EXPECT_EQ(serialFrame.step(), threadedFrame.step()) << "in frame " << frameIndex;
+        EXPECT_EQ(serialFrame.time(), threadedFrame.time()) << "in frame " << frameIndex;
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                EXPECT_EQ(serialFrame.box()[d][e], threadedFrame.box()[d][e])
+                        << "in frame " << frameIndex;
+            }
+        }
+        ASSERT_EQ(serialFrame.x().size(), threadedFrame.x().size()) << "in frame " << frameIndex;
+        for (size_t i = 0; i < serialFrame.x().size(); i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_EQ(serialFrame.x()[i][d], threadedFrame.x()[i][d])
+                        << "for atom " << i << " in frame " << frameIndex;
+            }
+        }
+        frameIndex++;
+    }
+    EXPECT_FALSE(threadedReader.readNextFrame()) << "Threaded output has extra frames";
+    EXPECT_GT(frameIndex, 0) << "Some frames should be written";
+}
+
+//! Option sets that are processed in the pipeline, with the group selections they need
+const ThreadsTestParameters threadsTestParameters[] = {
+    { { "-pbc", "mol", "-center" }, "Protein\nSystem\n" },
+    { { "-fit", "rot+trans" }, "Protein\nSystem\n" },
+};
+
+//! Help GoogleTest name our test cases
+std::string nameOfTrjconvWithThreadsTest(const testing::TestParamInfo<ThreadsTestParameters>& info)
+{
+    std::string testName = joinStrings(std::get<0>(info.param), "_");
+
+    testName = replaceAll(testName, "-", "");
+    testName = replaceAll(testName, "+", "_");
+    return testName;
+}
+
+INSTANTIATE_TEST_SUITE_P(Works,
+                         TrjconvWithThreads,
+                         ::testing::ValuesIn(threadsTestParameters),
+                         nameOfTrjconvWithThreadsTest);
 } // namespace
 } // namespace test
 } // namespace gmx
@@ -151,6 +151,30 @@ static void scan_trj_files(gmx::ArrayRef<const std::string> files,
     fprintf(stderr, "\n");
 }
 
+/*! \brief Reads the next frame of an xtc file without decompressing the coordinates
+ *
+ * Sets the step, time and number of atoms of \p fr from the frame header.
+ * Returns whether a frame was read.
+ */
+static bool read_next_raw_frame(t_fileio* fio, XtcRawFrame* rawFrame, t_trxframe* fr)
+{
+    gmx_bool bOK;
+    if (!read_next_xtc_raw(fio, rawFrame, &bOK))
+    {
+        if (!bOK)
+        {
+            fprintf(stderr, "\nWARNING: Incomplete frame after time %g\n", fr->time);
+        }
+        return false;
+    }
+    fr->natoms = rawFrame->natoms;
+    fr->step   = rawFrame->step;
+    fr->time   = rawFrame->time;
+    fr->bStep  = TRUE;
+    fr->bTime  = TRUE;
+    return true;
+}
+
 static void sort_files(gmx::ArrayRef<std::string> files, real* settime)
 {
     for (gmx::index i = 0; i < files.ssize(); i++)
@@ -437,6 +461,10 @@ int gmx_trjcat(int argc, char* argv[])
         "such that a command like [TT]gmx trjcat -f *.trr -o fixed.trr[tt] should do ",
         "the trick. Using [TT]-cat[tt], you can simply paste several files ",
         "together without removal of frames with identical time stamps.[PAR]",
+        "When both the input and output files are [REF].xtc[ref] files and no index",
+        "group is selected, the compressed frames are copied without decompressing",
+        "and recompressing the coordinates, which makes concatenating many parts",
+        "much faster.[PAR]",
         "One important option is inferred when the output file is amongst the",
         "input files. In that case that particular file will be appended to",
         "which implies you do not need to store double the amount of data.",
@@ -662,6 +690,13 @@ int gmx_trjcat(int argc, char* argv[])
                       out_file);
         }
 
+        /* Without an index group, xtc frames are copied in compressed form,
+         * only the time in the frame header is changed.
+         */
+        const bool  bRawCopy = (!bIndex && ftpin == efXTC && ftpout == efXTC);
+        t_fileio*   rawIn    = nullptr;
+        XtcRawFrame rawFrame;
+
         /* Not checking input format, could be dangerous :-) */
         /* Not checking output format, equally dangerous :-) */
 
@@ -844,7 +879,19 @@ int gmx_trjcat(int argc, char* argv[])
             {
                 timestep = timest[i];
             }
-            read_first_frame(oenv, &status, inFilesEdited[i].c_str(), &fr, FLAGS);
+            if (bRawCopy)
+            {
+                clear_trxframe(&fr, TRUE);
+                rawIn = open_xtc(inFilesEdited[i].c_str(), "r");
+                if (!read_next_raw_frame(rawIn, &rawFrame, &fr))
+                {
+                    gmx_fatal(FARGS, "Couldn't read frame from file %s", inFilesEdited[i].c_str());
+                }
+            }
+            else
+            {
+                read_first_frame(oenv, &status, inFilesEdited[i].c_str(), &fr, FLAGS);
+            }
             if (!fr.bTime)
             {
                 fr.time = 0;
@@ -932,7 +979,15 @@ int gmx_trjcat(int argc, char* argv[])
                             bNewFile = FALSE;
                         }
 
-                        if (bIndex)
+                        if (bRawCopy)
+                        {
+                            rawFrame.time = frout.time;
+                            if (!write_xtc_raw(trx_get_fileio(trxout), rawFrame))
+                            {
+                                gmx_fatal(FARGS, "Error writing frame to %s", out_file);
+                            }
+                        }
+                        else if (bIndex)
                         {
                             write_trxframe_indexed(trxout, &frout, isize, index, nullptr);
                         }
@@ -951,9 +1006,17 @@ int gmx_trjcat(int argc, char* argv[])
                         }
                     }
                 }
-            } while (read_next_frame(oenv, status, &fr));
+            } while (bRawCopy ? read_next_raw_frame(rawIn, &rawFrame, &fr)
+                              : read_next_frame(oenv, status, &fr));
 
-            close_trx(status);
+            if (bRawCopy)
+            {
+                close_xtc(rawIn);
+            }
+            else
+            {
+                close_trx(status);
+            }
         }
         if (trxout)
         {
@@ -39,12 +39,17 @@
 
 #include "trjconv.h"
 
+#include "config.h"
+
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
 
 #include <algorithm>
+#include <array>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -71,8 +76,10 @@
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 static void mk_filenm(char* base, const char* ext, int ndigit, int file_nr, char out_file[])
@@ -311,6 +318,501 @@ static void swapFrames(t_trxframe* a, t_trxframe* b)
     std::swap(a->index, b->index);
 }
 
+/*! \brief Settings for the coordinate transformations of frames for output
+ *
+ * These transformations only depend on the frame itself and on fixed
+ * reference data, so different frames can be transformed independently.
+ */
+struct FrameTransformSettings
+{
+    //! Whether to set the diagonal box elements to \p newBox
+    bool setBox = false;
+    //! The new box diagonal, negative elements are not changed
+    const real* newBox = nullptr;
+    //! Whether to translate all atoms by \p translation
+    bool translate = false;
+    //! The translation vector
+    const real* translation = nullptr;
+    //! Whether the frames were already fitted while reading (progressive fit)
+    bool progressiveFit = false;
+    //! Whether to make molecules whole
+    bool removePbc = false;
+    //! Whether to put the center of mass of the fit group at the origin
+    bool reset = false;
+    //! Whether to do a least-squares fit to \p referenceX
+    bool fit = false;
+    //! The number of dimensions to reset and fit in
+    int numFitDimensions = 0;
+    //! The number of atoms in the fit group
+    int numFitAtoms = 0;
+    //! The indices of the atoms in the fit group
+    const int* fitIndex = nullptr;
+    //! The mass weights for resetting and fitting
+    real* fitWeights = nullptr;
+    //! The reference coordinates for fitting
+    const rvec* referenceX = nullptr;
+    //! The shift to apply after resetting, when not centering
+    const real* resetShift = nullptr;
+    //! Whether to center the atoms in \p centerIndex
+    bool center = false;
+    //! The type of box center
+    int boxCenterType = 0;
+    //! The number of atoms to center
+    int numCenterAtoms = 0;
+    //! The indices of the atoms to center
+    const int* centerIndex = nullptr;
+    //! Whether to put all atoms in the box
+    bool putAtomsInBox = false;
+    //! Whether to put the center of mass of residues in the box
+    bool putResiduesInBox = false;
+    //! Whether to put the center of mass of molecules in the box
+    bool putMoleculesInBox = false;
+    //! The unit-cell representation
+    int unitCellType = 0;
+    //! The type of PBC
+    PbcType pbcType = PbcType::Unset;
+    //! The atoms in the system, used for their masses and residue indices
+    t_atoms* atoms = nullptr;
+    //! The molecules in the system
+    t_block* molecules = nullptr;
+    //! The number of atoms in the system
+    int numAtoms = 0;
+};
+
+//! Set the box and translate the atoms of \c fr as requested
+static void setBoxAndTranslate(const FrameTransformSettings& settings, t_trxframe* fr)
+{
+    if (settings.setBox)
+    {
+        /* generate new box */
+        if (!fr->bBox)
+        {
+            clear_mat(fr->box);
+        }
+        for (int m = 0; m < DIM; m++)
+        {
+            if (settings.newBox[m] >= 0)
+            {
+                fr->box[m][m] = settings.newBox[m];
+            }
+            else
+            {
+                if (!fr->bBox)
+                {
+                    gmx_fatal(FARGS, "Cannot preserve a box that does not exist.\n");
+                }
+            }
+        }
+    }
+
+    if (settings.translate)
+    {
+        for (int i = 0; i < settings.numAtoms; i++)
+        {
+            rvec_inc(fr->x[i], settings.translation);
+        }
+    }
+}
+
+/*! \brief Apply the PBC treatment, fitting and centering for output to \c fr
+ *
+ * \p gpbc can only be used by one thread at a time.
+ */
+static void transformFrameForOutput(const FrameTransformSettings& settings,
+                                    gmx_rmpbc_t                   gpbc,
+                                    t_trxframe*                   fr)
+{
+    if (!settings.progressiveFit)
+    {
+        /* Now modify the coords according to the flags,
+           for PFit we did this already! */
+
+        if (settings.removePbc)
+        {
+            gmx_rmpbc_trxfr(gpbc, fr);
+        }
+
+        if (settings.reset)
+        {
+            reset_x_ndim(settings.numFitDimensions,
+                         settings.numFitAtoms,
+                         settings.fitIndex,
+                         settings.numAtoms,
+                         nullptr,
+                         fr->x,
+                         settings.fitWeights);
+            if (settings.fit)
+            {
+                do_fit_ndim(settings.numFitDimensions,
+                            settings.numAtoms,
+                            settings.fitWeights,
+                            settings.referenceX,
+                            fr->x);
+            }
+            if (!settings.center)
+            {
+                for (int i = 0; i < settings.numAtoms; i++)
+                {
+                    rvec_inc(fr->x[i], settings.resetShift);
+                }
+            }
+        }
+
+        if (settings.center)
+        {
+            center_x(settings.boxCenterType,
+                     fr->x,
+                     fr->box,
+                     settings.numAtoms,
+                     settings.numCenterAtoms,
+                     settings.centerIndex);
+        }
+    }
+
+    auto positionsArrayRef =
+            gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(fr->x), settings.numAtoms);
+    if (settings.putAtomsInBox)
+    {
+        switch (settings.unitCellType)
+        {
+            case euRect: put_atoms_in_box(settings.pbcType, fr->box, positionsArrayRef); break;
+            case euTric:
+                put_atoms_in_triclinic_unitcell(settings.boxCenterType, fr->box, positionsArrayRef);
+                break;
+            case euCompact:
+                put_atoms_in_compact_unitcell(
+                        settings.pbcType, settings.boxCenterType, fr->box, positionsArrayRef);
+                break;
+        }
+    }
+    if (settings.putResiduesInBox)
+    {
+        put_residue_com_in_box(settings.unitCellType,
+                               settings.boxCenterType,
+                               settings.numAtoms,
+                               settings.atoms->atom,
+                               settings.pbcType,
+                               fr->box,
+                               fr->x);
+    }
+    if (settings.putMoleculesInBox)
+    {
+        put_molecule_com_in_box(settings.unitCellType,
+                                settings.boxCenterType,
+                                settings.molecules,
+                                settings.numAtoms,
+                                settings.atoms->atom,
+                                settings.pbcType,
+                                fr->box,
+                                fr->x);
+    }
+}
+
+//! Settings for selecting frames for output by time and for changing their times
+struct FrameTimeSettings
+{
+    //! The first output time
+    real tzero = 0;
+    //! Only write frames at multiples of this interval after \p tzero, 0 writes all
+    real deltaT = 0;
+    //! Whether to round times to the nearest picosecond for selection
+    bool round = false;
+    //! Whether to set the times from the frame index and \p timestep
+    bool changeTimestep = false;
+    //! The new time step between input frames
+    real timestep = 0;
+    //! Whether to shift the times by \p timeShift
+    bool shiftTime = false;
+    //! The time shift
+    real timeShift = 0;
+};
+
+//! Return the output time of input frame number \c frame with time \c time
+static real outputFrameTime(const FrameTimeSettings& settings, int frame, real time)
+{
+    if (settings.changeTimestep)
+    {
+        return settings.tzero + frame * settings.timestep;
+    }
+    else if (settings.shiftTime)
+    {
+        return time + settings.timeShift;
+    }
+    return time;
+}
+
+//! Return whether a frame with output time \c time should be written
+static bool isOutputTime(const FrameTimeSettings& settings, real time)
+{
+    if (settings.deltaT == 0)
+    {
+        return true;
+    }
+    if (!settings.round)
+    {
+        return bRmod(time, settings.tzero, settings.deltaT);
+    }
+    /* round() is not C89 compatible, so we do this:  */
+    return bRmod(std::floor(time + 0.5),
+                 std::floor(settings.tzero + 0.5),
+                 std::floor(settings.deltaT + 0.5));
+}
+
+//! Settings for setting up output frames from transformed input frames
+struct OutputFrameSettings
+{
+    //! Whether to write velocities
+    bool writeVelocities = false;
+    //! Whether to write forces
+    bool writeForces = false;
+    //! The number of output atoms
+    int numAtoms = 0;
+    //! Whether the output format needs a precision
+    bool needPrecision = false;
+    //! Whether to use \p precision also when the input has a precision
+    bool overridePrecision = false;
+    //! The precision to use for output
+    real precision = 0;
+    //! Whether the output atoms need to be copied
+    bool copyAtoms = false;
+    //! The indices of the output atoms
+    const int* index = nullptr;
+    //! Output coordinate buffer, used when copying atoms
+    rvec* x = nullptr;
+    //! Output velocity buffer, used when copying atoms
+    rvec* v = nullptr;
+    //! Output force buffer, used when copying atoms
+    rvec* f = nullptr;
+};
+
+/*! \brief Set up \c frout for writing the atoms of \c fr at time \c time
+ *
+ * The other frame data is taken from \c header.
+ */
+static void setupOutputFrame(const OutputFrameSettings& settings,
+                             const t_trxframe&          header,
+                             const t_trxframe&          fr,
+                             real                       time,
+                             t_trxframe*                frout)
+{
+    /* Copy the input trxframe struct to the output trxframe struct */
+    *frout        = header;
+    frout->time   = time;
+    frout->bV     = (frout->bV && settings.writeVelocities);
+    frout->bF     = (frout->bF && settings.writeForces);
+    frout->natoms = settings.numAtoms;
+    if (settings.needPrecision && (settings.overridePrecision || !fr.bPrec))
+    {
+        frout->bPrec = TRUE;
+        frout->prec  = settings.precision;
+    }
+    if (settings.copyAtoms)
+    {
+        frout->x = settings.x;
+        if (frout->bV)
+        {
+            frout->v = settings.v;
+        }
+        if (frout->bF)
+        {
+            frout->f = settings.f;
+        }
+        for (int i = 0; i < settings.numAtoms; i++)
+        {
+            copy_rvec(fr.x[settings.index[i]], frout->x[i]);
+            if (frout->bV)
+            {
+                copy_rvec(fr.v[settings.index[i]], frout->v[i]);
+            }
+            if (frout->bF)
+            {
+                copy_rvec(fr.f[settings.index[i]], frout->f[i]);
+            }
+        }
+    }
+}
+
+//! A frame in the conversion pipeline along with its output time
+struct PipelineFrame
+{
+    //! The frame
+    t_trxframe frame;
+    //! The time to write the frame with
+    real outputTime;
+};
+
+/*! \brief Convert all frames with a pipeline of a reader, transform threads and a writer
+ *
+ * Frames are processed in batches. While the frames of one batch are
+ * transformed in parallel by \p numThreads OpenMP threads, the next
+ * batch is read and the previous batch is written, in order, by two
+ * other threads. Can only be used for transformations that do not
+ * depend on earlier frames and for output to a single trajectory file.
+ * Progress is only reported by read_next_frame() in the reading thread,
+ * so that progress lines from different threads do not interleave.
+ *
+ * \param[in] oenv                Output environment
+ * \param[in] trxin               The input trajectory, \p firstFrame has been read
+ * \param[in] firstFrame          The first frame of the input
+ * \param[in] frameSkip           Only every \p frameSkip-th frame is written
+ * \param[in] timeSettings        Settings for selecting and setting output times
+ * \param[in] transformSettings   Settings for transforming the frames
+ * \param[in] outputSettings      Settings for setting up the output frames
+ * \param[in] gpbc                Whole molecule handler, used by the first thread
+ * \param[in] idef                The interactions for making molecules whole, only used with
+ *                                \p transformSettings.removePbc
+ * \param[in] outputFileType      The type of the output file
+ * \param[in] trxout              The output trajectory
+ * \param[in] numThreads          The number of threads for transforming frames
+ */
+static void convertFramesInPipeline(const gmx_output_env_t*       oenv,
+                                    t_trxstatus*                  trxin,
+                                    const t_trxframe&             firstFrame,
+                                    int                           frameSkip,
+                                    const FrameTimeSettings&      timeSettings,
+                                    const FrameTransformSettings& transformSettings,
+                                    const OutputFrameSettings&    outputSettings,
+                                    gmx_rmpbc_t                   gpbc,
+                                    const t_idef*                 idef,
+                                    int                           outputFileType,
+                                    t_trxstatus*                  trxout,
+                                    int                           numThreads)
+{
+    /* Each thread needs its own whole molecule handler, as these store the graph shifts */
+    std::vector<gmx_rmpbc_t> threadGpbc(numThreads, gpbc);
+    if (transformSettings.removePbc)
+    {
+        for (int thread = 1; thread < numThreads; thread++)
+        {
+            threadGpbc[thread] =
+                    gmx_rmpbc_init(idef, transformSettings.pbcType, transformSettings.numAtoms);
+        }
+    }
+
+    /* Three batches: one being read, one being transformed and one being written.
+     * A few frames per thread limit the load imbalance at the end of a batch.
+     */
+    const int                                 batchSize = 4 * numThreads;
+    std::array<std::vector<PipelineFrame>, 3> batches;
+    for (auto& batch : batches)
+    {
+        batch.resize(batchSize);
+        for (auto& slot : batch)
+        {
+            clear_trxframe(&slot.frame, true);
+            copyTrxframeDeeply(firstFrame, &slot.frame);
+        }
+    }
+
+    int     frame        = 0;
+    int64_t newstep      = 0;
+    int64_t previousStep = firstFrame.step;
+    bool    haveFrame    = true;
+    /* Reads frames until the batch is full, returns the number of frames for output */
+    auto readBatch = [&](std::vector<PipelineFrame>* batch) {
+        int count = 0;
+        while (count < batchSize && haveFrame)
+        {
+            PipelineFrame& slot = (*batch)[count];
+            if (frame > 0)
+            {
+                slot.frame.step = previousStep;
+                if (!read_next_frame(oenv, trxin, &slot.frame))
+                {
+                    haveFrame = false;
+                    break;
+                }
+            }
+            else
+            {
+                copyTrxframeDeeply(firstFrame, &slot.frame);
+            }
+            if (!slot.frame.bStep)
+            {
+                /* set the step */
+                slot.frame.step = newstep;
+                newstep++;
+            }
+            previousStep    = slot.frame.step;
+            slot.outputTime = outputFrameTime(timeSettings, frame, slot.frame.time);
+            if (frame % frameSkip == 0 && isOutputTime(timeSettings, slot.outputTime))
+            {
+                count++;
+            }
+            frame++;
+        }
+        return count;
+    };
+
+    /* Writes the frames in order */
+    auto writeBatch = [&](const std::vector<PipelineFrame>& batch, int count) {
+        for (int i = 0; i < count; i++)
+        {
+            t_trxframe frout;
+            setupOutputFrame(
+                    outputSettings, batch[i].frame, batch[i].frame, batch[i].outputTime, &frout);
+            if (outputFileType == efTNG)
+            {
+                write_tng_frame(trxout, &frout);
+            }
+            else
+            {
+                write_trxframe(trxout, &frout, nullptr);
+            }
+        }
+    };
+
+    std::vector<PipelineFrame>* readingBatch      = &batches[0];
+    std::vector<PipelineFrame>* transformingBatch = &batches[1];
+    std::vector<PipelineFrame>* writingBatch      = &batches[2];
+    int                         transformCount    = readBatch(transformingBatch);
+    std::future<void>           writing;
+    while (transformCount > 0)
+    {
+        std::future<int> reading = std::async(std::launch::async, readBatch, readingBatch);
+
+#pragma omp parallel for num_threads(numThreads) schedule(dynamic)
+        for (int i = 0; i < transformCount; i++)
+        {
+            try
+            {
+                t_trxframe* fr     = &(*transformingBatch)[i].frame;
+                const int   thread = gmx_omp_get_thread_num();
+                setBoxAndTranslate(transformSettings, fr);
+                transformFrameForOutput(transformSettings, threadGpbc[thread], fr);
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
+        }
+
+        if (writing.valid())
+        {
+            writing.get();
+        }
+        writing = std::async(
+                std::launch::async, writeBatch, std::cref(*transformingBatch), transformCount);
+        transformCount = reading.get();
+
+        std::swap(writingBatch, transformingBatch);
+        std::swap(transformingBatch, readingBatch);
+    }
+    if (writing.valid())
+    {
+        writing.get();
+    }
+
+    for (auto& batch : batches)
+    {
+        for (auto& slot : batch)
+        {
+            done_frame(&slot.frame);
+        }
+    }
+    for (int thread = 1; thread < numThreads && transformSettings.removePbc; thread++)
+    {
+        gmx_rmpbc_done(threadGpbc[thread]);
+    }
+}
+
 int gmx_trjconv(int argc, char* argv[])
 {
     const char* desc[] = {
@@ -451,7 +953,16 @@ int gmx_trjconv(int argc, char* argv[])
         "Option [TT]-drop[tt] reads an [REF].xvg[ref] file with times and values.",
         "When options [TT]-dropunder[tt] and/or [TT]-dropover[tt] are set,",
         "frames with a value below and above the value of the respective options",
-        "will not be written."
+        "will not be written.[PAR]",
+
+        "With [TT]-nt[tt] larger than 1, frames are read, transformed and written",
+        "in a pipeline, where multiple threads transform different frames at",
+        "the same time. The output is identical to that with one thread.",
+        "This is used for [REF].xtc[ref], [REF].trr[ref] and [REF].tng[ref] output",
+        "when the processing of a frame does not depend on earlier frames,",
+        "i.e. not with [TT]-pbc nojump[tt], [TT]-pbc cluster[tt],",
+        "[TT]-fit progressive[tt], [TT]-dump[tt], [TT]-fr[tt], [TT]-drop[tt],",
+        "[TT]-split[tt], [TT]-shift[tt] or [TT]-exec[tt]."
     };
 
     int pbc_enum;
@@ -506,7 +1017,8 @@ int gmx_trjconv(int argc, char* argv[])
     rvec     newbox = { 0, 0, 0 }, shift = { 0, 0, 0 }, trans = { 0, 0, 0 };
     char*    exec_command = nullptr;
     real     dropunder = 0, dropover = 0;
-    gmx_bool bRound = FALSE;
+    gmx_bool bRound     = FALSE;
+    int      numThreads = 1;
 
     t_pargs pa[] = {
         { "-skip", FALSE, etINT, { &skip_nr }, "Only write every nr-th frame" },
@@ -569,7 +1081,10 @@ int gmx_trjconv(int argc, char* argv[])
           { &bCONECT },
           "Add CONECT PDB records when writing [REF].pdb[ref] files. Useful "
           "for visualization of non-standard molecules, e.g. "
-          "coarse grained ones" }
+          "coarse grained ones" },
+#if GMX_OPENMP
+        { "-nt", FALSE, etINT, { &numThreads }, "Number of threads for transforming frames" },
+#endif
     };
 #define NPA asize(pa)
 
@@ -582,7 +1097,7 @@ int gmx_trjconv(int argc, char* argv[])
     rvec *       xmem = nullptr, *vmem = nullptr, *fmem = nullptr;
     rvec *       xp    = nullptr, x_shift, hbox;
     real*        w_rls = nullptr;
-    int          m, i, d, frame, outframe, natoms, nout, ncent, newstep = 0, model_nr;
+    int          m, i, d, frame, outframe, natoms, nout, ncent = 0, newstep = 0, model_nr;
 #define SKIP 10
     t_topology* top     = nullptr;
     gmx_conect  gc      = nullptr;
@@ -593,8 +1108,8 @@ int gmx_trjconv(int argc, char* argv[])
     char*       grpnm = nullptr;
     int *       frindex, nrfri;
     char*       frname;
-    int         ifit;
-    int*        ind_fit;
+    int         ifit    = 0;
+    int*        ind_fit = nullptr;
     char*       gn_fit;
     int         ndrop = 0, ncol, drop0 = 0, drop1 = 0, dropuse = 0;
     double**    dropval;
@@ -769,6 +1284,10 @@ int gmx_trjconv(int argc, char* argv[])
         {
             gmx_fatal(FARGS, "Argument for -skip (%d) needs to be greater or equal to 1.", skip_nr);
         }
+        if (numThreads <= 0)
+        {
+            gmx_fatal(FARGS, "Argument for -nt (%d) needs to be at least 1.", numThreads);
+        }
 
         std::unique_ptr<gmx_mtop_t> mtop = read_mtop_for_tng(top_file, in_file, out_file);
 
@@ -989,6 +1508,10 @@ int gmx_trjconv(int argc, char* argv[])
             }
         }
 
+        FrameTransformSettings transformSettings;
+        FrameTimeSettings      timeSettings;
+        OutputFrameSettings    outputSettings;
+        bool                   usePipeline = false;
         if (bHaveFirstFrame)
         {
             if (bTDump)
@@ -1090,6 +1613,66 @@ int gmx_trjconv(int argc, char* argv[])
                 }
             }
 
+            transformSettings.setBox            = bSetBox;
+            transformSettings.newBox            = newbox;
+            transformSettings.translate         = bTrans;
+            transformSettings.translation       = trans;
+            transformSettings.progressiveFit    = bPFit;
+            transformSettings.removePbc         = bRmPBC;
+            transformSettings.reset             = bReset;
+            transformSettings.fit               = bFit;
+            transformSettings.numFitDimensions  = nfitdim;
+            transformSettings.numFitAtoms       = ifit;
+            transformSettings.fitIndex          = ind_fit;
+            transformSettings.fitWeights        = w_rls;
+            transformSettings.referenceX        = xp;
+            transformSettings.resetShift        = x_shift;
+            transformSettings.center            = bCenter;
+            transformSettings.boxCenterType     = ecenter;
+            transformSettings.numCenterAtoms    = ncent;
+            transformSettings.centerIndex       = cindex;
+            transformSettings.putAtomsInBox     = bPBCcomAtom;
+            transformSettings.putResiduesInBox  = bPBCcomRes;
+            transformSettings.putMoleculesInBox = bPBCcomMol;
+            transformSettings.unitCellType      = unitcell_enum;
+            transformSettings.pbcType           = pbcType;
+            transformSettings.atoms             = atoms;
+            transformSettings.molecules         = bTPS ? &top->mols : nullptr;
+            transformSettings.numAtoms          = natoms;
+
+            timeSettings.tzero          = tzero;
+            timeSettings.deltaT         = delta_t;
+            timeSettings.round          = bRound;
+            timeSettings.changeTimestep = bTimeStep;
+            timeSettings.timestep       = timestep;
+            timeSettings.shiftTime      = bSetTime;
+            timeSettings.timeShift      = tshift;
+
+            outputSettings.writeVelocities   = bVels;
+            outputSettings.writeForces       = bForce;
+            outputSettings.numAtoms          = nout;
+            outputSettings.needPrecision     = bNeedPrec;
+            outputSettings.overridePrecision = bSetXtcPrec;
+            outputSettings.precision         = prec;
+            outputSettings.copyAtoms         = bCopy;
+            outputSettings.index             = index;
+            outputSettings.x                 = xmem;
+            outputSettings.v                 = vmem;
+            outputSettings.f                 = fmem;
+
+            /* The pipeline can only be used when frames can be processed
+             * independently and are written to a single trajectory file */
+            usePipeline =
+                    (numThreads > 1 && (ftp == efXTC || ftp == efTRR || ftp == efTNG) && !bSplit
+                     && !bTDump && frindex == nullptr && !bDropUnder && !bDropOver && !bNoJump
+                     && !bCluster && !bPFit && !bExec && !opt2parg_bSet("-shift", NPA, pa));
+            if (numThreads > 1 && !usePipeline)
+            {
+                fprintf(stderr,
+                        "\nNote: the selected options and output format require processing "
+                        "the frames in order, will use one thread\n");
+            }
+
             /* Start the big loop over frames */
             file_nr  = 0;
             frame    = 0;
@@ -1101,6 +1684,25 @@ int gmx_trjconv(int argc, char* argv[])
             // current frame. This is important for letting -dump work
             // out when it should dump the last frame.
             clear_trxframe(&nextFrame, true);
+            if (usePipeline)
+            {
+                convertFramesInPipeline(oenv,
+                                        trxin,
+                                        fr,
+                                        skip_nr,
+                                        timeSettings,
+                                        transformSettings,
+                                        outputSettings,
+                                        gpbc,
+                                        bRmPBC ? &top->idef : nullptr,
+                                        ftp,
+                                        trxout,
+                                        numThreads);
+            }
+        }
+
+        if (bHaveFirstFrame && !usePipeline)
+        {
             // Copy the current frame to the next frame, just to
             // ensure the internal allocations have been made. The
             // content will be overwritten before it is read.
@@ -1119,37 +1721,7 @@ int gmx_trjconv(int argc, char* argv[])
                 nextFrame.step = fr.step;
                 bHaveNextFrame = read_next_frame(oenv, trxin, &nextFrame);
 
-
-                if (bSetBox)
-                {
-                    /* generate new box */
-                    if (!fr.bBox)
-                    {
-                        clear_mat(fr.box);
-                    }
-                    for (m = 0; m < DIM; m++)
-                    {
-                        if (newbox[m] >= 0)
-                        {
-                            fr.box[m][m] = newbox[m];
-                        }
-                        else
-                        {
-                            if (!fr.bBox)
-                            {
-                                gmx_fatal(FARGS, "Cannot preserve a box that does not exist.\n");
-                            }
-                        }
-                    }
-                }
-
-                if (bTrans)
-                {
-                    for (i = 0; i < natoms; i++)
-                    {
-                        rvec_inc(fr.x[i], trans);
-                    }
-                }
+                setBoxAndTranslate(transformSettings, &fr);
 
                 if (bTDump)
                 {
@@ -1301,19 +1873,8 @@ int gmx_trjconv(int argc, char* argv[])
                      * but since here we don't have the output frame yet,
                      * we introduce a temporary output frame time variable.
                      */
-                    real frout_time;
-
-                    frout_time = bTDump ? frameToDump->time : fr.time;
-
-                    /* calc new time */
-                    if (bTimeStep)
-                    {
-                        frout_time = tzero + frame * timestep;
-                    }
-                    else if (bSetTime)
-                    {
-                        frout_time += tshift;
-                    }
+                    real frout_time = outputFrameTime(
+                            timeSettings, frame, bTDump ? frameToDump->time : fr.time);
 
                     if (bTDump)
                     {
@@ -1324,21 +1885,7 @@ int gmx_trjconv(int argc, char* argv[])
                     }
 
                     /* check for writing at each delta_t */
-                    bDoIt = (delta_t == 0);
-                    if (!bDoIt)
-                    {
-                        if (!bRound)
-                        {
-                            bDoIt = bRmod(frout_time, tzero, delta_t);
-                        }
-                        else
-                        {
-                            /* round() is not C89 compatible, so we do this:  */
-                            bDoIt = bRmod(std::floor(frout_time + 0.5),
-                                          std::floor(tzero + 0.5),
-                                          std::floor(delta_t + 0.5));
-                        }
-                    }
+                    bDoIt = isOutputTime(timeSettings, frout_time);
 
                     if (bDoIt || bTDump)
                     {
@@ -1352,101 +1899,12 @@ int gmx_trjconv(int argc, char* argv[])
                             fflush(stderr);
                         }
 
-                        if (!bPFit)
-                        {
-                            /* Now modify the coords according to the flags,
-                               for PFit we did this already! */
-
-                            if (bRmPBC)
-                            {
-                                gmx_rmpbc_trxfr(gpbc, &fr);
-                            }
-
-                            if (bReset)
-                            {
-                                reset_x_ndim(nfitdim, ifit, ind_fit, natoms, nullptr, fr.x, w_rls);
-                                if (bFit)
-                                {
-                                    do_fit_ndim(nfitdim, natoms, w_rls, xp, fr.x);
-                                }
-                                if (!bCenter)
-                                {
-                                    for (i = 0; i < natoms; i++)
-                                    {
-                                        rvec_inc(fr.x[i], x_shift);
-                                    }
-                                }
-                            }
-
-                            if (bCenter)
-                            {
-                                center_x(ecenter, fr.x, fr.box, natoms, ncent, cindex);
-                            }
-                        }
-
-                        auto positionsArrayRef =
-                                gmx::arrayRefFromArray(reinterpret_cast<gmx::RVec*>(fr.x), natoms);
-                        if (bPBCcomAtom)
-                        {
-                            switch (unitcell_enum)
-                            {
-                                case euRect:
-                                    put_atoms_in_box(pbcType, fr.box, positionsArrayRef);
-                                    break;
-                                case euTric:
-                                    put_atoms_in_triclinic_unitcell(ecenter, fr.box, positionsArrayRef);
-                                    break;
-                                case euCompact:
-                                    put_atoms_in_compact_unitcell(
-                                            pbcType, ecenter, fr.box, positionsArrayRef);
-                                    break;
-                            }
-                        }
-                        if (bPBCcomRes)
-                        {
-                            put_residue_com_in_box(
-                                    unitcell_enum, ecenter, natoms, atoms->atom, pbcType, fr.box, fr.x);
-                        }
-                        if (bPBCcomMol)
-                        {
-                            put_molecule_com_in_box(
-                                    unitcell_enum, ecenter, &top->mols, natoms, atoms->atom, pbcType, fr.box, fr.x);
-                        }
-                        /* Copy the input trxframe struct to the output trxframe struct */
-                        frout        = bTDump ? *frameToDump : fr;
-                        frout.time   = frout_time;
-                        frout.bV     = (frout.bV && bVels);
-                        frout.bF     = (frout.bF && bForce);
-                        frout.natoms = nout;
-                        if (bNeedPrec && (bSetXtcPrec || !fr.bPrec))
-                        {
-                            frout.bPrec = TRUE;
-                            frout.prec  = prec;
-                        }
-                        if (bCopy)
-                        {
-                            frout.x = xmem;
-                            if (frout.bV)
-                            {
-                                frout.v = vmem;
-                            }
-                            if (frout.bF)
-                            {
-                                frout.f = fmem;
-                            }
-                            for (i = 0; i < nout; i++)
-                            {
-                                copy_rvec(fr.x[index[i]], frout.x[i]);
-                                if (frout.bV)
-                                {
-                                    copy_rvec(fr.v[index[i]], frout.v[i]);
-                                }
-                                if (frout.bF)
-                                {
-                                    copy_rvec(fr.f[index[i]], frout.f[i]);
-                                }
-                            }
-                        }
+                        transformFrameForOutput(transformSettings, gpbc, &fr);
+                        setupOutputFrame(outputSettings,
+                                         bTDump ? *frameToDump : fr,
+                                         fr,
+                                         frout_time,
+                                         &frout);
 
                         if (opt2parg_bSet("-shift", NPA, pa))
                         {
@@ -50,6 +50,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <numeric>
 #include <string>
 #include <vector>
 
@@ -73,7 +74,9 @@
 #include "gromacs/trajectoryanalysis/analysismodule.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/stringutil.h"
 
 namespace gmx
@@ -156,11 +159,14 @@ private:
     SelectionList sel_;
 
     /*! \brief
-     * Raw pairwise distance data from which the RDF is computed.
+     * Binned pairwise distance data from which the RDF is computed.
      *
-     * There is a data set for each selection in `sel_`, with a single
-     * column.  Each point set will contain a single pairwise distance
-     * that contributes to the RDF.
+     * There is a data set for each selection in `sel_`, with two
+     * columns.  Each point set contains the center of a histogram bin
+     * and the number of pairwise distances that fell into that bin
+     * in the frame.  The pairs are binned by the threads that found them,
+     * which keeps the serial part of the frame independent of the
+     * number of pairs.
      */
     AnalysisData pairDist_;
     /*! \brief
@@ -179,7 +185,7 @@ private:
      * the averager is normalized by the average number of reference
      * positions (average of the first column of `normFactors_`).
      */
-    AnalysisDataSimpleHistogramModulePointer pairCounts_;
+    AnalysisDataWeightedHistogramModulePointer pairCounts_;
     /*! \brief
      * Average normalization factors.
      */
@@ -197,6 +203,7 @@ private:
     bool          bNormalizationSet_;
     bool          bXY_;
     bool          bExclusions_;
+    int           nthreads_;
 
     // Pre-computed values for faster access during analysis.
     real cut2_;
@@ -208,7 +215,7 @@ private:
 
 Rdf::Rdf() :
     surface_(SurfaceType::None),
-    pairCounts_(new AnalysisDataSimpleHistogramModule()),
+    pairCounts_(new AnalysisDataWeightedHistogramModule()),
     normAve_(new AnalysisDataAverageModule()),
     localTop_(nullptr),
     binwidth_(0.002),
@@ -218,6 +225,7 @@ Rdf::Rdf() :
     bNormalizationSet_(false),
     bXY_(false),
     bExclusions_(false),
+    nthreads_(0),
     cut2_(0.0),
     rmax2_(0.0),
     surfaceGroupCount_(0)
@@ -281,7 +289,12 @@ void Rdf::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
         "the volume of a bin is not easily computable.",
         "",
         "Option [TT]-cn[tt] produces the cumulative number RDF,",
-        "i.e. the average number of particles within a distance r."
+        "i.e. the average number of particles within a distance r.",
+        "",
+        "Each frame is processed in parallel by splitting the positions",
+        "in [TT]-sel[tt] over [TT]-nt[tt] threads (by default, all",
+        "available threads), each of which searches for its own pairs",
+        "and accumulates its own histogram."
     };
 
     settings->setHelpText(desc);
@@ -314,6 +327,8 @@ void Rdf::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* se
             "Shortest distance (nm) to be considered"));
     options->addOption(
             DoubleOption("rmax").store(&rmax_).description("Largest distance (nm) to calculate"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of threads to use within a frame (0 is all available)"));
 
     options->addOption(EnumOption<SurfaceType>("surf")
                                .enumValue(c_surfaceTypeNames)
@@ -350,6 +365,14 @@ void Rdf::optionsFinished(TrajectoryAnalysisSettings* settings)
     {
         cutoff_ = 0.0;
     }
+    if (nthreads_ < 0)
+    {
+        GMX_THROW(InconsistentInputError("-nt should be non-negative"));
+    }
+    if (nthreads_ == 0)
+    {
+        nthreads_ = gmx_omp_get_max_threads();
+    }
 }
 
 void Rdf::initAnalysis(const TrajectoryAnalysisSettings& settings, const TopologyInformation& top)
@@ -357,7 +380,7 @@ void Rdf::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolog
     pairDist_.setDataSetCount(sel_.size());
     for (size_t i = 0; i < sel_.size(); ++i)
     {
-        pairDist_.setColumnCount(i, 1);
+        pairDist_.setColumnCount(i, 2);
     }
     plotSettings_ = settings.plotSettings();
     nb_.setXYMode(bXY_);
@@ -439,6 +462,27 @@ void Rdf::initAfterFirstFrame(const TrajectoryAnalysisSettings& settings, const
 class RdfModuleData : public TrajectoryAnalysisModuleData
 {
 public:
+    /*! \brief
+     * Temporary memory for the part of a frame processed by one thread.
+     */
+    struct ThreadData
+    {
+        /*! \brief
+         * Minimum distance to each surface group.
+         *
+         * One entry for each group (residue/molecule, per -surf) in the
+         * reference selection.
+         * This is needed to support neighborhood searching, which may not
+         * return the reference positions in order: for each position, we need
+         * to search through all the reference positions and update this array
+         * to find the minimum distance to each surface group, and then compute
+         * the RDF from these numbers.
+         */
+        std::vector<real> surfaceDist2;
+        //! Pair counts in each histogram bin for the current data set.
+        std::vector<double> pairCount;
+    };
+
     /*! \brief
      * Reserves memory for the frame-local data.
      *
@@ -447,32 +491,31 @@ public:
     RdfModuleData(TrajectoryAnalysisModule*          module,
                   const AnalysisDataParallelOptions& opt,
                   const SelectionCollection&         selections,
-                  int                                surfaceGroupCount) :
-        TrajectoryAnalysisModuleData(module, opt, selections)
+                  int                                surfaceGroupCount,
+                  int                                binCount,
+                  int                                threadCount) :
+        TrajectoryAnalysisModuleData(module, opt, selections), threadData_(threadCount)
     {
-        surfaceDist2_.resize(surfaceGroupCount);
+        for (ThreadData& threadData : threadData_)
+        {
+            threadData.surfaceDist2.resize(surfaceGroupCount);
+            threadData.pairCount.resize(binCount);
+        }
     }
 
     void finish() override { finishDataHandles(); }
 
-    /*! \brief
-     * Minimum distance to each surface group.
-     *
-     * One entry for each group (residue/molecule, per -surf) in the
-     * reference selection.
-     * This is needed to support neighborhood searching, which may not
-     * return the reference positions in order: for each position, we need
-     * to search through all the reference positions and update this array
-     * to find the minimum distance to each surface group, and then compute
-     * the RDF from these numbers.
-     */
-    std::vector<real> surfaceDist2_;
+    //! Work arrays for each thread processing the frame.
+    std::vector<ThreadData> threadData_;
+    //! Indices 0, 1, ... used to split the selection positions over threads.
+    std::vector<int> positionIndices_;
 };
 
 TrajectoryAnalysisModuleDataPointer Rdf::startFrames(const AnalysisDataParallelOptions& opt,
                                                      const SelectionCollection&         selections)
 {
-    return TrajectoryAnalysisModuleDataPointer(new RdfModuleData(this, opt, selections, surfaceGroupCount_));
+    return TrajectoryAnalysisModuleDataPointer(new RdfModuleData(
+            this, opt, selections, surfaceGroupCount_, pairCounts_->settings().binCount(), nthreads_));
 }
 
 void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAnalysisModuleData* pdata)
@@ -482,7 +525,7 @@ void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAna
     const Selection&     refSel    = pdata->parallelSelection(refSel_);
     const SelectionList& sel       = pdata->parallelSelections(sel_);
     RdfModuleData&       frameData = *static_cast<RdfModuleData*>(pdata);
-    const bool           bSurface  = !frameData.surfaceDist2_.empty();
+    const bool           bSurface  = (surfaceGroupCount_ > 0);
 
     matrix boxForVolume;
     copy_mat(fr.box, boxForVolume);
@@ -527,62 +570,117 @@ void Rdf::analyzeFrame(int frnr, const t_trxframe& fr, t_pbc* pbc, TrajectoryAna
     }
 
     dh.startFrame(frnr, fr.time);
-    AnalysisNeighborhoodSearch nbsearch = nb_.initSearch(pbc, refSel);
+    AnalysisNeighborhoodSearch       nbsearch     = nb_.initSearch(pbc, refSel);
+    const AnalysisHistogramSettings& histSettings = pairCounts_->settings();
+    const int                        threadCount  = ssize(frameData.threadData_);
     for (size_t g = 0; g < sel.size(); ++g)
     {
         dh.selectDataSet(g);
 
-        if (bSurface)
+        const int posCount = sel[g].posCount();
+        if (!bSurface && ssize(frameData.positionIndices_) < posCount)
+        {
+            frameData.positionIndices_.resize(posCount);
+            std::iota(frameData.positionIndices_.begin(), frameData.positionIndices_.end(), 0);
+        }
+        // Each thread processes a contiguous block of the positions in the
+        // selection with its own pair search, and bins the distances into
+        // its own histogram.
+#pragma omp parallel for num_threads(threadCount) schedule(static)
+        for (int thread = 0; thread < threadCount; ++thread)
         {
-            // Special loop for surface calculation, where a separate neighbor
-            // search is done for each position in the selection, and the
-            // nearest position from each surface group is tracked.
-            std::vector<real>& surfaceDist2 = frameData.surfaceDist2_;
-            for (int i = 0; i < sel[g].posCount(); ++i)
+            try
             {
-                std::fill(surfaceDist2.begin(), surfaceDist2.end(), std::numeric_limits<real>::max());
-                AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g].position(i));
-                AnalysisNeighborhoodPair       pair;
-                while (pairSearch.findNextPair(&pair))
+                RdfModuleData::ThreadData& threadData = frameData.threadData_[thread];
+                std::vector<double>&       pairCount  = threadData.pairCount;
+                std::fill(pairCount.begin(), pairCount.end(), 0.0);
+                const int posBegin = (posCount * thread) / threadCount;
+                const int posEnd   = (posCount * (thread + 1)) / threadCount;
+                if (posBegin == posEnd)
                 {
-                    const real r2    = pair.distance2();
-                    const int  refId = refSel.position(pair.refIndex()).mappedId();
-                    if (r2 < surfaceDist2[refId])
+                    continue;
+                }
+                if (bSurface)
+                {
+                    // Special loop for surface calculation, where a separate neighbor
+                    // search is done for each position in the selection, and the
+                    // nearest position from each surface group is tracked.
+                    std::vector<real>& surfaceDist2 = threadData.surfaceDist2;
+                    for (int i = posBegin; i < posEnd; ++i)
                     {
-                        surfaceDist2[refId] = r2;
+                        std::fill(surfaceDist2.begin(), surfaceDist2.end(), std::numeric_limits<real>::max());
+                        AnalysisNeighborhoodPairSearch pairSearch =
+                                nbsearch.startPairSearch(sel[g].position(i));
+                        AnalysisNeighborhoodPair pair;
+                        while (pairSearch.findNextPair(&pair))
+                        {
+                            const real r2    = pair.distance2();
+                            const int  refId = refSel.position(pair.refIndex()).mappedId();
+                            if (r2 < surfaceDist2[refId])
+                            {
+                                surfaceDist2[refId] = r2;
+                            }
+                        }
+                        // Accumulate the RDF from the distances to the surface.
+                        for (size_t i = 0; i < surfaceDist2.size(); ++i)
+                        {
+                            const real r2 = surfaceDist2[i];
+                            // Here, we need to check for rmax, since the value might
+                            // be above the cutoff if no points were close to some
+                            // surface positions.
+                            if (r2 > cut2_ && r2 <= rmax2_)
+                            {
+                                const int bin = histSettings.findBin(std::sqrt(r2));
+                                if (bin != -1)
+                                {
+                                    pairCount[bin] += 1;
+                                }
+                            }
+                        }
                     }
                 }
-                // Accumulate the RDF from the distances to the surface.
-                for (size_t i = 0; i < surfaceDist2.size(); ++i)
+                else
                 {
-                    const real r2 = surfaceDist2[i];
-                    // Here, we need to check for rmax, since the value might
-                    // be above the cutoff if no points were close to some
-                    // surface positions.
-                    if (r2 > cut2_ && r2 <= rmax2_)
+                    // Standard neighborhood search over all pairs within the cutoff
+                    // for the -surf no case.
+                    AnalysisNeighborhoodPositions positions = sel[g];
+                    positions.indexed(constArrayRefFromArray(
+                            frameData.positionIndices_.data() + posBegin, posEnd - posBegin));
+                    AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(positions);
+                    AnalysisNeighborhoodPair       pair;
+                    while (pairSearch.findNextPair(&pair))
                     {
-                        dh.setPoint(0, std::sqrt(r2));
-                        dh.finishPointSet();
+                        const real r2 = pair.distance2();
+                        if (r2 > cut2_)
+                        {
+                            const int bin = histSettings.findBin(std::sqrt(r2));
+                            if (bin != -1)
+                            {
+                                pairCount[bin] += 1;
+                            }
+                        }
                     }
                 }
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
         }
-        else
+        // Reduce the thread-local histograms and pass the non-empty bins on.
+        std::vector<double>& pairCount = frameData.threadData_[0].pairCount;
+        for (int thread = 1; thread < threadCount; ++thread)
         {
-            // Standard neighborhood search over all pairs within the cutoff
-            // for the -surf no case.
-            AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g]);
-            AnalysisNeighborhoodPair       pair;
-            while (pairSearch.findNextPair(&pair))
+            const std::vector<double>& threadPairCount = frameData.threadData_[thread].pairCount;
+            for (size_t bin = 0; bin < pairCount.size(); ++bin)
             {
-                const real r2 = pair.distance2();
-                if (r2 > cut2_)
-                {
-                    // TODO: Consider whether the histogramming could be done with
-                    // less overhead (after first measuring the overhead).
-                    dh.setPoint(0, std::sqrt(r2));
-                    dh.finishPointSet();
-                }
+                pairCount[bin] += threadPairCount[bin];
+            }
+        }
+        for (size_t bin = 0; bin < pairCount.size(); ++bin)
+        {
+            if (pairCount[bin] > 0)
+            {
+                dh.setPoint(0, histSettings.firstEdge() + (bin + 0.5) * histSettings.binWidth());
+                dh.setPoint(1, pairCount[bin]);
+                dh.finishPointSet();
             }
         }
         // Normalization factor for the number density (only used without
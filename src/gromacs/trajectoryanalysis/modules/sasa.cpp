@@ -73,6 +73,7 @@
 #include "gromacs/trajectoryanalysis/topologyinformation.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
@@ -377,6 +378,7 @@ private:
 
     double solsize_;
     int    ndots_;
+    int    nthreads_;
     // double                  minarea_;
     double dgsDefault_;
     bool   bIncludeSolute_;
@@ -401,7 +403,7 @@ private:
 };
 
 Sasa::Sasa() :
-    solsize_(0.14), ndots_(24), dgsDefault_(0), bIncludeSolute_(true), mtop_(nullptr), atoms_(nullptr)
+    solsize_(0.14), ndots_(24), nthreads_(0), dgsDefault_(0), bIncludeSolute_(true), mtop_(nullptr), atoms_(nullptr)
 {
     // minarea_ = 0.5;
     registerAnalysisDataset(&area_, "area");
@@ -495,6 +497,8 @@ void Sasa::initOptions(IOptionsContainer* options, TrajectoryAnalysisSettings* s
             DoubleOption("probe").store(&solsize_).description("Radius of the solvent probe (nm)"));
     options->addOption(IntegerOption("ndots").store(&ndots_).description(
             "Number of dots per sphere, more dots means more accuracy"));
+    options->addOption(IntegerOption("nt").store(&nthreads_).description(
+            "Number of threads to use within a frame (0 is all available)"));
     options->addOption(
             BooleanOption("prot").store(&bIncludeSolute_).description("Output the protein to the Connolly [REF].pdb[ref] file too"));
     options->addOption(
@@ -535,6 +539,14 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
         ndots_ = 20;
         fprintf(stderr, "Ndots too small, setting it to %d\n", ndots_);
     }
+    if (nthreads_ < 0)
+    {
+        GMX_THROW(InconsistentInputError("-nt should be non-negative"));
+    }
+    if (nthreads_ == 0)
+    {
+        nthreads_ = gmx_omp_get_max_threads();
+    }
 
     please_cite(stderr, "Eisenhaber95");
 
@@ -632,6 +644,7 @@ void Sasa::initAnalysis(const TrajectoryAnalysisSettings& settings, const Topolo
 
     calculator_.setDotCount(ndots_);
     calculator_.setRadii(radii_);
+    calculator_.setThreadCount(nthreads_);
 
     // Initialize all the output data objects and initialize the output plotters.
 
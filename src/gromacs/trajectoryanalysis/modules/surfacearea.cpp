@@ -53,12 +53,14 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/nbsearch.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
-using namespace gmx;
-
 #define UNSP_ICO_DOD 9
 #define UNSP_ICO_ARC 10
 
@@ -617,7 +619,7 @@ static std::vector<real> make_unsp(int densit, int cubus)
         GMX_RELEASE_ASSERT(false, "Invalid unit sphere mode");
     }
 
-    const int ndot = ssize(xus) / 3;
+    const int ndot = gmx::ssize(xus) / 3;
 
     /* determine distribution of points in elementary cubes */
     if (cubus)
@@ -705,11 +707,112 @@ static std::vector<real> make_unsp(int densit, int cubus)
     return xus;
 }
 
+/* Only from here on, so that the unit sphere construction above uses
+ * the C math library and not the SIMD scalar math functions in gmx */
+using namespace gmx;
+
+namespace
+{
+
+//! Width of the blocks of surface dots that are tested together.
+#if GMX_SIMD_HAVE_REAL
+constexpr int c_dotBlockSize = GMX_SIMD_REAL_WIDTH;
+#else
+constexpr int c_dotBlockSize = 1;
+#endif
+
+//! Aligned real array for SIMD access.
+typedef std::vector<real, AlignedAllocator<real>> AlignedRealVector;
+
+/*! \internal
+ * \brief
+ * Surface dots of the unit sphere in a layout suitable for SIMD.
+ *
+ * The coordinates are stored separately for x, y and z, padded to a
+ * multiple of the SIMD width.  \p uncovered contains 1 for each real dot
+ * and 0 for each padding dot, and is the initial state of the per-sphere
+ * work array, such that padding dots are never counted.
+ */
+struct UnitSphereDotsSimd
+{
+    //! Initializes the SIMD layout from dots stored as x,y,z triplets.
+    void init(const std::vector<real>& xus)
+    {
+        count                 = ssize(xus) / 3;
+        const int paddedCount = ((count + c_dotBlockSize - 1) / c_dotBlockSize) * c_dotBlockSize;
+        x.assign(paddedCount, 0);
+        y.assign(paddedCount, 0);
+        z.assign(paddedCount, 0);
+        uncovered.assign(paddedCount, 0);
+        for (int l = 0; l < count; ++l)
+        {
+            x[l]         = xus[3 * l];
+            y[l]         = xus[3 * l + 1];
+            z[l]         = xus[3 * l + 2];
+            uncovered[l] = 1;
+        }
+    }
+
+    //! Number of actual dots.
+    int count = 0;
+    //! x coordinates of the dots.
+    AlignedRealVector x;
+    //! y coordinates of the dots.
+    AlignedRealVector y;
+    //! z coordinates of the dots.
+    AlignedRealVector z;
+    //! 1 for a dot, 0 for padding.
+    AlignedRealVector uncovered;
+};
+
+/*! \brief
+ * Marks the dots covered by a neighboring sphere.
+ *
+ * A dot at unit vector u on sphere i is covered by sphere j when
+ * u . dx > \p refdot, where dx is the vector from i to j.
+ * Covered dots are set to zero in \p uncovered.
+ *
+ * \returns The number of dots that remain uncovered.
+ */
+int markCoveredDots(const UnitSphereDotsSimd& dots, const rvec dx, real refdot, real* uncovered)
+{
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal dxS(dx[XX]);
+    const SimdReal dyS(dx[YY]);
+    const SimdReal dzS(dx[ZZ]);
+    const SimdReal refdotS(refdot);
+    SimdReal       countS = setZero();
+    for (size_t l = 0; l < dots.uncovered.size(); l += GMX_SIMD_REAL_WIDTH)
+    {
+        SimdReal proj = dxS * load<SimdReal>(dots.x.data() + l);
+        proj          = fma(dyS, load<SimdReal>(dots.y.data() + l), proj);
+        proj          = fma(dzS, load<SimdReal>(dots.z.data() + l), proj);
+        SimdReal u    = selectByNotMask(load<SimdReal>(uncovered + l), refdotS < proj);
+        store(uncovered + l, u);
+        countS = countS + u;
+    }
+    return static_cast<int>(reduce(countS));
+#else
+    int count = 0;
+    for (int l = 0; l < dots.count; ++l)
+    {
+        if (uncovered[l] != 0 && dx[XX] * dots.x[l] + dx[YY] * dots.y[l] + dx[ZZ] * dots.z[l] > refdot)
+        {
+            uncovered[l] = 0;
+        }
+        count += static_cast<int>(uncovered[l]);
+    }
+    return count;
+#endif
+}
+
+} // namespace
+
 static void nsc_dclm_pbc(const rvec*                 coords,
                          const ArrayRef<const real>& radius,
                          int                         nat,
                          const real*                 xus,
-                         int                         n_dot,
+                         const UnitSphereDotsSimd&   dotsSimd,
                          int                         mode,
                          real*                       value_of_area,
                          real**                      at_area,
@@ -718,8 +821,10 @@ static void nsc_dclm_pbc(const rvec*                 coords,
                          int*                        nu_dots,
                          int                         index[],
                          AnalysisNeighborhood*       nb,
-                         const t_pbc*                pbc)
+                         const t_pbc*                pbc,
+                         int                         threadCount)
 {
+    const int  n_dot   = dotsSimd.count;
     const real dotarea = FOURPI / static_cast<real>(n_dot);
 
     if (debug)
@@ -733,23 +838,6 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     {
         return;
     }
-    real  area = 0.0, vol = 0.0;
-    real *dots = nullptr, *atom_area = nullptr;
-    int   lfnr = 0, maxdots = 0;
-    if (mode & FLAG_VOLUME)
-    {
-        vol = 0.;
-    }
-    if (mode & FLAG_DOTS)
-    {
-        maxdots = (3 * n_dot * nat) / 10;
-        snew(dots, maxdots);
-        lfnr = 0;
-    }
-    if (mode & FLAG_ATOM_AREA)
-    {
-        snew(atom_area, nat);
-    }
 
     // Compute the center of the molecule for volume calculation.
     // In principle, the center should not influence the results, but that is
@@ -774,106 +862,122 @@ static void nsc_dclm_pbc(const rvec*                 coords,
     pos.indexed(constArrayRefFromArray(index, nat));
     AnalysisNeighborhoodSearch nbsearch(nb->initSearch(pbc, pos));
 
-    std::vector<int> wkdot(n_dot);
+    // The spheres are split into contiguous blocks, one for each thread.
+    // Per-sphere results are stored and reduced afterwards in sphere order,
+    // so that the results do not depend on the number of threads.
+    const int                      numThreads = std::max(1, std::min(threadCount, nat));
+    std::vector<real>              sphereArea(nat);
+    std::vector<real>              sphereVolume((mode & FLAG_VOLUME) ? nat : 0);
+    std::vector<std::vector<real>> threadDots((mode & FLAG_DOTS) ? numThreads : 0);
 
-    for (int i = 0; i < nat; ++i)
+#pragma omp parallel for num_threads(numThreads) schedule(static)
+    for (int thread = 0; thread < numThreads; ++thread)
     {
-        const int                      iat  = index[i];
-        const real                     ai   = radius[iat];
-        const real                     aisq = ai * ai;
-        AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
-        AnalysisNeighborhoodPair       pair;
-        std::fill(wkdot.begin(), wkdot.end(), 1);
-        int currDotCount = n_dot;
-        while (currDotCount > 0 && pairSearch.findNextPair(&pair))
+        try
         {
-            const int  jat = index[pair.refIndex()];
-            const real aj  = radius[jat];
-            const real d2  = pair.distance2();
-            if (iat == jat || d2 > gmx::square(ai + aj))
-            {
-                continue;
-            }
-            const rvec& dx     = pair.dx();
-            const real  refdot = (d2 + aisq - aj * aj) / (2 * ai);
-            // TODO: Consider whether micro-optimizations from the old
-            // implementation would be useful, compared to the complexity that
-            // they bring: instead of this direct loop, the neighbors were
-            // stored into a temporary array, the loop order was
-            // reversed (first over dots, then over neighbors), and for each
-            // dot, it was first checked whether the same neighbor that
-            // resulted in marking the previous dot covered would also cover
-            // this dot. This presumably plays together with sorting of the
-            // surface dots (done in make_unsp) to avoid some of the looping.
-            // Alternatively, we could keep a skip list here to avoid
-            // repeatedly looping over dots that have already marked as
-            // covered.
-            for (int j = 0; j < n_dot; ++j)
+            AlignedRealVector wkdot(dotsSimd.uncovered.size());
+            const int         sphereBegin = (nat * thread) / numThreads;
+            const int         sphereEnd   = (nat * (thread + 1)) / numThreads;
+            for (int i = sphereBegin; i < sphereEnd; ++i)
             {
-                if (wkdot[j] && iprod(&xus[3 * j], dx) > refdot)
+                const int                      iat  = index[i];
+                const real                     ai   = radius[iat];
+                const real                     aisq = ai * ai;
+                AnalysisNeighborhoodPairSearch pairSearch(nbsearch.startPairSearch(coords[iat]));
+                AnalysisNeighborhoodPair       pair;
+                std::copy(dotsSimd.uncovered.begin(), dotsSimd.uncovered.end(), wkdot.begin());
+                int currDotCount = n_dot;
+                while (currDotCount > 0 && pairSearch.findNextPair(&pair))
                 {
-                    --currDotCount;
-                    wkdot[j] = 0;
+                    const int  jat = index[pair.refIndex()];
+                    const real aj  = radius[jat];
+                    const real d2  = pair.distance2();
+                    if (iat == jat || d2 > gmx::square(ai + aj))
+                    {
+                        continue;
+                    }
+                    const real refdot = (d2 + aisq - aj * aj) / (2 * ai);
+                    // All dots are tested against each neighbor in SIMD
+                    // blocks; dots that are already covered stay covered.
+                    currDotCount = markCoveredDots(dotsSimd, pair.dx(), refdot, wkdot.data());
                 }
-            }
-        }
 
-        const real a = aisq * dotarea * currDotCount;
-        area         = area + a;
-        if (mode & FLAG_ATOM_AREA)
-        {
-            atom_area[i] = a;
-        }
-        const real xi = coords[iat][XX];
-        const real yi = coords[iat][YY];
-        const real zi = coords[iat][ZZ];
-        if (mode & FLAG_DOTS)
-        {
-            for (int l = 0; l < n_dot; l++)
-            {
-                if (wkdot[l])
+                sphereArea[i]   = aisq * dotarea * currDotCount;
+                const real xi   = coords[iat][XX];
+                const real yi   = coords[iat][YY];
+                const real zi   = coords[iat][ZZ];
+                if (mode & FLAG_DOTS)
                 {
-                    lfnr++;
-                    if (maxdots <= 3 * lfnr + 1)
+                    std::vector<real>& dots = threadDots[thread];
+                    for (int l = 0; l < n_dot; l++)
                     {
-                        maxdots = maxdots + n_dot * 3;
-                        srenew(dots, maxdots);
+                        if (wkdot[l] != 0)
+                        {
+                            dots.push_back(ai * xus[3 * l] + xi);
+                            dots.push_back(ai * xus[1 + 3 * l] + yi);
+                            dots.push_back(ai * xus[2 + 3 * l] + zi);
+                        }
                     }
-                    dots[3 * lfnr - 3] = ai * xus[3 * l] + xi;
-                    dots[3 * lfnr - 2] = ai * xus[1 + 3 * l] + yi;
-                    dots[3 * lfnr - 1] = ai * xus[2 + 3 * l] + zi;
                 }
-            }
-        }
-        if (mode & FLAG_VOLUME)
-        {
-            real dx = 0.0, dy = 0.0, dz = 0.0;
-            for (int l = 0; l < n_dot; l++)
-            {
-                if (wkdot[l])
+                if (mode & FLAG_VOLUME)
                 {
-                    dx = dx + xus[3 * l];
-                    dy = dy + xus[1 + 3 * l];
-                    dz = dz + xus[2 + 3 * l];
+                    real dx = 0.0, dy = 0.0, dz = 0.0;
+                    for (int l = 0; l < n_dot; l++)
+                    {
+                        if (wkdot[l] != 0)
+                        {
+                            dx = dx + xus[3 * l];
+                            dy = dy + xus[1 + 3 * l];
+                            dz = dz + xus[2 + 3 * l];
+                        }
+                    }
+                    sphereVolume[i] = aisq
+                                      * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs)
+                                         + ai * currDotCount);
                 }
             }
-            vol = vol + aisq * (dx * (xi - xs) + dy * (yi - ys) + dz * (zi - zs) + ai * currDotCount);
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR
     }
 
+    real area = 0.0;
+    for (int i = 0; i < nat; ++i)
+    {
+        area = area + sphereArea[i];
+    }
     if (mode & FLAG_VOLUME)
     {
+        real vol = 0.0;
+        for (int i = 0; i < nat; ++i)
+        {
+            vol = vol + sphereVolume[i];
+        }
         *value_of_vol = vol * FOURPI / (3. * n_dot);
     }
     if (mode & FLAG_DOTS)
     {
+        size_t dotValueCount = 0;
+        for (const auto& dots : threadDots)
+        {
+            dotValueCount += dots.size();
+        }
+        real* dots = nullptr;
+        snew(dots, std::max<size_t>(dotValueCount, 3));
+        real* dotsEnd = dots;
+        for (const auto& threadDotValues : threadDots)
+        {
+            dotsEnd = std::copy(threadDotValues.begin(), threadDotValues.end(), dotsEnd);
+        }
         GMX_RELEASE_ASSERT(nu_dots != nullptr, "Must have valid nu_dots pointer");
-        *nu_dots = lfnr;
+        *nu_dots = dotValueCount / 3;
         GMX_RELEASE_ASSERT(lidots != nullptr, "Must have valid lidots pointer");
         *lidots = dots;
     }
     if (mode & FLAG_ATOM_AREA)
     {
+        real* atom_area = nullptr;
+        snew(atom_area, nat);
+        std::copy(sphereArea.begin(), sphereArea.end(), atom_area);
         GMX_RELEASE_ASSERT(at_area != nullptr, "Must have valid at_area pointer");
         *at_area = atom_area;
     }
@@ -891,11 +995,13 @@ namespace gmx
 class SurfaceAreaCalculator::Impl
 {
 public:
-    Impl() : flags_(0) {}
+    Impl() : flags_(0), threadCount_(1) {}
 
     std::vector<real>            unitSphereDots_;
+    UnitSphereDotsSimd           unitSphereDotsSimd_;
     ArrayRef<const real>         radius_;
     int                          flags_;
+    int                          threadCount_;
     mutable AnalysisNeighborhood nb_;
 };
 
@@ -906,6 +1012,7 @@ SurfaceAreaCalculator::~SurfaceAreaCalculator() {}
 void SurfaceAreaCalculator::setDotCount(int dotCount)
 {
     impl_->unitSphereDots_ = make_unsp(dotCount, 4);
+    impl_->unitSphereDotsSimd_.init(impl_->unitSphereDots_);
 }
 
 void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
@@ -918,6 +1025,11 @@ void SurfaceAreaCalculator::setRadii(const ArrayRef<const real>& radius)
     }
 }
 
+void SurfaceAreaCalculator::setThreadCount(int threadCount)
+{
+    impl_->threadCount_ = std::max(threadCount, 1);
+}
+
 void SurfaceAreaCalculator::setCalculateVolume(bool bVolume)
 {
     if (bVolume)
@@ -1003,7 +1115,7 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
                  impl_->radius_,
                  nat,
                  &impl_->unitSphereDots_[0],
-                 impl_->unitSphereDots_.size() / 3,
+                 impl_->unitSphereDotsSimd_,
                  flags,
                  area,
                  at_area,
@@ -1012,7 +1124,8 @@ void SurfaceAreaCalculator::calculate(const rvec*  x,
                  n_dots,
                  index,
                  &impl_->nb_,
-                 pbc);
+                 pbc,
+                 impl_->threadCount_);
 }
 
 } // namespace gmx
@@ -106,6 +106,15 @@ public:
      * Does not throw.
      */
     void setRadii(const ArrayRef<const real>& radius);
+    /*! \brief
+     * Sets the number of OpenMP threads to use in calculate().
+     *
+     * The spheres are divided between the threads; the results do not
+     * depend on the number of threads.  The default is a single thread.
+     *
+     * Does not throw.
+     */
+    void setThreadCount(int threadCount);
 
     /*! \brief
      * Requests calculation of volume.
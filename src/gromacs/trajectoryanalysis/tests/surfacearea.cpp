@@ -57,6 +57,7 @@
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
@@ -72,7 +73,14 @@ class SurfaceAreaTest : public ::testing::Test
 {
 public:
     SurfaceAreaTest() :
-        box_(), rng_(12345), area_(0.0), volume_(0.0), atomArea_(nullptr), dotCount_(0), dots_(nullptr)
+        box_(),
+        rng_(12345),
+        threadCount_(1),
+        area_(0.0),
+        volume_(0.0),
+        atomArea_(nullptr),
+        dotCount_(0),
+        dots_(nullptr)
     {
     }
     ~SurfaceAreaTest() override
@@ -142,6 +150,7 @@ public:
         gmx::SurfaceAreaCalculator calculator;
         calculator.setDotCount(ndots);
         calculator.setRadii(radius_);
+        calculator.setThreadCount(threadCount_);
         calculator.calculate(as_rvec_array(x_.data()),
                              bPBC ? &pbc : nullptr,
                              index_.size(),
@@ -153,9 +162,65 @@ public:
                              &dots_,
                              &dotCount_);
     }
+    void setThreadCount(int threadCount) { threadCount_ = threadCount; }
     real resultArea() const { return area_; }
     real resultVolume() const { return volume_; }
     real atomArea(int index) const { return atomArea_[index]; }
+    int  resultDotCount() const { return dotCount_; }
+    int  sphereCount() const { return index_.size(); }
+    real sphereRadius(int i) const { return radius_[index_[i]]; }
+
+    /*! \brief
+     * Counts the dots of sphere \p i that are not inside any other sphere.
+     *
+     * This tests every dot against every other sphere directly, without PBC
+     * and without neighborhood searching, and is used as a reference.
+     */
+    int countUncoveredDots(int i, const std::vector<gmx::RVec>& unitDots) const
+    {
+        const int iat   = index_[i];
+        int       count = 0;
+        for (const gmx::RVec& u : unitDots)
+        {
+            rvec dot;
+            svmul(radius_[iat], u, dot);
+            rvec_inc(dot, x_[iat]);
+            bool bCovered = false;
+            for (size_t j = 0; j < index_.size() && !bCovered; ++j)
+            {
+                const int jat = index_[j];
+                bCovered = (jat != iat && distance2(dot, x_[jat]) < gmx::square(radius_[jat]));
+            }
+            if (!bCovered)
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    //! Returns the dots that the calculator uses on a unit sphere.
+    static std::vector<gmx::RVec> unitSphereDots(int ndots)
+    {
+        const std::vector<real>    radius = { 1 };
+        std::vector<gmx::RVec>     x      = { { 0, 0, 0 } };
+        std::vector<int>           index  = { 0 };
+        gmx::SurfaceAreaCalculator calculator;
+        calculator.setDotCount(ndots);
+        calculator.setRadii(radius);
+        real  area     = 0;
+        real* dots     = nullptr;
+        int   dotCount = 0;
+        calculator.calculate(
+                as_rvec_array(x.data()), nullptr, 1, index.data(), FLAG_DOTS, &area, nullptr, nullptr, &dots, &dotCount);
+        std::vector<gmx::RVec> result(dotCount);
+        for (int i = 0; i < dotCount; ++i)
+        {
+            result[i] = { dots[3 * i], dots[3 * i + 1], dots[3 * i + 2] };
+        }
+        sfree(dots);
+        return result;
+    }
 
     void checkReference(gmx::test::TestReferenceChecker* checker, const char* id, bool checkDotCoordinates)
     {
@@ -213,6 +278,7 @@ private:
     }
 
     gmx::DefaultRandomEngine rng_;
+    int                      threadCount_;
     std::vector<gmx::RVec>   x_;
     std::vector<real>        radius_;
     std::vector<int>         index_;
@@ -302,6 +368,55 @@ TEST_F(SurfaceAreaTest, Computes100Points)
     checkReference(&checker, "100Points", false);
 }
 
+TEST_F(SurfaceAreaTest, MatchesDirectDotTest)
+{
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    const int ndots = 122;
+    ASSERT_NO_FATAL_FAILURE(calculate(ndots, FLAG_ATOM_AREA, false));
+
+    const std::vector<gmx::RVec> unitDots = unitSphereDots(ndots);
+    const real                   dotArea  = 4 * M_PI / unitDots.size();
+    for (int i = 0; i < sphereCount(); ++i)
+    {
+        const int dotCount = gmx::roundToInt(atomArea(i) / (dotArea * gmx::square(sphereRadius(i))));
+        SCOPED_TRACE(gmx::formatString("Sphere %d", i));
+        // Dots exactly at the intersection of two spheres can be
+        // classified differently by the two tests because of rounding.
+        EXPECT_NEAR(countUncoveredDots(i, unitDots), dotCount, 1);
+    }
+}
+
+TEST_F(SurfaceAreaTest, ResultsDoNotDependOnThreadCount)
+{
+    box_[XX][XX] = 10.0;
+    box_[YY][YY] = 10.0;
+    box_[ZZ][ZZ] = 10.0;
+    generateRandomPositions(100);
+    const int flags = FLAG_VOLUME | FLAG_ATOM_AREA | FLAG_DOTS;
+    ASSERT_NO_FATAL_FAILURE(calculate(24, flags, false));
+    const real        area     = resultArea();
+    const real        volume   = resultVolume();
+    const int         dotCount = resultDotCount();
+    std::vector<real> atomAreas;
+    for (int i = 0; i < sphereCount(); ++i)
+    {
+        atomAreas.push_back(atomArea(i));
+    }
+
+    setThreadCount(4);
+    ASSERT_NO_FATAL_FAILURE(calculate(24, flags, false));
+    EXPECT_EQ(area, resultArea());
+    EXPECT_EQ(volume, resultVolume());
+    EXPECT_EQ(dotCount, resultDotCount());
+    for (int i = 0; i < sphereCount(); ++i)
+    {
+        EXPECT_EQ(atomAreas[i], atomArea(i));
+    }
+}
+
 TEST_F(SurfaceAreaTest, Computes100PointsWithRectangularPBC)
 {
     // TODO: It would be nice to check that this produces the same result as
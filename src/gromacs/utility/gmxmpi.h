@@ -85,6 +85,7 @@ typedef void* MPI_Status;
 typedef void* MPI_Group;
 #        define MPI_COMM_NULL nullptr
 #        define MPI_GROUP_NULL nullptr
+#        define MPI_REQUEST_NULL nullptr
 #        define MPI_COMM_WORLD nullptr
 #    endif
 #endif
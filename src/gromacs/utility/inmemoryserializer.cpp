@@ -45,6 +45,8 @@
 
 #include "config.h"
 
+#include <cstring>
+
 #include <algorithm>
 #include <vector>
 
@@ -99,6 +101,24 @@ T swapEndian(const T& value)
     return endianessSwappedValue.value_;
 }
 
+/*! \brief Copies \p count values of \p ValueSize bytes from \p source to
+ * \p destination while swapping the byte order of each value.
+ *
+ * Written as a plain loop over bytes with compile-time value size, so that
+ * compilers can vectorize it.
+ */
+template<size_t ValueSize>
+void copyAndSwapEndian(const char* source, char* destination, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        for (size_t b = 0; b < ValueSize; b++)
+        {
+            destination[i * ValueSize + b] = source[i * ValueSize + ValueSize - 1 - b];
+        }
+    }
+}
+
 /*! \brief Change the host-dependent endian settings to either Swap or DoNotSwap.
  *
  * \param endianSwapBehavior input swap behavior, might depend on host.
@@ -288,6 +308,33 @@ public:
         std::copy(&buffer_[pos_], &buffer_[pos_ + size], data);
         pos_ += size;
     }
+    template<typename T>
+    void doValueArray(T* values, int elements)
+    {
+        if (elements <= 0)
+        {
+            return;
+        }
+        const size_t numBytes    = elements * sizeof(T);
+        char*        destination = reinterpret_cast<char*>(values);
+        if (endianSwapBehavior_ == EndianSwapBehavior::Swap)
+        {
+            copyAndSwapEndian<sizeof(T)>(&buffer_[pos_], destination, elements);
+        }
+        else
+        {
+            std::memcpy(destination, &buffer_[pos_], numBytes);
+        }
+        pos_ += numBytes;
+    }
+    //! Reads \p elements values of type \p SourceType and converts them to \p T
+    template<typename SourceType, typename T>
+    void doConvertedValueArray(T* values, int elements)
+    {
+        std::vector<SourceType> sourceValues(std::max(elements, 0));
+        doValueArray(sourceValues.data(), elements);
+        std::copy(sourceValues.begin(), sourceValues.end(), values);
+    }
 
     ArrayRef<const char> buffer_;
     bool                 sourceIsDouble_;
@@ -396,4 +443,61 @@ void InMemoryDeserializer::doOpaque(char* data, std::size_t size)
     impl_->doOpaque(data, size);
 }
 
+void InMemoryDeserializer::doIntArray(int* values, int elements)
+{
+    impl_->doValueArray(values, elements);
+}
+
+void InMemoryDeserializer::doInt32Array(int32_t* values, int elements)
+{
+    impl_->doValueArray(values, elements);
+}
+
+void InMemoryDeserializer::doInt64Array(int64_t* values, int elements)
+{
+    impl_->doValueArray(values, elements);
+}
+
+void InMemoryDeserializer::doFloatArray(float* values, int elements)
+{
+    impl_->doValueArray(values, elements);
+}
+
+void InMemoryDeserializer::doDoubleArray(double* values, int elements)
+{
+    impl_->doValueArray(values, elements);
+}
+
+void InMemoryDeserializer::doRealArray(real* values, int elements)
+{
+    if (sourceIsDouble() == (GMX_DOUBLE != 0))
+    {
+        impl_->doValueArray(values, elements);
+    }
+    else if (sourceIsDouble())
+    {
+        impl_->doConvertedValueArray<double>(values, elements);
+    }
+    else
+    {
+        impl_->doConvertedValueArray<float>(values, elements);
+    }
+}
+
+void InMemoryDeserializer::doIvecArray(ivec* values, int elements)
+{
+    if (elements > 0)
+    {
+        impl_->doValueArray(&values[0][0], elements * DIM);
+    }
+}
+
+void InMemoryDeserializer::doRvecArray(rvec* values, int elements)
+{
+    if (elements > 0)
+    {
+        doRealArray(&values[0][0], elements * DIM);
+    }
+}
+
 } // namespace gmx
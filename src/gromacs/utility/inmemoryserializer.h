@@ -126,6 +126,17 @@ public:
     void doRvec(rvec* value) override;
     void doString(std::string* value) override;
     void doOpaque(char* data, std::size_t size) override;
+    //! \brief Deserialize whole arrays at once, swapping bytes in bulk when needed.
+    ///@{
+    void doIntArray(int* values, int elements) override;
+    void doInt32Array(int32_t* values, int elements) override;
+    void doInt64Array(int64_t* values, int elements) override;
+    void doFloatArray(float* values, int elements) override;
+    void doDoubleArray(double* values, int elements) override;
+    void doRealArray(real* values, int elements) override;
+    void doIvecArray(ivec* values, int elements) override;
+    void doRvecArray(rvec* values, int elements) override;
+    ///@}
 
 private:
     class Impl;
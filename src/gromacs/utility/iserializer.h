@@ -99,8 +99,9 @@ public:
             doBool(&(values[i]));
         }
     }
-    // Char, UChar and RVec have vector specializations that can be
-    // used instead of the default looping.
+    // All array types except Bool and UShort can be specialized by
+    // implementations that handle whole arrays more efficiently than
+    // the default looping.
     virtual void doCharArray(char* values, int elements)
     {
         for (int i = 0; i < elements; i++)
@@ -122,49 +123,49 @@ public:
             doUShort(&(values[i]));
         }
     }
-    void doIntArray(int* values, int elements)
+    virtual void doIntArray(int* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doInt(&(values[i]));
         }
     }
-    void doInt32Array(int32_t* values, int elements)
+    virtual void doInt32Array(int32_t* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doInt32(&(values[i]));
         }
     }
-    void doInt64Array(int64_t* values, int elements)
+    virtual void doInt64Array(int64_t* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doInt64(&(values[i]));
         }
     }
-    void doFloatArray(float* values, int elements)
+    virtual void doFloatArray(float* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doFloat(&(values[i]));
         }
     }
-    void doDoubleArray(double* values, int elements)
+    virtual void doDoubleArray(double* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doDouble(&(values[i]));
         }
     }
-    void doRealArray(real* values, int elements)
+    virtual void doRealArray(real* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
             doReal(&(values[i]));
         }
     }
-    void doIvecArray(ivec* values, int elements)
+    virtual void doIvecArray(ivec* values, int elements)
     {
         for (int i = 0; i < elements; i++)
         {
@@ -44,9 +44,13 @@
 
 #include "gromacs/utility/inmemoryserializer.h"
 
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "gromacs/math/vectypes.h"
+
 namespace gmx
 {
 namespace test
@@ -266,6 +270,44 @@ TEST_F(InMemorySerializerTest, SizeIsCorrect)
     EXPECT_EQ(buffer.size(), 56);
 }
 
+TEST_F(InMemorySerializerTest, ArraysRoundtripWithEndianessSwap)
+{
+    InMemorySerializer   serializer(EndianSwapBehavior::Swap);
+    std::vector<int32_t> int32Values = { c_int32Value, c_int32ValueSwapped, -1, 0 };
+    std::vector<int64_t> int64Values = { c_int64Value, c_int64ValueSwapped, -1 };
+    std::vector<float>   floatValues = { 1.5F, -2.25F, c_intAndFloat32.floatValue_ };
+    std::vector<double>  doubleValues = { 1.5, -2.25, c_intAndFloat64.doubleValue_ };
+    std::vector<RVec>    rvecValues   = { { 1, 2, 3 }, { -4, 5, -6 } };
+    serializer.doInt32Array(int32Values.data(), int32Values.size());
+    serializer.doInt64Array(int64Values.data(), int64Values.size());
+    serializer.doFloatArray(floatValues.data(), floatValues.size());
+    serializer.doDoubleArray(doubleValues.data(), doubleValues.size());
+    serializer.doRvecArray(as_rvec_array(rvecValues.data()), rvecValues.size());
+
+    auto buffer = serializer.finishAndGetBuffer();
+
+    InMemoryDeserializer deserializer(buffer, std::is_same_v<real, double>, EndianSwapBehavior::Swap);
+    std::vector<int32_t> int32Result(int32Values.size());
+    std::vector<int64_t> int64Result(int64Values.size());
+    std::vector<float>   floatResult(floatValues.size());
+    std::vector<double>  doubleResult(doubleValues.size());
+    std::vector<RVec>    rvecResult(rvecValues.size());
+    deserializer.doInt32Array(int32Result.data(), int32Result.size());
+    deserializer.doInt64Array(int64Result.data(), int64Result.size());
+    deserializer.doFloatArray(floatResult.data(), floatResult.size());
+    deserializer.doDoubleArray(doubleResult.data(), doubleResult.size());
+    deserializer.doRvecArray(as_rvec_array(rvecResult.data()), rvecResult.size());
+
+    EXPECT_THAT(int32Result, ::testing::Pointwise(::testing::Eq(), int32Values));
+    EXPECT_THAT(int64Result, ::testing::Pointwise(::testing::Eq(), int64Values));
+    EXPECT_THAT(floatResult, ::testing::Pointwise(::testing::Eq(), floatValues));
+    EXPECT_THAT(doubleResult, ::testing::Pointwise(::testing::Eq(), doubleValues));
+    for (size_t i = 0; i < rvecValues.size(); i++)
+    {
+        EXPECT_EQ(rvecValues[i], rvecResult[i]);
+    }
+}
+
 } // namespace
 } // namespace test
 } // namespace gmx
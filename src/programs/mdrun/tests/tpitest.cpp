@@ -43,10 +43,13 @@
  */
 #include "gmxpre.h"
 
+#include <cstdlib>
+
 #include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/textreader.h"
 
 #include "testutils/refdata.h"
+#include "testutils/setenv.h"
 #include "testutils/testasserts.h"
 
 #include "moduletest.h"
@@ -64,11 +67,47 @@ namespace
 class TpiTest : public MdrunTestFixture, public ::testing::WithParamInterface<int>
 {
 public:
+    //! Sets up the mdp file for \p randomSeed
+    void setMdpFile(int randomSeed);
+    //! Runs grompp and mdrun and returns the TPI part of the log file in \p tpiOutputs
+    void runTpi(std::string* tpiOutputs);
     //! Runs the test with the given inputs
     void runTest();
 };
 
-void TpiTest::runTest()
+void TpiTest::setMdpFile(const int randomSeed)
+{
+    const int         nsteps          = 200;
+    const std::string mdpFileContents = formatString(R"(
+        integrator               = tpi
+        ld-seed                  = %d
+        rtpi                     = 0.05
+        nstlog                   = 0
+        nstenergy                = 0
+        cutoff-scheme            = Verlet
+        nstlist                  = 10
+        ns_type                  = grid
+        rlist                    = 0.9
+        coulombtype              = reaction-field
+        rcoulomb                 = 0.9
+        epsilon-r                = 1
+        epsilon-rf               = 0
+        vdw-type                 = cut-off
+        vdw-modifier             = none
+        rvdw                     = 0.9
+        Tcoupl                   = no
+        tc-grps                  = System
+        tau_t                    = 0.5
+        ref_t                    = 298
+        nsteps                   = %d
+    )",
+                                                     randomSeed,
+                                                     nsteps);
+
+    runner_.useStringAsMdpFile(mdpFileContents);
+}
+
+void TpiTest::runTpi(std::string* tpiOutputs)
 {
     runner_.useTopGroAndNdxFromDatabase("spc216_with_methane");
     runner_.ndxFileName_ = "";
@@ -81,8 +120,27 @@ void TpiTest::runTest()
     ASSERT_EQ(0, runner_.callMdrun(commandLine));
 
     const std::string logFileContexts = TextReader::readFileToString(runner_.logFileName_);
-    const std::string tpiOutputs =
-            logFileContexts.substr(logFileContexts.find("Started Test Particle Insertion"));
+    const size_t      tpiStart        = logFileContexts.find("Started Test Particle Insertion");
+    ASSERT_NE(tpiStart, std::string::npos);
+    *tpiOutputs = logFileContexts.substr(tpiStart);
+}
+
+//! Returns the value that follows \p pattern in \p tpiOutputs
+double tpiOutputValue(const std::string& tpiOutputs, const std::string& pattern)
+{
+    const size_t startIndex = tpiOutputs.find(pattern);
+    if (startIndex == std::string::npos)
+    {
+        ADD_FAILURE() << "Did not find '" << pattern << "' in the TPI output";
+        return 0;
+    }
+    return std::stod(tpiOutputs.substr(startIndex + pattern.size()));
+}
+
+void TpiTest::runTest()
+{
+    std::string tpiOutputs;
+    ASSERT_NO_FATAL_FAILURE(runTpi(&tpiOutputs));
 
     TestReferenceData    refData;
     TestReferenceChecker checker(refData.rootChecker());
@@ -97,10 +155,7 @@ void TpiTest::runTest()
         const auto& name              = valueDesc.first;
         const auto& pattern           = valueDesc.second.first;
         const auto& relativeTolerance = valueDesc.second.second;
-        auto        startIndex        = tpiOutputs.find(pattern);
-        ASSERT_NE(startIndex, std::string::npos);
-        startIndex += pattern.size();
-        const double actualValue = std::stod(tpiOutputs.substr(startIndex));
+        const double actualValue       = tpiOutputValue(tpiOutputs, pattern);
         checker.setDefaultTolerance(relativeToleranceAsFloatingPoint(actualValue, relativeTolerance));
         checker.checkDouble(actualValue, name.c_str());
     }
@@ -108,37 +163,31 @@ void TpiTest::runTest()
 
 TEST_P(TpiTest, ReproducesOutput)
 {
-    const int randomSeed = GetParam();
+    setMdpFile(GetParam());
+    runTest();
+}
 
-    const int         nsteps          = 200;
-    const std::string mdpFileContents = formatString(R"(
-        integrator               = tpi
-        ld-seed                  = %d
-        rtpi                     = 0.05
-        nstlog                   = 0
-        nstenergy                = 0
-        cutoff-scheme            = Verlet
-        nstlist                  = 10
-        ns_type                  = grid
-        rlist                    = 0.9
-        coulombtype              = reaction-field
-        rcoulomb                 = 0.9
-        epsilon-r                = 1
-        epsilon-rf               = 0
-        vdw-type                 = cut-off
-        vdw-modifier             = none
-        rvdw                     = 0.9
-        Tcoupl                   = no
-        tc-grps                  = System
-        tau_t                    = 0.5
-        ref_t                    = 298
-        nsteps                   = %d
-    )",
-                                                     randomSeed,
-                                                     nsteps);
+TEST_P(TpiTest, BatchedEnergiesMatchForceRoutines)
+{
+    setMdpFile(GetParam());
 
-    runner_.useStringAsMdpFile(mdpFileContents);
-    runTest();
+    const char* const noBatchVariable = "GMX_TPI_NO_BATCH";
+    ASSERT_EQ(nullptr, std::getenv(noBatchVariable));
+
+    std::string batchedOutputs;
+    ASSERT_NO_FATAL_FAILURE(runTpi(&batchedOutputs));
+    EXPECT_NE(batchedOutputs.find("insertion energies in batches"), std::string::npos);
+
+    std::string forceOutputs;
+    gmxSetenv(noBatchVariable, "1", 1);
+    runTpi(&forceOutputs);
+    gmxUnsetenv(noBatchVariable);
+    ASSERT_FALSE(HasFatalFailure());
+    EXPECT_NE(forceOutputs.find("insertion energies with the force routines"), std::string::npos);
+
+    const double muBatched = tpiOutputValue(batchedOutputs, "<mu> =");
+    const double muForce   = tpiOutputValue(forceOutputs, "<mu> =");
+    EXPECT_DOUBLE_EQ_TOL(muForce, muBatched, relativeToleranceAsFloatingPoint(muForce, 1e-3));
 }
 
 INSTANTIATE_TEST_SUITE_P(Simple, TpiTest, ::testing::Values(1993, 2994));